@@ -0,0 +1,157 @@
+#include "async.hpp"
+#include "bench_helper.hpp"
+#include <benchmark/benchmark.h>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#if defined __linux__
+#include <sys/timerfd.h>
+
+// Coroutine, which signs `cnt` -many messages one after another, either by
+// offloading signing to worker pool ( see `falcon::async_sign` ) or by signing
+// on event loop itself, while yielding to event loop between two signatures.
+// Last coroutine to finish stops event loop.
+template<const size_t N, const bool offload>
+static async::task_t
+sign_many(async::executor_t& exec,
+          const falcon::expanded_key_t<N>& key,
+          const uint8_t* const msg,
+          const size_t mlen,
+          uint8_t* const sig,
+          const size_t cnt,
+          bool& _signed,
+          size_t& pending)
+{
+  co_await exec.schedule();
+
+  for (size_t i = 0; i < cnt; i++) {
+    if constexpr (offload) {
+      _signed &= co_await falcon::async_sign<N>(key, msg, mlen, sig);
+    } else {
+      auto& state = async::signer_state<N>();
+      key.sign(msg, mlen, sig, *state.ws, state.rng);
+      co_await exec.schedule();
+    }
+  }
+
+  if (--pending == 0) {
+    exec.stop();
+  }
+}
+
+// Benchmark responsiveness of an epoll based event loop, while coroutines
+// running on it keep signing messages, using Falcon{512, 1024}. A timerfd,
+// watched by event loop, fires every 1 ms and lateness of each tick ( i.e. time
+// from expiry of timer to its callback being run ) is recorded.
+//
+// When signing is offloaded to worker pool ( see `falcon::async_sign` ), tick
+// lateness should stay flat, while pool workers saturate cores. When signing
+// happens on event loop, ticks are delayed by as long as a signing call takes.
+template<const size_t N, const bool offload>
+void
+falcon_async_sign(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  using sclock = std::chrono::steady_clock;
+
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t per_task = 8;
+  constexpr auto period = std::chrono::milliseconds(1);
+
+  const size_t task_cnt = 2 * async::default_pool().size();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  std::vector<uint8_t> msgs(task_cnt * mlen);
+  std::vector<uint8_t> sigs(task_cnt * siglen);
+  prng::prng_t rng;
+
+  falcon::keygen<N>(pkey.data(), skey.data());
+  rng.read(msgs.data(), msgs.size());
+
+  falcon::expanded_key_t<N> key;
+  bool _signed = key.expand(skey.data());
+
+  async::executor_t exec;
+  sign_engine::histogram_t lateness;
+
+  // arm a periodic timer, recording how late each of its ticks is handled
+  const int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  const auto ns = std::chrono::nanoseconds(period).count();
+
+  itimerspec spec{};
+  spec.it_interval.tv_nsec = ns;
+  spec.it_value.tv_nsec = ns;
+  timerfd_settime(tfd, 0, &spec, nullptr);
+
+  auto next_tick = sclock::now() + period;
+  exec.watch(tfd, [&]() {
+    uint64_t expirations = 0;
+    if (read(tfd, &expirations, sizeof(expirations)) <= 0) {
+      return;
+    }
+
+    const auto late = sclock::now() - next_tick;
+    const auto late_ns = std::chrono::nanoseconds(late).count();
+    lateness.record(static_cast<uint64_t>(std::max<int64_t>(0, late_ns)));
+
+    next_tick += period * expirations;
+  });
+
+  for (auto _ : state) {
+    size_t pending = task_cnt;
+
+    for (size_t i = 0; i < task_cnt; i++) {
+      const auto msg = msgs.data() + i * mlen;
+      const auto sig = sigs.data() + i * siglen;
+
+      sign_many<N, offload>(
+        exec, key, msg, mlen, sig, per_task, _signed, pending);
+    }
+
+    exec.run();
+
+    benchmark::DoNotOptimize(_signed);
+    benchmark::DoNotOptimize(sigs);
+    benchmark::ClobberMemory();
+  }
+
+  exec.unwatch(tfd);
+  close(tfd);
+
+  const auto items = static_cast<int64_t>(state.iterations() * task_cnt);
+  state.SetItemsProcessed(items * static_cast<int64_t>(per_task));
+
+  state.counters["tick_p50_us"] = lateness.percentile(.5) / 1e3;
+  state.counters["tick_p99_us"] = lateness.percentile(.99) / 1e3;
+  state.counters["tick_p999_us"] = lateness.percentile(.999) / 1e3;
+
+  const bool verified =
+    falcon::verify<N>(pkey.data(), msgs.data(), mlen, sigs.data());
+
+  assert(_signed);
+  assert(verified);
+}
+
+BENCHMARK(falcon_async_sign<512, true>)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_async_sign<512, false>)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_async_sign<1024, true>)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_async_sign<1024, false>)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+#endif
@@ -0,0 +1,98 @@
+#include "bench_helper.hpp"
+#include "hashing.hpp"
+#include "prng.hpp"
+#include "signing.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Benchmark hashing of ( salt, message ) pair to a degree N polynomial over Z_q
+template<const size_t N>
+void
+hash_to_point(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  const size_t mlen = state.range();
+  constexpr size_t slen = signing::SALT_LEN;
+
+  std::vector<uint8_t> salt(slen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<ff::ff_t> poly(N);
+  prng::prng_t rng;
+
+  rng.read(salt.data(), salt.size());
+  rng.read(msg.data(), msg.size());
+
+  for (auto _ : state) {
+    hashing::hash_to_point<N>(salt.data(), slen, msg.data(), mlen, poly.data());
+
+    benchmark::DoNotOptimize(salt);
+    benchmark::DoNotOptimize(msg);
+    benchmark::DoNotOptimize(poly);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Benchmark hashing of 4 -many ( salt, message ) pairs to degree N polynomials
+// over Z_q, using 4-way interleaved Keccak. Items processed is reported as
+// number of hashed pairs, so that it can be compared with above benchmark.
+template<const size_t N>
+void
+hash_to_point_x4(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  const size_t mlen = state.range();
+  constexpr size_t slen = signing::SALT_LEN;
+
+  std::vector<uint8_t> salt(4 * slen);
+  std::vector<uint8_t> msg(4 * mlen);
+  std::vector<ff::ff_t> poly(4 * N);
+  prng::prng_t rng;
+
+  rng.read(salt.data(), salt.size());
+  rng.read(msg.data(), msg.size());
+
+  const uint8_t* const salts[]{ salt.data() + 0 * slen,
+                                salt.data() + 1 * slen,
+                                salt.data() + 2 * slen,
+                                salt.data() + 3 * slen };
+  const uint8_t* const msgs[]{ msg.data() + 0 * mlen,
+                               msg.data() + 1 * mlen,
+                               msg.data() + 2 * mlen,
+                               msg.data() + 3 * mlen };
+  const size_t mlens[]{ mlen, mlen, mlen, mlen };
+  ff::ff_t* const polys[]{ poly.data() + 0 * N,
+                           poly.data() + 1 * N,
+                           poly.data() + 2 * N,
+                           poly.data() + 3 * N };
+
+  for (auto _ : state) {
+    hashing::hash_to_point_x4<N>(salts, slen, msgs, mlens, polys);
+
+    benchmark::DoNotOptimize(salt);
+    benchmark::DoNotOptimize(msg);
+    benchmark::DoNotOptimize(poly);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(4 * state.iterations()));
+}
+
+BENCHMARK(hash_to_point<512>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(hash_to_point_x4<512>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(hash_to_point<1024>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(hash_to_point_x4<1024>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
@@ -1,6 +1,15 @@
 #include "bench_helper.hpp"
 #include "falcon.hpp"
+#include "falcon_tree_batch.hpp"
+#include "key_pool.hpp"
+#include "keygen_batch.hpp"
+#include "ntru_solve_rns.hpp"
 #include <benchmark/benchmark.h>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Benchmark Falcon{512, 1024} keypair generation algorithm.
 //
@@ -38,3 +47,578 @@ BENCHMARK(falcon_keygen<512>)
 BENCHMARK(falcon_keygen<1024>)
   ->ComputeStatistics("min", compute_min)
   ->ComputeStatistics("max", compute_max);
+
+// Benchmark generation of a Falcon{512, 1024} keypair, which is both byte
+// encoded ( so that it can be stored ) and expanded ( so that it can be used
+// for signing ), either in one go, using fused key generation pipeline ( see
+// `falcon::expanded_key_t::generate` ), or by generating byte encoded keypair
+// and then decoding and expanding secret key.
+template<const size_t N, const bool fused>
+static void
+falcon_keygen_expanded(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t wslen = keygen::keygen_ws_len<N>();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  falcon::expanded_key_t<N> key;
+  prng::prng_t rng;
+
+  for (auto _ : state) {
+    if constexpr (fused) {
+      key.generate(pkey.data(), skey.data(), { ws, wslen }, rng);
+    } else {
+      falcon::keygen<N>(pkey.data(), skey.data(), rng);
+      key.expand(skey.data());
+    }
+
+    benchmark::DoNotOptimize(key);
+    benchmark::DoNotOptimize(pkey);
+    benchmark::DoNotOptimize(skey);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+  std::free(ws);
+}
+
+BENCHMARK(falcon_keygen_expanded<512, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_expanded<512, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_expanded<1024, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_expanded<1024, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark expansion of 64 byte encoded Falcon{512, 1024} secret keys, either
+// in batches, s.t. keys of a batch are processed in lockstep ( see
+// `falcon::expanded_key_t::expand_batch` ), or one key at a time ( see
+// `falcon::expanded_key_t::expand` ). Compare keys/ second, to see how much
+// faster bulk key import is.
+template<const size_t N, const bool batch>
+static void
+falcon_expand_keys(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t K = falcon_tree_batch::LANES;
+  constexpr size_t count = 64;
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skeys(count * sklen);
+
+  // K distinct keys, repeated, as generating all of them takes a while
+  for (size_t i = 0; i < K; i++) {
+    falcon::keygen<N>(pkey.data(), skeys.data() + i * sklen);
+  }
+  for (size_t i = K; i < count; i++) {
+    const auto src = skeys.data() + (i % K) * sklen;
+    std::copy_n(src, sklen, skeys.data() + i * sklen);
+  }
+
+  std::vector<falcon::expanded_key_t<N>> keys(count);
+  bool ok = true;
+
+  for (auto _ : state) {
+    if constexpr (batch) {
+      ok &= falcon::expanded_key_t<N>::expand_batch(
+        skeys.data(), keys.data(), count);
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        ok &= keys[i].expand(skeys.data() + i * sklen);
+      }
+    }
+
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(keys);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+  assert(ok);
+}
+
+BENCHMARK(falcon_expand_keys<512, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_expand_keys<512, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_expand_keys<1024, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_expand_keys<1024, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark sampling of a polynomial f ( or g ) ∈ Z[x]/(x^N + 1), used in
+// Falcon{512, 1024} key generation, either using table based sampler ( see
+// `ntru_gen::gen_poly` ) or by summing up SamplerZ draws ( see
+// `ntru_gen::gen_poly_samplerz` ).
+template<const size_t N, const bool cdt>
+static void
+falcon_gen_poly(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  int32_t f[N];
+  prng::prng_t prng;
+
+  for (auto _ : state) {
+    if constexpr (cdt) {
+      ntru_gen::gen_poly<log2<N>()>(f, prng);
+    } else {
+      ntru_gen::gen_poly_samplerz<log2<N>()>(f, prng);
+    }
+
+    benchmark::DoNotOptimize(f);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(falcon_gen_poly<512, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_gen_poly<512, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_gen_poly<1024, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_gen_poly<1024, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark batch generation of Falcon{512, 1024} keypairs, on a work-stealing
+// pool of `state.range(0)` -many workers ( see `falcon::keygen_batch` ), where
+// each iteration generates four keys per worker. Compare keys/ second across
+// worker counts, to see how well batch key generation scales with # -of cores.
+template<const size_t N>
+static void
+falcon_keygen_batch(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  const size_t threads = static_cast<size_t>(state.range(0));
+  const size_t count = 4 * threads;
+
+  std::vector<uint8_t> pkeys(count * pklen);
+  std::vector<uint8_t> skeys(count * sklen);
+  work_stealing::pool_t pool{ threads };
+
+  for (auto _ : state) {
+    falcon::keygen_batch<N>(count, pkeys.data(), skeys.data(), pool);
+
+    benchmark::DoNotOptimize(pkeys);
+    benchmark::DoNotOptimize(skeys);
+    benchmark::ClobberMemory();
+  }
+
+  const auto keys = static_cast<int64_t>(state.iterations() * count);
+  state.SetItemsProcessed(keys);
+}
+
+// Worker counts 1, 2, 4 ... up to # -of cores, always including # -of cores
+static void
+worker_counts(benchmark::internal::Benchmark* const b)
+{
+  const int64_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int64_t i = 1; i < cores; i *= 2) {
+    b->Arg(i);
+  }
+  b->Arg(cores);
+}
+
+BENCHMARK(falcon_keygen_batch<512>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_batch<1024>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark latency of generating a single Falcon{512, 1024} keypair, while
+// speculatively trying as many candidates f, g at once, as there are workers
+// in pool ( see `falcon::keygen_speculative` ). Compare it with
+// `falcon_keygen`, to see how much wall-clock time is saved on an idle
+// many-core machine.
+template<const size_t N>
+static void
+falcon_keygen_speculative(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  work_stealing::pool_t pool{ static_cast<size_t>(state.range(0)) };
+
+  for (auto _ : state) {
+    falcon::keygen_speculative<N>(pkey.data(), skey.data(), pool);
+
+    benchmark::DoNotOptimize(pkey);
+    benchmark::DoNotOptimize(skey);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(falcon_keygen_speculative<512>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_speculative<1024>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark latency of generating a single expanded Falcon{512, 1024} keypair
+// ( see `falcon::expanded_key_t::generate` ), in fork-join execution mode, on
+// a pool of `state.range(0)` -many workers, s.t. independent branches of
+// NTRUSolve and ffLDL* run in parallel ( see
+// `work_stealing::fork_join_scope_t` ). Compare it with
+// `falcon_keygen_expanded<N, true>`, to see how much wall-clock time is saved.
+template<const size_t N>
+static void
+falcon_keygen_fork_join(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t wslen = keygen::keygen_ws_len<N>();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  falcon::expanded_key_t<N> key;
+  prng::prng_t rng;
+
+  work_stealing::pool_t pool{ static_cast<size_t>(state.range(0)) };
+  work_stealing::fork_join_scope_t scope(pool);
+
+  for (auto _ : state) {
+    key.generate(pkey.data(), skey.data(), { ws, wslen }, rng);
+
+    benchmark::DoNotOptimize(key);
+    benchmark::DoNotOptimize(pkey);
+    benchmark::DoNotOptimize(skey);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+  std::free(ws);
+}
+
+BENCHMARK(falcon_keygen_fork_join<512>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_keygen_fork_join<1024>)
+  ->Apply(worker_counts)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark latency of acquiring a Falcon{512, 1024} keypair from a key pool (
+// see `key_pool::pool_t` ), which is filled up to its high watermark, before
+// measurement begins. Compare it with `falcon_keygen`, which is what it costs
+// to generate a key on request path.
+template<const size_t N>
+static void
+falcon_key_pool_acquire(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  using sclock = std::chrono::steady_clock;
+
+  const size_t high = static_cast<size_t>(state.max_iterations);
+  key_pool::pool_t<N> pool{ high, high };
+
+  while (pool.depth() < high) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  for (auto _ : state) {
+    const auto t0 = sclock::now();
+    auto key = pool.try_acquire();
+    const auto t1 = sclock::now();
+
+    benchmark::DoNotOptimize(key);
+    benchmark::ClobberMemory();
+
+    state.SetIterationTime(std::chrono::duration<double>(t1 - t0).count());
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["refill_rate"] = pool.refill_rate();
+}
+
+BENCHMARK(falcon_key_pool_acquire<512>)
+  ->Iterations(16)
+  ->UseManualTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_key_pool_acquire<1024>)
+  ->Iterations(16)
+  ->UseManualTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Samples candidate f, g ∈ Z[x]/(x^N + 1), which passes all checks of
+// algorithm 5 of Falcon specification and has a solution to NTRU equation
+template<const size_t N>
+static void
+sample_ntru_candidate(int32_t* const __restrict f, int32_t* const __restrict g)
+{
+  int32_t F[N];
+  int32_t G[N];
+  prng::prng_t prng;
+
+  while (1) {
+    ntru_gen::gen_poly<log2<N>()>(f, prng);
+    ntru_gen::gen_poly<log2<N>()>(g, prng);
+
+    if (!ntru_gen::is_poly_invertible<log2<N>()>(f)) {
+      continue;
+    }
+    if (ntru_gen::gram_schmidt_norm<log2<N>()>(f, g) >
+        ntru_gen::GS_NORM_THRESHOLD) {
+      continue;
+    }
+    if (ntru_rns::ntru_solve<N>(f, g, F, G)) {
+      break;
+    }
+  }
+}
+
+// Benchmark GMP-free NTRUSolve ( see `ntru_rns::ntru_solve` ), which dominates
+// cost of Falcon{512, 1024} key generation, on a fixed candidate f, g.
+template<const size_t N>
+static void
+falcon_ntru_solve_rns(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  int32_t f[N];
+  int32_t g[N];
+  int32_t F[N];
+  int32_t G[N];
+
+  sample_ntru_candidate<N>(f, g);
+
+  for (auto _ : state) {
+    const bool ok = ntru_rns::ntru_solve<N>(f, g, F, G);
+
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(F);
+    benchmark::DoNotOptimize(G);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(falcon_ntru_solve_rns<512>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_ntru_solve_rns<1024>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+#if !defined FALCON_NTRU_SOLVE_RNS
+
+// Same as above, but using GMP backed NTRUSolve ( see `ntru_gen::ntru_solve` ),
+// on same kind of candidate f, g, for comparison.
+//
+// Polynomial multiplication strategy is picked using thresholds ( see
+// `ntru_mul::thresholds_t` ) `state.range(0)` and `state.range(1)`, while time
+// spent in multiplying polynomials of degree 2^i, per NTRUSolve, is reported
+// as counter `mul_us@i`, so that thresholds can be tuned for a machine. Also
+// reports # -of Babai reduction rounds and time spent in reducing at degree
+// 2^i, per NTRUSolve, as counters `rounds@i` and `reduce_us@i`.
+template<const size_t N>
+static void
+falcon_ntru_solve_gmp(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  int32_t f[N];
+  int32_t g[N];
+
+  sample_ntru_candidate<N>(f, g);
+
+  std::array<mpz_class, N> f_;
+  std::array<mpz_class, N> g_;
+
+  for (size_t i = 0; i < N; i++) {
+    f_[i] = mpz_class(f[i]);
+    g_[i] = mpz_class(g[i]);
+  }
+
+  const auto t_ = ntru_mul::thresholds();
+
+  ntru_mul::set_thresholds({ static_cast<size_t>(state.range(0)),
+                             static_cast<size_t>(state.range(1)) });
+  ntru_mul::reset_stats();
+  ntru_gen::reset_reduce_stats();
+
+  for (auto _ : state) {
+    const auto ret = ntru_gen::ntru_solve(f_, g_);
+
+    benchmark::DoNotOptimize(ret);
+    benchmark::ClobberMemory();
+  }
+
+  ntru_mul::set_thresholds(t_);
+
+  const auto solves = static_cast<double>(state.iterations());
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+  const auto& stats = ntru_mul::stats();
+  for (size_t i = 0; i < stats.size(); i++) {
+    uint64_t ns = 0;
+    for (const auto v : stats[i].ns) {
+      ns += v;
+    }
+
+    const auto key = "mul_us@" + std::to_string(i);
+    state.counters[key] = static_cast<double>(ns) / 1e3 / solves;
+  }
+
+  const auto& rstats = ntru_gen::reduce_stats();
+  for (size_t i = 0; i < rstats.size(); i++) {
+    if (rstats[i].calls == 0) {
+      continue;
+    }
+
+    const auto lvl = std::to_string(i);
+    const auto rounds = static_cast<double>(rstats[i].rounds);
+    const auto ns = static_cast<double>(rstats[i].ns);
+
+    state.counters["rounds@" + lvl] = rounds / solves;
+    state.counters["reduce_us@" + lvl] = ns / 1e3 / solves;
+  }
+}
+
+// NTT multiplication thresholds, default ones along with NTT being disabled
+static void
+ntt_thresholds(benchmark::internal::Benchmark* const b)
+{
+  const ntru_mul::thresholds_t t;
+
+  b->ArgNames({ "ntt_min_degree", "ntt_max_bits" });
+  b->Args({ static_cast<int64_t>(t.ntt_min_degree),
+            static_cast<int64_t>(t.ntt_max_bits) });
+  b->Args({ 1l << 20, 0 });
+}
+
+BENCHMARK(falcon_ntru_solve_gmp<512>)
+  ->Apply(ntt_thresholds)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_ntru_solve_gmp<1024>)
+  ->Apply(ntt_thresholds)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+// Benchmark NTRUGen for Falcon{512, 1024}, while counting # -of calls made to
+// system allocator per key ( see `gmp_arena::stats` ), with big integer
+// temporaries of NTRUSolve served from an arena ( when `arena` is set, see
+// `ntru_gen::ntru_gen` ) or each of them going through system allocator.
+template<const size_t N, const bool arena>
+static void
+falcon_ntru_gen_allocs(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  int32_t f[N];
+  int32_t g[N];
+  int32_t F[N];
+  int32_t G[N];
+  prng::prng_t rng;
+
+  gmp_arena::install();
+
+  uint64_t heap_allocs = 0;
+  uint64_t gmp_allocs = 0;
+
+  for (auto _ : state) {
+    const auto s0 = gmp_arena::stats();
+
+    if constexpr (arena) {
+      ntru_gen::ntru_gen<N>(f, g, F, G, rng);
+    } else {
+      while (!ntru_gen::ntru_gen_once<N>(f, g, F, G, rng)) {
+      }
+    }
+
+    const auto s1 = gmp_arena::stats();
+    heap_allocs += s1.heap_allocs - s0.heap_allocs;
+    gmp_allocs += (s1.heap_allocs - s0.heap_allocs) +
+                  (s1.arena_allocs - s0.arena_allocs);
+
+    benchmark::DoNotOptimize(F);
+    benchmark::DoNotOptimize(G);
+    benchmark::ClobberMemory();
+  }
+
+  const auto keys = static_cast<double>(state.iterations());
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  state.counters["heap_allocs/key"] = static_cast<double>(heap_allocs) / keys;
+  state.counters["gmp_allocs/key"] = static_cast<double>(gmp_allocs) / keys;
+}
+
+BENCHMARK(falcon_ntru_gen_allocs<512, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_ntru_gen_allocs<512, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_ntru_gen_allocs<1024, false>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(falcon_ntru_gen_allocs<1024, true>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+#endif
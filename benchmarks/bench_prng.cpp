@@ -0,0 +1,49 @@
+#include "bench_helper.hpp"
+#include "prng.hpp"
+#include "prng_aes_ctr.hpp"
+#include "prng_chacha20.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Benchmark throughput of PRNG, which can be plugged into Falcon's sampler and
+// signer stack, when reading fixed length random bytes from it.
+template<prng::rng RNG>
+static void
+prng_read(benchmark::State& state)
+{
+  const size_t len = state.range();
+
+  std::vector<uint8_t> bytes(len, 0);
+  RNG rng;
+
+  for (auto _ : state) {
+    rng.read(bytes.data(), bytes.size());
+
+    benchmark::DoNotOptimize(bytes);
+    benchmark::DoNotOptimize(rng);
+    benchmark::ClobberMemory();
+  }
+
+  const size_t total_bytes = len * static_cast<size_t>(state.iterations());
+  state.SetBytesProcessed(static_cast<int64_t>(total_bytes));
+}
+
+BENCHMARK(prng_read<prng::prng_t>)
+  ->Arg(1)
+  ->Arg(4096)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+BENCHMARK(prng_read<prng::chacha20_t>)
+  ->Arg(1)
+  ->Arg(4096)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
+#if defined __AES__ && defined __SSE2__
+BENCHMARK(prng_read<prng::aes_ctr_t>)
+  ->Arg(1)
+  ->Arg(4096)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#endif
@@ -0,0 +1,166 @@
+#include "bench_helper.hpp"
+#include "prng_chacha20.hpp"
+#include "samplerz.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+// Benchmark BaseSampler, over 72 -bit uniform random samples, each of them
+// compared against all RCDT entries, without any data dependent branch.
+void
+base_sampler(benchmark::State& state)
+{
+  constexpr size_t cnt = 1024;
+
+  std::vector<uint64_t> u_lo(cnt);
+  std::vector<uint64_t> u_hi(cnt);
+  std::vector<uint32_t> z0(cnt);
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  for (size_t i = 0; i < cnt; i++) {
+    u_lo[i] = gen();
+    u_hi[i] = gen() & 0xfful;
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < cnt; i++) {
+      z0[i] = samplerz::base_sampler(u_lo[i], u_hi[i]);
+    }
+
+    benchmark::DoNotOptimize(u_lo);
+    benchmark::DoNotOptimize(u_hi);
+    benchmark::DoNotOptimize(z0);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(cnt * state.iterations()));
+}
+
+// Benchmark computation of integral approximations of 2^63 * ccs * e^-x, for
+// random x ∈ [0, ln(2)] and ccs ∈ [0, 1], using one of `approx_exp` backends.
+template<const samplerz::exp_backend_t backend>
+void
+approx_exp(benchmark::State& state)
+{
+  constexpr size_t cnt = 1024;
+
+  std::vector<double> x(cnt);
+  std::vector<double> ccs(cnt);
+  std::vector<uint64_t> y(cnt);
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> x_dis(0., samplerz::LN2);
+  std::uniform_real_distribution<double> ccs_dis(0., 1.);
+  for (size_t i = 0; i < cnt; i++) {
+    x[i] = x_dis(gen);
+    ccs[i] = ccs_dis(gen);
+  }
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < cnt; i++) {
+      y[i] = samplerz::approx_exp<backend>(x[i], ccs[i]);
+    }
+
+    benchmark::DoNotOptimize(x);
+    benchmark::DoNotOptimize(ccs);
+    benchmark::DoNotOptimize(y);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(cnt * state.iterations()));
+}
+
+// Benchmark SamplerZ, sampling one integer at a time, from D_{Z, μ, σ'}, for
+// random μ, while σ' is kept fixed.
+//
+// Note, ChaCha20 based PRNG is used, so that cost of producing randomness
+// doesn't dominate.
+void
+samplerz_single(benchmark::State& state)
+{
+  constexpr double σ_min = samplerz::FALCON512_σ_min;
+  constexpr double σ_prime = 1.5;
+  const size_t cnt = state.range();
+
+  std::vector<double> μ(cnt);
+  std::vector<int32_t> z(cnt);
+  prng::chacha20_t rng;
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> dis(-128., 128.);
+  for (size_t i = 0; i < cnt; i++) {
+    μ[i] = dis(gen);
+  }
+
+  const auto leaf = samplerz::compute_leaf(σ_prime, σ_min);
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < cnt; i++) {
+      z[i] = samplerz::samplerz(μ[i], leaf, rng);
+    }
+
+    benchmark::DoNotOptimize(μ);
+    benchmark::DoNotOptimize(z);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(cnt * state.iterations()));
+}
+
+// Benchmark batched SamplerZ, sampling `cnt` -many integers per call, from
+// D_{Z, μ, σ'}, for random μ, while σ' is kept fixed. Note, during ffSampling
+// two samples are requested per call.
+void
+samplerz_batch(benchmark::State& state)
+{
+  constexpr double σ_min = samplerz::FALCON512_σ_min;
+  constexpr double σ_prime = 1.5;
+  const size_t cnt = state.range();
+
+  std::vector<double> μ(cnt);
+  std::vector<int32_t> z(cnt);
+  prng::chacha20_t rng;
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> dis(-128., 128.);
+  for (size_t i = 0; i < cnt; i++) {
+    μ[i] = dis(gen);
+  }
+
+  const auto leaf = samplerz::compute_leaf(σ_prime, σ_min);
+  std::vector<samplerz::leaf_t> leaves(cnt, leaf);
+
+  for (auto _ : state) {
+    samplerz::samplerz_batch(μ.data(), leaves.data(), z.data(), cnt, rng);
+
+    benchmark::DoNotOptimize(μ);
+    benchmark::DoNotOptimize(z);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(cnt * state.iterations()));
+}
+
+BENCHMARK(base_sampler)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(approx_exp<samplerz::exp_backend_t::portable>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#if __SIZEOF_INT128__ == 16
+BENCHMARK(approx_exp<samplerz::exp_backend_t::int128>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#endif
+BENCHMARK(approx_exp<samplerz::exp_backend_t::fpr>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(samplerz_single)
+  ->Arg(2)
+  ->Arg(64)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(samplerz_batch)
+  ->Arg(2)
+  ->Arg(64)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
@@ -1,14 +1,18 @@
 #include "bench_helper.hpp"
 #include "falcon.hpp"
 #include "prng.hpp"
+#include "sign_engine.hpp"
 #include <benchmark/benchmark.h>
 #include <cassert>
+#include <thread>
+#include <vector>
 
 // Benchmark Falcon{512, 1024} message signing algorithm, emulating only single
 // message is signed with secret key.
 //
-// Note, this signing API builds matrix B and falcon tree T, everytime it's
-// asked to sign a message, by decoding Falcon secret key.
+// Note, this signing API decodes Falcon secret key and builds matrix B and
+// falcon tree T, only when it's asked to sign using a secret key, different
+// from last one, used by same thread ( see `falcon::thread_context` ).
 template<const size_t N>
 void
 falcon_sign_single(benchmark::State& state)
@@ -60,7 +64,10 @@ falcon_sign_single(benchmark::State& state)
 // it's asked to sign a message, rather it keeps them loaded in memory. So this
 // benchmark result should be faster compared to above `sign_single` benchmark
 // result.
-template<const size_t N>
+//
+// Any PRNG, satisfying `prng::rng` concept, can be used for sampling salt and
+// feeding ffSampling, which is why this benchmark is parameterized over it.
+template<const size_t N, prng::rng RNG = prng::prng_t>
 void
 falcon_sign_many(benchmark::State& state)
   requires((N == 512) || (N == 1024))
@@ -84,7 +91,7 @@ falcon_sign_many(benchmark::State& state)
   auto h = static_cast<ff::ff_t*>(std::malloc(sizeof(ff::ff_t) * N));
   auto sig = static_cast<uint8_t*>(std::malloc(siglen));
   auto msg = static_cast<uint8_t*>(std::malloc(mlen));
-  prng::prng_t rng;
+  RNG rng;
 
   keygen::keygen<N>(B, T, h, σ, rng);
   rng.read(msg, mlen);
@@ -113,6 +120,172 @@ falcon_sign_many(benchmark::State& state)
   assert(verified);
 }
 
+// Falcon{512, 1024} keypair, shared by all threads of multi-threaded signing
+// benchmark, along with matrix B and falcon tree T, which are only read during
+// signing.
+template<const size_t N>
+struct shared_key_t
+{
+  static constexpr size_t ftlen = (log2<N>() + 1) * (1ul << log2<N>());
+
+  std::vector<fft::cmplx> B = std::vector<fft::cmplx>(2 * 2 * N);
+  std::vector<fft::cmplx> T = std::vector<fft::cmplx>(ftlen);
+  std::vector<ff::ff_t> h = std::vector<ff::ff_t>(N);
+
+  shared_key_t()
+  {
+    constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+    constexpr double σ = σ_values[N == 1024];
+
+    prng::prng_t rng;
+    keygen::keygen<N>(B.data(), T.data(), h.data(), σ, rng);
+  }
+};
+
+// Benchmark Falcon{512, 1024} message signing algorithm, when 1 to N threads
+// are concurrently signing messages, using same matrix B and falcon tree T,
+// while each of them uses PRNG of its own signing context ( see
+// `falcon::thread_context` ). Throughput should scale ~linearly with number
+// of threads, as long as there're enough cores.
+template<const size_t N>
+void
+falcon_sign_threads(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  static const shared_key_t<N> key;
+  auto& rng = falcon::thread_context<N>().rng;
+
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  rng.read(msg.data(), msg.size());
+
+  const auto B = key.B.data();
+  const auto T = key.T.data();
+
+  for (auto _ : state) {
+    falcon::sign<N>(B, T, msg.data(), mlen, sig.data(), rng);
+
+    benchmark::DoNotOptimize(msg);
+    benchmark::DoNotOptimize(sig);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Benchmark Falcon{512, 1024} signing engine ( see `sign_engine::engine_t` ),
+// running one worker per core, by submitting a batch of sign requests, with
+// futures, and waiting for all of them to complete, in each iteration. Median
+// and tail latencies, observed by engine, are reported as counters.
+template<const size_t N>
+void
+falcon_sign_engine(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  const size_t batch = state.range();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  std::vector<uint8_t> msgs(batch * mlen);
+  std::vector<uint8_t> sigs(batch * siglen);
+  std::vector<std::future<bool>> futs(batch);
+  prng::prng_t rng;
+
+  falcon::keygen<N>(pkey.data(), skey.data());
+  rng.read(msgs.data(), msgs.size());
+
+  sign_engine::engine_t<N> engine;
+
+  size_t key_id = 0;
+  bool _signed = engine.add_key(skey.data(), key_id);
+
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; i++) {
+      const auto msg = msgs.data() + i * mlen;
+      const auto sig = sigs.data() + i * siglen;
+
+      futs[i] = engine.sign(key_id, msg, mlen, sig);
+    }
+    for (size_t i = 0; i < batch; i++) {
+      _signed &= futs[i].get();
+    }
+
+    benchmark::DoNotOptimize(_signed);
+    benchmark::DoNotOptimize(sigs);
+    benchmark::ClobberMemory();
+  }
+
+  const auto stats = engine.stats();
+  const auto items = static_cast<int64_t>(state.iterations() * batch);
+
+  state.SetItemsProcessed(items);
+  state.counters["p50_us"] = static_cast<double>(stats.p50_ns) / 1e3;
+  state.counters["p99_us"] = static_cast<double>(stats.p99_ns) / 1e3;
+  state.counters["p999_us"] = static_cast<double>(stats.p999_ns) / 1e3;
+
+  const bool verified =
+    falcon::verify<N>(pkey.data(), msgs.data(), mlen, sigs.data());
+
+  assert(_signed);
+  assert(verified);
+}
+
+// Benchmark compression of Falcon{512, 1024} signature polynomial s2 ( see
+// `encoding::compress_sig` ), which is performed on every successful signing
+// attempt. s2 is obtained by decompressing a freshly computed signature.
+template<const size_t N>
+void
+falcon_compress_sig(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  std::vector<uint8_t> sig(siglen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<int32_t> s2(N);
+  prng::prng_t rng;
+
+  falcon::keygen<N>(pkey.data(), skey.data());
+  rng.read(msg.data(), msg.size());
+
+  bool compressed = falcon::sign<N>(skey.data(), msg.data(), mlen, sig.data());
+  compressed &= decoding::decompress_sig<N, siglen>(sig.data(), s2.data());
+
+  for (auto _ : state) {
+    compressed &= encoding::compress_sig<N, siglen>(s2.data(), sig.data());
+
+    benchmark::DoNotOptimize(compressed);
+    benchmark::DoNotOptimize(s2);
+    benchmark::DoNotOptimize(sig);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+
+  const bool verified =
+    falcon::verify<N>(pkey.data(), msg.data(), mlen, sig.data());
+
+  assert(compressed);
+  assert(verified);
+}
+
+// Maximum number of threads, used in multi-threaded signing benchmark
+static const int max_threads =
+  static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
 BENCHMARK(falcon_sign_single<512>)
   ->Arg(32)
   ->ComputeStatistics("min", compute_min)
@@ -121,6 +294,20 @@ BENCHMARK(falcon_sign_many<512>)
   ->Arg(32)
   ->ComputeStatistics("min", compute_min)
   ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_many<512, prng::chacha20_t>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_many<512, prng::background_t<>>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#if defined __AES__ && defined __SSE2__
+BENCHMARK(falcon_sign_many<512, prng::aes_ctr_t>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#endif
 
 BENCHMARK(falcon_sign_single<1024>)
   ->Arg(32)
@@ -130,3 +317,44 @@ BENCHMARK(falcon_sign_many<1024>)
   ->Arg(32)
   ->ComputeStatistics("min", compute_min)
   ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_many<1024, prng::chacha20_t>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_many<1024, prng::background_t<>>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#if defined __AES__ && defined __SSE2__
+BENCHMARK(falcon_sign_many<1024, prng::aes_ctr_t>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+#endif
+
+BENCHMARK(falcon_sign_threads<512>)
+  ->ThreadRange(1, max_threads)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_threads<1024>)
+  ->ThreadRange(1, max_threads)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_engine<512>)
+  ->Arg(64)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_sign_engine<1024>)
+  ->Arg(64)
+  ->UseRealTime()
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_compress_sig<512>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_compress_sig<1024>)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
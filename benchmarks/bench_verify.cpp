@@ -52,12 +52,85 @@ falcon_verify(benchmark::State& state)
   assert(verified);
 }
 
+// Benchmark Falcon{512, 1024} batch signature verification algorithm, where
+// 4 -many signatures, produced using same secret key, are verified together, so
+// that messages can be hashed using 4-way interleaved Keccak.
+//
+// Note, items processed is reported as number of verified signatures, so that
+// it can be compared with above benchmark.
+template<const size_t N>
+void
+falcon_verify_batch(benchmark::State& state)
+  requires((N == 512) || (N == 1024))
+{
+  const size_t mlen = state.range();
+  constexpr size_t count = 4;
+
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+
+  auto pkey = static_cast<uint8_t*>(std::malloc(pklen));
+  auto skey = static_cast<uint8_t*>(std::malloc(sklen));
+  auto sig = static_cast<uint8_t*>(std::malloc(siglen * count));
+  auto msg = static_cast<uint8_t*>(std::malloc(mlen * count));
+  prng::prng_t rng;
+
+  falcon::keygen<N>(pkey, skey);
+  rng.read(msg, mlen * count);
+
+  const uint8_t* msgs[count];
+  const uint8_t* sigs[count];
+  size_t mlens[count];
+  bool res[count];
+
+  bool _signed = true;
+  for (size_t i = 0; i < count; i++) {
+    _signed &= falcon::sign<N>(skey, msg + i * mlen, mlen, sig + i * siglen);
+
+    msgs[i] = msg + i * mlen;
+    sigs[i] = sig + i * siglen;
+    mlens[i] = mlen;
+  }
+  assert(_signed);
+
+  bool verified = true;
+  for (auto _ : state) {
+    verified &= falcon::verify_batch<N>(pkey, msgs, mlens, sigs, res, count);
+    verified &= res[0] & res[1] & res[2] & res[3];
+
+    benchmark::DoNotOptimize(verified);
+    benchmark::DoNotOptimize(pkey);
+    benchmark::DoNotOptimize(msg);
+    benchmark::DoNotOptimize(sig);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(count * state.iterations()));
+
+  std::free(pkey);
+  std::free(skey);
+  std::free(sig);
+  std::free(msg);
+
+  assert(verified);
+}
+
 BENCHMARK(falcon_verify<512>)
   ->Arg(32)
   ->ComputeStatistics("min", compute_min)
   ->ComputeStatistics("max", compute_max);
 
+BENCHMARK(falcon_verify_batch<512>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
+
 BENCHMARK(falcon_verify<1024>)
   ->Arg(32)
   ->ComputeStatistics("min", compute_min)
   ->ComputeStatistics("max", compute_max);
+BENCHMARK(falcon_verify_batch<1024>)
+  ->Arg(32)
+  ->ComputeStatistics("min", compute_min)
+  ->ComputeStatistics("max", compute_max);
@@ -0,0 +1,129 @@
+#include "sign_daemon.hpp"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+// Compile it with
+//
+// clang++ -std=c++20 -Wall -O3 -march=native -mtune=native -I include/ -I
+// sha3/include/ examples/sign_daemon.cpp -lgmpxx -lgmp -lpthread
+//
+// Run it as
+//
+// ./a.out <socket-path> <key-file> [<key-file> ...]
+//
+// s.t. each key file holds a byte encoded public key, followed by byte encoded
+// secret key. If a key file doesn't exist, a fresh keypair is generated and
+// written to it ( with mode 0600 ), so that clients can verify signatures,
+// using public key. i-th key file is identified by key id `i`, in requests.
+// Socket is only accessible by user running daemon.
+
+// Try changing N to 1024 if interested in using FALCON1024
+constexpr size_t N = 512;
+
+static sign_daemon::server_t<N>* daemon_ptr = nullptr;
+
+static void
+on_signal(int)
+{
+  if (daemon_ptr != nullptr) {
+    daemon_ptr->stop();
+  }
+}
+
+// Writes all of len -bytes to file descriptor
+static bool
+write_all(const int fd, const uint8_t* bytes, size_t len)
+{
+  while (len > 0) {
+    const ssize_t n = ::write(fd, bytes, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+
+    bytes += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Reads keypair from file, generating a fresh one, if file doesn't exist. A
+// fresh key file is created exclusively, readable/ writable only by owner, so
+// that secret key is never exposed to others.
+static bool
+load_keypair(const char* const file, uint8_t* const pkey, uint8_t* const skey)
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    falcon::keygen<N>(pkey, skey);
+
+    const int fd = open(file, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+      return false;
+    }
+
+    const bool ok = write_all(fd, pkey, pklen) && write_all(fd, skey, sklen);
+    return (close(fd) == 0) && ok;
+  }
+
+  in.read(reinterpret_cast<char*>(pkey), pklen);
+  in.read(reinterpret_cast<char*>(skey), sklen);
+  return in.good();
+}
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0] << " <socket-path> <key-file>...\n";
+    return 1;
+  }
+
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  sign_daemon::server_t<N> server;
+  if (!server.valid()) {
+    std::cerr << "Failed to set up event loop\n";
+    return 1;
+  }
+
+  for (int i = 2; i < argc; i++) {
+    uint8_t pkey[pklen];
+    uint8_t skey[sklen];
+
+    if (!load_keypair(argv[i], pkey, skey) || !server.add_key(pkey, skey)) {
+      std::cerr << "Failed to load keypair from " << argv[i] << "\n";
+      return 1;
+    }
+  }
+
+  if (!server.listen(argv[1])) {
+    std::cerr << "Failed to listen on " << argv[1] << "\n";
+    return 1;
+  }
+
+  daemon_ptr = &server;
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+
+  std::cout << "Falcon" << N << " signing daemon, listening on " << argv[1]
+            << ", with " << (argc - 2) << " key(s)\n";
+
+  server.run();
+
+  std::cout << "Served " << server.request_count() << " request(s), in "
+            << server.batch_count() << " batch(es)\n";
+
+  daemon_ptr = nullptr;
+  return 0;
+}
@@ -0,0 +1,135 @@
+#include "sign_daemon.hpp"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compile it with
+//
+// clang++ -std=c++20 -Wall -O3 -march=native -mtune=native -I include/ -I
+// sha3/include/ examples/sign_loadgen.cpp -lgmpxx -lgmp -lpthread
+//
+// Run it as
+//
+// ./a.out <socket-path> <key-file> [clients] [requests-per-client] [depth]
+//
+// while signing daemon ( see examples/sign_daemon.cpp ) is running, using same
+// key file. Each client connects to daemon and keeps `depth` -many sign
+// requests in flight, till it has made `requests-per-client` -many requests,
+// while latency of each request is recorded. All signatures are verified using
+// public key, read from key file.
+
+// Must match with N, used by signing daemon
+constexpr size_t N = 512;
+
+int
+main(int argc, char** argv)
+{
+  using sclock = std::chrono::steady_clock;
+
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <socket-path> <key-file> [clients] [requests] [depth]\n";
+    return 1;
+  }
+
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t mlen = 32;
+
+  const std::string path = argv[1];
+  const size_t clients = argc > 3 ? std::stoul(argv[3]) : 4;
+  const size_t reqs = argc > 4 ? std::stoul(argv[4]) : 1024;
+  const uint32_t depth = argc > 5 ? std::stoul(argv[5]) : 8;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::ifstream in(argv[2], std::ios::binary);
+  in.read(reinterpret_cast<char*>(pkey.data()), pklen);
+  if (!in.good() || (depth == 0)) {
+    std::cerr << "Failed to read public key from " << argv[2] << "\n";
+    return 1;
+  }
+
+  sign_engine::histogram_t latency;
+  std::vector<size_t> failures(clients, 0);
+  std::vector<std::thread> threads;
+
+  const auto started = sclock::now();
+
+  for (size_t c = 0; c < clients; c++) {
+    threads.emplace_back([&, c]() {
+      sign_daemon::client_t<N> client;
+      if (!client.connect(path, depth)) {
+        failures[c] = reqs;
+        return;
+      }
+
+      prng::prng_t rng;
+      std::vector<sclock::time_point> sent(depth);
+      std::vector<uint64_t> ids(depth);
+
+      // submits a sign request for a fresh random message, using given slot
+      const auto submit = [&](const uint32_t slot) {
+        rng.read(client.msg(slot), mlen);
+        sent[slot] = sclock::now();
+        return client.submit(sign_daemon::op_t::sign, 0, slot, mlen, ids[slot]);
+      };
+
+      size_t submitted = 0;
+      size_t completed = 0;
+
+      for (uint32_t slot = 0; (slot < depth) && (submitted < reqs); slot++) {
+        submitted += submit(slot);
+      }
+
+      while (completed < submitted) {
+        sign_daemon::response_t resp;
+        if (!client.receive(resp) || (resp.slot >= depth)) {
+          failures[c] += submitted - completed;
+          return;
+        }
+
+        const auto lat = sclock::now() - sent[resp.slot];
+        latency.record(std::chrono::nanoseconds(lat).count());
+        completed++;
+
+        const auto msg = client.msg(resp.slot);
+        const auto sig = client.sig(resp.slot);
+        const bool ok = (resp.ok != 0) && (resp.id == ids[resp.slot]) &&
+                        falcon::verify<N>(pkey.data(), msg, mlen, sig);
+        failures[c] += !ok;
+
+        if (submitted < reqs) {
+          submitted += submit(resp.slot);
+        }
+      }
+    });
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const auto elapsed = sclock::now() - started;
+  const double secs = std::chrono::duration<double>(elapsed).count();
+  const uint64_t done = latency.count();
+
+  size_t failed = 0;
+  for (const auto f : failures) {
+    failed += f;
+  }
+
+  std::cout << "Falcon" << N << " signing daemon load test\n\n";
+  std::cout << "Clients         : " << clients << "\n";
+  std::cout << "Depth           : " << depth << "\n";
+  std::cout << "Requests        : " << done << "\n";
+  std::cout << "Failures        : " << failed << "\n";
+  std::cout << "Throughput      : " << done / secs << " signatures/s\n";
+  std::cout << "Latency p50     : " << latency.percentile(.5) / 1e3 << " us\n";
+  std::cout << "Latency p99     : " << latency.percentile(.99) / 1e3 << " us\n";
+  std::cout << "Latency p999    : " << latency.percentile(.999) / 1e3
+            << " us\n";
+
+  return failed == 0 ? 0 : 1;
+}
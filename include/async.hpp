@@ -0,0 +1,452 @@
+#pragma once
+#include "falcon.hpp"
+#include "sign_engine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+// Asynchronous, C++20 coroutine based, Falcon{512, 1024} signing and
+// verification, which offloads CPU bound work to a pool of worker threads,
+// while resuming awaiting coroutine on its own executor.
+namespace async {
+
+// Fire-and-forget coroutine, which starts running as soon as it's called and
+// destroys itself, once it runs to completion.
+struct task_t
+{
+  struct promise_type
+  {
+    task_t get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// Fixed size pool of worker threads, which runs submitted jobs, in order they
+// were submitted, using a bounded lock-free MPMC queue ( see
+// `sign_engine::mpmc_queue_t` ). Idle workers park themselves, until next job
+// arrives.
+struct pool_t
+{
+public:
+  using job_t = std::function<void()>;
+
+private:
+  sign_engine::mpmc_queue_t<job_t, 1ul << 12> queue;
+  alignas(64) std::atomic<uint64_t> pushed{ 0ul }; // workers park on this
+  alignas(64) std::atomic<bool> stop{ false };
+  std::vector<std::thread> workers;
+
+  // Keeps running jobs, until pool is asked to stop and queue is drained.
+  inline void serve()
+  {
+    job_t job;
+
+    while (1) {
+      const uint64_t seen = pushed.load(std::memory_order_acquire);
+
+      if (!queue.try_pop(job)) {
+        if (stop.load()) {
+          break;
+        }
+
+        pushed.wait(seen, std::memory_order_acquire);
+        continue;
+      }
+
+      job();
+      job = nullptr;
+    }
+  }
+
+public:
+  // Starts `worker_cnt` -many worker threads ( defaults to # -of cores )
+  inline explicit pool_t(const size_t worker_cnt = 0)
+  {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t cnt = worker_cnt == 0 ? cores : worker_cnt;
+
+    workers.reserve(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+      workers.emplace_back(&pool_t::serve, this);
+    }
+  }
+
+  pool_t(const pool_t&) = delete;
+  pool_t& operator=(const pool_t&) = delete;
+
+  // Lets workers finish all pending jobs and waits for them to exit.
+  inline ~pool_t()
+  {
+    stop.store(true);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_all();
+
+    for (auto& w : workers) {
+      w.join();
+    }
+  }
+
+  // Submits a job, yielding while queue is full, and wakes up a parked worker.
+  inline void submit(job_t&& job)
+  {
+    while (!queue.try_push(std::move(job))) {
+      std::this_thread::yield();
+    }
+
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+  }
+
+  // Number of worker threads
+  inline size_t size() const { return workers.size(); }
+};
+
+// Returns process-wide pool, which is used by `falcon::async_sign` and
+// `falcon::async_verify`, when no pool is specified. It's created on first use,
+// with one worker per core.
+//
+// Note, this routine isn't marked `static`, so that all translation units
+// share same pool.
+inline pool_t&
+default_pool()
+{
+  static pool_t pool;
+  return pool;
+}
+
+#if defined __linux__
+
+// Minimal single-threaded executor, built on Linux epoll, which runs an event
+// loop on the thread calling `run`. It resumes coroutines, which are posted to
+// it from any thread ( woken up using an eventfd ), and invokes callbacks
+// registered for file descriptors, when they become readable. Because Falcon
+// work is offloaded to a worker pool, coroutines running on this executor can
+// sign/ verify, without blocking I/O handled by same loop.
+struct executor_t
+{
+private:
+  int epfd = -1;
+  int evfd = -1;
+  std::atomic<bool> stopped{ false };
+
+  std::mutex lock;
+  std::vector<std::coroutine_handle<>> ready;
+  std::unordered_map<int, std::function<void()>> watchers;
+
+  // Executor, whose event loop is being run by calling thread, if any
+  static inline executor_t*& current_()
+  {
+    thread_local executor_t* exec = nullptr;
+    return exec;
+  }
+
+  // Resumes all coroutines, which are posted to executor, till now
+  inline void drain()
+  {
+    uint64_t cnt = 0;
+    if (::read(evfd, &cnt, sizeof(cnt)) < 0) {
+      // nothing to do, eventfd was already drained
+    }
+
+    std::vector<std::coroutine_handle<>> handles;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      handles.swap(ready);
+    }
+
+    for (auto h : handles) {
+      h.resume();
+    }
+  }
+
+public:
+  // Sets up event loop, throwing `std::system_error`, if epoll instance or
+  // eventfd can't be created, because executor couldn't ever be woken up.
+  inline executor_t()
+  {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) [[unlikely]] {
+      throw std::system_error(errno, std::system_category(), "epoll_create1");
+    }
+
+    evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (evfd < 0) [[unlikely]] {
+      const int err = errno;
+      close(epfd);
+      throw std::system_error(err, std::system_category(), "eventfd");
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = evfd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev) != 0) [[unlikely]] {
+      const int err = errno;
+      close(evfd);
+      close(epfd);
+      throw std::system_error(err, std::system_category(), "epoll_ctl");
+    }
+  }
+
+  executor_t(const executor_t&) = delete;
+  executor_t& operator=(const executor_t&) = delete;
+
+  inline ~executor_t()
+  {
+    close(evfd);
+    close(epfd);
+  }
+
+  // Returns executor, whose event loop is being run by calling thread, if any,
+  // otherwise returns nullptr.
+  static inline executor_t* current() { return current_(); }
+
+  // Schedules given coroutine to be resumed on event loop. Can be called from
+  // any thread.
+  inline void post(const std::coroutine_handle<> h)
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      ready.push_back(h);
+    }
+
+    const uint64_t one = 1;
+    if (::write(evfd, &one, sizeof(one)) < 0) {
+      // eventfd counter can't overflow, as it's drained by each wake up
+    }
+  }
+
+  // Registers callback, which is invoked on event loop, whenever given file
+  // descriptor becomes readable. Must be called either before event loop is
+  // started or from event loop itself. Returns false, if file descriptor can't
+  // be watched.
+  inline bool watch(const int fd, std::function<void()> cb)
+  {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      return false;
+    }
+
+    watchers[fd] = std::move(cb);
+    return true;
+  }
+
+  // Stops watching given file descriptor. Must be called either before event
+  // loop is started or from event loop itself.
+  inline void unwatch(const int fd)
+  {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    watchers.erase(fd);
+  }
+
+  // Runs event loop on calling thread, until `stop` is called. Once stopped,
+  // event loop can be run again.
+  //
+  // Before returning, it resumes all coroutines, which were posted till then,
+  // including ones posted after `stop` was called ( say by a worker, racing
+  // it ). Coroutines posted after `run` returns are resumed by next `run`, so
+  // executor must not be destroyed, while a coroutine is yet to be posted to
+  // it, otherwise that coroutine stays suspended forever.
+  inline void run()
+  {
+    constexpr int max_events = 64;
+    epoll_event events[max_events];
+
+    current_() = this;
+
+    while (!stopped.load()) {
+      const int cnt = epoll_wait(epfd, events, max_events, -1);
+      if (cnt < 0 && errno != EINTR) [[unlikely]] {
+        const int err = errno;
+        current_() = nullptr;
+        throw std::system_error(err, std::system_category(), "epoll_wait");
+      }
+
+      for (int i = 0; i < cnt; i++) {
+        const int fd = events[i].data.fd;
+
+        if (fd == evfd) {
+          drain();
+          continue;
+        }
+
+        const auto it = watchers.find(fd);
+        if (it != watchers.end()) {
+          // callback might unwatch itself, so keep a copy alive
+          const auto cb = it->second;
+          cb();
+        }
+      }
+    }
+
+    drain();
+
+    current_() = nullptr;
+    stopped.store(false);
+  }
+
+  // Asks event loop to stop, after it handles events, which it's currently
+  // handling. Can be called from any thread.
+  inline void stop()
+  {
+    stopped.store(true);
+
+    const uint64_t one = 1;
+    if (::write(evfd, &one, sizeof(one)) < 0) {
+      // eventfd counter can't overflow, as it's drained by each wake up
+    }
+  }
+
+  // Returns an awaitable, which suspends awaiting coroutine and resumes it on
+  // this executor's event loop, so that a coroutine can be moved onto loop.
+  inline auto schedule()
+  {
+    struct awaiter_t
+    {
+      executor_t& exec;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) { exec.post(h); }
+      void await_resume() const noexcept {}
+    };
+
+    return awaiter_t{ *this };
+  }
+};
+
+#endif
+
+// Awaitable, which runs given function on a worker pool and resumes awaiting
+// coroutine on executor, whose event loop was running on awaiting thread ( see
+// `executor_t::current` ). If awaiting thread wasn't running any executor,
+// coroutine is resumed on worker thread itself. Result of function is returned
+// by `co_await`.
+template<typename R, typename F>
+struct offload_t
+{
+  pool_t& pool;
+  F fn;
+  R result{};
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(const std::coroutine_handle<> h)
+  {
+#if defined __linux__
+    executor_t* const exec = executor_t::current();
+#else
+    void* const exec = nullptr;
+#endif
+
+    pool.submit([this, h, exec]() {
+      result = fn();
+
+#if defined __linux__
+      if (exec != nullptr) {
+        exec->post(h);
+        return;
+      }
+#endif
+      h.resume();
+    });
+  }
+
+  R await_resume() { return std::move(result); }
+};
+
+// Scratch space and PRNG, owned by each thread running asynchronous signing
+// jobs, so that nothing is allocated or seeded per signing request.
+template<const size_t N>
+struct signer_state_t
+{
+  std::unique_ptr<signing::workspace_t<N>> ws =
+    std::make_unique<signing::workspace_t<N>>();
+  prng::chacha20_t rng;
+};
+
+// Returns signing state owned by calling thread, which is created on first use.
+template<const size_t N>
+inline signer_state_t<N>&
+signer_state()
+{
+  thread_local signer_state_t<N> state;
+  return state;
+}
+
+}
+
+// Falcon{512, 1024} Key Generation, Signing and Verification Algorithm
+namespace falcon {
+
+// Asynchronously signs mlen -bytes message, using expanded secret key ( see
+// `expanded_key_t` ), writing compressed signature to `sig`, on given worker
+// pool, s.t. `co_await`-ing coroutine is resumed on its own executor, once
+// signature is ready. Resolves to true, once signature is produced.
+//
+// Note, key, message and signature buffers must stay alive, until awaiting
+// coroutine is resumed.
+template<const size_t N>
+static inline auto
+async_sign(const expanded_key_t<N>& key,
+           const uint8_t* const msg,
+           const size_t mlen,
+           uint8_t* const sig,
+           async::pool_t& pool = async::default_pool())
+  requires((N == 512) || (N == 1024))
+{
+  const auto fn = [&key, msg, mlen, sig]() {
+    auto& state = async::signer_state<N>();
+    key.sign(msg, mlen, sig, *state.ws, state.rng);
+    return true;
+  };
+
+  return async::offload_t<bool, decltype(fn)>{ pool, fn };
+}
+
+// Asynchronously verifies compressed signature of mlen -bytes message, using
+// byte encoded public key ( see `verify` ), on given worker pool, s.t.
+// `co_await`-ing coroutine is resumed on its own executor, with result of
+// verification.
+//
+// Note, public key, message and signature buffers must stay alive, until
+// awaiting coroutine is resumed.
+template<const size_t N>
+static inline auto
+async_verify(const uint8_t* const pkey,
+             const uint8_t* const msg,
+             const size_t mlen,
+             const uint8_t* const sig,
+             async::pool_t& pool = async::default_pool())
+  requires((N == 512) || (N == 1024))
+{
+  const auto fn = [pkey, msg, mlen, sig]() {
+    return verify<N>(pkey, msg, mlen, sig);
+  };
+
+  return async::offload_t<bool, decltype(fn)>{ pool, fn };
+}
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include "common.hpp"
+#include <algorithm>
+#include <bit>
 #include <complex>
 #include <cstring>
 
@@ -152,6 +154,58 @@ encode_skey(const int32_t* const __restrict f,
   }
 }
 
+// Writes a stream of bits to a byte array, most significant bit first, s.t.
+// bits are collected in a 64 -bit accumulator, which is flushed to byte array,
+// 8 -bytes at a time.
+struct bit_writer_t
+{
+  uint8_t* const buf;
+  uint64_t acc = 0;   // pending bits, filled from most significant end
+  size_t acc_len = 0; // # -of pending bits, always < 64
+  size_t off = 0;     // # -of bytes flushed to buf
+
+  // Flushes accumulator to next 8 -bytes of buf, in big-endian order
+  inline void flush()
+  {
+    uint64_t word = acc;
+    if constexpr (std::endian::native == std::endian::little) {
+      word = __builtin_bswap64(word);
+    }
+
+    std::memcpy(buf + off, &word, sizeof(word));
+    off += sizeof(word);
+  }
+
+  // Appends `w` ( ∈ [1, 64] ) least significant bits of `v`, s.t. all other
+  // bits of `v` must be zero
+  inline void put(const uint64_t v, const size_t w)
+  {
+    const size_t room = 64 - acc_len;
+
+    if (w < room) {
+      acc |= v << (room - w);
+      acc_len += w;
+      return;
+    }
+
+    const size_t rem = w - room;
+
+    acc |= v >> rem;
+    flush();
+
+    acc = rem == 0 ? 0 : v << (64 - rem);
+    acc_len = rem;
+  }
+
+  // Flushes pending bits ( if any ), padded with zero bits
+  inline void finish()
+  {
+    if (acc_len > 0) {
+      flush();
+    }
+  }
+};
+
 // Given a degree N polynomials with coefficients ∈ Z[x] s.t. they are
 // distributed around 0 according to a discrete Gaussian distribution, this
 // routine attempts to compress it using (sbytelen * 8 - 328) -bits, following
@@ -161,11 +215,16 @@ encode_skey(const int32_t* const __restrict f,
 //                 <320 -bits of salt> +
 //                 <{666, 1280} - 41 -bytes of compressed signature>
 //
+// Each coefficient is encoded as a single code ( sign bit, low 7 -bits of
+// absolute value and high bits of it, in unary ), which is appended to a 64
+// -bit accumulator, using shifts ( see `bit_writer_t` ).
+//
 // This routine doesn't access first 41 -bytes of signature, setting those bytes
 // properly is not responsibility of this routine.
 //
 // In case of successful compression, returns boolean truth value, otherwise
-// returns false, denoting compression failure.
+// returns false, denoting compression failure, in which case compressed
+// signature bytes are zeroed.
 template<const size_t N, const size_t sbytelen>
 static inline bool
 compress_sig(const int32_t* const __restrict poly_s,
@@ -174,59 +233,48 @@ compress_sig(const int32_t* const __restrict poly_s,
            ((N == 1024) && (sbytelen == 1280)))
 {
   constexpr size_t slen = 8 * sbytelen - (8 + 320); // signature bit length
-  constexpr size_t max_sbytelen = (std::bit_width(ff::Q) * N) / 8;
+  constexpr size_t blen = sbytelen - (1 + 40);      // signature byte length
 
-  uint8_t sig_buf[max_sbytelen]{};
+  // accumulator is flushed 8 -bytes at a time, so buffer length is rounded up
+  uint8_t sig_buf[(blen + 7) & ~7ul]{};
+  bit_writer_t writer{ sig_buf };
 
   size_t bit_idx = 0;
-  size_t coeff_idx = 0;
-
-  while (coeff_idx < N) {
-    // encode sign bit
-    {
-      const size_t byte_idx = bit_idx >> 3;
-      const size_t from_bit = bit_idx & 7ul;
 
-      sig_buf[byte_idx] |= ((poly_s[coeff_idx] < 0) * 1) << (7 - from_bit);
-      bit_idx += 1;
-    }
+  for (size_t i = 0; i < N; i++) {
+    const uint32_t mag = static_cast<uint32_t>(std::abs(poly_s[i]));
+    const size_t k = mag >> 7;
 
-    // encode low 7 -bits of coefficient
-    {
-      const int32_t coeff = std::abs(poly_s[coeff_idx]);
-      for (size_t i = bit_idx; i < bit_idx + 7; i++) {
-        const size_t byte_idx = i >> 3;
-        const size_t from_bit = i & 7ul;
+    // sign bit, low 7 -bits, k -many zero bits and terminating one bit
+    const size_t w = 9 + k;
 
-        const uint8_t bit = (coeff >> (6 - (i - bit_idx))) & 0b1;
-        sig_buf[byte_idx] |= bit << (7 - from_bit);
-      }
-
-      bit_idx += 7;
+    if (bit_idx + w >= slen) {
+      std::memset(sig + (1 + 40), 0, blen);
+      return false;
     }
+    bit_idx += w;
 
-    // encode high bits of coefficient, in unary code
-    {
-      const size_t k = std::abs(poly_s[coeff_idx]) >> 7;
-      for (size_t i = bit_idx; i < bit_idx + k; i++) {
-        const size_t byte_idx = i >> 3;
-        const size_t from_bit = i & 7ul;
+    const uint64_t sign = poly_s[i] < 0;
+    const uint64_t low = (sign << 7) | (mag & 0x7fu);
 
-        sig_buf[byte_idx] |= 0 << (7 - from_bit);
-      }
+    if (w <= 64) [[likely]] {
+      writer.put((low << (k + 1)) | 1u, w);
+    } else {
+      writer.put(low, 8);
+      for (size_t z = k; z > 0;) {
+        const size_t zw = std::min(z, 64ul);
 
-      bit_idx += k;
-      sig_buf[bit_idx >> 3] |= 1 << (7 - (bit_idx & 7ul));
-      bit_idx += 1;
+        writer.put(0, zw);
+        z -= zw;
+      }
+      writer.put(1, 1);
     }
-
-    coeff_idx += 1;
   }
 
-  std::memset(sig_buf, 0, max_sbytelen * (bit_idx >= slen));
-  std::memcpy(sig + (1 + 40), sig_buf, sbytelen - (1 + 40));
+  writer.finish();
+  std::memcpy(sig + (1 + 40), sig_buf, blen);
 
-  return bit_idx < slen;
+  return true;
 }
 
 }
@@ -2,13 +2,27 @@
 #include "common.hpp"
 #include "decoding.hpp"
 #include "encoding.hpp"
+#include "falcon_tree_batch.hpp"
 #include "ff.hpp"
 #include "fft.hpp"
+#include "hashing.hpp"
 #include "keygen.hpp"
 #include "prng.hpp"
+#include "prng_aes_ctr.hpp"
+#include "prng_background.hpp"
+#include "prng_chacha20.hpp"
 #include "signing.hpp"
+#include "utils.hpp"
 #include "verification.hpp"
+#include <algorithm>
 #include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#if defined __unix__ || defined __APPLE__
+#include <unistd.h>
+#endif
 
 // Falcon{512, 1024} Key Generation, Signing and Verification Algorithm
 namespace falcon {
@@ -24,10 +38,15 @@ namespace falcon {
 // Falcon Tree T, which are required during signing period. For those, see
 // keygen.hpp file's keygen() function implementation - that is an
 // implementation of algorithm 4 of Falcon specification, which does no byte
-// serialization for secret key or public key.
-template<const size_t N>
+// serialization for secret key or public key. If both serialized key pair and
+// B, T are required, see `expanded_key_t::generate`, which computes all of
+// them in one go.
+//
+// Random sampling of f, g is done using caller supplied PRNG, so that it can be
+// reused across many key generation calls ( see `keygen_batch` ).
+template<const size_t N, prng::rng RNG>
 static inline void
-keygen(uint8_t* const __restrict pkey, uint8_t* const __restrict skey)
+keygen(uint8_t* const __restrict pkey, uint8_t* const __restrict skey, RNG& rng)
   requires((N == 512) || (N == 1024))
 {
   int32_t f[N];
@@ -35,14 +54,25 @@ keygen(uint8_t* const __restrict pkey, uint8_t* const __restrict skey)
   int32_t F[N];
   int32_t G[N];
   ff::ff_t h[N];
-  prng::prng_t rng;
+  ntru_gen::fg_forms_t<N> forms;
 
-  ntru_gen::ntru_gen<N>(f, g, F, G, rng);
-  keygen::compute_public_key<N>(f, g, h);
+  // NTT form of f is reused from NTRUGen
+  ntru_gen::ntru_gen<N>(f, g, F, G, rng, &forms);
+  keygen::compute_public_key<N>(forms.f_ntt, g, h);
   encoding::encode_pkey<N>(h, pkey);
   encoding::encode_skey<N>(f, g, F, skey);
 }
 
+// Same as above, but samples f, g using a freshly seeded PRNG.
+template<const size_t N>
+static inline void
+keygen(uint8_t* const __restrict pkey, uint8_t* const __restrict skey)
+  requires((N == 512) || (N == 1024))
+{
+  prng::prng_t rng;
+  keygen<N>(pkey, skey, rng);
+}
+
 // Given three degree N polynomials f, g and F, this routine recomputes G using
 // NTRU equation fG - gF = q mod φ.
 //
@@ -152,14 +182,19 @@ compute_falcon_tree(
 // can be useful when you need to sign many messages one after another. If
 // you're interested in signing just a single message, it's better idea to use
 // sign function living just below this.
-template<const size_t N>
+//
+// Any PRNG, satisfying `prng::rng` concept, can be used as source of
+// randomness, for sampling salt and feeding ffSampling e.g. SHAKE256 based
+// `prng::prng_t`, ChaCha20 based `prng::chacha20_t` or AES-256-CTR based
+// `prng::aes_ctr_t`.
+template<const size_t N, prng::rng RNG>
 static inline void
 sign(const fft::cmplx* const __restrict B, // 2x2 matrix [[g, -f], [G, -F]]
      const fft::cmplx* const __restrict T, // Falcon Tree ( in FFT form )
      const uint8_t* const __restrict msg,  // message to be signed
      const size_t mlen,                    // = len(msg), in bytes
      uint8_t* const __restrict sig,        // compressed falcon signature
-     prng::prng_t& rng)
+     RNG& rng)
   requires((N == 512) || (N == 1024))
 {
   constexpr int32_t β2_values[]{ 34034726, 70265242 };
@@ -173,6 +208,418 @@ sign(const fft::cmplx* const __restrict B, // 2x2 matrix [[g, -f], [G, -F]]
   signing::sign<N, β2, slen>(B, T, msg, mlen, sig, σ_min, rng);
 }
 
+// Same as `sign` above, but all scratch space is taken from caller supplied
+// workspace `ws`, which must be of at least `signing::sign_ws_len<N>()` -bytes
+// and aligned to `alignof(fft::cmplx)` -bytes ( though 64 -bytes alignment is
+// preferred ). It lets one workspace be reused by a worker, across many signing
+// calls, while only a few KB of stack is used, so that signing can run inside a
+// fiber ( or thread ) with small stack e.g. 64 KB.
+template<const size_t N, prng::rng RNG>
+static inline void
+sign_ws(const fft::cmplx* const __restrict B, // 2x2 matrix [[g, -f], [G, -F]]
+        const fft::cmplx* const __restrict T, // Falcon Tree ( in FFT form )
+        const uint8_t* const __restrict msg,  // message to be signed
+        const size_t mlen,                    // = len(msg), in bytes
+        uint8_t* const __restrict sig,        // compressed falcon signature
+        std::span<uint8_t> ws,                // signing workspace
+        RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr size_t slen_values[]{ 666, 1280 };
+  constexpr double σ_min_values[]{ 1.277833697, 1.298280334 };
+
+  constexpr int32_t β2 = β2_values[N == 1024];
+  constexpr size_t slen = slen_values[N == 1024];
+  constexpr double σ_min = σ_min_values[N == 1024];
+
+  signing::sign_ws<N, β2, slen>(B, T, msg, mlen, sig, σ_min, ws, rng);
+}
+
+// Given a 2x2 matrix B ( in its FFT form ) s.t. B = [[g, -f], [G, -F]], falcon
+// tree T ( in its FFT representation ) and a reader ( see `hashing::reader` ),
+// which produces message bytes in chunks, this routine computes compressed
+// Falcon{512, 1024} signature, same as `sign` does.
+//
+// This is useful for signing large messages e.g. files, which are read from
+// disk, in fixed size chunks, without holding whole message in memory. Returns
+// false, leaving signature zeroed, if reader reports an error.
+template<const size_t N, hashing::reader Reader, prng::rng RNG>
+static inline bool
+sign_stream(const fft::cmplx* const __restrict B, // 2x2 matrix
+            const fft::cmplx* const __restrict T, // Falcon Tree ( FFT form )
+            Reader& read,                         // message reader
+            uint8_t* const __restrict sig,        // compressed signature
+            RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr size_t slen_values[]{ 666, 1280 };
+  constexpr double σ_min_values[]{ 1.277833697, 1.298280334 };
+
+  constexpr int32_t β2 = β2_values[N == 1024];
+  constexpr size_t slen = slen_values[N == 1024];
+  constexpr double σ_min = σ_min_values[N == 1024];
+
+  return signing::sign_stream<N, β2, slen>(B, T, read, sig, σ_min, rng);
+}
+
+// Given a 2x2 matrix B ( in its FFT form ) s.t. B = [[g, -f], [G, -F]], falcon
+// tree T ( in its FFT representation ) and `count` -many messages s.t. i-th
+// message is of `mlens[i]` -bytes, this routine signs all of them with same
+// secret key, writing i-th compressed signature to `sigs[i]`.
+//
+// Messages are processed in groups of four, so that ( salt, message ) pairs can
+// be hashed together using 4-way interleaved Keccak, see
+// `hashing::hash_to_point_x4`. Remaining messages are signed one by one.
+template<const size_t N, prng::rng RNG>
+static inline void
+sign_batch(const fft::cmplx* const __restrict B, // 2x2 matrix
+           const fft::cmplx* const __restrict T, // Falcon Tree ( FFT form )
+           const uint8_t* const* const __restrict msgs,
+           const size_t* const __restrict mlens,
+           uint8_t* const* const __restrict sigs,
+           const size_t count,
+           RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr size_t slen_values[]{ 666, 1280 };
+  constexpr double σ_min_values[]{ 1.277833697, 1.298280334 };
+
+  constexpr int32_t β2 = β2_values[N == 1024];
+  constexpr size_t slen = slen_values[N == 1024];
+  constexpr double σ_min = σ_min_values[N == 1024];
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const auto m = msgs + i;
+    const auto ml = mlens + i;
+    const auto s = sigs + i;
+
+    signing::sign_x4<N, β2, slen>(B, T, m, ml, s, σ_min, rng);
+  }
+  for (; i < count; i++) {
+    sign<N>(B, T, msgs[i], mlens[i], sigs[i], rng);
+  }
+}
+
+// Falcon{512, 1024} secret key, expanded into the form, which is used during
+// signing i.e. 2x2 matrix B, falcon tree T and SamplerZ constants for leaves of
+// T. All of those are heap allocated and only read during signing, so that one
+// expanded key can be shared by many signing threads.
+template<const size_t N>
+  requires((N == 512) || (N == 1024))
+struct expanded_key_t
+{
+private:
+  static constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+
+  static constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  static constexpr size_t slen_values[]{ 666, 1280 };
+  static constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  static constexpr double σ_min_values[]{ 1.277833697, 1.298280334 };
+
+  static constexpr int32_t β2 = β2_values[N == 1024];
+  static constexpr double σ = σ_values[N == 1024];
+  static constexpr size_t slen = slen_values[N == 1024];
+  static constexpr double σ_min = σ_min_values[N == 1024];
+
+  std::vector<fft::cmplx> B = std::vector<fft::cmplx>(2 * 2 * N);
+  std::vector<fft::cmplx> T = std::vector<fft::cmplx>(ftlen);
+  std::vector<samplerz::leaf_t> L = std::vector<samplerz::leaf_t>(N);
+
+public:
+  // Expands byte encoded secret key, computing matrix B, falcon tree T and
+  // SamplerZ constants for leaves of T. Returns false, if secret key can't be
+  // decoded.
+  inline bool expand(const uint8_t* const __restrict skey)
+  {
+    int32_t f[N];
+    int32_t g[N];
+    int32_t F[N];
+    int32_t G[N];
+
+    const bool decoded = decoding::decode_skey<N>(skey, f, g, F);
+    if (!decoded) [[unlikely]] {
+      return decoded;
+    }
+
+    recompute_G<N>(f, g, F, G);
+    compute_matrix_B<N>(f, g, F, G, B.data());
+    compute_falcon_tree<N>(B.data(), T.data());
+    ffsampling::precompute_leaves<N, 0, log2<N>()>(T.data(), σ_min, L.data());
+
+    return decoded;
+  }
+
+  // Expands `count` -many byte encoded secret keys, s.t. i-th one is read from
+  // `skeys + i * sklen` and expanded into `keys[i]`, where sklen is byte length
+  // of secret key ( see falcon_utils.hpp ). Matrix B and Falcon tree T are
+  // computed for `falcon_tree_batch::LANES` -many keys at once, in lockstep (
+  // see `falcon_tree_batch::expand_ws` ), which gives much higher throughput,
+  // than expanding one key at a time ( see `expand` ), when importing many
+  // keys. Returns false, if any of secret keys can't be decoded, in which case
+  // it's unspecified which of keys are expanded.
+  static inline bool expand_batch(const uint8_t* const __restrict skeys,
+                                  expanded_key_t* const __restrict keys,
+                                  const size_t count)
+  {
+    constexpr size_t K = falcon_tree_batch::LANES;
+    constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+    constexpr size_t wslen = falcon_tree_batch::expand_ws_len<N, K>();
+
+    using lanes_t = falcon_tree_batch::lanes_t<K>;
+
+    std::vector<int32_t> polys(2 * 2 * K * N);
+    std::vector<lanes_t> ws(wslen / sizeof(lanes_t));
+
+    for (size_t off = 0; off < count; off += K) {
+      const size_t cnt = std::min(K, count - off);
+
+      const int32_t* f[K];
+      const int32_t* g[K];
+      const int32_t* F[K];
+      const int32_t* G[K];
+      fft::cmplx* B_[K];
+      fft::cmplx* T_[K];
+
+      for (size_t k = 0; k < K; k++) {
+        // last batch is filled up by repeating its last key
+        const size_t k_ = std::min(k, cnt - 1);
+        auto poly = polys.data() + k_ * 2 * 2 * N;
+
+        f[k] = poly;
+        g[k] = poly + N;
+        F[k] = poly + 2 * N;
+        G[k] = poly + 3 * N;
+        B_[k] = keys[off + k_].B.data();
+        T_[k] = keys[off + k_].T.data();
+
+        if (k != k_) {
+          continue;
+        }
+
+        const auto skey = skeys + (off + k) * sklen;
+        const bool decoded = decoding::decode_skey<N>(
+          skey, poly, poly + N, poly + 2 * N);
+        if (!decoded) [[unlikely]] {
+          return decoded;
+        }
+
+        recompute_G<N>(poly, poly + N, poly + 2 * N, poly + 3 * N);
+      }
+
+      const auto ws_ = std::span(reinterpret_cast<uint8_t*>(ws.data()), wslen);
+      falcon_tree_batch::expand_ws<N, K>(f, g, F, G, B_, T_, σ, ws_);
+
+      for (size_t k = 0; k < cnt; k++) {
+        auto& key = keys[off + k];
+        ffsampling::precompute_leaves<N, 0, log2<N>()>(
+          key.T.data(), σ_min, key.L.data());
+      }
+    }
+
+    return true;
+  }
+
+  // Generates a fresh keypair, directly in its expanded form, using
+  // `keygen::keygen_ws`, writing byte encoded public key to `pkey`. Scratch
+  // space of `keygen::keygen_ws_len<N>()` -bytes and PRNG are supplied by
+  // caller. Note, byte encoded secret key is never computed.
+  template<prng::rng RNG>
+  inline void generate(uint8_t* const __restrict pkey,
+                       std::span<uint8_t> ws,
+                       RNG& rng)
+  {
+    ff::ff_t h[N];
+
+    keygen::keygen_ws<N>(B.data(), T.data(), h, σ, ws, rng);
+    ffsampling::precompute_leaves<N, 0, log2<N>()>(T.data(), σ_min, L.data());
+    encoding::encode_pkey<N>(h, pkey);
+  }
+
+  // Same as above, but also writes byte encoded secret key to `skey`, so that
+  // a fresh keypair can be both stored and used for signing, without decoding
+  // secret key and expanding it again ( see `expand` ).
+  template<prng::rng RNG>
+  inline void generate(uint8_t* const __restrict pkey,
+                       uint8_t* const __restrict skey,
+                       std::span<uint8_t> ws,
+                       RNG& rng)
+  {
+    keygen::keygen_ws<N>(B.data(), T.data(), pkey, skey, σ, ws, rng);
+    ffsampling::precompute_leaves<N, 0, log2<N>()>(T.data(), σ_min, L.data());
+  }
+
+  // Zeroes matrix B, falcon tree T and SamplerZ constants for leaves of T, so
+  // that no secret key material is left behind, once key isn't needed anymore.
+  // Key must be expanded again, before it can be used for signing.
+  inline void wipe()
+  {
+    falcon_utils::secure_wipe(B.data(), B.size() * sizeof(fft::cmplx));
+    falcon_utils::secure_wipe(T.data(), T.size() * sizeof(fft::cmplx));
+    falcon_utils::secure_wipe(L.data(), L.size() * sizeof(samplerz::leaf_t));
+  }
+
+  // Signs mlen -bytes message, using expanded secret key, writing compressed
+  // signature to `sig`, while scratch space and PRNG are supplied by caller.
+  template<prng::rng RNG>
+  inline void sign(const uint8_t* const __restrict msg,
+                   const size_t mlen,
+                   uint8_t* const __restrict sig,
+                   signing::workspace_t<N>& ws,
+                   RNG& rng) const
+  {
+    const auto B_ = B.data();
+    const auto T_ = T.data();
+    const auto L_ = L.data();
+
+    signing::sign<N, β2, slen>(B_, T_, L_, msg, mlen, sig, ws, rng);
+  }
+
+  // Signs `count` -many messages s.t. i-th message is of `mlens[i]` -bytes,
+  // using expanded secret key, writing i-th compressed signature to `sigs[i]`.
+  // Messages are hashed four at a time ( see `signing::sign_x4` ), while
+  // remaining ones are signed one by one.
+  template<prng::rng RNG>
+  inline void sign_batch(const uint8_t* const* const __restrict msgs,
+                         const size_t* const __restrict mlens,
+                         uint8_t* const* const __restrict sigs,
+                         const size_t count,
+                         signing::workspace_t<N>& ws,
+                         RNG& rng) const
+  {
+    const auto B_ = B.data();
+    const auto T_ = T.data();
+    const auto L_ = L.data();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+      const auto m = msgs + i;
+      const auto ml = mlens + i;
+      const auto s = sigs + i;
+
+      signing::sign_x4<N, β2, slen>(B_, T_, L_, m, ml, s, ws, rng);
+    }
+    for (; i < count; i++) {
+      sign(msgs[i], mlens[i], sigs[i], ws, rng);
+    }
+  }
+};
+
+// Signing context, which owns everything required for signing messages with a
+// Falcon{512, 1024} secret key, so that it can be reused across many signing
+// calls, without any per-call setup i.e.
+//
+// - ChaCha20 based PRNG, seeded when context is created and seeded again, if
+//   process forks, so that parent and child never share keystream
+// - Expanded secret key ( see `expanded_key_t` ), which is recomputed only when
+//   a different secret key is loaded, as told by SHAKE256 digest of secret key
+// - Scratch space required during signing ( see `signing::workspace_t` )
+//
+// All of those are heap allocated, so that context doesn't occupy ~ hundreds of
+// KB of stack. Expanded secret key is wiped when it's replaced and when context
+// is destroyed. A context must be used by a single thread at a time, see
+// `thread_context`.
+template<const size_t N>
+  requires((N == 512) || (N == 1024))
+struct context_t
+{
+private:
+  static constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  static constexpr size_t dlen = 32;
+
+  uint8_t digest[dlen]{};
+  expanded_key_t<N> key;
+  std::unique_ptr<signing::workspace_t<N>> ws =
+    std::make_unique<signing::workspace_t<N>>();
+  bool loaded = false;
+
+#if defined __unix__ || defined __APPLE__
+  pid_t pid = getpid();
+#endif
+
+  // Seeds PRNG again, if calling process isn't the one which seeded it i.e. it
+  // was forked, after PRNG was seeded.
+  inline void reseed_if_forked()
+  {
+#if defined __unix__ || defined __APPLE__
+    const pid_t pid_ = getpid();
+    if (pid_ != pid) [[unlikely]] {
+      rng = prng::chacha20_t();
+      pid = pid_;
+    }
+#endif
+  }
+
+public:
+  prng::chacha20_t rng;
+
+  context_t() = default;
+  context_t(const context_t&) = delete;
+  context_t& operator=(const context_t&) = delete;
+
+  inline ~context_t()
+  {
+    key.wipe();
+    falcon_utils::secure_wipe(digest, sizeof(digest));
+  }
+
+  // Loads byte encoded secret key into context, expanding it. If same secret
+  // key is already loaded, this is a no-op. Returns false, if secret key can't
+  // be decoded.
+  inline bool load(const uint8_t* const __restrict skey)
+  {
+    uint8_t digest_[dlen];
+
+    shake256::shake256<false> hasher;
+    hasher.hash(skey, sklen);
+    hasher.read(digest_, sizeof(digest_));
+
+    if (loaded && falcon_utils::ct_equal(digest, digest_, dlen)) {
+      return true;
+    }
+
+    if (loaded) {
+      key.wipe();
+    }
+
+    loaded = key.expand(skey);
+    if (!loaded) [[unlikely]] {
+      key.wipe();
+      return loaded;
+    }
+
+    std::copy_n(digest_, dlen, digest);
+    return loaded;
+  }
+
+  // Signs mlen -bytes message, using secret key, which was last loaded into
+  // this context, writing compressed signature to `sig`.
+  inline void sign(const uint8_t* const __restrict msg,
+                   const size_t mlen,
+                   uint8_t* const __restrict sig)
+  {
+    reseed_if_forked();
+    key.sign(msg, mlen, sig, *ws, rng);
+  }
+};
+
+// Returns signing context owned by calling thread, which is created on first
+// use, by that thread, and lives as long as the thread does.
+//
+// Note, unlike other routines, this one isn't marked `static`, so that all
+// translation units share same context, per thread.
+template<const size_t N>
+inline context_t<N>&
+thread_context()
+  requires((N == 512) || (N == 1024))
+{
+  thread_local context_t<N> ctx;
+  return ctx;
+}
+
 // [User Friendly API] Falcon{512, 1024} message signing algorithm, takes
 // following inputs
 //
@@ -186,6 +633,11 @@ sign(const fft::cmplx* const __restrict B, // 2x2 matrix [[g, -f], [G, -F]]
 // when one signs many messages - one after another say. But for single shot
 // usecases, where secret key is loaded into memory just to sign a single
 // message, one might prefer using this routine.
+//
+// Signing happens using calling thread's signing context ( see
+// `thread_context` ), so that PRNG and scratch space are reused, while matrix
+// B and falcon tree T are computed again, only when secret key changes between
+// consecutive calls, made by same thread.
 template<const size_t N>
 static inline bool
 sign(const uint8_t* const __restrict skey,
@@ -194,24 +646,14 @@ sign(const uint8_t* const __restrict skey,
      uint8_t* const __restrict sig)
   requires((N == 512) || (N == 1024))
 {
-  int32_t f[N];
-  int32_t g[N];
-  int32_t F[N];
-  int32_t G[N];
-  fft::cmplx B[2 * 2 * N];
-  fft::cmplx T[(1ul << log2<N>()) * (log2<N>() + 1)];
-  prng::prng_t rng;
+  auto& ctx = thread_context<N>();
 
-  const bool decoded = decoding::decode_skey<N>(skey, f, g, F);
-  if (!decoded) [[unlikely]] {
-    return decoded;
+  const bool loaded = ctx.load(skey);
+  if (!loaded) [[unlikely]] {
+    return loaded;
   }
 
-  recompute_G<N>(f, g, F, G);
-  compute_matrix_B<N>(f, g, F, G, B);
-  compute_falcon_tree<N>(B, T);
-  sign<N>(B, T, msg, mlen, sig, rng);
-
+  ctx.sign(msg, mlen, sig);
   return true;
 }
 
@@ -232,7 +674,7 @@ static inline bool
 verify(const uint8_t* const __restrict pkey,
        const uint8_t* const __restrict msg,
        const size_t mlen,
-       uint8_t* const __restrict sig)
+       const uint8_t* const __restrict sig)
   requires((N == 512) || (N == 1024))
 {
   ff::ff_t h[N];
@@ -248,4 +690,76 @@ verify(const uint8_t* const __restrict pkey,
   return verification::verify<N, β2>(h, msg, mlen, sig);
 }
 
+// [User Friendly API] Falcon{512, 1024} signature verification algorithm, same
+// as `verify` above, but message bytes are produced in chunks, by a reader (
+// see `hashing::reader` ), so that large messages can be verified without
+// holding them in memory. Returns false, if reader reports an error.
+template<const size_t N, hashing::reader Reader>
+static inline bool
+verify_stream(const uint8_t* const __restrict pkey,
+              Reader& read,
+              const uint8_t* const __restrict sig)
+  requires((N == 512) || (N == 1024))
+{
+  ff::ff_t h[N];
+
+  const size_t decoded = decoding::decode_pkey<N>(pkey, h);
+  if (!decoded) [[unlikely]] {
+    return decoded;
+  }
+
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr int32_t β2 = β2_values[N == 1024];
+
+  return verification::verify_stream<N, β2>(h, read, sig);
+}
+
+// [User Friendly API] Falcon{512, 1024} batch signature verification
+// algorithm, which verifies `count` -many ( message, signature ) pairs, all
+// signed with secret key corresponding to same public key. i-th message is of
+// `mlens[i]` -bytes, while verification result of i-th signature is written to
+// `res[i]`.
+//
+// Public key is decoded only once, while messages are hashed in groups of four,
+// using 4-way interleaved Keccak, see `hashing::hash_to_point_x4`. Remaining
+// ones are verified one by one. This routine returns false, only if public key
+// can't be decoded, in which case all results are set to false.
+template<const size_t N>
+static inline bool
+verify_batch(const uint8_t* const __restrict pkey,
+             const uint8_t* const* const __restrict msgs,
+             const size_t* const __restrict mlens,
+             const uint8_t* const* const __restrict sigs,
+             bool* const __restrict res,
+             const size_t count)
+  requires((N == 512) || (N == 1024))
+{
+  ff::ff_t h[N];
+
+  const size_t decoded = decoding::decode_pkey<N>(pkey, h);
+  if (!decoded) [[unlikely]] {
+    std::fill_n(res, count, false);
+    return decoded;
+  }
+
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr int32_t β2 = β2_values[N == 1024];
+
+  const ff::ff_t* const hs[]{ h, h, h, h };
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const auto m = msgs + i;
+    const auto ml = mlens + i;
+    const auto s = sigs + i;
+
+    verification::verify_x4<N, β2>(hs, m, ml, s, res + i);
+  }
+  for (; i < count; i++) {
+    res[i] = verification::verify<N, β2>(h, msgs[i], mlens[i], sigs[i]);
+  }
+
+  return true;
+}
+
 }
@@ -1,8 +1,12 @@
 #pragma once
 #include "common.hpp"
 #include "polynomial.hpp"
+#include "work_stealing.hpp"
+#include <cassert>
 #include <cmath>
 #include <cstring>
+#include <span>
+#include <vector>
 
 // Construction of Falcon Tree from f, g, F, G ∈ Z[x]/(x^n + 1)
 namespace falcon_tree {
@@ -10,31 +14,67 @@ namespace falcon_tree {
 // Given a full-rank self-adjoint matrix G = (G_ij) ∈ FFT(Q[x]/ φ)^(2×2), this
 // routine computes LDL* decomposition of G = LDL* over FFT(Q[x]/ φ), following
 // algorithm 8 of Falcon specification https://falcon-sign.info/falcon.pdf
+//
+// Scratch space of 2 * N complex numbers is taken from `tmp`.
 template<const size_t N>
 static inline void
 ldl(const fft::cmplx* const __restrict G,
     fft::cmplx* const __restrict l10,
     fft::cmplx* const __restrict d00,
-    fft::cmplx* const __restrict d11)
+    fft::cmplx* const __restrict d11,
+    fft::cmplx* const __restrict tmp)
   requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
 {
   const fft::cmplx* g00 = G;
   const fft::cmplx* g10 = G + 2 * N;
   const fft::cmplx* g11 = G + 3 * N;
 
+  auto tmp0 = tmp;
+  auto tmp1 = tmp + N;
+
   std::memcpy(d00, g00, sizeof(fft::cmplx) * N);
   polynomial::div<log2<N>()>(g10, g00, l10);
 
-  fft::cmplx tmp0[N];
-  fft::cmplx tmp1[N];
-
-  std::memcpy(tmp0, l10, sizeof(tmp0));
+  std::memcpy(tmp0, l10, sizeof(fft::cmplx) * N);
   fft::adj_poly<log2<N>()>(tmp0);
   polynomial::mul<log2<N>()>(l10, tmp0, tmp1);
   polynomial::mul<log2<N>()>(tmp1, g00, tmp0);
   polynomial::sub<log2<N>()>(g11, tmp0, d11);
 }
 
+// Same as above, but scratch space is allocated on stack.
+template<const size_t N>
+static inline void
+ldl(const fft::cmplx* const __restrict G,
+    fft::cmplx* const __restrict l10,
+    fft::cmplx* const __restrict d00,
+    fft::cmplx* const __restrict d11)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  fft::cmplx tmp[2 * N];
+  ldl<N>(G, l10, d00, d11, tmp);
+}
+
+// At levels of recursion of `ffldl_ws`, where polynomials are of degree >=
+// FORK_JOIN_MIN_N, both children are visited in parallel, when calling thread
+// is in fork-join execution mode ( see `work_stealing::fork_join_scope_t` ).
+constexpr size_t FORK_JOIN_MIN_N = 64;
+
+// Compile-time compute byte length of scratch space, required by `ffldl_ws`,
+// for computing LDL tree of a Gram matrix, whose each component is a degree N
+// polynomial. It covers all levels of recursion.
+template<const size_t N>
+static inline constexpr size_t
+ffldl_ws_len()
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  if constexpr (N == 2) {
+    return sizeof(fft::cmplx) * 4 * N;
+  } else {
+    return sizeof(fft::cmplx) * 6 * N + ffldl_ws_len<N / 2>();
+  }
+}
+
 // Given a full-rank Gram matrix G ∈ FFT(Q[x]/ (x^N + 1))^(2×2), this routine
 // computes LDL tree T ( which is a binary tree ), by recursively splitting
 // diagonal elements of D, which is obtained by repeated LDL* decomposition of
@@ -51,60 +91,103 @@ ldl(const fft::cmplx* const __restrict G,
 // has enough space for storing those many complex numbers. Also note, at
 // deepest level of recursion i.e. when N = 2, only real part of complex number
 // matters i.e. imaginary part is negligibly small.
+//
+// All scratch space is taken from caller supplied workspace `ws`, which must
+// be of at least `ffldl_ws_len<N>()` -bytes and aligned to
+// `alignof(fft::cmplx)` -bytes. Nothing big is put on stack, so it can be
+// called from a thread ( or fiber ) with a small stack. In fork-join execution
+// mode, scratch space of children being visited by other workers, is
+// allocated on heap.
 template<const size_t N, const size_t AT_LEVEL, const size_t T_HEIGHT>
 static inline void
-ffldl(const fft::cmplx* const __restrict G, fft::cmplx* const __restrict T)
+ffldl_ws(const fft::cmplx* const __restrict G,
+         fft::cmplx* const __restrict T,
+         std::span<uint8_t> ws)
   requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024) &&
            (AT_LEVEL < T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
 {
+  assert(fft::is_valid_ws(ws, ffldl_ws_len<N>()));
+
   constexpr size_t node_cnt = 1ul << AT_LEVEL;
   constexpr size_t tree_off = node_cnt * N;
 
-  fft::cmplx D00[N];
-  fft::cmplx D11[N];
+  auto D00 = reinterpret_cast<fft::cmplx*>(ws.data());
+  auto D11 = D00 + N;
+  auto G0 = D11 + N;
 
-  ldl<N>(G, T, D00, D11);
+  // G0 isn't yet populated, so it's used as scratch space by LDL*
+  ldl<N>(G, T, D00, D11, G0);
 
   if constexpr (N == 2) {
     // deepest level of recursion !
     static_assert(AT_LEVEL == (T_HEIGHT - 1),
                   "Can't go below this level of tree !");
 
-    std::memcpy(T + tree_off, D00, sizeof(D00) / 2);
-    std::memcpy(T + tree_off + (N / 2), D11, sizeof(D11) / 2);
+    std::memcpy(T + tree_off, D00, sizeof(fft::cmplx) * (N / 2));
+    std::memcpy(T + tree_off + (N / 2), D11, sizeof(fft::cmplx) * (N / 2));
 
     return;
   } else {
-    fft::cmplx d00[N / 2];
-    fft::cmplx d01[N / 2];
-    fft::cmplx d10[N / 2];
-    fft::cmplx d11[N / 2];
-
-    fft::split_fft<log2<N>()>(D00, d00, d01);
-    fft::split_fft<log2<N>()>(D11, d10, d11);
+    constexpr size_t hlen = sizeof(fft::cmplx) * (N / 2);
 
-    fft::cmplx G0[(N / 2) * 2 * 2];
-    fft::cmplx G1[(N / 2) * 2 * 2];
+    auto G1 = G0 + 2 * N;
 
-    std::memcpy(G0, d00, sizeof(d00));
-    std::memcpy(G0 + (N / 2), d01, sizeof(d01));
-    std::memcpy(G0 + N, d01, sizeof(d01));
-    std::memcpy(G0 + N + (N / 2), d00, sizeof(d00));
+    // G0 = [[d00, d01], [d01*, d00*]], where d00 and d01 are halves of D00
+    fft::split_fft<log2<N>()>(D00, G0, G0 + (N / 2));
+    std::memcpy(G0 + N, G0 + (N / 2), hlen);
+    std::memcpy(G0 + N + (N / 2), G0, hlen);
     fft::adj_poly<log2<N>()>(G0 + N);
 
-    std::memcpy(G1, d10, sizeof(d10));
-    std::memcpy(G1 + (N / 2), d11, sizeof(d11));
-    std::memcpy(G1 + N, d11, sizeof(d11));
-    std::memcpy(G1 + N + (N / 2), d10, sizeof(d10));
+    // G1 = [[d10, d11], [d11*, d10*]], where d10 and d11 are halves of D11
+    fft::split_fft<log2<N>()>(D11, G1, G1 + (N / 2));
+    std::memcpy(G1 + N, G1 + (N / 2), hlen);
+    std::memcpy(G1 + N + (N / 2), G1, hlen);
     fft::adj_poly<log2<N>()>(G1 + N);
 
-    ffldl<N / 2, AT_LEVEL + 1, T_HEIGHT>(G0, T + tree_off);
-    ffldl<N / 2, AT_LEVEL + 1, T_HEIGHT>(G1, T + tree_off + (N / 2));
+    const auto ws_ = ws.subspan(sizeof(fft::cmplx) * 6 * N);
+
+    if constexpr (N >= FORK_JOIN_MIN_N) {
+      if (work_stealing::fork_join_pool() != nullptr) {
+        // children are visited in parallel, so second one gets its own
+        // scratch space
+        constexpr size_t wlen = ffldl_ws_len<N / 2>();
+        std::vector<fft::cmplx> ws1(wlen / sizeof(fft::cmplx));
+
+        work_stealing::fork_join(
+          [&]() {
+            ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT>(G0, T + tree_off, ws_);
+          },
+          [&]() {
+            auto ws1_ = std::span(reinterpret_cast<uint8_t*>(ws1.data()), wlen);
+            auto T1 = T + tree_off + (N / 2);
+
+            ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT>(G1, T1, ws1_);
+          });
+
+        return;
+      }
+    }
+
+    // both children reuse same scratch space, as they are visited one after
+    // another
+    ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT>(G0, T + tree_off, ws_);
+    ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT>(G1, T + tree_off + (N / 2), ws_);
 
     return;
   }
 }
 
+// Same as `ffldl_ws` above, but scratch space is allocated on stack.
+template<const size_t N, const size_t AT_LEVEL, const size_t T_HEIGHT>
+static inline void
+ffldl(const fft::cmplx* const __restrict G, fft::cmplx* const __restrict T)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024) &&
+           (AT_LEVEL < T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
+{
+  alignas(fft::cmplx) uint8_t ws[ffldl_ws_len<N>()];
+  ffldl_ws<N, AT_LEVEL, T_HEIGHT>(G, T, ws);
+}
+
 // Normalizes LDL tree's leaf nodes computing a Falcon tree, following step 6, 7
 // of algorithm 4 of Falcon specification https://falcon-sign.info/falcon.pdf
 template<const size_t N, const size_t AT_LEVEL, const size_t T_HEIGHT>
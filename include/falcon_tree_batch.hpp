@@ -0,0 +1,377 @@
+#pragma once
+#include "common.hpp"
+#include "falcon_tree.hpp"
+#include "fft.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Construction of matrix B and Falcon Tree T, for a batch of K -many keys at
+// once, s.t. all keys of batch go through FFT, Gram matrix computation and
+// ffLDL* in lockstep, with one key per SIMD lane. This is useful when many
+// secret keys need to be expanded at once ( e.g. while importing them ), as at
+// lower levels of ffLDL* recursion, each key alone works on too short arrays
+// for SIMD to pay off.
+namespace falcon_tree_batch {
+
+// Default # -of keys in a batch, s.t. real ( or imaginary ) parts of one
+// complex number, across all keys of batch, fill a 256 -bit register. Wider
+// batches make working set of Falcon1024 spill out of L2 cache, which costs
+// more than it saves.
+constexpr size_t LANES = 4;
+
+// K complex numbers, one per key of batch, s.t. real and imaginary parts are
+// kept in separate arrays, so that each arithmetic operation is performed on
+// all K keys at once, by an ( auto-vectorized ) loop over lanes.
+//
+// A polynomial of degree N, for whole batch, is an array of N such elements,
+// so that it can be split and indexed just like N -many `fft::cmplx`.
+template<const size_t K>
+struct lanes_t
+{
+  double re[K];
+  double im[K];
+};
+
+// Cooley-Tukey butterfly, performed on all K lanes at once i.e. u, v = u + ζ *
+// v, u - ζ * v.
+template<const size_t K>
+static inline void
+butterfly(lanes_t<K>& __restrict u,
+          lanes_t<K>& __restrict v,
+          const double ζ_re,
+          const double ζ_im)
+{
+  for (size_t k = 0; k < K; k++) {
+    const double t_re = ζ_re * v.re[k] - ζ_im * v.im[k];
+    const double t_im = ζ_re * v.im[k] + ζ_im * v.re[k];
+
+    v.re[k] = u.re[k] - t_re;
+    v.im[k] = u.im[k] - t_im;
+    u.re[k] = u.re[k] + t_re;
+    u.im[k] = u.im[k] + t_im;
+  }
+}
+
+// Computes fast fourier transform of a batch of polynomials, each with {512,
+// 1024} coefficients, same as `fft::fft`, but in lockstep.
+template<const size_t LOG2N, const size_t K>
+static inline void
+fft(lanes_t<K>* const __restrict vec)
+  requires((LOG2N > 0) && (LOG2N <= 10))
+{
+  constexpr size_t N = 1ul << LOG2N;
+
+  for (int64_t l = LOG2N - 1; l >= 0; l--) {
+    const size_t len = 1ul << l;
+    const size_t lenx2 = len << 1;
+    const size_t k_beg = N >> (l + 1);
+
+    for (size_t start = 0; start < N; start += lenx2) {
+      const size_t k_now = k_beg + (start >> (l + 1));
+      const double ζ_re = fft::POWERS_OF_ζ[k_now].real();
+      const double ζ_im = fft::POWERS_OF_ζ[k_now].imag();
+
+      for (size_t i = start; i < start + len; i++) {
+        butterfly<K>(vec[i], vec[i + len], ζ_re, ζ_im);
+      }
+    }
+  }
+}
+
+// Splits a batch of polynomials f into f0, f1, in their FFT representation,
+// same as `fft::split_fft`, but in lockstep.
+template<const size_t LOG2N, const size_t K>
+static inline void
+split_fft(const lanes_t<K>* const __restrict f,
+          lanes_t<K>* const __restrict f0,
+          lanes_t<K>* const __restrict f1)
+  requires((LOG2N > 0) && (LOG2N <= 10))
+{
+  constexpr size_t N = 1ul << LOG2N;
+  constexpr size_t hN = N >> 1;
+
+  for (size_t i = 0; i < hN; i++) {
+    const double ζ_re = fft::POWERS_OF_ζ[hN + i].real();
+    const double ζ_im = fft::POWERS_OF_ζ[hN + i].imag();
+
+    const auto& a = f[2 * i];
+    const auto& b = f[2 * i + 1];
+
+    for (size_t k = 0; k < K; k++) {
+      const double d_re = 0.5 * (a.re[k] - b.re[k]);
+      const double d_im = 0.5 * (a.im[k] - b.im[k]);
+
+      f0[i].re[k] = 0.5 * (a.re[k] + b.re[k]);
+      f0[i].im[k] = 0.5 * (a.im[k] + b.im[k]);
+
+      // multiplied by conjugate of ζ
+      f1[i].re[k] = d_re * ζ_re + d_im * ζ_im;
+      f1[i].im[k] = d_im * ζ_re - d_re * ζ_im;
+    }
+  }
+}
+
+// Computes Hermitian adjoint of a batch of polynomials, in their FFT
+// representation, same as `fft::adj_poly`, but in lockstep.
+template<const size_t LOG2N, const size_t K>
+static inline void
+adj_poly(lanes_t<K>* const poly)
+  requires((LOG2N > 0) && (LOG2N <= 10))
+{
+  constexpr size_t N = 1ul << LOG2N;
+
+  for (size_t i = 0; i < N; i++) {
+    for (size_t k = 0; k < K; k++) {
+      poly[i].im[k] = -poly[i].im[k];
+    }
+  }
+}
+
+// Computes a * b* + c * d*, element-wise, for a batch of polynomials in their
+// FFT representation, writing result to `res`.
+template<const size_t N, const size_t K>
+static inline void
+mul_adj_add(const lanes_t<K>* const __restrict a,
+            const lanes_t<K>* const __restrict b,
+            const lanes_t<K>* const __restrict c,
+            const lanes_t<K>* const __restrict d,
+            lanes_t<K>* const __restrict res)
+{
+  for (size_t i = 0; i < N; i++) {
+    for (size_t k = 0; k < K; k++) {
+      const double ab_re = a[i].re[k] * b[i].re[k] + a[i].im[k] * b[i].im[k];
+      const double ab_im = a[i].im[k] * b[i].re[k] - a[i].re[k] * b[i].im[k];
+      const double cd_re = c[i].re[k] * d[i].re[k] + c[i].im[k] * d[i].im[k];
+      const double cd_im = c[i].im[k] * d[i].re[k] - c[i].re[k] * d[i].im[k];
+
+      res[i].re[k] = ab_re + cd_re;
+      res[i].im[k] = ab_im + cd_im;
+    }
+  }
+}
+
+// Computes Gram matrix G = B x B* for a batch of 2x2 matrices B, whose
+// components are in their FFT representation, same as
+// `keygen::compute_gram_matrix`, but in lockstep.
+template<const size_t N, const size_t K>
+static inline void
+compute_gram_matrix(const lanes_t<K>* const __restrict B,
+                    lanes_t<K>* const __restrict G)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  const auto b00 = B;
+  const auto b01 = B + N;
+  const auto b10 = B + 2 * N;
+  const auto b11 = B + 3 * N;
+
+  mul_adj_add<N, K>(b00, b00, b01, b01, G);
+  mul_adj_add<N, K>(b00, b10, b01, b11, G + N);
+  mul_adj_add<N, K>(b10, b00, b11, b01, G + 2 * N);
+  mul_adj_add<N, K>(b10, b10, b11, b11, G + 3 * N);
+}
+
+// Computes LDL* decomposition of a batch of full-rank self-adjoint matrices G,
+// same as `falcon_tree::ldl`, but in lockstep.
+template<const size_t N, const size_t K>
+static inline void
+ldl(const lanes_t<K>* const __restrict G,
+    lanes_t<K>* const __restrict l10,
+    lanes_t<K>* const __restrict d00,
+    lanes_t<K>* const __restrict d11)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  const auto g00 = G;
+  const auto g10 = G + 2 * N;
+  const auto g11 = G + 3 * N;
+
+  std::memcpy(d00, g00, sizeof(lanes_t<K>) * N);
+
+  for (size_t i = 0; i < N; i++) {
+    for (size_t k = 0; k < K; k++) {
+      const double a_re = g10[i].re[k];
+      const double a_im = g10[i].im[k];
+      const double b_re = g00[i].re[k];
+      const double b_im = g00[i].im[k];
+      const double inv = 1. / (b_re * b_re + b_im * b_im);
+
+      // l10 = g10 / g00
+      const double l_re = (a_re * b_re + a_im * b_im) * inv;
+      const double l_im = (a_im * b_re - a_re * b_im) * inv;
+
+      // d11 = g11 - l10 * l10* * g00, where l10 * l10* = |l10|^2
+      const double ll = l_re * l_re + l_im * l_im;
+
+      l10[i].re[k] = l_re;
+      l10[i].im[k] = l_im;
+      d11[i].re[k] = g11[i].re[k] - ll * b_re;
+      d11[i].im[k] = g11[i].im[k] - ll * b_im;
+    }
+  }
+}
+
+// Compile-time compute byte length of scratch space, required by `ffldl_ws`,
+// for a batch of K -many keys.
+template<const size_t N, const size_t K>
+static inline constexpr size_t
+ffldl_ws_len()
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  return K * falcon_tree::ffldl_ws_len<N>();
+}
+
+// Computes LDL tree T of a batch of Gram matrices G, same as
+// `falcon_tree::ffldl_ws`, but in lockstep, s.t. i-th node of tree is stored
+// at T[i], for all keys of batch.
+//
+// All scratch space is taken from caller supplied workspace `ws`, which must
+// be of at least `ffldl_ws_len<N, K>()` -bytes and aligned to
+// `alignof(lanes_t<K>)` -bytes.
+template<const size_t N,
+         const size_t AT_LEVEL,
+         const size_t T_HEIGHT,
+         const size_t K>
+static inline void
+ffldl_ws(const lanes_t<K>* const __restrict G,
+         lanes_t<K>* const __restrict T,
+         std::span<uint8_t> ws)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024) &&
+           (AT_LEVEL < T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
+{
+  assert(fft::is_valid_ws(ws, ffldl_ws_len<N, K>(), alignof(lanes_t<K>)));
+
+  constexpr size_t node_cnt = 1ul << AT_LEVEL;
+  constexpr size_t tree_off = node_cnt * N;
+
+  auto D00 = reinterpret_cast<lanes_t<K>*>(ws.data());
+  auto D11 = D00 + N;
+  auto G0 = D11 + N;
+
+  ldl<N, K>(G, T, D00, D11);
+
+  if constexpr (N == 2) {
+    // deepest level of recursion !
+    static_assert(AT_LEVEL == (T_HEIGHT - 1),
+                  "Can't go below this level of tree !");
+
+    std::memcpy(T + tree_off, D00, sizeof(lanes_t<K>) * (N / 2));
+    std::memcpy(T + tree_off + (N / 2), D11, sizeof(lanes_t<K>) * (N / 2));
+  } else {
+    constexpr size_t hlen = sizeof(lanes_t<K>) * (N / 2);
+
+    auto G1 = G0 + 2 * N;
+
+    // G0 = [[d00, d01], [d01*, d00*]], where d00 and d01 are halves of D00
+    split_fft<log2<N>(), K>(D00, G0, G0 + (N / 2));
+    std::memcpy(G0 + N, G0 + (N / 2), hlen);
+    std::memcpy(G0 + N + (N / 2), G0, hlen);
+    adj_poly<log2<N>(), K>(G0 + N);
+
+    // G1 = [[d10, d11], [d11*, d10*]], where d10 and d11 are halves of D11
+    split_fft<log2<N>(), K>(D11, G1, G1 + (N / 2));
+    std::memcpy(G1 + N, G1 + (N / 2), hlen);
+    std::memcpy(G1 + N + (N / 2), G1, hlen);
+    adj_poly<log2<N>(), K>(G1 + N);
+
+    // both children reuse same scratch space, as they are visited one after
+    // another
+    const auto ws_ = ws.subspan(sizeof(lanes_t<K>) * 6 * N);
+
+    ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT, K>(G0, T + tree_off, ws_);
+    ffldl_ws<N / 2, AT_LEVEL + 1, T_HEIGHT, K>(G1, T + tree_off + N / 2, ws_);
+  }
+}
+
+// Compile-time compute byte length of scratch space, required by `expand_ws`,
+// for a batch of K -many keys. It holds matrix B, Gram matrix and LDL tree of
+// whole batch, along with scratch space of `ffldl_ws`.
+template<const size_t N, const size_t K>
+static inline constexpr size_t
+expand_ws_len()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t ftlen = N * (log2<N>() + 1);
+  constexpr size_t len = 2 * 2 * N + 2 * 2 * N + ftlen;
+
+  return sizeof(lanes_t<K>) * len + ffldl_ws_len<N, K>();
+}
+
+// Given K -many secret keys f, g, F, G ∈ Z[x]/(x^N + 1), this routine computes
+// matrix B = [[g, -f], [G, -F]] ( in its FFT form ) and Falcon tree T of each
+// of them ( same as `falcon::compute_matrix_B` followed by
+// `falcon::compute_falcon_tree` ), s.t. whole batch is processed in lockstep.
+// i-th key is read from f[i], g[i], F[i], G[i], while its B and T are written
+// to B[i] and T[i]. Same key may appear in more than one slot of batch.
+//
+// All scratch space is taken from caller supplied workspace `ws`, which must
+// be of at least `expand_ws_len<N, K>()` -bytes and aligned to
+// `alignof(lanes_t<K>)` -bytes.
+//
+// Results may differ from those computed one key at a time, in least
+// significant bits, as complex arithmetic is performed in different order.
+template<const size_t N, const size_t K>
+static inline void
+expand_ws(const int32_t* const* const __restrict f,
+          const int32_t* const* const __restrict g,
+          const int32_t* const* const __restrict F,
+          const int32_t* const* const __restrict G,
+          fft::cmplx* const* const __restrict B,
+          fft::cmplx* const* const __restrict T,
+          const double σ,
+          std::span<uint8_t> ws)
+  requires((N == 512) || (N == 1024))
+{
+  assert(fft::is_valid_ws(ws, expand_ws_len<N, K>(), alignof(lanes_t<K>)));
+
+  constexpr size_t LOG2N = log2<N>();
+  constexpr size_t ftlen = N * (LOG2N + 1);
+
+  auto B_ = reinterpret_cast<lanes_t<K>*>(ws.data());
+  auto gram = B_ + 2 * 2 * N;
+  auto T_ = gram + 2 * 2 * N;
+  auto ws_ = ws.subspan(sizeof(lanes_t<K>) * (2 * 2 * N + 2 * 2 * N + ftlen));
+
+  for (size_t k = 0; k < K; k++) {
+    for (size_t i = 0; i < N; i++) {
+      B_[i].re[k] = static_cast<double>(g[k][i]);
+      B_[N + i].re[k] = -static_cast<double>(f[k][i]);
+      B_[2 * N + i].re[k] = static_cast<double>(G[k][i]);
+      B_[3 * N + i].re[k] = -static_cast<double>(F[k][i]);
+    }
+  }
+  for (size_t i = 0; i < 2 * 2 * N; i++) {
+    std::fill_n(B_[i].im, K, 0.);
+  }
+
+  fft<LOG2N, K>(B_);
+  fft<LOG2N, K>(B_ + N);
+  fft<LOG2N, K>(B_ + 2 * N);
+  fft<LOG2N, K>(B_ + 3 * N);
+
+  compute_gram_matrix<N, K>(B_, gram);
+  ffldl_ws<N, 0, LOG2N, K>(gram, T_, ws_);
+
+  // leaves of tree are stored contiguously, at its end, see
+  // `falcon_tree::normalize_tree`
+  for (size_t i = N * LOG2N; i < ftlen; i++) {
+    for (size_t k = 0; k < K; k++) {
+      T_[i].re[k] = σ / std::sqrt(T_[i].re[k]);
+      T_[i].im[k] = 0.;
+    }
+  }
+
+  for (size_t k = 0; k < K; k++) {
+    for (size_t i = 0; i < 2 * 2 * N; i++) {
+      B[k][i] = fft::cmplx{ B_[i].re[k], B_[i].im[k] };
+    }
+    for (size_t i = 0; i < ftlen; i++) {
+      T[k][i] = fft::cmplx{ T_[i].re[k], T_[i].im[k] };
+    }
+  }
+}
+
+}
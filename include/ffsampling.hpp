@@ -3,29 +3,81 @@
 #include "polynomial.hpp"
 #include "prng.hpp"
 #include "samplerz.hpp"
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <span>
 
 // Fast Fourier Sampling
 namespace ffsampling {
 
+// Given normalized Falcon Tree T ( in its FFT representation ), rooted at level
+// `AT_LEVEL`, this routine computes constants, required by SamplerZ, for each
+// of N leaves of tree, so that they can be computed once per tree, instead of
+// doing so, each time a leaf is reached, during ffSampling.
+//
+// Note, leaves of ( sub )tree are stored contiguously, at the end of tree, in
+// same order as they are visited by ffSampling.
+template<const size_t N, const size_t AT_LEVEL, const size_t T_HEIGHT>
+static inline void
+precompute_leaves(const fft::cmplx* const __restrict T,
+                  const double σ_min,
+                  samplerz::leaf_t* const __restrict L)
+  requires((N > 0) && ((N & (N - 1)) == 0) && (N <= 1024) &&
+           (AT_LEVEL <= T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
+{
+  constexpr size_t leaf_off = (1ul << T_HEIGHT) * (T_HEIGHT - AT_LEVEL);
+
+  for (size_t i = 0; i < N; i++) {
+    L[i] = samplerz::compute_leaf(T[leaf_off + i].real(), σ_min);
+  }
+}
+
+// Compile-time compute byte length of scratch space, required by
+// `ff_sampling_ws`, for sampling using a ( sub )tree with N leaves. It covers
+// all levels of recursion.
+template<const size_t N>
+static inline constexpr size_t
+ff_sampling_ws_len()
+  requires((N > 0) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  if constexpr (N == 1) {
+    return 0;
+  } else {
+    return sizeof(fft::cmplx) * 6 * N + ff_sampling_ws_len<N / 2>();
+  }
+}
+
 // Given two polynomials t0, t1 ∈ FFT(Q[x]/ (x^N + 1)) i.e. in their FFT
-// representation and Falcon Tree T ( in its FFT representation ), this routine
+// representation, Falcon Tree T ( in its FFT representation ) and SamplerZ
+// constants for each leaf of tree ( see `precompute_leaves` ), this routine
 // computes two polynomials z0, z1 ∈ FFT (Z[x]/ (x^N + 1)), using algorithm 11 (
 // ffSampling ) as defined in Falcon specification
 // https://falcon-sign.info/falcon.pdf
 //
 // For understanding ffSampling, you should read section 3.9 of specification.
-template<const size_t N, const size_t AT_LEVEL, const size_t T_HEIGHT>
+//
+// All scratch space is taken from caller supplied workspace `ws`, which must
+// be of at least `ff_sampling_ws_len<N>()` -bytes and aligned to
+// `alignof(fft::cmplx)` -bytes.
+template<const size_t N,
+         const size_t AT_LEVEL,
+         const size_t T_HEIGHT,
+         prng::rng RNG>
 static inline void
-ff_sampling(const fft::cmplx* const __restrict t0,
-            const fft::cmplx* const __restrict t1,
-            const fft::cmplx* const __restrict T,
-            const double σ_min,
-            fft::cmplx* const __restrict z0,
-            fft::cmplx* const __restrict z1,
-            prng::prng_t& rng)
+ff_sampling_ws(const fft::cmplx* const __restrict t0,
+               const fft::cmplx* const __restrict t1,
+               const fft::cmplx* const __restrict T,
+               const samplerz::leaf_t* const __restrict L,
+               fft::cmplx* const __restrict z0,
+               fft::cmplx* const __restrict z1,
+               std::span<uint8_t> ws,
+               RNG& rng)
   requires((N > 0) && ((N & (N - 1)) == 0) && (N <= 1024) &&
            (AT_LEVEL <= T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
 {
+  assert(fft::is_valid_ws(ws, ff_sampling_ws_len<N>()));
+
   constexpr size_t node_cnt = 1ul << AT_LEVEL;
   constexpr size_t tree_off = node_cnt * N;
 
@@ -33,12 +85,15 @@ ff_sampling(const fft::cmplx* const __restrict t0,
     // deepest level of recursion !
     static_assert(AT_LEVEL == T_HEIGHT, "Can't go below leaf level of tree !");
 
-    const double σ_prime = T[0].real();
-    const auto z0_ = samplerz::samplerz(t0[0].real(), σ_prime, σ_min, rng);
-    const auto z1_ = samplerz::samplerz(t1[0].real(), σ_prime, σ_min, rng);
+    // both samples are independent of each other, so sample them together
+    const double μ[]{ t0[0].real(), t1[0].real() };
+    const samplerz::leaf_t leaves[]{ L[0], L[0] };
+    int32_t z[2];
+
+    samplerz::samplerz_batch(μ, leaves, z, 2, rng);
 
-    z0[0] = fft::cmplx{ static_cast<double>(z0_) };
-    z1[0] = fft::cmplx{ static_cast<double>(z1_) };
+    z0[0] = fft::cmplx{ static_cast<double>(z[0]) };
+    z1[0] = fft::cmplx{ static_cast<double>(z[1]) };
 
     return;
   } else {
@@ -50,42 +105,99 @@ ff_sampling(const fft::cmplx* const __restrict t0,
     const auto l = T;
     const auto Tl = T + tree_off;
     const auto Tr = Tl + (N / 2);
+    const auto Ll = L;
+    const auto Lr = Ll + (N / 2);
     const auto z0l = z0;
     const auto z1l = z1;
     const auto z0r = z0l + (N / 2);
     const auto z1r = z1l + (N / 2);
 
-    fft::cmplx t1_0[N / 2];
-    fft::cmplx t1_1[N / 2];
+    auto t1_0 = reinterpret_cast<fft::cmplx*>(ws.data());
+    auto t1_1 = t1_0 + (N / 2);
+    auto merged_z1 = t1_1 + (N / 2);
+    auto tmp0 = merged_z1 + N;
+    auto tmp1 = tmp0 + N;
+    auto t0_0 = tmp1 + N;
+    auto t0_1 = t0_0 + (N / 2);
+    auto merged_z0 = t0_1 + (N / 2);
+
+    // both subtrees reuse same scratch space, as they are visited one after
+    // another
+    const auto ws_ = ws.subspan(sizeof(fft::cmplx) * 6 * N);
 
     fft::split_fft<log2<N>()>(t1, t1_0, t1_1);
-    ff_sampling<nby2, nlvl, T_HEIGHT>(t1_0, t1_1, Tr, σ_min, z0r, z1r, rng);
+    ff_sampling_ws<nby2, nlvl, T_HEIGHT>(
+      t1_0, t1_1, Tr, Lr, z0r, z1r, ws_, rng);
 
-    fft::cmplx merged_z1[N];
     fft::merge_fft<log2<N>()>(z0r, z1r, merged_z1);
 
-    fft::cmplx tmp0[N];
-    fft::cmplx tmp1[N];
     polynomial::sub<log2<N>()>(t1, merged_z1, tmp0);
     polynomial::mul<log2<N>()>(tmp0, l, tmp1);
     polynomial::add<log2<N>()>(t0, tmp1, tmp0);
 
     // t0' = tmp0
 
-    fft::cmplx t0_0[N / 2];
-    fft::cmplx t0_1[N / 2];
-
     fft::split_fft<log2<N>()>(tmp0, t0_0, t0_1);
-    ff_sampling<nby2, nlvl, T_HEIGHT>(t0_0, t0_1, Tl, σ_min, z0l, z1l, rng);
+    ff_sampling_ws<nby2, nlvl, T_HEIGHT>(
+      t0_0, t0_1, Tl, Ll, z0l, z1l, ws_, rng);
 
-    fft::cmplx merged_z0[N];
     fft::merge_fft<log2<N>()>(z0l, z1l, merged_z0);
 
-    std::memcpy(z0, merged_z0, sizeof(merged_z0));
-    std::memcpy(z1, merged_z1, sizeof(merged_z1));
+    std::memcpy(z0, merged_z0, sizeof(fft::cmplx) * N);
+    std::memcpy(z1, merged_z1, sizeof(fft::cmplx) * N);
 
     return;
   }
 }
 
+// Same as `ff_sampling_ws` above, but scratch space is allocated on stack.
+template<const size_t N,
+         const size_t AT_LEVEL,
+         const size_t T_HEIGHT,
+         prng::rng RNG>
+static inline void
+ff_sampling(const fft::cmplx* const __restrict t0,
+            const fft::cmplx* const __restrict t1,
+            const fft::cmplx* const __restrict T,
+            const samplerz::leaf_t* const __restrict L,
+            fft::cmplx* const __restrict z0,
+            fft::cmplx* const __restrict z1,
+            RNG& rng)
+  requires((N > 0) && ((N & (N - 1)) == 0) && (N <= 1024) &&
+           (AT_LEVEL <= T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
+{
+  alignas(fft::cmplx) std::array<uint8_t, ff_sampling_ws_len<N>()> ws;
+  ff_sampling_ws<N, AT_LEVEL, T_HEIGHT>(t0, t1, T, L, z0, z1, ws, rng);
+}
+
+// Given two polynomials t0, t1 ∈ FFT(Q[x]/ (x^N + 1)) i.e. in their FFT
+// representation and Falcon Tree T ( in its FFT representation ), this routine
+// computes two polynomials z0, z1 ∈ FFT (Z[x]/ (x^N + 1)), using algorithm 11 (
+// ffSampling ) as defined in Falcon specification
+// https://falcon-sign.info/falcon.pdf
+//
+// SamplerZ constants for leaves of tree are computed before sampling. When
+// sampling many times, using same tree, prefer computing them once, using
+// `precompute_leaves`, and calling above routine.
+template<const size_t N,
+         const size_t AT_LEVEL,
+         const size_t T_HEIGHT,
+         prng::rng RNG>
+static inline void
+ff_sampling(const fft::cmplx* const __restrict t0,
+            const fft::cmplx* const __restrict t1,
+            const fft::cmplx* const __restrict T,
+            const double σ_min,
+            fft::cmplx* const __restrict z0,
+            fft::cmplx* const __restrict z1,
+            RNG& rng)
+  requires((N > 0) && ((N & (N - 1)) == 0) && (N <= 1024) &&
+           (AT_LEVEL <= T_HEIGHT) && (N == (1ul << (T_HEIGHT - AT_LEVEL))))
+{
+  samplerz::leaf_t L[N];
+  precompute_leaves<N, AT_LEVEL, T_HEIGHT>(T, σ_min, L);
+
+  ff_sampling<N, AT_LEVEL, T_HEIGHT>(t0, t1, T, L, z0, z1, rng);
+}
+
 }
@@ -1,7 +1,9 @@
 #pragma once
 #include <cmath>
 #include <complex>
+#include <cstdint>
 #include <numbers>
+#include <span>
 
 // (inverse) Fast Fourier Transform of degree-{511, 1023} polynomial f ∈
 // Q[x]/(φ) s.t. φ is a monic with distinct roots over C
@@ -9,6 +11,18 @@ namespace fft {
 
 using cmplx = std::complex<double>;
 
+// Checks whether a caller supplied workspace ( see routines named `*_ws` ) is
+// of at least `len` -bytes and aligned to `align` -bytes, which is
+// `alignof(cmplx)` for all of them, but batched ones.
+static inline bool
+is_valid_ws(const std::span<const uint8_t> ws,
+            const size_t len,
+            const size_t align = alignof(cmplx))
+{
+  const auto addr = reinterpret_cast<uintptr_t>(ws.data());
+  return (ws.size() >= len) && ((addr % align) == 0);
+}
+
 // Given a 64 -bit unsigned integer, this routine extracts specified many
 // contiguous bits from ( least significant bit ) LSB side & reverses their bit
 // order, returning bit reversed `mbw` -bit wide number
@@ -0,0 +1,269 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <gmp.h>
+#include <memory>
+#include <vector>
+
+// Arena allocator for GNU MP, which can be installed ( see `install` ), so that
+// big integer temporaries created by NTRUSolve don't each go through system
+// allocator. It's opt-in i.e. unless installed, GMP's memory functions are
+// never touched.
+//
+// Solving NTRU equation for a single Falcon{512, 1024} candidate f, g performs
+// millions of short-lived GMP allocations ( summing up to GBs ), while peak
+// amount of memory live at a time is only a few MBs. Hence memory is carved out
+// of large slabs, using a bump pointer, while freed blocks are kept in per size
+// class free lists, to be reused by following allocations.
+namespace gmp_arena {
+
+// Byte length of each slab, requested from system allocator
+constexpr size_t SLAB_LEN = 1ul << 20;
+
+// Blocks are of 2^i -bytes s.t. i ∈ [MIN_CLASS, MAX_CLASS], while requests for
+// larger blocks go to system allocator
+constexpr size_t MIN_CLASS = 4;
+constexpr size_t MAX_CLASS = 16;
+
+// Allocation counters of calling thread, see `stats`
+struct stats_t
+{
+  uint64_t arena_allocs = 0; // # -of blocks served from arena
+  uint64_t heap_allocs = 0;  // # -of calls made to system allocator
+};
+
+// Per-thread arena, made of slabs, which are only released when thread exits
+struct arena_t
+{
+  std::vector<std::unique_ptr<uint8_t[]>> slabs;
+  uint8_t* top = nullptr; // next free byte of last slab
+  uint8_t* end = nullptr; // one past last byte of last slab
+
+  // Heads of intrusive singly linked free lists, one per size class
+  void* free_lists[MAX_CLASS + 1]{};
+
+  bool active = false;
+  stats_t stats;
+
+  // Size class of block, holding n -bytes
+  static inline size_t size_class(const size_t n)
+  {
+    const size_t c = static_cast<size_t>(std::bit_width(n - 1));
+    return std::max(c, MIN_CLASS);
+  }
+
+  // Whether p points into one of slabs of this arena
+  inline bool owns(const void* const p) const
+  {
+    const auto q = static_cast<const uint8_t*>(p);
+    return std::any_of(slabs.begin(), slabs.end(), [q](const auto& s) {
+      return std::less_equal<>{}(s.get(), q) &&
+             std::less<>{}(q, s.get() + SLAB_LEN);
+    });
+  }
+
+  // Allocates a block of 2^c -bytes, for c ∈ [MIN_CLASS, MAX_CLASS]
+  inline void* alloc(const size_t c)
+  {
+    stats.arena_allocs++;
+
+    if (void* const p = free_lists[c]; p != nullptr) {
+      std::memcpy(&free_lists[c], p, sizeof(void*));
+      return p;
+    }
+
+    const size_t len = 1ul << c;
+    if (static_cast<size_t>(end - top) < len) {
+      stats.heap_allocs++;
+
+      slabs.emplace_back(new uint8_t[SLAB_LEN]);
+      top = slabs.back().get();
+      end = top + SLAB_LEN;
+    }
+
+    void* const p = top;
+    top += len;
+    return p;
+  }
+
+  // Returns a block of 2^c -bytes, back to its free list
+  inline void dealloc(void* const p, const size_t c)
+  {
+    std::memcpy(p, &free_lists[c], sizeof(void*));
+    free_lists[c] = p;
+  }
+};
+
+// Arena of calling thread
+inline arena_t&
+arena()
+{
+  static thread_local arena_t a;
+  return a;
+}
+
+// GMP memory functions, which were in effect, when arena was installed, to
+// which all blocks, not served from arena, are handed over
+struct chain_t
+{
+  void* (*alloc)(size_t) = nullptr;
+  void* (*realloc)(void*, size_t, size_t) = nullptr;
+  void (*free)(void*, size_t) = nullptr;
+  std::atomic<bool> installed = false;
+};
+
+inline chain_t&
+chain()
+{
+  static chain_t c;
+  return c;
+}
+
+// Allocation function, installed using `mp_set_memory_functions`. It allocates
+// from arena of calling thread, only while that arena is active ( see
+// `scope_t` ), otherwise request goes to previously installed function.
+inline void*
+allocate(const size_t n)
+{
+  auto& a = arena();
+
+  if (a.active) {
+    if (const size_t c = arena_t::size_class(n); c <= MAX_CLASS) {
+      return a.alloc(c);
+    }
+  }
+
+  a.stats.heap_allocs++;
+  return chain().alloc(n);
+}
+
+// Deallocation function, installed using `mp_set_memory_functions`. Blocks,
+// which were served from arena of calling thread, are returned to it, even
+// when arena isn't active anymore, so it's never passed a block, allocated
+// from arena of some other thread. Rest go to previously installed function.
+inline void
+deallocate(void* const p, const size_t n)
+{
+  auto& a = arena();
+
+  if (a.owns(p)) {
+    a.dealloc(p, arena_t::size_class(n));
+    return;
+  }
+
+  chain().free(p, n);
+}
+
+// Reallocation function, installed using `mp_set_memory_functions`, which
+// keeps block as it's, if it's already large enough. A block, not served from
+// arena, is moved into arena, if it's active, otherwise it's reallocated by
+// previously installed function.
+inline void*
+reallocate(void* const p, const size_t old_n, const size_t new_n)
+{
+  auto& a = arena();
+
+  if (!a.owns(p)) {
+    if (a.active) {
+      void* const q = allocate(new_n);
+      std::memcpy(q, p, std::min(old_n, new_n));
+      chain().free(p, old_n);
+      return q;
+    }
+
+    a.stats.heap_allocs++;
+    return chain().realloc(p, old_n, new_n);
+  }
+
+  const size_t c = arena_t::size_class(old_n);
+  if (new_n <= (1ul << c)) {
+    return p;
+  }
+
+  void* const q = allocate(new_n);
+  std::memcpy(q, p, old_n);
+  a.dealloc(p, c);
+  return q;
+}
+
+// Installs above memory functions, remembering ones in effect, to which
+// blocks, not served from arena, are handed over. Installing again is a no-op.
+// Until installed, `scope_t` has no effect.
+//
+// Note, no other thread should be using GMP, while memory functions are being
+// swapped.
+inline void
+install()
+{
+  auto& c = chain();
+  if (c.installed.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  mp_get_memory_functions(&c.alloc, &c.realloc, &c.free);
+  mp_set_memory_functions(allocate, reallocate, deallocate);
+  c.installed.store(true, std::memory_order_release);
+}
+
+// Restores memory functions, which were in effect, when arena was installed.
+// Uninstalling, when not installed, is a no-op.
+//
+// Note, same as `install`, no other thread should be using GMP meanwhile and
+// no big integer, served from an arena, should be alive.
+inline void
+uninstall()
+{
+  auto& c = chain();
+  if (!c.installed.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  mp_set_memory_functions(c.alloc, c.realloc, c.free);
+  c.installed.store(false, std::memory_order_release);
+}
+
+// Whether arena allocator is installed
+inline bool
+installed()
+{
+  return chain().installed.load(std::memory_order_acquire);
+}
+
+// Allocation counters of calling thread, collected since it started
+inline stats_t
+stats()
+{
+  return arena().stats;
+}
+
+// Activates arena of calling thread, for lifetime of this object, so that GMP
+// allocations, performed meanwhile, are served from it, if arena allocator is
+// installed ( see `install` ), otherwise this is a no-op. Big integers
+// allocated while arena is active must be destroyed by the same thread.
+// Nested scopes are allowed.
+struct scope_t
+{
+private:
+  bool was_active = false;
+
+public:
+  inline scope_t()
+  {
+    auto& a = arena();
+    was_active = a.active;
+    a.active = was_active || installed();
+  }
+
+  inline ~scope_t() { arena().active = was_active; }
+
+  scope_t(const scope_t&) = delete;
+  scope_t& operator=(const scope_t&) = delete;
+};
+
+}
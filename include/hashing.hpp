@@ -1,10 +1,200 @@
 #pragma once
 #include "ff.hpp"
+#include "keccak_x4.hpp"
 #include "shake256.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstring>
 
 // Message Hashing for Falcon-{512, 1024}
 namespace hashing {
 
+// Given `blen` -many bytes squeezed out of SHAKE256 XOF, this routine parses
+// them as 16 -bit big-endian integers, rejecting those >= k * q, while writing
+// accepted ones ( reduced modulo q ) to polynomial `poly`, starting at index
+// `coeff_idx`, until all n coefficients are filled.
+//
+// Returns index of next coefficient to be filled.
+template<const size_t n>
+static inline size_t
+rejection_sample_scalar(const uint8_t* const __restrict buf,
+                        const size_t blen,
+                        ff::ff_t* const __restrict poly,
+                        size_t coeff_idx)
+{
+  constexpr size_t m = 1ul << 16;
+  constexpr size_t q = ff::Q;
+  constexpr size_t k = m / q;
+  constexpr uint16_t kq = k * q;
+
+  for (size_t off = 0; (off < blen) && (coeff_idx < n); off += 2) {
+    const uint16_t t = (static_cast<uint16_t>(buf[off + 0]) << 8) |
+                       (static_cast<uint16_t>(buf[off + 1]) << 0);
+    if (t < kq) {
+      poly[coeff_idx] = ff::ff_t{ t };
+      coeff_idx++;
+    }
+  }
+
+  return coeff_idx;
+}
+
+#if defined __AVX2__
+
+// Compile-time computes byte shuffle table for compacting accepted 16 -bit
+// values, among 8 of them living in a 128 -bit register. For every possible 8
+// -bit acceptance mask, indices of accepted values are moved to the front, in
+// order, while remaining bytes are zeroed.
+static inline constexpr std::array<std::array<uint8_t, 16>, 256>
+compute_compaction_table()
+{
+  std::array<std::array<uint8_t, 16>, 256> res{};
+
+  for (size_t mask = 0; mask < res.size(); mask++) {
+    size_t j = 0;
+
+    for (size_t i = 0; i < 8; i++) {
+      if ((mask >> i) & 1ul) {
+        res[mask][2 * j + 0] = static_cast<uint8_t>(2 * i + 0);
+        res[mask][2 * j + 1] = static_cast<uint8_t>(2 * i + 1);
+        j++;
+      }
+    }
+    for (; j < 8; j++) {
+      res[mask][2 * j + 0] = 0x80;
+      res[mask][2 * j + 1] = 0x80;
+    }
+  }
+
+  return res;
+}
+
+// Byte shuffle table, used for compacting accepted values
+alignas(16) constexpr auto COMPACTION_TABLE = compute_compaction_table();
+
+#endif
+
+// Same as `rejection_sample_scalar`, producing exactly same output, but on
+// x86_64 targets with AVX2, 16 values are parsed at a time, by loading 32
+// -bytes, swapping bytes of each 16 -bit lane, comparing all lanes against k *
+// q and reducing them modulo q. Accepted values of each half of the register
+// are then moved to front, using a shuffle table indexed by 8 -bit acceptance
+// mask, before being written to `poly`. Trailing bytes ( i.e. < 32 ) or last
+// few coefficients ( i.e. < 16 ) are handled by scalar routine.
+template<const size_t n>
+static inline size_t
+rejection_sample(const uint8_t* const __restrict buf,
+                 const size_t blen,
+                 ff::ff_t* const __restrict poly,
+                 size_t coeff_idx)
+{
+  size_t off = 0;
+
+#if defined __AVX2__
+  static_assert(sizeof(ff::ff_t) == sizeof(uint16_t),
+                "Field element must be represented as 16 -bit integer !");
+
+  constexpr uint16_t q = ff::Q;
+  constexpr uint16_t kq = ((1ul << 16) / q) * q;
+
+  const __m256i bswap = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10,
+                                         13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7,
+                                         6, 9, 8, 11, 10, 13, 12, 15, 14);
+  const __m256i kq_1 = _mm256_set1_epi16(static_cast<int16_t>(kq - 1));
+  const __m256i q1 = _mm256_set1_epi16(static_cast<int16_t>(q));
+  const __m256i q2 = _mm256_set1_epi16(static_cast<int16_t>(2 * q));
+  const __m256i q4 = _mm256_set1_epi16(static_cast<int16_t>(4 * q));
+
+  auto dst = reinterpret_cast<uint8_t*>(poly);
+
+  for (; (off + 32 <= blen) && (coeff_idx + 16 <= n); off += 32) {
+    const auto src = reinterpret_cast<const __m256i*>(buf + off);
+    const __m256i t0 = _mm256_shuffle_epi8(_mm256_loadu_si256(src), bswap);
+
+    // t < kq <=> min(t, kq - 1) == t
+    const __m256i ok = _mm256_cmpeq_epi16(_mm256_min_epu16(t0, kq_1), t0);
+
+    // t ( < 5q ) mod q, by conditionally subtracting 4q, 2q and q. If t < x,
+    // t - x wraps around to a value > t, so min(t, t - x) is what we need.
+    __m256i t1 = _mm256_min_epu16(t0, _mm256_sub_epi16(t0, q4));
+    t1 = _mm256_min_epu16(t1, _mm256_sub_epi16(t1, q2));
+    t1 = _mm256_min_epu16(t1, _mm256_sub_epi16(t1, q1));
+
+    // bits [0..8) of mask are for low 8 lanes and [16..24) for high 8 lanes
+    const __m256i packed = _mm256_packs_epi16(ok, _mm256_setzero_si256());
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(packed));
+    const uint32_t mask_lo = mask & 0xffu;
+    const uint32_t mask_hi = (mask >> 16) & 0xffu;
+
+    const auto tab_lo = COMPACTION_TABLE[mask_lo].data();
+    const auto tab_hi = COMPACTION_TABLE[mask_hi].data();
+
+    const __m128i v_lo = _mm_shuffle_epi8(
+      _mm256_castsi256_si128(t1),
+      _mm_load_si128(reinterpret_cast<const __m128i*>(tab_lo)));
+    const __m128i v_hi = _mm_shuffle_epi8(
+      _mm256_extracti128_si256(t1, 1),
+      _mm_load_si128(reinterpret_cast<const __m128i*>(tab_hi)));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * coeff_idx), v_lo);
+    coeff_idx += static_cast<size_t>(std::popcount(mask_lo));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * coeff_idx), v_hi);
+    coeff_idx += static_cast<size_t>(std::popcount(mask_hi));
+  }
+#endif
+
+  return rejection_sample_scalar<n>(buf + off, blen - off, poly, coeff_idx);
+}
+
+// Incremental variant of message hashing, for Falcon-{512, 1024}, which can be
+// used when message is not available as a single contiguous byte array e.g.
+// when it's being read from disk, in fixed size chunks.
+//
+// Salt is absorbed during construction, then message chunks are absorbed
+// ( any number of times, each chunk of arbitrary length ), in order, before
+// computing degree-(n-1) polynomial over Z_q, by finalizing. Absorbing salt
+// and message chunks, in order, produces same polynomial as absorbing salt and
+// concatenation of message chunks, using `hash_to_point`, defined below.
+template<const size_t n>
+  requires((n == 512) || (n == 1024))
+struct hash_to_point_t
+{
+private:
+  shake256::shake256<true> hasher{};
+
+public:
+  // Begins hashing, by absorbing `slen` -bytes salt into SHAKE256 XOF state
+  inline hash_to_point_t(const uint8_t* const salt, const size_t slen)
+  {
+    hasher.absorb(salt, slen);
+  }
+
+  // Absorbs next `mlen` -bytes chunk of message into SHAKE256 XOF state
+  inline void absorb(const uint8_t* const msg, const size_t mlen)
+  {
+    hasher.absorb(msg, mlen);
+  }
+
+  // Finalizes SHAKE256 XOF state and computes degree-(n-1) polynomial over Z_q,
+  // by squeezing bytes out of keccak sponge state and rejection sampling. No
+  // more message bytes can be absorbed, after calling this routine.
+  inline void finalize(ff::ff_t* const __restrict poly)
+  {
+    hasher.finalize();
+
+    size_t coeff_idx = 0;
+    uint8_t buf[shake256::rate >> 3];
+
+    while (coeff_idx < n) {
+      hasher.read(buf, sizeof(buf));
+      coeff_idx = rejection_sample<n>(buf, sizeof(buf), poly, coeff_idx);
+    }
+  }
+};
+
 // Given uniform random sampled salt bytes ( of length `slen` ) and message of
 // length `mlen` bytes, this function first absorbs salt and message ( in order
 // ) into SHAKE256 XOF state and then computes a degree-(n-1) polynomial over
@@ -22,31 +212,195 @@ hash_to_point(const uint8_t* const __restrict salt,
               ff::ff_t* const __restrict poly)
   requires((n == 512) || (n == 1024))
 {
-  constexpr size_t m = 1ul << 16;
-  constexpr size_t q = ff::Q;
-  constexpr size_t k = m / q;
-  constexpr uint16_t kq = k * q;
-
-  shake256::shake256<true> hasher{};
-  hasher.absorb(salt, slen);
+  hash_to_point_t<n> hasher(salt, slen);
   hasher.absorb(msg, mlen);
-  hasher.finalize();
+  hasher.finalize(poly);
+}
+
+// Any source of message bytes, which can be consumed in chunks, while hashing
+// message, must satisfy this concept i.e. it must be callable as
+//
+// ptrdiff_t read(uint8_t* const bytes, const size_t len)
+//
+// s.t. it fills at max `len` -many bytes and returns how many bytes it has
+// filled. Returning 0 denotes there are no more message bytes left, while a
+// negative return value denotes that message couldn't be read ( e.g. I/O error
+// ), same as POSIX `read` does. Note, it's fine to return fewer than `len`
+// bytes, before reaching end of message.
+template<typename T>
+concept reader = requires(T& r, uint8_t* const bytes, const size_t len) {
+  {
+    r(bytes, len)
+  } -> std::signed_integral;
+};
+
+// Byte length of buffer, used for reading message chunks, when hashing message
+// using `hash_to_point_stream`. It's a multiple of SHAKE256 rate, so that full
+// chunks can be absorbed without any internal buffering.
+constexpr size_t STREAM_CHUNK_LEN = 32 * (shake256::rate >> 3);
+
+// Given uniform random sampled salt bytes ( of length `slen` ) and a reader,
+// which produces message bytes in chunks, this routine computes same
+// degree-(n-1) polynomial over Z_q, as `hash_to_point` does, when invoked with
+// full message, while using only `STREAM_CHUNK_LEN` -bytes buffer, irrespective
+// of message length.
+//
+// Returns false, if reader reports an error, in which case content of `poly`
+// must not be used.
+template<const size_t n, reader Reader>
+static inline bool
+hash_to_point_stream(const uint8_t* const __restrict salt,
+                     const size_t slen,
+                     Reader& read,
+                     ff::ff_t* const __restrict poly)
+  requires((n == 512) || (n == 1024))
+{
+  hash_to_point_t<n> hasher(salt, slen);
+  uint8_t chunk[STREAM_CHUNK_LEN];
 
-  size_t coeff_idx = 0;
-  uint8_t buf[shake256::rate >> 3];
+  while (true) {
+    const auto clen = read(chunk, sizeof(chunk));
+    if (clen == 0) {
+      break;
+    }
+    if (clen < 0) [[unlikely]] {
+      return false;
+    }
+
+    hasher.absorb(chunk, static_cast<size_t>(clen));
+  }
 
-  while (coeff_idx < n) {
-    hasher.read(buf, sizeof(buf));
+  hasher.finalize(poly);
+  return true;
+}
 
-    for (size_t off = 0; (off < sizeof(buf)) && (coeff_idx < n); off += 2) {
-      const uint16_t t = (static_cast<uint16_t>(buf[off + 0]) << 8) |
-                         (static_cast<uint16_t>(buf[off + 1]) << 0);
-      if (t < kq) {
-        poly[coeff_idx] = ff::ff_t{ t };
-        coeff_idx++;
+// Given salt ( of length `slen` ) and message ( of length `mlen` ), this
+// routine prepares `bidx` -th SHAKE256 input block ( of rate -bytes ), of the
+// byte stream salt || message || padding, where padding is SHAKE256's domain
+// separator 0b1111 followed by pad10*1 rule, see section 5.1 and 6.2 of SHA3
+// specification https://dx.doi.org/10.6028/NIST.FIPS.202
+static inline void
+prepare_block(const uint8_t* const __restrict salt,
+              const size_t slen,
+              const uint8_t* const __restrict msg,
+              const size_t mlen,
+              const size_t bidx,
+              uint8_t* const __restrict blk)
+{
+  constexpr size_t rbytes = shake256::rate >> 3;
+
+  const size_t len = slen + mlen;
+  const size_t bcnt = len / rbytes + 1;
+  const size_t off = bidx * rbytes;
+
+  std::memset(blk, 0, rbytes);
+
+  if (off < slen) {
+    std::memcpy(blk, salt + off, std::min(slen - off, rbytes));
+  }
+
+  const size_t beg = std::max(off, slen);
+  const size_t end = std::min(off + rbytes, len);
+  if (beg < end) {
+    std::memcpy(blk + (beg - off), msg + (beg - slen), end - beg);
+  }
+
+  if ((len >= off) && (len < off + rbytes)) {
+    blk[len - off] ^= 0x1f;
+  }
+  if (bidx == bcnt - 1) {
+    blk[rbytes - 1] ^= 0x80;
+  }
+}
+
+// Given 4 -many ( salt, message ) pairs s.t. all salts are of length `slen`
+// while i-th message is of length `mlens[i]` -bytes, this routine computes 4
+// -many degree-(n-1) polynomials over Z_q, producing exactly same output as
+// invoking `hash_to_point` on each pair.
+//
+// On x86_64 targets with AVX2, four SHAKE256 instances are advanced together,
+// using 4-way interleaved Keccak-f[1600] permutation. Messages of different
+// length need different number of permutations for absorption, so once a lane
+// finishes absorbing its input, each following permutation produces its next
+// squeezed block, which is consumed right away, while other lanes are still
+// absorbing. On other targets, this routine simply calls `hash_to_point`, four
+// times.
+template<const size_t n>
+static inline void
+hash_to_point_x4(const uint8_t* const* const __restrict salts,
+                 const size_t slen,
+                 const uint8_t* const* const __restrict msgs,
+                 const size_t* const __restrict mlens,
+                 ff::ff_t* const* const __restrict polys)
+  requires((n == 512) || (n == 1024))
+{
+#if defined __AVX2__
+  constexpr size_t lanes = keccak_x4::LANES;
+  constexpr size_t rbytes = shake256::rate >> 3;
+  constexpr size_t rwords = rbytes >> 3;
+
+  __m256i state[25];
+  for (size_t i = 0; i < 25; i++) {
+    state[i] = _mm256_setzero_si256();
+  }
+
+  size_t bcnt[lanes];
+  size_t coeff_idx[lanes]{};
+  for (size_t j = 0; j < lanes; j++) {
+    bcnt[j] = (slen + mlens[j]) / rbytes + 1;
+  }
+
+  alignas(32) uint64_t words[rwords][lanes];
+  uint8_t blk[rbytes];
+
+  size_t bidx = 0;
+  bool done = false;
+
+  while (!done) {
+    // absorb next input block of lanes, which still have input left
+    for (size_t j = 0; j < lanes; j++) {
+      if (bidx < bcnt[j]) {
+        prepare_block(salts[j], slen, msgs[j], mlens[j], bidx, blk);
+      } else {
+        std::memset(blk, 0, sizeof(blk));
+      }
+
+      for (size_t w = 0; w < rwords; w++) {
+        std::memcpy(&words[w][j], blk + w * 8, 8);
+      }
+    }
+
+    for (size_t w = 0; w < rwords; w++) {
+      const auto ptr = reinterpret_cast<const __m256i*>(words[w]);
+      state[w] = _mm256_xor_si256(state[w], _mm256_load_si256(ptr));
+    }
+
+    keccak_x4::permute(state);
+    bidx++;
+
+    for (size_t w = 0; w < rwords; w++) {
+      _mm256_store_si256(reinterpret_cast<__m256i*>(words[w]), state[w]);
+    }
+
+    // squeeze output block of lanes, which are done with absorption
+    done = true;
+    for (size_t j = 0; j < lanes; j++) {
+      if ((bidx >= bcnt[j]) && (coeff_idx[j] < n)) {
+        for (size_t w = 0; w < rwords; w++) {
+          std::memcpy(blk + w * 8, &words[w][j], 8);
+        }
+
+        coeff_idx[j] = rejection_sample<n>(blk, rbytes, polys[j], coeff_idx[j]);
       }
+
+      done &= coeff_idx[j] == n;
     }
   }
+#else
+  for (size_t j = 0; j < 4; j++) {
+    hash_to_point<n>(salts[j], slen, msgs[j], mlens[j], polys[j]);
+  }
+#endif
 }
 
 }
@@ -1,66 +1,112 @@
 #pragma once
 #include <array>
+#include <cstddef>
 #include <gmp.h>
 #include <gmpxx.h>
+#include <vector>
 
 // Karatsuba Multiplication of two Polynomials
 namespace karatsuba {
 
+// Polynomials of degree < CUTOFF are multiplied using schoolbook method, with
+// products accumulated in-place, because at that size, Karatsuba's saving of
+// one multiplication doesn't pay off for additions and subtractions it adds
+constexpr size_t CUTOFF = 4;
+
+// # -of big integers, which are required as scratch space, for multiplying two
+// polynomials of degree N-1, using `karatsuba`
+template<const size_t N>
+static inline constexpr size_t
+karatsuba_scratch_len()
+{
+  if constexpr (N <= CUTOFF) {
+    return 0;
+  } else {
+    return 2 * N + karatsuba_scratch_len<N / 2>();
+  }
+}
+
+// # -of big integers, which are required as scratch space, for multiplying two
+// polynomials of degree N-1 modulo (x ** N + 1), using `karamul`
+template<const size_t N>
+static inline constexpr size_t
+karamul_scratch_len()
+{
+  return 2 * N + karatsuba_scratch_len<N>();
+}
+
 // Given two polynomials of degree N-1 ( s.t. N is power of 2 and N >= 1), this
 // routine multiplies them using Karatsuba algorithm, following
 // https://github.com/tprest/falcon.py/blob/88d01ed/ntrugen.py#L14-L39
-// computing resulting polynomial with degree 2*N - 1
+// computing resulting polynomial with degree 2*N - 1, which is written to
+// `polyab`, while using `scratch`, which must have room for
+// `karatsuba_scratch_len<N>()` -many big integers.
+//
+// Result and scratch space are owned by caller, so that big integers are
+// reused across calls, instead of being allocated afresh, at every level of
+// recursion.
 //
 // Note, polynomial coefficients can be big integers - this routine depends on
 // C++ interface of GNU MP
 // https://gmplib.org/manual/C_002b_002b-Interface-Integers
 template<const size_t N>
-static inline std::array<mpz_class, 2 * N>
-karatsuba(const std::array<mpz_class, N>& polya,
-          const std::array<mpz_class, N>& polyb)
+static inline void
+karatsuba(const mpz_class* const __restrict polya,
+          const mpz_class* const __restrict polyb,
+          mpz_class* const __restrict polyab,
+          mpz_class* const __restrict scratch)
 {
   static_assert((N & (N - 1)) == 0,
                 "Degree of Polynomial + 1 must be 2^i | i >=0");
 
-  if constexpr (N == 1) {
-    return { mpz_class(polya[0] * polyb[0]), mpz_class(0) };
+  if constexpr (N <= CUTOFF) {
+    for (size_t i = 0; i < 2 * N; i++) {
+      polyab[i] = 0;
+    }
+
+    for (size_t i = 0; i < N; i++) {
+      for (size_t j = 0; j < N; j++) {
+        mpz_addmul(polyab[i + j].get_mpz_t(),
+                   polya[i].get_mpz_t(),
+                   polyb[j].get_mpz_t());
+      }
+    }
   } else {
     constexpr size_t Nby2 = N / 2;
 
-    std::array<mpz_class, Nby2> polya0;
-    std::array<mpz_class, Nby2> polya1;
-    std::array<mpz_class, Nby2> polyb0;
-    std::array<mpz_class, Nby2> polyb1;
-    std::array<mpz_class, Nby2> polyax;
-    std::array<mpz_class, Nby2> polybx;
+    mpz_class* const polyax = scratch;
+    mpz_class* const polybx = polyax + Nby2;
+    mpz_class* const polyaxbx = polybx + Nby2;
+    mpz_class* const rest = polyaxbx + N;
 
     for (size_t i = 0; i < Nby2; i++) {
-      polya0[i] = polya[i];
-      polya1[i] = polya[Nby2 + i];
-
-      polyb0[i] = polyb[i];
-      polyb1[i] = polyb[Nby2 + i];
-
-      polyax[i] = polya[i] + polya[Nby2 + i];
-      polybx[i] = polyb[i] + polyb[Nby2 + i];
+      mpz_add(polyax[i].get_mpz_t(),
+              polya[i].get_mpz_t(),
+              polya[Nby2 + i].get_mpz_t());
+      mpz_add(polybx[i].get_mpz_t(),
+              polyb[i].get_mpz_t(),
+              polyb[Nby2 + i].get_mpz_t());
     }
 
-    const std::array<mpz_class, N> polya0b0 = karatsuba<Nby2>(polya0, polyb0);
-    const std::array<mpz_class, N> polya1b1 = karatsuba<Nby2>(polya1, polyb1);
-    std::array<mpz_class, N> polyaxbx = karatsuba<Nby2>(polyax, polybx);
+    // a0 * b0 and a1 * b1 are written to lower and upper halves of result
+    karatsuba<Nby2>(polya, polyb, polyab, rest);
+    karatsuba<Nby2>(polya + Nby2, polyb + Nby2, polyab + N, rest);
+    karatsuba<Nby2>(polyax, polybx, polyaxbx, rest);
 
     for (size_t i = 0; i < N; i++) {
-      polyaxbx[i] = polyaxbx[i] - mpz_class(polya0b0[i] + polya1b1[i]);
+      mpz_sub(polyaxbx[i].get_mpz_t(),
+              polyaxbx[i].get_mpz_t(),
+              polyab[i].get_mpz_t());
+      mpz_sub(polyaxbx[i].get_mpz_t(),
+              polyaxbx[i].get_mpz_t(),
+              polyab[N + i].get_mpz_t());
     }
 
-    std::array<mpz_class, 2 * N> polyab{};
     for (size_t i = 0; i < N; i++) {
-      polyab[i] = polyab[i] + polya0b0[i];
-      polyab[N + i] = polyab[N + i] + polya1b1[i];
-      polyab[Nby2 + i] = polyab[Nby2 + i] + polyaxbx[i];
+      mpz_add(polyab[Nby2 + i].get_mpz_t(),
+              polyab[Nby2 + i].get_mpz_t(),
+              polyaxbx[i].get_mpz_t());
     }
-
-    return polyab;
   }
 }
 
@@ -68,18 +114,36 @@ karatsuba(const std::array<mpz_class, N>& polya,
 // routine first multiplies them using Karatsuba algorithm and then reduces it
 // modulo  (x ** N + 1), following
 // https://github.com/tprest/falcon.py/blob/88d01ed/ntrugen.py#L42-L49
+//
+// Result is written to `res`, while `scratch` must have room for
+// `karamul_scratch_len<N>()` -many big integers.
+template<const size_t N>
+static inline void
+karamul(const mpz_class* const __restrict polya,
+        const mpz_class* const __restrict polyb,
+        mpz_class* const __restrict res,
+        mpz_class* const __restrict scratch)
+{
+  mpz_class* const polyab = scratch;
+  karatsuba<N>(polya, polyb, polyab, scratch + 2 * N);
+
+  for (size_t i = 0; i < N; i++) {
+    mpz_sub(res[i].get_mpz_t(),
+            polyab[i].get_mpz_t(),
+            polyab[N + i].get_mpz_t());
+  }
+}
+
+// Same as above, but allocates scratch space for itself and returns result.
 template<const size_t N>
 static inline std::array<mpz_class, N>
 karamul(const std::array<mpz_class, N>& polya,
         const std::array<mpz_class, N>& polyb)
 {
-  const std::array<mpz_class, 2 * N> polyab = karatsuba(polya, polyb);
-
+  std::vector<mpz_class> scratch(karamul_scratch_len<N>());
   std::array<mpz_class, N> res{};
-  for (size_t i = 0; i < N; i++) {
-    res[i] = polyab[i] - polyab[N + i];
-  }
 
+  karamul<N>(polya.data(), polyb.data(), res.data(), scratch.data());
   return res;
 }
 
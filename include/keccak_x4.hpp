@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#if defined __AVX2__
+#include <immintrin.h>
+#endif
+
+// 4-way interleaved Keccak-f[1600] permutation
+namespace keccak_x4 {
+
+#if defined __AVX2__
+
+// Number of Keccak-f[1600] instances, which are permuted in parallel
+constexpr size_t LANES = 4;
+
+// Round constants of ι step mapping, see table 5 of section 3.2.5 of SHA3
+// specification https://dx.doi.org/10.6028/NIST.FIPS.202
+constexpr uint64_t RC[24]{
+  0x0000000000000001ul, 0x0000000000008082ul, 0x800000000000808aul,
+  0x8000000080008000ul, 0x000000000000808bul, 0x0000000080000001ul,
+  0x8000000080008081ul, 0x8000000000008009ul, 0x000000000000008aul,
+  0x0000000000000088ul, 0x0000000080008009ul, 0x000000008000000aul,
+  0x000000008000808bul, 0x800000000000008bul, 0x8000000000008089ul,
+  0x8000000000008003ul, 0x8000000000008002ul, 0x8000000000000080ul,
+  0x000000000000800aul, 0x800000008000000aul, 0x8000000080008081ul,
+  0x8000000000008080ul, 0x0000000080000001ul, 0x8000000080008008ul
+};
+
+// Rotation offsets of ρ step mapping, indexed by x + 5 * y, see table 2 of
+// section 3.2.2 of SHA3 specification
+constexpr int ROT[25]{ 0,  1,  62, 28, 27, 36, 44, 6,  55, 20, 3,  10, 43,
+                       25, 39, 41, 45, 15, 21, 8,  18, 2,  61, 56, 14 };
+
+// Rotates each 64 -bit lane of a 256 -bit register left, by `n` bits
+static inline __m256i
+rotl(const __m256i v, const int n)
+{
+  if (n == 0) {
+    return v;
+  }
+  return _mm256_or_si256(_mm256_slli_epi64(v, n), _mm256_srli_epi64(v, 64 - n));
+}
+
+// Applies 24 rounds of Keccak-f[1600] permutation on 4 independent states, s.t.
+// i-th 256 -bit register holds i-th 64 -bit word of all 4 states, where j-th 64
+// -bit lane of the register belongs to j-th state.
+//
+// See algorithm 7 of section 3.3 of SHA3 specification.
+static inline void
+permute(__m256i* const state)
+{
+  const __m256i ones = _mm256_set1_epi64x(-1ll);
+
+  for (size_t r = 0; r < 24; r++) {
+    // θ
+    __m256i C[5];
+    __m256i D[5];
+
+    for (size_t x = 0; x < 5; x++) {
+      C[x] = _mm256_xor_si256(state[x], state[x + 5]);
+      C[x] = _mm256_xor_si256(C[x], state[x + 10]);
+      C[x] = _mm256_xor_si256(C[x], state[x + 15]);
+      C[x] = _mm256_xor_si256(C[x], state[x + 20]);
+    }
+    for (size_t x = 0; x < 5; x++) {
+      D[x] = _mm256_xor_si256(C[(x + 4) % 5], rotl(C[(x + 1) % 5], 1));
+    }
+    for (size_t i = 0; i < 25; i++) {
+      state[i] = _mm256_xor_si256(state[i], D[i % 5]);
+    }
+
+    // ρ and π
+    __m256i B[25];
+    for (size_t y = 0; y < 5; y++) {
+      for (size_t x = 0; x < 5; x++) {
+        const size_t idx = y + 5 * ((2 * x + 3 * y) % 5);
+        B[idx] = rotl(state[x + 5 * y], ROT[x + 5 * y]);
+      }
+    }
+
+    // χ
+    for (size_t y = 0; y < 5; y++) {
+      for (size_t x = 0; x < 5; x++) {
+        const __m256i t0 = _mm256_xor_si256(B[(x + 1) % 5 + 5 * y], ones);
+        const __m256i t1 = _mm256_and_si256(t0, B[(x + 2) % 5 + 5 * y]);
+        state[x + 5 * y] = _mm256_xor_si256(B[x + 5 * y], t1);
+      }
+    }
+
+    // ι
+    const auto rc = static_cast<long long>(RC[r]);
+    state[0] = _mm256_xor_si256(state[0], _mm256_set1_epi64x(rc));
+  }
+}
+
+#endif
+
+}
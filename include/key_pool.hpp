@@ -0,0 +1,275 @@
+#pragma once
+#include "falcon.hpp"
+#include "sign_engine.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Pool of pre-generated Falcon{512, 1024} keypairs, for protocols which use a
+// fresh ( say one-time ) key per request, so that key generation doesn't sit on
+// request path.
+namespace key_pool {
+
+// A keypair, as handed out by key pool i.e. byte encoded public key and secret
+// key, expanded into the form which is used during signing ( see
+// `falcon::expanded_key_t` ). Expanded secret key is wiped, when keypair is
+// destroyed, be it by consumer or by pool itself.
+template<const size_t N>
+  requires((N == 512) || (N == 1024))
+struct pooled_key_t
+{
+  std::array<uint8_t, falcon_utils::compute_pkey_len<N>()> pkey{};
+  falcon::expanded_key_t<N> key;
+
+  pooled_key_t() = default;
+  pooled_key_t(const pooled_key_t&) = delete;
+  pooled_key_t& operator=(const pooled_key_t&) = delete;
+
+  inline ~pooled_key_t() { key.wipe(); }
+};
+
+// Snapshot of key pool counters, see `pool_t::stats`
+struct stats_t
+{
+  size_t depth = 0;          // # -of keys, ready to be acquired
+  uint64_t generated = 0;    // # -of keys generated by refill threads
+  uint64_t acquired = 0;     // # -of keys handed out
+  uint64_t misses = 0;       // # -of acquisitions, which found pool drained
+  double refill_rate = 0.;   // keys generated per second, while refilling
+  double drain_rate = 0.;    // keys acquired per second
+};
+
+// Falcon{512, 1024} key pool, which keeps depth of pool i.e. # -of ready to use
+// keys between low and high watermarks. A fixed number of refill threads, each
+// owning its own ChaCha20 based PRNG and key generation scratch space, start
+// generating keys ( see `falcon::expanded_key_t::generate` ) as soon as depth
+// drops below low watermark and keep doing so, till it reaches high watermark,
+// after which they park themselves.
+//
+// Keys are handed out to any number of consumer threads, through a bounded
+// lock-free MPMC queue ( see `sign_engine::mpmc_queue_t` ), so that acquiring
+// a key takes a few microseconds, as long as pool isn't drained.
+template<const size_t N, const size_t CAP = 1ul << 10>
+  requires(((N == 512) || (N == 1024)) && std::has_single_bit(CAP))
+struct pool_t
+{
+public:
+  using key_t = std::unique_ptr<pooled_key_t<N>>;
+
+private:
+  using sclock = std::chrono::steady_clock;
+
+  struct worker_t
+  {
+    prng::chacha20_t rng;
+    std::vector<uint8_t> ws = std::vector<uint8_t>(keygen::keygen_ws_len<N>());
+    std::thread thread;
+  };
+
+  const size_t low;
+  const size_t high;
+
+  sign_engine::mpmc_queue_t<key_t, CAP> queue;
+
+  // # -of keys in queue, along with ones being generated
+  alignas(64) std::atomic<size_t> reserved{ 0ul };
+  alignas(64) std::atomic<size_t> depth_{ 0ul };
+  alignas(64) std::atomic<bool> refilling{ true };
+  alignas(64) std::atomic<uint64_t> wake{ 0ul }; // refill threads park on this
+  std::atomic<bool> stop{ false };
+
+  alignas(64) std::atomic<uint64_t> generated{ 0ul };
+  alignas(64) std::atomic<uint64_t> acquired{ 0ul };
+  alignas(64) std::atomic<uint64_t> misses{ 0ul };
+  std::atomic<uint64_t> busy_ns{ 0ul }; // summed over refill threads
+  const sclock::time_point started = sclock::now();
+
+  std::vector<std::unique_ptr<worker_t>> workers;
+
+  // Asks refill threads to start refilling, if depth is below low watermark
+  inline void maybe_refill()
+  {
+    if (reserved.load() >= low) {
+      return;
+    }
+
+    refilling.store(true);
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_all();
+  }
+
+  // Keeps generating keys, while pool is being refilled, until it's asked to
+  // stop.
+  inline void serve(worker_t& w)
+  {
+    while (1) {
+      const uint64_t seen = wake.load(std::memory_order_acquire);
+
+      if (stop.load()) {
+        break;
+      }
+
+      if (!refilling.load()) {
+        wake.wait(seen, std::memory_order_acquire);
+        continue;
+      }
+
+      if (reserved.fetch_add(1) >= high) {
+        reserved.fetch_sub(1);
+
+        // pool is full, but a consumer might have drained it below low
+        // watermark, just before refilling was stopped, so check again
+        refilling.store(false);
+        maybe_refill();
+        continue;
+      }
+
+      const auto t0 = sclock::now();
+
+      auto key = std::make_unique<pooled_key_t<N>>();
+      key->key.generate(key->pkey.data(), w.ws, w.rng);
+
+      // scratch space still holds f, g, F, G
+      falcon_utils::secure_wipe(w.ws.data(), w.ws.size());
+
+      const auto t1 = sclock::now();
+      const auto ns = std::chrono::nanoseconds(t1 - t0).count();
+      busy_ns.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+
+      // can't be full, because `reserved` never exceeds high watermark
+      while (!queue.try_push(std::move(key))) {
+        std::this_thread::yield();
+      }
+
+      depth_.fetch_add(1, std::memory_order_release);
+      generated.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+public:
+  // Starts `worker_cnt` -many refill threads, which fill pool up to high
+  // watermark, right away. High watermark is capped at CAP, while low
+  // watermark is capped at high watermark.
+  inline pool_t(const size_t low_watermark,
+                const size_t high_watermark,
+                const size_t worker_cnt = 1)
+    : low(std::min(low_watermark, std::min(high_watermark, CAP)))
+    , high(std::min(high_watermark, CAP))
+  {
+    workers.reserve(worker_cnt);
+    for (size_t i = 0; i < worker_cnt; i++) {
+      auto w = std::make_unique<worker_t>();
+      w->thread = std::thread(&pool_t::serve, this, std::ref(*w));
+      workers.push_back(std::move(w));
+    }
+  }
+
+  pool_t(const pool_t&) = delete;
+  pool_t& operator=(const pool_t&) = delete;
+
+  // Waits for refill threads to finish keys, they are generating, and exit,
+  // before wiping keys, which were never acquired.
+  inline ~pool_t()
+  {
+    stop.store(true);
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_all();
+
+    for (auto& w : workers) {
+      w->thread.join();
+    }
+
+    key_t key;
+    while (queue.try_pop(key)) {
+      key.reset();
+    }
+  }
+
+  // Hands out a ready to use key, if pool isn't drained, otherwise returns
+  // nullptr. Can be called from any thread.
+  inline key_t try_acquire()
+  {
+    key_t key;
+
+    if (!queue.try_pop(key)) {
+      misses.fetch_add(1, std::memory_order_relaxed);
+      maybe_refill();
+      return nullptr;
+    }
+
+    depth_.fetch_sub(1, std::memory_order_relaxed);
+    reserved.fetch_sub(1);
+    acquired.fetch_add(1, std::memory_order_relaxed);
+
+    maybe_refill();
+    return key;
+  }
+
+  // Same as above, but when pool is drained, a key is generated on calling
+  // thread, using given PRNG, so that caller never goes without a key.
+  template<prng::rng RNG>
+  inline key_t acquire(RNG& rng)
+  {
+    if (auto key = try_acquire(); key) {
+      return key;
+    }
+
+    std::vector<uint8_t> ws(keygen::keygen_ws_len<N>());
+
+    auto key = std::make_unique<pooled_key_t<N>>();
+    key->key.generate(key->pkey.data(), ws, rng);
+    falcon_utils::secure_wipe(ws.data(), ws.size());
+
+    acquired.fetch_add(1, std::memory_order_relaxed);
+    return key;
+  }
+
+  // # -of keys, ready to be acquired
+  inline size_t depth() const
+  {
+    return depth_.load(std::memory_order_acquire);
+  }
+
+  // Keys generated per second, while refill threads are busy, summed over all
+  // of them. It's the rate at which a drained pool gets refilled.
+  inline double refill_rate() const
+  {
+    const uint64_t ns = busy_ns.load(std::memory_order_relaxed);
+    const uint64_t cnt = generated.load(std::memory_order_relaxed);
+    if (ns == 0) {
+      return 0.;
+    }
+
+    const double secs = static_cast<double>(ns) / 1e9;
+    const double per_worker = static_cast<double>(cnt) / secs;
+    return per_worker * static_cast<double>(workers.size());
+  }
+
+  // Returns snapshot of counters, collected since pool was created.
+  inline stats_t stats() const
+  {
+    const auto elapsed = sclock::now() - started;
+    const double secs = std::chrono::duration<double>(elapsed).count();
+
+    stats_t s;
+    s.depth = depth();
+    s.generated = generated.load(std::memory_order_relaxed);
+    s.acquired = acquired.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.refill_rate = refill_rate();
+    s.drain_rate = secs > 0. ? static_cast<double>(s.acquired) / secs : 0.;
+    return s;
+  }
+
+  // Watermarks, between which depth of pool is kept
+  inline size_t low_watermark() const { return low; }
+  inline size_t high_watermark() const { return high; }
+};
+
+}
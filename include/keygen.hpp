@@ -1,12 +1,27 @@
 #pragma once
+#include "encoding.hpp"
 #include "falcon_tree.hpp"
 #include "ff.hpp"
 #include "fft.hpp"
 #include "ntru_gen.hpp"
+#include <algorithm>
+#include <cassert>
+#include <span>
 
 // Falcon{512, 1024} Key Pair Generation related Routines
 namespace keygen {
 
+// Compile-time compute byte length of scratch space, required by
+// `compute_gram_matrix_ws`, for computing Gram matrix of B, whose each
+// component is a degree N polynomial.
+template<const size_t N>
+static inline constexpr size_t
+compute_gram_matrix_ws_len()
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  return sizeof(fft::cmplx) * (N * 2 * 2 + N);
+}
+
 // Given a matrix B of dimension 2x2 s.t. each element of matrix ∈ FFT(Q[x]/
 // (x^N + 1)), this routine computes Gram matrix G = B x B*, following line 4 of
 // algorithm 4 in Falcon specification.
@@ -21,19 +36,25 @@ namespace keygen {
 // https://github.com/tprest/falcon.py/blob/88d01ede1d7fa74a8392116bc5149dee57af93f2/ffsampling.py#L15-L31
 // where it's shown how Gram matrix of B can be computed in coefficient
 // representation.
+//
+// All scratch space is taken from caller supplied workspace `ws`, which must
+// be of at least `compute_gram_matrix_ws_len<N>()` -bytes and aligned to
+// `alignof(fft::cmplx)` -bytes.
 template<const size_t N>
 static inline void
-compute_gram_matrix(
+compute_gram_matrix_ws(
   const fft::cmplx* const __restrict B, // 2 x 2 x N complex numbers
-  fft::cmplx* const __restrict G        // 2 x 2 x N complex numbers
-  )
+  fft::cmplx* const __restrict G,       // 2 x 2 x N complex numbers
+  std::span<uint8_t> ws)
   requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
 {
-  fft::cmplx B_adj[N * 2 * 2];
-  fft::cmplx tmp[N];
+  assert(fft::is_valid_ws(ws, compute_gram_matrix_ws_len<N>()));
+
+  auto B_adj = reinterpret_cast<fft::cmplx*>(ws.data());
+  auto tmp = B_adj + N * 2 * 2;
 
   // compute B*
-  std::memcpy(B_adj, B, sizeof(B_adj));
+  std::memcpy(B_adj, B, sizeof(fft::cmplx) * N * 2 * 2);
   fft::adj_poly<log2<N>()>(B_adj);
   fft::adj_poly<log2<N>()>(B_adj + N);
   fft::adj_poly<log2<N>()>(B_adj + 2 * N);
@@ -60,6 +81,49 @@ compute_gram_matrix(
   polynomial::add_to<log2<N>()>(G + 3 * N, tmp);
 }
 
+// Same as `compute_gram_matrix_ws` above, but scratch space is allocated on
+// stack.
+template<const size_t N>
+static inline void
+compute_gram_matrix(
+  const fft::cmplx* const __restrict B, // 2 x 2 x N complex numbers
+  fft::cmplx* const __restrict G        // 2 x 2 x N complex numbers
+  )
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  alignas(fft::cmplx) uint8_t ws[compute_gram_matrix_ws_len<N>()];
+  compute_gram_matrix_ws<N>(B, G, ws);
+}
+
+// Given NTT form of a degree N polynomial f and a degree N polynomial g ( in
+// coefficient form ) s.t. f is invertible mod q ( = 12289 ), this routine
+// computes h = gf^-1 mod q, which is the Falcon public key, following step 9 of
+// algorithm 4 of Falcon specification https://falcon-sign.info/falcon.pdf
+//
+// NTT form of f is computed while checking whether f is invertible ( see
+// `ntru_gen::is_poly_invertible` ), so it doesn't need to be computed again.
+template<const size_t N>
+static inline void
+compute_public_key(const ff::ff_t* const __restrict f_ntt,
+                   const int32_t* const __restrict g,
+                   ff::ff_t* const __restrict h)
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  constexpr int32_t q = ff::Q;
+
+  ff::ff_t g_[N];
+
+  // Input polynomial g has its coefficients ∈ [-6145, 6143], but for
+  // performing division in NTT domain, we need to convert them into [0, 12289)
+  for (size_t i = 0; i < N; i++) {
+    g_[i].v = static_cast<uint16_t>((g[i] < 0) * q + g[i]);
+  }
+
+  ntt::ntt<log2<N>()>(g_);
+  polynomial::div<log2<N>()>(g_, f_ntt, h);
+  ntt::intt<log2<N>()>(h);
+}
+
 // Given two degree N polynomials f, g s.t. f is invertible mod q ( = 12289 ),
 // this routine computes h = gf^-1 mod q, which is the Falcon public key,
 // following step 9 of algorithm 4 of Falcon specification
@@ -74,64 +138,158 @@ compute_public_key(const int32_t* const __restrict f,
   constexpr int32_t q = ff::Q;
 
   ff::ff_t f_[N];
-  ff::ff_t g_[N];
 
-  // Input polynomials f, g has its coefficients ∈ [-6145, 6143], but for
-  // performing division in NTT domain, we need to convert them into [0, 12289)
   for (size_t i = 0; i < N; i++) {
     f_[i].v = static_cast<uint16_t>((f[i] < 0) * q + f[i]);
-    g_[i].v = static_cast<uint16_t>((g[i] < 0) * q + g[i]);
   }
 
   ntt::ntt<log2<N>()>(f_);
-  ntt::ntt<log2<N>()>(g_);
-  polynomial::div<log2<N>()>(g_, f_, h);
-  ntt::intt<log2<N>()>(h);
+  compute_public_key<N>(f_, g, h);
 }
 
-// Falcon{512, 1024} key generation algorithm i.e. an implementation of
-// algorithm 4 of Falcon specification which takes only standard deviation σ as
-// input ( see table 3.3 of Falcon specification for possible values that it can
-// take ) and computes FFT form of 2x2 matrix B = [[g, -f], [G, -F]], Falcon
-// Tree T ( also in FFT form ) and Falcon public key h = gf^-1 mod q ( s.t. q =
-// 12289 ).
-//
-// Note, B and T are part of Falcon secret key, while h is Falcon public key.
+// Compile-time compute byte length of scratch space, required by `keygen_ws`,
+// for generating Falcon{512, 1024} key pair. It holds f, g, F, G, NTT/ FFT
+// forms of f, g ( see `ntru_gen::fg_forms_t` ), Gram matrix of B and scratch
+// space of routines computing Gram matrix and Falcon tree.
 template<const size_t N>
-static inline void
-keygen(fft::cmplx* const __restrict B, // FFT form of [[g, -f], [G, -F]]
-       fft::cmplx* const __restrict T, // Falcon Tree
-       ff::ff_t* const __restrict h,   // Falcon Public Key
-       const double σ, // Standard deviation ( see table 3.3 of specification )
-       prng::prng_t& rng)
+static inline constexpr size_t
+keygen_ws_len()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t fgFG_len = sizeof(int32_t) * N * 4;
+  constexpr size_t forms_len = sizeof(ntru_gen::fg_forms_t<N>);
+  constexpr size_t gram_len = sizeof(fft::cmplx) * N * 2 * 2;
+  constexpr size_t scratch_len = std::max(compute_gram_matrix_ws_len<N>(),
+                                          falcon_tree::ffldl_ws_len<N>());
+
+  return fgFG_len + forms_len + gram_len + scratch_len;
+}
+
+// Falcon{512, 1024} key generation pipeline, which generates f, g, F, G ( see
+// `ntru_gen::ntru_gen` ) and computes matrix B, Falcon tree T and public key h,
+// from them, returning pointer to f, g, F, G ( 4 x N integers, kept in `ws` ).
+//
+// NTT form of f and FFT forms of f, g, which NTRUGen computes while checking
+// candidate f, g, are reused for computing h and B, so that only g ( in NTT
+// domain ) and F, G ( in FFT domain ) need to be transformed.
+//
+// f, g, F, G, their NTT/ FFT forms, Gram matrix and scratch space of ffLDL*
+// are taken from workspace `ws`, which must be of at least `keygen_ws_len<N>()`
+// -bytes and aligned to `alignof(fft::cmplx)` -bytes.
+template<const size_t N, prng::rng RNG>
+static inline const int32_t*
+keygen_fused_ws(fft::cmplx* const __restrict B, // [[g, -f], [G, -F]]
+                fft::cmplx* const __restrict T, // Falcon Tree
+                ff::ff_t* const __restrict h,   // Falcon Public Key
+                const double σ, // Standard deviation ( see table 3.3 of spec )
+                std::span<uint8_t> ws,
+                RNG& rng)
   requires((N == 512) || (N == 1024))
 {
-  int32_t f[N];
-  int32_t g[N];
-  int32_t F[N];
-  int32_t G[N];
+  assert(fft::is_valid_ws(ws, keygen_ws_len<N>()));
+
+  using forms_t = ntru_gen::fg_forms_t<N>;
+
+  constexpr size_t gram_off = sizeof(forms_t);
+  constexpr size_t fgFG_off = gram_off + sizeof(fft::cmplx) * N * 2 * 2;
+  constexpr size_t scratch_off = fgFG_off + sizeof(int32_t) * N * 4;
 
-  ntru_gen::ntru_gen<N>(f, g, F, G, rng);
+  auto forms = reinterpret_cast<forms_t*>(ws.data());
+  auto gram_matrix = reinterpret_cast<fft::cmplx*>(ws.data() + gram_off);
+  auto f = reinterpret_cast<int32_t*>(ws.data() + fgFG_off);
+  auto g = f + N;
+  auto F = g + N;
+  auto G = F + N;
+  const auto scratch = ws.subspan(scratch_off);
 
+  ntru_gen::ntru_gen<N>(f, g, F, G, rng, forms);
+
+  // FFT is linear, so FFT(-f) = -FFT(f)
   for (size_t i = 0; i < N; i++) {
-    B[i] = fft::cmplx{ static_cast<double>(g[i]) };
-    B[N + i] = fft::cmplx{ -static_cast<double>(f[i]) };
+    B[i] = forms->g_fft[i];
+    B[N + i] = -forms->f_fft[i];
     B[2 * N + i] = fft::cmplx{ static_cast<double>(G[i]) };
     B[3 * N + i] = fft::cmplx{ -static_cast<double>(F[i]) };
   }
 
-  fft::fft<log2<N>()>(B);
-  fft::fft<log2<N>()>(B + N);
   fft::fft<log2<N>()>(B + 2 * N);
   fft::fft<log2<N>()>(B + 3 * N);
 
-  fft::cmplx gram_matrix[2 * 2 * N];
-  compute_gram_matrix<N>(B, gram_matrix);
+  compute_public_key<N>(forms->f_ntt, g, h);
+  compute_gram_matrix_ws<N>(B, gram_matrix, scratch);
 
-  falcon_tree::ffldl<N, 0, log2<N>()>(gram_matrix, T);
+  falcon_tree::ffldl_ws<N, 0, log2<N>()>(gram_matrix, T, scratch);
   falcon_tree::normalize_tree<N, 0, log2<N>()>(T, σ);
 
-  compute_public_key<N>(f, g, h);
+  return f;
+}
+
+// Falcon{512, 1024} key generation algorithm i.e. an implementation of
+// algorithm 4 of Falcon specification which takes only standard deviation σ as
+// input ( see table 3.3 of Falcon specification for possible values that it can
+// take ) and computes FFT form of 2x2 matrix B = [[g, -f], [G, -F]], Falcon
+// Tree T ( also in FFT form ) and Falcon public key h = gf^-1 mod q ( s.t. q =
+// 12289 ).
+//
+// Note, B and T are part of Falcon secret key, while h is Falcon public key.
+// Any PRNG, satisfying `prng::rng` concept, can be used as source of
+// randomness.
+//
+// f, g, F, G, NTT/ FFT forms of f, g, Gram matrix and scratch space of ffLDL*
+// are taken from caller supplied workspace `ws`, which must be of at least
+// `keygen_ws_len<N>()` -bytes and aligned to `alignof(fft::cmplx)` -bytes.
+// Note, NTRUGen ( see `ntru_gen::ntru_gen` ) still keeps its own scratch space
+// ( big integers and tens of KB of arrays ) outside of `ws`, so unlike
+// `signing::sign_ws`, this routine must not be called on a small stack. See
+// `keygen_fused_ws`, for how it reuses transforms.
+template<const size_t N, prng::rng RNG>
+static inline void
+keygen_ws(fft::cmplx* const __restrict B, // FFT form of [[g, -f], [G, -F]]
+          fft::cmplx* const __restrict T, // Falcon Tree
+          ff::ff_t* const __restrict h,   // Falcon Public Key
+          const double σ, // Standard deviation ( see table 3.3 of spec )
+          std::span<uint8_t> ws,
+          RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  keygen_fused_ws<N>(B, T, h, σ, ws, rng);
+}
+
+// Same as `keygen_ws` above, but instead of public key h, it writes byte
+// encoded public key to `pkey` and byte encoded secret key ( i.e. f, g, F ) to
+// `skey`, so that one call generates a key pair, which can be stored, along
+// with matrix B and Falcon tree T, which are required for signing, without
+// decoding secret key and expanding it again.
+template<const size_t N, prng::rng RNG>
+static inline void
+keygen_ws(fft::cmplx* const __restrict B, // FFT form of [[g, -f], [G, -F]]
+          fft::cmplx* const __restrict T, // Falcon Tree
+          uint8_t* const __restrict pkey, // Encoded Falcon Public Key
+          uint8_t* const __restrict skey, // Encoded Falcon Secret Key
+          const double σ, // Standard deviation ( see table 3.3 of spec )
+          std::span<uint8_t> ws,
+          RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  ff::ff_t h[N];
+  const int32_t* const f = keygen_fused_ws<N>(B, T, h, σ, ws, rng);
+
+  encoding::encode_pkey<N>(h, pkey);
+  encoding::encode_skey<N>(f, f + N, f + 2 * N, skey);
+}
+
+// Same as `keygen_ws` above, but scratch space is allocated on stack.
+template<const size_t N, prng::rng RNG>
+static inline void
+keygen(fft::cmplx* const __restrict B, // FFT form of [[g, -f], [G, -F]]
+       fft::cmplx* const __restrict T, // Falcon Tree
+       ff::ff_t* const __restrict h,   // Falcon Public Key
+       const double σ, // Standard deviation ( see table 3.3 of specification )
+       RNG& rng)
+  requires((N == 512) || (N == 1024))
+{
+  alignas(fft::cmplx) uint8_t ws[keygen_ws_len<N>()];
+  keygen_ws<N>(B, T, h, σ, ws, rng);
 }
 
 }
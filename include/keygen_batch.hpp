@@ -0,0 +1,95 @@
+#pragma once
+#include "falcon.hpp"
+#include "work_stealing.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Falcon{512, 1024} Key Generation, Signing and Verification Algorithm
+namespace falcon {
+
+// Generates `count` -many Falcon{512, 1024} keypairs ( see `keygen` ), on
+// workers of given work-stealing pool, writing i-th public key to `pkeys + i *
+// pklen` and i-th secret key to `skeys + i * sklen`, s.t. pklen, sklen are
+// byte length of public, secret key respectively ( see falcon_utils.hpp ).
+//
+// Each key is generated by a separate job, so that as soon as a worker is done
+// with its jobs, it steals pending ones from other workers, which keeps all
+// cores busy, even though time taken by NTRUGen varies widely from one key to
+// another. Each worker samples using its own ChaCha20 PRNG, seeded once from
+// system randomness, while all big integer temporaries of NTRUSolve are owned
+// by worker generating that key - so workers never contend on shared state.
+template<const size_t N>
+static inline void
+keygen_batch(const size_t count,
+             uint8_t* const __restrict pkeys,
+             uint8_t* const __restrict skeys,
+             work_stealing::pool_t& pool)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  // one PRNG per worker, indexed by `worker_index`
+  std::vector<prng::chacha20_t> rngs(pool.size());
+
+  pool.parallel_for(count, [&](const size_t i) {
+    auto& rng = rngs[pool.worker_index()];
+    keygen<N>(pkeys + i * pklen, skeys + i * sklen, rng);
+  });
+}
+
+// Same as above, but generates keys on a pool of `threads` -many workers (
+// defaults to # -of cores ), which lives only for duration of this call.
+template<const size_t N>
+static inline void
+keygen_batch(const size_t count,
+             uint8_t* const __restrict pkeys,
+             uint8_t* const __restrict skeys,
+             const size_t threads = 0)
+  requires((N == 512) || (N == 1024))
+{
+  work_stealing::pool_t pool{ threads };
+  keygen_batch<N>(count, pkeys, skeys, pool);
+}
+
+// Generates a single Falcon{512, 1024} keypair ( see `keygen` ), while trying
+// several candidates f, g at once, on workers of given work-stealing pool, s.t.
+// lowest numbered one to solve NTRU equation wins and higher numbered ones are
+// abandoned ( see `ntru_gen::ntru_gen_speculative` ). This reduces latency of
+// generating one key, on an otherwise idle many-core machine.
+template<const size_t N>
+static inline void
+keygen_speculative(uint8_t* const __restrict pkey,
+                   uint8_t* const __restrict skey,
+                   work_stealing::pool_t& pool)
+  requires((N == 512) || (N == 1024))
+{
+  int32_t f[N];
+  int32_t g[N];
+  int32_t F[N];
+  int32_t G[N];
+  ff::ff_t h[N];
+  ntru_gen::fg_forms_t<N> forms;
+  prng::prng_t rng;
+
+  ntru_gen::ntru_gen_speculative<N>(f, g, F, G, rng, pool, &forms);
+  keygen::compute_public_key<N>(forms.f_ntt, g, h);
+  encoding::encode_pkey<N>(h, pkey);
+  encoding::encode_skey<N>(f, g, F, skey);
+}
+
+// Same as above, but on a pool of `threads` -many workers ( defaults to # -of
+// cores ), which lives only for duration of this call.
+template<const size_t N>
+static inline void
+keygen_speculative(uint8_t* const __restrict pkey,
+                   uint8_t* const __restrict skey,
+                   const size_t threads = 0)
+  requires((N == 512) || (N == 1024))
+{
+  work_stealing::pool_t pool{ threads };
+  keygen_speculative<N>(pkey, skey, pool);
+}
+
+}
@@ -1,8 +1,29 @@
 #pragma once
-#include "karatsuba.hpp"
 #include "polynomial.hpp"
 #include "prng.hpp"
+#include "prng_chacha20.hpp"
 #include "samplerz.hpp"
+#include "work_stealing.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+// NTRUSolve is by default implemented using GNU MP's big integers, while
+// defining FALCON_NTRU_SOLVE_RNS switches to multi-precision arithmetic in
+// residue number system ( see ntru_solve_rns.hpp ), removing dependency on GMP
+#if defined FALCON_NTRU_SOLVE_RNS
+#include "ntru_solve_rns.hpp"
+#else
+#include "gmp_arena.hpp"
+#include "ntru_mul.hpp"
+#endif
 
 // Generate f, g, F, G ∈ Z[x]/(φ) | fG − gF = q mod φ ( i.e. NTRU equation )
 namespace ntru_gen {
@@ -11,13 +32,22 @@ namespace ntru_gen {
 // 5 of Falcon specification https://falcon-sign.info/falcon.pdf
 constexpr double GS_NORM_THRESHOLD = 1.17 * 1.17 * static_cast<double>(ff::Q);
 
+// Coefficients of F ( and G ) must ∈ [-127, 127], because F is encoded in
+// secret key, using 8 -bits per coefficient, see section 3.11.5 of Falcon
+// specification https://falcon-sign.info/falcon.pdf
+constexpr int32_t FG_COEFF_MAX = 127;
+
 // Generate a random polynomial of degree (n - 1) | n ∈ {512, 1024} and each
 // coefficient is sampled from a gaussian distribution D_{Z, σ{f, g}, 0} with σ
 // = 1.17 * √(q/ 8192) as described in equation 3.29 on page 34 of the Falcon
-// specification https://falcon-sign.info/falcon.pdf
-template<const size_t LOG2N>
+// specification https://falcon-sign.info/falcon.pdf, by summing up 4096 / n
+// -many SamplerZ draws per coefficient.
+//
+// Note, key generation uses `gen_poly` instead, which samples from same
+// distribution, while this routine is kept as reference for testing it.
+template<const size_t LOG2N, prng::rng RNG>
 static inline void
-gen_poly(int32_t* const poly, prng::prng_t& rng)
+gen_poly_samplerz(int32_t* const poly, RNG& rng)
 {
   constexpr size_t N = 1ul << LOG2N;
   constexpr size_t k = 4096 / N;
@@ -38,33 +68,132 @@ gen_poly(int32_t* const poly, prng::prng_t& rng)
   }
 }
 
+// Reverse cumulative distribution tables of |x|, where x is sum of 4096 / n
+// -many samples from D_{Z, σ, 0} with σ = 1.17 * √(q/ 8192) ( i.e. what
+// `gen_poly_samplerz` computes per coefficient ) for n = 512 and n = 1024
+// respectively, s.t. i -th entry is ⌊2^63 * Pr[|x| > i]⌉. Those are computed
+// by convolving D_{Z, σ, 0} with itself, using 80 -digit decimal arithmetic,
+// while omitted entries would've been 0. Resulting standard deviation is ≈
+// 1.17 * √(q/ 2n), see equation 3.29 of Falcon specification.
+constexpr uint64_t FG_RCDT_512[]{ 0x7366BB52120E4E6Ful, 0x5AF5903F82E037D3ul,
+                                  0x44A66907D9B43E97ul, 0x317D782F3EA6DA20ul,
+                                  0x2201B4C5899CCD85ul, 0x163BB0832B46254Aul,
+                                  0x0DCF32EE81891CDFul, 0x0823606D698EDE63ul,
+                                  0x048BAEC53981B796ul, 0x02677C28E8A04558ul,
+                                  0x0134053BBFBE99C7ul, 0x0091C2279C5D4D9Dul,
+                                  0x00412ED739E6641Bul, 0x001B88B7A02F652Cul,
+                                  0x000AFB4036C10C31ul, 0x0004223E034BC66Aul,
+                                  0x000177DCEDA71986ul, 0x00007DECE8FA079Dul,
+                                  0x000027C940AD4255ul, 0x00000BDA1E3D75DCul,
+                                  0x000003540738AEADul, 0x000000E1825458AFul,
+                                  0x000000383F34B493ul, 0x0000000D38139C1Cul,
+                                  0x00000002ED4DAE31ul, 0x000000009C4B8778ul,
+                                  0x000000001EB56C3Eul, 0x0000000005AED12Bul,
+                                  0x0000000000FD8E38ul, 0x0000000000299DCEul,
+                                  0x0000000000066EA1ul, 0x000000000000EFA4ul,
+                                  0x00000000000020D6ul, 0x000000000000043Dul,
+                                  0x0000000000000084ul, 0x000000000000000Ful,
+                                  0x0000000000000002ul };
+
+constexpr uint64_t FG_RCDT_1024[]{ 0x6E2EC827D2037EACul, 0x4CA71379D0CA71EFul,
+                                   0x30B8137BD9715250ul, 0x1C1D82B0C6253CDFul,
+                                   0x0EA8F1A2E8A62BEEul, 0x06E14E41D01A12A5ul,
+                                   0x02E5BE00E3FC6726ul, 0x0117A1A6BD475DA2ul,
+                                   0x005E30BF36795B3Dul, 0x001C4DEA0BD58720ul,
+                                   0x000794225CD14AC6ul, 0x0001CE69617DF1E4ul,
+                                   0x00006205F2DEBAF0ul, 0x00001278063F6C47ul,
+                                   0x00000317547AF83Cul, 0x00000075990F1DDBul,
+                                   0x0000000F82C483BFul, 0x00000001D0AF3998ul,
+                                   0x00000000303C51DCul, 0x000000000470AEA1ul,
+                                   0x00000000005CC4D1ul, 0x000000000006B625ul,
+                                   0x0000000000006E2Cul, 0x0000000000000643ul,
+                                   0x0000000000000051ul, 0x0000000000000004ul };
+
+// Generate a random polynomial of degree (n - 1) | n ∈ {512, 1024} and each
+// coefficient is sampled from a gaussian distribution D_{Z, σ{f, g}, 0} with σ
+// = 1.17 * √(q/ 8192) as described in equation 3.29 on page 34 of the Falcon
+// specification https://falcon-sign.info/falcon.pdf
+//
+// Instead of summing up 4096 / n -many SamplerZ draws ( see
+// `gen_poly_samplerz` ), each coefficient is sampled directly from distribution
+// of that sum, using a single 64 -bit random word, whose low 63 -bits are
+// compared against all entries of RCDT ( see `FG_RCDT_512` ), computing |x|,
+// while its top bit decides sign of x. All comparisons are performed, without
+// any data dependent branch, so that it runs in constant-time.
+template<const size_t LOG2N, prng::rng RNG>
+static inline void
+gen_poly(int32_t* const poly, RNG& rng)
+  requires((LOG2N == 9) || (LOG2N == 10))
+{
+  constexpr size_t N = 1ul << LOG2N;
+  constexpr auto rcdt = LOG2N == 9 ? std::span<const uint64_t>(FG_RCDT_512)
+                                   : std::span<const uint64_t>(FG_RCDT_1024);
+
+  uint64_t u[N];
+  rng.read(reinterpret_cast<uint8_t*>(u), sizeof(u));
+
+  for (size_t i = 0; i < N; i++) {
+    const uint64_t v = u[i] & ((1ul << 63) - 1ul);
+    const auto s = -static_cast<int32_t>(u[i] >> 63);
+
+    int32_t z = 0;
+    for (const uint64_t r : rcdt) {
+      z += static_cast<int32_t>(v < r);
+    }
+
+    // conditionally negate z, when s = -1
+    poly[i] = (z ^ s) - s;
+  }
+}
+
+// NTT form of f and FFT forms of f, g, which are computed while checking a
+// candidate pair f, g ( see `ntru_gen_once` ), kept so that key generation can
+// reuse them, for computing public key and matrix B, instead of transforming
+// f, g again.
+template<const size_t N>
+struct fg_forms_t
+{
+  ff::ff_t f_ntt[N];   // NTT form of f, over Z_q
+  fft::cmplx f_fft[N]; // FFT form of f
+  fft::cmplx g_fft[N]; // FFT form of g
+};
+
 // Given a polynomial of degree (n - 1) | n ∈ {512, 1024}, this routine checks
 // whether it can be inverted by computing NTT representation of polynomial and
-// ensuring none of the coefficients, in NTT representation, are zero.
+// ensuring none of the coefficients, in NTT representation, are zero. NTT
+// representation is written to `poly_ntt`.
 template<const size_t LOG2N>
 static inline bool
-is_poly_invertible(const int32_t* const poly)
+is_poly_invertible(const int32_t* const __restrict poly,
+                   ff::ff_t* const __restrict poly_ntt)
 {
   constexpr size_t N = 1ul << LOG2N;
   constexpr int32_t q = ff::Q;
 
-  ff::ff_t tmp[N];
-
   for (size_t i = 0; i < N; i++) {
     const bool flg = poly[i] < 0;
-    tmp[i].v = static_cast<uint16_t>(flg * q + poly[i]);
+    poly_ntt[i].v = static_cast<uint16_t>(flg * q + poly[i]);
   }
 
-  ntt::ntt<LOG2N>(tmp);
+  ntt::ntt<LOG2N>(poly_ntt);
 
   bool flg = true;
   for (size_t i = 0; i < N; i++) {
-    flg &= tmp[i].v != 0;
+    flg &= poly_ntt[i].v != 0;
   }
 
   return flg;
 }
 
+// Same as above, but NTT representation of polynomial is thrown away.
+template<const size_t LOG2N>
+static inline bool
+is_poly_invertible(const int32_t* const poly)
+{
+  ff::ff_t tmp[1ul << LOG2N];
+  return is_poly_invertible<LOG2N>(poly, tmp);
+}
+
 // Given a polynomial of degree (n - 1) | n ∈ {512, 1024}, in its coefficient
 // representation, this routine computes squared norm using formula 3.10, as
 // described on top of page 24 of the Falcon specification
@@ -103,14 +232,17 @@ sqrd_norm(const fft::cmplx* const poly)
 }
 
 // Computes squared Gram-Schmidt norm of NTRU matrix generated using random
-// sampled polynomials f, g of degree (N - 1) | N = 2^LOG2N
+// sampled polynomials f, g of degree (N - 1) | N = 2^LOG2N, while writing FFT
+// forms of f, g to `f_`, `g_`.
 //
 // This routine does what line 9 of algorithm 5 in the Falcon specification (
 // https://falcon-sign.info/falcon.pdf ) does.
 template<const size_t LOG2N>
 static inline double
 gram_schmidt_norm(const int32_t* const __restrict f,
-                  const int32_t* const __restrict g)
+                  const int32_t* const __restrict g,
+                  fft::cmplx* const __restrict f_,
+                  fft::cmplx* const __restrict g_)
 {
   constexpr size_t N = 1ul << LOG2N;
   constexpr double q = ff::Q;
@@ -126,9 +258,6 @@ gram_schmidt_norm(const int32_t* const __restrict f,
 
   const auto sq_norm_fg = sqrd_norm<LOG2N>(tmp0) + sqrd_norm<LOG2N>(tmp1);
 
-  fft::cmplx f_[N];
-  fft::cmplx g_[N];
-
   for (size_t i = 0; i < N; i++) {
     f_[i] = fft::cmplx{ tmp0[i] };
     g_[i] = fft::cmplx{ tmp1[i] };
@@ -140,8 +269,8 @@ gram_schmidt_norm(const int32_t* const __restrict f,
   fft::cmplx f_adj[N];
   fft::cmplx g_adj[N];
 
-  std::memcpy(f_adj, f_, sizeof(f_));
-  std::memcpy(g_adj, g_, sizeof(g_));
+  std::memcpy(f_adj, f_, sizeof(f_adj));
+  std::memcpy(g_adj, g_, sizeof(g_adj));
 
   fft::adj_poly<LOG2N>(f_adj);
   fft::adj_poly<LOG2N>(g_adj);
@@ -165,6 +294,42 @@ gram_schmidt_norm(const int32_t* const __restrict f,
   return std::max(sq_norm_fg, sq_norm_FG);
 }
 
+// Same as above, but FFT forms of f, g are thrown away.
+template<const size_t LOG2N>
+static inline double
+gram_schmidt_norm(const int32_t* const __restrict f,
+                  const int32_t* const __restrict g)
+{
+  fft::cmplx f_[1ul << LOG2N];
+  fft::cmplx g_[1ul << LOG2N];
+
+  return gram_schmidt_norm<LOG2N>(f, g, f_, g_);
+}
+
+#if !defined FALCON_NTRU_SOLVE_RNS
+
+// At recursion levels of NTRUSolve, where polynomials are of degree >=
+// FORK_JOIN_MIN_N, independent branches of computation are run in parallel,
+// when calling thread is in fork-join execution mode ( see
+// `work_stealing::fork_join_scope_t` ). Below that, each branch is too short
+// to pay off for handing it over to another worker.
+constexpr size_t FORK_JOIN_MIN_N = 64;
+
+// Runs f0() and f1(), which work on polynomials of degree N, in parallel ( see
+// `work_stealing::fork_join` ), if N >= FORK_JOIN_MIN_N, otherwise one after
+// another.
+template<const size_t N, typename F0, typename F1>
+static inline void
+fork_join(F0&& f0, F1&& f1)
+{
+  if constexpr (N >= FORK_JOIN_MIN_N) {
+    work_stealing::fork_join(f0, f1);
+  } else {
+    f0();
+    f1();
+  }
+}
+
 // Computes field norm a polynomial ( in coefficient representation ) of degree
 // N s.t. N > 1 and N = 2^i, projecting element of Q[x]/(x^n + 1) to
 // Q[x]/(x^(n/2) + 1), following section 3.6.1 of the Falcon specification ( see
@@ -188,8 +353,14 @@ field_norm(const std::array<mpz_class, N>& poly)
     polyo[i] = poly[2 * i + 1];
   }
 
-  const nby2poly_t polye_sq = karatsuba::karamul(polye, polye);
-  const nby2poly_t polyo_sq = karatsuba::karamul(polyo, polyo);
+  std::vector<mpz_class> scratch(ntru_mul::scratch_len<Nby2>());
+  nby2poly_t polye_sq;
+  nby2poly_t polyo_sq;
+
+  ntru_mul::mul<Nby2>(
+    polye.data(), polye.data(), polye_sq.data(), scratch.data());
+  ntru_mul::mul<Nby2>(
+    polyo.data(), polyo.data(), polyo_sq.data(), scratch.data());
 
   nby2poly_t res = polye_sq;
   for (size_t i = 0; i < Nby2 - 1; i++) {
@@ -279,172 +450,212 @@ galois_conjugate(const std::array<mpz_class, N>& poly)
   return res;
 }
 
-// Approximates bit length of value ∈ Z, with out considering sign bit. Note,
-// this function doesn't precisely compute bit length of v, rather it rounds bit
-// length to next multiple of 8.
-//
-// Adapted from
-// https://github.com/tprest/falcon.py/blob/88d01ed/ntrugen.py#L90-L101
+// Computes exact bit length of |v|, for v ∈ Z, s.t. it's 0 for v = 0
 static inline size_t
-approx_bit_len(const mpz_class& v)
+bit_len(const mpz_class& v)
 {
-  const mpz_class zero{ 0 };
-
-  mpz_class v_;
-  mpz_abs(v_.get_mpz_t(), v.get_mpz_t());
+  return sgn(v) == 0 ? 0 : mpz_sizeinbase(v.get_mpz_t(), 2);
+}
 
+// Computes maximum bit length of coefficients of a polynomial of degree N - 1
+template<const size_t N>
+static inline size_t
+max_bit_len(const std::array<mpz_class, N>& poly)
+{
   size_t len = 0;
-  while (v_ > zero) {
-    len += 8;
-    v_ = v_ >> 8;
+  for (size_t i = 0; i < N; i++) {
+    len = std::max(len, bit_len(poly[i]));
   }
-
   return len;
 }
 
-// Given a polynomial of degree N ( s.t. > 1 and power of 2 ), this routine find
-// minimum and maximum coefficient from that polynomial.
-template<const size_t N>
-static inline std::pair<mpz_class, mpz_class>
-min_max(const std::array<mpz_class, N>& arr)
-  requires((N > 1) && (N & (N - 1)) == 0)
+// Approximates v / 2^sh, for v ∈ Z, as a double precision floating point
+// number, without allocating any temporary big integer
+static inline double
+to_double(const mpz_class& v, const size_t sh)
 {
-  mpz_class min(arr[0]);
-  mpz_class max(arr[0]);
+  long e = 0;
+  const double d = mpz_get_d_2exp(&e, v.get_mpz_t());
+  return std::ldexp(d, static_cast<int>(e) - static_cast<int>(sh));
+}
 
-  for (size_t i = 1; i < N; i++) {
-    if (min > arr[i]) {
-      min = arr[i];
-    }
-    if (max < arr[i]) {
-      max = arr[i];
-    }
-  }
+// Statistics of Babai reduction ( see `reduce` ), at some recursion level of
+// NTRUSolve
+struct reduce_stats_t
+{
+  uint64_t calls = 0;  // # -of times F, G were reduced
+  uint64_t rounds = 0; // # -of rounds, summed over all calls
+  uint64_t ns = 0;     // time spent, summed over all calls
+};
+
+// Per-level statistics of Babai reduction, collected by calling thread,
+// indexed by log2 of degree of polynomials being reduced
+using reduce_stats_arr_t = std::array<reduce_stats_t, 11>;
+
+// Statistics of Babai reduction, collected by calling thread, since it started
+// or since those were last reset
+inline reduce_stats_arr_t&
+reduce_stats()
+{
+  static thread_local reduce_stats_arr_t s{};
+  return s;
+}
 
-  return { min, max };
+// Resets statistics of Babai reduction, collected by calling thread
+inline void
+reset_reduce_stats()
+{
+  reduce_stats() = reduce_stats_arr_t{};
 }
 
 // Given four polynomials of degree N, this routine reduces F, G w.r.t. f, g
 // using algorithm 7 of Falcon specification and returns reduced F, G.
 //
+// FFT of f, g and f * adj(f) + g * adj(g) is computed only once. Each round
+// approximates k = (F * adj(f) + G * adj(g)) / (f * adj(f) + g * adj(g)),
+// scaled s.t. it carries ~ 50 -bits of precision, which is why F, G shrink by
+// ~ 50 -bits per round. Bit length of F, G is tracked while subtracting k * f,
+// k * g from them. Number of rounds and time spent are accounted in statistics
+// of calling thread ( see `reduce_stats` ).
+//
+// Returns false, if reduction doesn't converge, which happens for some
+// ill-conditioned f, g, where k keeps flipping, without F, G getting any
+// smaller. Such candidates are rejected, same as GMP-free NTRUSolve does.
+//
 // This implementation collects inspiration from
 // https://github.com/tprest/falcon.py/blob/88d01ed/ntrugen.py#L104-L150
 template<const size_t N>
-static inline void
+static inline bool
 reduce(const std::array<mpz_class, N>& f,
        const std::array<mpz_class, N>& g,
        std::array<mpz_class, N>& F,
        std::array<mpz_class, N>& G)
   requires((N > 1) && (N & (N - 1)) == 0)
 {
-  const std::pair<mpz_class, mpz_class> fmm = min_max(f);
-  const std::pair<mpz_class, mpz_class> gmm = min_max(g);
+  using sclock = std::chrono::steady_clock;
+  constexpr size_t max_rounds = 1024;
+
+  const auto t0 = sclock::now();
 
-  const size_t blen0 = std::max(
-    53ul,
-    std::max(std::max(approx_bit_len(fmm.first), approx_bit_len(fmm.second)),
-             std::max(approx_bit_len(gmm.first), approx_bit_len(gmm.second))));
+  const size_t blen0 = std::max(53ul, std::max(max_bit_len(f), max_bit_len(g)));
 
-  fft::cmplx f_adjust[N];
-  fft::cmplx g_adjust[N];
-  fft::cmplx f_adjoint[N];
-  fft::cmplx g_adjoint[N];
+  fft::cmplx f_adj[N];
+  fft::cmplx g_adj[N];
+  fft::cmplx fg_den[N];
 
   for (size_t i = 0; i < N; i++) {
-    f_adjust[i] = fft::cmplx{ mpz_class(f[i] >> (blen0 - 53ul)).get_d() };
-    g_adjust[i] = fft::cmplx{ mpz_class(g[i] >> (blen0 - 53ul)).get_d() };
+    f_adj[i] = fft::cmplx{ to_double(f[i], blen0) };
+    g_adj[i] = fft::cmplx{ to_double(g[i], blen0) };
   }
 
-  fft::fft<log2<N>()>(f_adjust);
-  fft::fft<log2<N>()>(g_adjust);
+  fft::fft<log2<N>()>(f_adj);
+  fft::fft<log2<N>()>(g_adj);
 
-  std::memcpy(f_adjoint, f_adjust, sizeof(f_adjust));
-  std::memcpy(g_adjoint, g_adjust, sizeof(g_adjust));
+  // f * adj(f) + g * adj(g) is real valued, in FFT form
+  for (size_t i = 0; i < N; i++) {
+    fg_den[i] = fft::cmplx{ std::norm(f_adj[i]) + std::norm(g_adj[i]) };
+  }
 
-  fft::adj_poly<log2<N>()>(f_adjoint);
-  fft::adj_poly<log2<N>()>(g_adjoint);
+  fft::adj_poly<log2<N>()>(f_adj);
+  fft::adj_poly<log2<N>()>(g_adj);
 
-  while (1) {
-    const std::pair<mpz_class, mpz_class> Fmm = min_max(F);
-    const std::pair<mpz_class, mpz_class> Gmm = min_max(G);
+  // big integers reused across rounds, so that their limbs are allocated once,
+  // while k * f and k * g have their own scratch space, as those may be
+  // computed in parallel
+  constexpr size_t slen = ntru_mul::scratch_len<N>();
+  std::vector<mpz_class> scratch(2 * slen);
+  std::array<mpz_class, N> k_mpz;
+  std::array<mpz_class, N> fk;
+  std::array<mpz_class, N> gk;
 
-    const size_t blen1 = std::max(
-      53ul,
-      std::max(
-        std::max(approx_bit_len(Fmm.first), approx_bit_len(Fmm.second)),
-        std::max(approx_bit_len(Gmm.first), approx_bit_len(Gmm.second))));
+  fft::cmplx F_fft[N];
+  fft::cmplx G_fft[N];
+  fft::cmplx k[N];
 
-    if (blen1 < blen0) {
-      break;
-    }
+  size_t blen1 = std::max(53ul, std::max(max_bit_len(F), max_bit_len(G)));
+  size_t rounds = 0;
 
-    fft::cmplx F_adjust[N];
-    fft::cmplx G_adjust[N];
-    fft::cmplx F_adjoint[N];
-    fft::cmplx G_adjoint[N];
+  while ((blen1 >= blen0) && (rounds < max_rounds)) {
+    // k is computed scaled down by 2^sh
+    size_t sh = blen1 > blen0 + 50 ? blen1 - blen0 - 50 : 0;
 
     for (size_t i = 0; i < N; i++) {
-      F_adjust[i] = fft::cmplx{ mpz_class(F[i] >> (blen1 - 53ul)).get_d() };
-      G_adjust[i] = fft::cmplx{ mpz_class(G[i] >> (blen1 - 53ul)).get_d() };
+      F_fft[i] = fft::cmplx{ to_double(F[i], blen0 + sh) };
+      G_fft[i] = fft::cmplx{ to_double(G[i], blen0 + sh) };
     }
 
-    fft::fft<log2<N>()>(F_adjust);
-    fft::fft<log2<N>()>(G_adjust);
-
-    std::memcpy(F_adjoint, F_adjust, sizeof(F_adjust));
-    std::memcpy(G_adjoint, G_adjust, sizeof(G_adjust));
-
-    fft::adj_poly<log2<N>()>(F_adjoint);
-    fft::adj_poly<log2<N>()>(G_adjoint);
+    fft::fft<log2<N>()>(F_fft);
+    fft::fft<log2<N>()>(G_fft);
 
-    fft::cmplx ff_mul[N];
-    fft::cmplx gg_mul[N];
-    fft::cmplx Ff_mul[N];
-    fft::cmplx Gg_mul[N];
-
-    polynomial::mul<log2<N>()>(f_adjust, f_adjoint, ff_mul);
-    polynomial::mul<log2<N>()>(g_adjust, g_adjoint, gg_mul);
-    polynomial::mul<log2<N>()>(F_adjust, f_adjoint, Ff_mul);
-    polynomial::mul<log2<N>()>(G_adjust, g_adjoint, Gg_mul);
-
-    fft::cmplx ffgg_add[N];
-    fft::cmplx FfGg_add[N];
-
-    polynomial::add<log2<N>()>(ff_mul, gg_mul, ffgg_add);
-    polynomial::add<log2<N>()>(Ff_mul, Gg_mul, FfGg_add);
-
-    fft::cmplx k[N];
+    for (size_t i = 0; i < N; i++) {
+      k[i] = (F_fft[i] * f_adj[i] + G_fft[i] * g_adj[i]) / fg_den[i];
+    }
 
-    polynomial::div<log2<N>()>(FfGg_add, ffgg_add, k);
     fft::ifft<log2<N>()>(k);
 
-    signed long k_rounded[N];
+    // when f, g are ill-conditioned, k may not fit in 62 -bits, in which case
+    // it's scaled down further
+    double kmax = 0.;
     for (size_t i = 0; i < N; i++) {
-      k_rounded[i] = static_cast<signed long>(std::round(k[i].real()));
+      kmax = std::max(kmax, std::abs(k[i].real()));
+    }
+    if (!std::isfinite(kmax)) [[unlikely]] {
+      rounds = max_rounds;
+      break;
+    }
+    if (kmax >= 0x1p61) {
+      const auto extra = static_cast<size_t>(std::ilogb(kmax)) - 60;
+      for (size_t i = 0; i < N; i++) {
+        k[i] = fft::cmplx{ std::ldexp(k[i].real(), -static_cast<int>(extra)) };
+      }
+      sh += extra;
     }
 
     bool atleast_one_nonzero = false;
     for (size_t i = 0; i < N; i++) {
-      atleast_one_nonzero |= k_rounded[i] != 0;
+      const auto v = static_cast<signed long>(std::round(k[i].real()));
+      atleast_one_nonzero |= v != 0;
+      k_mpz[i] = v;
     }
 
     if (!atleast_one_nonzero) {
       break;
     }
 
-    std::array<mpz_class, N> k_mpz;
+    fork_join<N>(
+      [&]() {
+        const auto k_ = k_mpz.data();
+        ntru_mul::mul<N>(f.data(), k_, fk.data(), scratch.data());
+      },
+      [&]() {
+        const auto k_ = k_mpz.data();
+        ntru_mul::mul<N>(g.data(), k_, gk.data(), scratch.data() + slen);
+      });
+
+    size_t blen = 0;
     for (size_t i = 0; i < N; i++) {
-      k_mpz[i] = mpz_class(k_rounded[i]);
-    }
+      mpz_mul_2exp(fk[i].get_mpz_t(), fk[i].get_mpz_t(), sh);
+      mpz_mul_2exp(gk[i].get_mpz_t(), gk[i].get_mpz_t(), sh);
 
-    const std::array<mpz_class, N> fk = karatsuba::karamul(f, k_mpz);
-    const std::array<mpz_class, N> gk = karatsuba::karamul(g, k_mpz);
+      F[i] -= fk[i];
+      G[i] -= gk[i];
 
-    for (size_t i = 0; i < N; i++) {
-      F[i] = F[i] - mpz_class(fk[i] << (blen1 - blen0));
-      G[i] = G[i] - mpz_class(gk[i] << (blen1 - blen0));
+      blen = std::max(blen, std::max(bit_len(F[i]), bit_len(G[i])));
     }
+
+    blen1 = std::max(53ul, blen);
+    rounds++;
   }
+
+  const auto t1 = sclock::now();
+  const auto ns = std::chrono::nanoseconds(t1 - t0).count();
+
+  auto& s = reduce_stats()[log2<N>()];
+  s.calls++;
+  s.rounds += rounds;
+  s.ns += static_cast<uint64_t>(ns);
+
+  return rounds < max_rounds;
 }
 
 // Ad-hoc wrapper type for denoting that it's time to abort execution of NTRU
@@ -470,13 +681,23 @@ public:
 // Before consuming two polynomials F, G, consider checking whether it's a valid
 // solution or not, using is_solution() function on returned value of type
 // ntru_solve_status_t.
+//
+// Cancellation token ( see `work_stealing::cancel_t` ) is checked once per
+// recursion level, on way down and up, s.t. as soon as it's cancelled, this
+// routine gives up, returning a status which isn't a solution.
 template<const size_t N>
 static inline std::pair<
   std::pair<std::array<mpz_class, N>, std::array<mpz_class, N>>,
   ntru_solve_status_t>
-ntru_solve(const std::array<mpz_class, N>& f, const std::array<mpz_class, N>& g)
+ntru_solve(const std::array<mpz_class, N>& f,
+           const std::array<mpz_class, N>& g,
+           const work_stealing::cancel_t cancelled = {})
   requires((N >= 1) && (N & (N - 1)) == 0)
 {
+  if (cancelled()) {
+    return { {}, ntru_solve_status_t{ 2u } };
+  }
+
   if constexpr (N == 1) {
     const auto ret = xgcd(f[0], g[0]);
     if (ret[2] != mpz_class{ 1 }) {
@@ -487,67 +708,270 @@ ntru_solve(const std::array<mpz_class, N>& f, const std::array<mpz_class, N>& g)
                ntru_solve_status_t{} };
     }
   } else {
-    const auto fprime = field_norm(f);
-    const auto gprime = field_norm(g);
+    std::array<mpz_class, N / 2> fprime;
+    std::array<mpz_class, N / 2> gprime;
 
-    const auto ret = ntru_solve(fprime, gprime);
+    fork_join<N>([&]() { fprime = field_norm(f); },
+                 [&]() { gprime = field_norm(g); });
+
+    const auto ret = ntru_solve(fprime, gprime, cancelled);
 
     if (!ret.second.is_solution()) {
       return { {}, ret.second };
     }
+    if (cancelled()) {
+      return { {}, ntru_solve_status_t{ 2u } };
+    }
 
-    auto F = karatsuba::karamul(lift(ret.first.first), galois_conjugate(g));
-    auto G = karatsuba::karamul(lift(ret.first.second), galois_conjugate(f));
-
-    reduce(f, g, F, G);
+    const auto Fl = lift(ret.first.first);
+    const auto Gl = lift(ret.first.second);
+    const auto fc = galois_conjugate(f);
+    const auto gc = galois_conjugate(g);
+
+    constexpr size_t slen = ntru_mul::scratch_len<N>();
+    std::vector<mpz_class> scratch(2 * slen);
+    std::array<mpz_class, N> F;
+    std::array<mpz_class, N> G;
+
+    fork_join<N>(
+      [&]() {
+        ntru_mul::mul<N>(Fl.data(), gc.data(), F.data(), scratch.data());
+      },
+      [&]() {
+        ntru_mul::mul<N>(Gl.data(), fc.data(), G.data(), scratch.data() + slen);
+      });
+
+    if (!reduce(f, g, F, G)) {
+      return { {}, ntru_solve_status_t{ 3u } };
+    }
     return { { F, G }, ntru_solve_status_t{} };
   }
 }
 
+#endif
+
+// Checks whether all coefficients of F and G ∈ [-FG_COEFF_MAX, FG_COEFF_MAX],
+// so that they can be encoded in secret key
+template<const size_t N>
+static inline bool
+is_encodable(const int32_t* const __restrict F,
+             const int32_t* const __restrict G)
+{
+  bool in_range = true;
+  for (size_t i = 0; i < N; i++) {
+    in_range &= std::abs(F[i]) <= FG_COEFF_MAX;
+    in_range &= std::abs(G[i]) <= FG_COEFF_MAX;
+  }
+  return in_range;
+}
+
+// Samples one candidate pair of polynomials f, g and attempts to compute F, G
+// s.t. f, g, F, G ∈ Z[x]/(x^N + 1) solve NTRU equation ( see eq 3.15 of Falcon
+// specification ), returning true if candidate passes all checks of algorithm
+// 5 of Falcon specification https://falcon-sign.info/falcon.pdf, otherwise
+// contents of f, g, F, G must not be used.
+//
+// Attempt is abandoned as soon as it's cancelled ( see
+// `work_stealing::cancel_t` ), which is checked between steps and on each
+// recursion level of NTRUSolve. If `forms` is non-null, NTT form of f and FFT
+// forms of f, g, computed while checking candidate, are written to it ( see
+// `fg_forms_t` ).
+template<const size_t N, prng::rng RNG>
+static inline bool
+ntru_gen_once(int32_t* const __restrict f,
+              int32_t* const __restrict g,
+              int32_t* const __restrict F,
+              int32_t* const __restrict G,
+              RNG& rng,
+              const work_stealing::cancel_t cancelled = {},
+              fg_forms_t<N>* const __restrict forms = nullptr)
+  requires((N == 512) || (N == 1024))
+{
+  fg_forms_t<N> forms_;
+  fg_forms_t<N>& fm = forms != nullptr ? *forms : forms_;
+
+  gen_poly<log2<N>()>(f, rng);
+  gen_poly<log2<N>()>(g, rng);
+
+  if (!is_poly_invertible<log2<N>()>(f, fm.f_ntt) || cancelled()) {
+    return false;
+  }
+
+  const double gsnorm =
+    gram_schmidt_norm<log2<N>()>(f, g, fm.f_fft, fm.g_fft);
+  if (gsnorm > GS_NORM_THRESHOLD || cancelled()) {
+    return false;
+  }
+
+#if defined FALCON_NTRU_SOLVE_RNS
+  if (!ntru_rns::ntru_solve<N>(f, g, F, G, cancelled)) {
+    return false;
+  }
+#else
+  std::array<mpz_class, N> f_;
+  std::array<mpz_class, N> g_;
+
+  for (size_t i = 0; i < N; i++) {
+    f_[i] = mpz_class(f[i]);
+    g_[i] = mpz_class(g[i]);
+  }
+
+  const auto ret = ntru_solve(f_, g_, cancelled);
+  if (!ret.second.is_solution()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    const auto& Fi = ret.first.first[i];
+    const auto& Gi = ret.first.second[i];
+
+    if (!Fi.fits_sint_p() || !Gi.fits_sint_p()) {
+      return false;
+    }
+
+    F[i] = static_cast<int32_t>(Fi.get_si());
+    G[i] = static_cast<int32_t>(Gi.get_si());
+  }
+#endif
+
+  // reject solution, if F or G can't be encoded, same as reference
+  // implementation does
+  return is_encodable<N>(F, G);
+}
+
 // Given a modulus q ( = 12289 ), this routine generates four polynomials f, g,
 // F, G ∈ Z[x]/(x^N + 1), solving NTRU equation ( see eq 3.15 of Falcon
 // specification ). This routine is an implementation of algorithm 5 of Falcon
 // specification https://falcon-sign.info/falcon.pdf
-template<const size_t N>
+//
+// If arena allocator is installed ( see `gmp_arena::install` ), big integer
+// temporaries of NTRUSolve are served from an arena, owned by calling thread,
+// for duration of this call, unless calling thread is in fork-join execution
+// mode ( see `work_stealing::fork_join_scope_t` ), in which independent
+// branches of NTRUSolve are run in parallel, by workers of the pool.
+//
+// If `forms` is non-null, NTT form of f and FFT forms of f, g are written to
+// it, so that caller can reuse them ( see `fg_forms_t` ).
+template<const size_t N, prng::rng RNG>
 static inline void
 ntru_gen(int32_t* const __restrict f,
          int32_t* const __restrict g,
          int32_t* const __restrict F,
          int32_t* const __restrict G,
-         prng::prng_t& rng)
+         RNG& rng,
+         fg_forms_t<N>* const __restrict forms = nullptr)
   requires((N == 512) || (N == 1024))
 {
-  while (1) {
-    gen_poly<log2<N>()>(f, rng);
-    gen_poly<log2<N>()>(g, rng);
+#if !defined FALCON_NTRU_SOLVE_RNS
+  // big integer temporaries of NTRUSolve are served from an arena, unless
+  // they may be passed around workers of a fork-join pool, because a block of
+  // arena must be freed by the thread, which allocated it
+  std::optional<gmp_arena::scope_t> arena;
+  if (work_stealing::fork_join_pool() == nullptr) {
+    arena.emplace();
+  }
+#endif
 
-    if (!is_poly_invertible<log2<N>()>(f)) {
-      continue;
-    }
+  while (!ntru_gen_once<N>(f, g, F, G, rng, {}, forms)) {
+  }
+}
 
-    const double gsnorm = gram_schmidt_norm<log2<N>()>(f, g);
-    if (gsnorm > GS_NORM_THRESHOLD) {
-      continue;
+// Same as above, but evaluates many candidate pairs f, g at once, one per
+// worker of given work-stealing pool. Candidates are numbered, in order of
+// being started, s.t. i-th candidate is sampled using a ChaCha20 based PRNG,
+// keyed with a seed sampled from `rng`, with nonce i. Lowest numbered
+// candidate, which solves NTRU equation, is accepted, so that a worker
+// abandons its candidate ( see `ntru_gen_once` ), only when a lower numbered
+// one has already succeeded.
+//
+// Hence, for a given seed, result doesn't depend on # -of workers or on their
+// scheduling, and it's same as trying candidates one after another, while
+// accepted f, g follow same distribution, as they do in `ntru_gen`.
+//
+// Only a fraction of candidates make it through all checks of algorithm 5, so
+// that on an otherwise idle machine, this reduces wall-clock time of
+// generating a single key, by trying several of them at once.
+template<const size_t N, prng::rng RNG>
+static inline void
+ntru_gen_speculative(int32_t* const __restrict f,
+                     int32_t* const __restrict g,
+                     int32_t* const __restrict F,
+                     int32_t* const __restrict G,
+                     RNG& rng,
+                     work_stealing::pool_t& pool,
+                     fg_forms_t<N>* const __restrict forms = nullptr)
+  requires((N == 512) || (N == 1024))
+{
+  // last candidate tried by a worker, which is also its solution, if `seq`
+  // turns out to be lowest numbered successful one
+  struct candidate_t
+  {
+    uint64_t seq = std::numeric_limits<uint64_t>::max();
+    int32_t f[N];
+    int32_t g[N];
+    int32_t F[N];
+    int32_t G[N];
+    fg_forms_t<N> forms;
+  };
+
+  uint8_t seed[prng::chacha20_t::KEY_LEN];
+  rng.read(seed, sizeof(seed));
+
+  const size_t cnt = pool.size();
+  std::vector<candidate_t> cands(cnt);
+
+  std::atomic<uint64_t> next{ 0ul };
+  std::atomic<uint64_t> best{ std::numeric_limits<uint64_t>::max() };
+
+  pool.parallel_for(cnt, [&](const size_t i) {
+#if !defined FALCON_NTRU_SOLVE_RNS
+    std::optional<gmp_arena::scope_t> arena;
+    if (work_stealing::fork_join_pool() == nullptr) {
+      arena.emplace();
     }
+#endif
 
-    std::array<mpz_class, N> f_;
-    std::array<mpz_class, N> g_;
+    auto& c = cands[i];
 
-    for (size_t i = 0; i < N; i++) {
-      f_[i] = mpz_class(f[i]);
-      g_[i] = mpz_class(g[i]);
+    while (true) {
+      const uint64_t seq = next.fetch_add(1ul, std::memory_order_relaxed);
+      if (seq > best.load(std::memory_order_relaxed)) {
+        break;
+      }
+
+      prng::chacha20_t crng(seed, seq);
+      const work_stealing::cancel_t cancelled{ &best, seq };
+
+      if (!ntru_gen_once<N>(c.f, c.g, c.F, c.G, crng, cancelled, &c.forms)) {
+        continue;
+      }
+
+      // lower best to seq, unless a lower numbered candidate has succeeded
+      uint64_t cur = best.load(std::memory_order_relaxed);
+      while ((seq < cur) && !best.compare_exchange_weak(cur, seq)) {
+      }
+      if (seq < cur) {
+        c.seq = seq;
+      }
+
+      // any candidate, this worker may start now, is numbered higher
+      break;
     }
+  });
 
-    const auto ret = ntru_solve(f_, g_);
-    if (!ret.second.is_solution()) {
+  const uint64_t won = best.load();
+  for (const auto& c : cands) {
+    if (c.seq != won) {
       continue;
     }
 
-    for (size_t i = 0; i < N; i++) {
-      F[i] = static_cast<int32_t>(ret.first.first[i].get_si());
-      G[i] = static_cast<int32_t>(ret.first.second[i].get_si());
+    std::copy_n(c.f, N, f);
+    std::copy_n(c.g, N, g);
+    std::copy_n(c.F, N, F);
+    std::copy_n(c.G, N, G);
+    if (forms != nullptr) {
+      *forms = c.forms;
     }
-    break;
   }
 }
 
@@ -0,0 +1,330 @@
+#pragma once
+#include "common.hpp"
+#include "karatsuba.hpp"
+#include "ntru_solve_rns.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <gmp.h>
+#include <gmpxx.h>
+#include <vector>
+
+// Multiplication of polynomials ∈ Z[x]/(x^N + 1), with big integer
+// coefficients, as performed by GMP backed NTRUSolve, while picking ( per call
+// ) one of several strategies, based on degree and coefficient bit size.
+//
+// Going down recursion levels of NTRUSolve, degree halves, while coefficients
+// grow to roughly 2^d * 6 -bits, at depth d. So no single strategy is best at
+// all levels.
+namespace ntru_mul {
+
+// Multiplication strategies
+enum class strategy_t : size_t
+{
+  // Schoolbook method over machine integers, when each coefficient of product
+  // fits in a ( 128 -bit, if supported ) machine word
+  schoolbook = 0,
+  // Karatsuba over GMP big integers, see karatsuba.hpp
+  karatsuba = 1,
+  // Modulo several 31 -bit primes, using NTT, followed by CRT, see
+  // ntru_solve_rns.hpp
+  ntt = 2,
+};
+
+// # -of multiplication strategies
+constexpr size_t STRATEGY_CNT = 3;
+
+// Thresholds, used for picking multiplication strategy, which can be tuned for
+// a specific machine, see `set_thresholds`.
+struct thresholds_t
+{
+  // Polynomials of degree >= ntt_min_degree are multiplied using NTT, as long
+  // as coefficients of product are of at most ntt_max_bits -bits, because cost
+  // of CRT reconstruction grows quadratically with # -of primes
+  size_t ntt_min_degree = 128;
+  size_t ntt_max_bits = 256;
+};
+
+// Thresholds shared by all threads, kept in atomics, so that those can be
+// updated while other threads are generating keys
+struct shared_thresholds_t
+{
+  std::atomic<size_t> ntt_min_degree{ thresholds_t{}.ntt_min_degree };
+  std::atomic<size_t> ntt_max_bits{ thresholds_t{}.ntt_max_bits };
+};
+
+inline shared_thresholds_t&
+shared_thresholds()
+{
+  static shared_thresholds_t t;
+  return t;
+}
+
+// Snapshot of thresholds being used by default, see `thresholds_t`
+inline thresholds_t
+thresholds()
+{
+  const auto& t = shared_thresholds();
+  return { t.ntt_min_degree.load(std::memory_order_relaxed),
+           t.ntt_max_bits.load(std::memory_order_relaxed) };
+}
+
+// Updates thresholds being used by default, see `thresholds_t`. A
+// multiplication, which is already running, keeps using thresholds it started
+// with.
+inline void
+set_thresholds(const thresholds_t& t)
+{
+  auto& t_ = shared_thresholds();
+  t_.ntt_min_degree.store(t.ntt_min_degree, std::memory_order_relaxed);
+  t_.ntt_max_bits.store(t.ntt_max_bits, std::memory_order_relaxed);
+}
+
+// Time spent in multiplying polynomials of degree 2^i, per strategy
+struct level_stats_t
+{
+  std::array<uint64_t, STRATEGY_CNT> calls{};
+  std::array<uint64_t, STRATEGY_CNT> ns{};
+};
+
+// Per-level statistics, collected by calling thread, indexed by log2 of degree
+// of polynomials being multiplied, see `level_stats_t`
+using stats_t = std::array<level_stats_t, 11>;
+
+// Statistics, collected by calling thread, since it started or since those
+// were last reset
+inline stats_t&
+stats()
+{
+  static thread_local stats_t s{};
+  return s;
+}
+
+// Resets statistics, collected by calling thread
+inline void
+reset_stats()
+{
+  stats() = stats_t{};
+}
+
+#if __SIZEOF_INT128__ == 16
+__extension__ using acc_t = __int128;
+#else
+using acc_t = int64_t;
+#endif
+
+// Maximum bit length of coefficients of product, for which schoolbook method
+// can be used, s.t. one bit is left for sign
+constexpr size_t SCHOOLBOOK_MAX_BITS = sizeof(acc_t) * 8 - 2;
+
+// Maximum bit length of an input coefficient, which fits in int64_t
+constexpr size_t SCHOOLBOOK_MAX_IN_BITS = 62;
+
+// Maximum bit length of coefficients of polynomial
+template<const size_t N>
+static inline size_t
+max_bits(const mpz_class* const poly)
+{
+  size_t bits = 0;
+  for (size_t i = 0; i < N; i++) {
+    bits = std::max(bits, mpz_sizeinbase(poly[i].get_mpz_t(), 2));
+  }
+  return bits;
+}
+
+// Picks multiplication strategy for polynomials of degree N - 1, whose
+// coefficients are of at most `abits`, `bbits` -bits respectively, using
+// thresholds `t`
+template<const size_t N>
+static inline strategy_t
+select(const size_t abits,
+       const size_t bbits,
+       const thresholds_t& t = thresholds())
+{
+  const size_t pbits = abits + bbits + log2<N>() + 1;
+
+  if ((abits <= SCHOOLBOOK_MAX_IN_BITS) && (bbits <= SCHOOLBOOK_MAX_IN_BITS) &&
+      (pbits <= SCHOOLBOOK_MAX_BITS)) {
+    return strategy_t::schoolbook;
+  }
+
+  if ((N >= t.ntt_min_degree) && (pbits <= t.ntt_max_bits)) {
+    return strategy_t::ntt;
+  }
+
+  return strategy_t::karatsuba;
+}
+
+// Computes a * b mod (x^N + 1), using schoolbook method over machine integers,
+// s.t. coefficients of a, b and a * b fit in int64_t, int64_t and acc_t.
+template<const size_t N>
+static inline void
+schoolbook(const mpz_class* const __restrict a,
+           const mpz_class* const __restrict b,
+           mpz_class* const __restrict res)
+{
+  std::array<int64_t, N> a_;
+  std::array<int64_t, N> b_;
+  std::array<acc_t, N> c{};
+
+  for (size_t i = 0; i < N; i++) {
+    a_[i] = mpz_get_si(a[i].get_mpz_t());
+    b_[i] = mpz_get_si(b[i].get_mpz_t());
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    const acc_t ai = a_[i];
+
+    for (size_t j = 0; j < N - i; j++) {
+      c[i + j] += ai * b_[j];
+    }
+    for (size_t j = N - i; j < N; j++) {
+      c[i + j - N] -= ai * b_[j];
+    }
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    const acc_t v = c[i];
+    const auto lo = static_cast<int64_t>(v);
+
+    if (static_cast<acc_t>(lo) == v) {
+      mpz_set_si(res[i].get_mpz_t(), lo);
+      continue;
+    }
+
+    // v doesn't fit in 64 -bits, so set its high and low halves separately
+    const auto hi = static_cast<int64_t>(v >> 32 >> 32);
+    mpz_set_si(res[i].get_mpz_t(), hi);
+    mpz_mul_2exp(res[i].get_mpz_t(), res[i].get_mpz_t(), 64);
+    mpz_add_ui(res[i].get_mpz_t(),
+               res[i].get_mpz_t(),
+               static_cast<unsigned long>(static_cast<uint64_t>(v)));
+  }
+}
+
+// Converts polynomial with big integer coefficients of at most `bits` -bits,
+// to one with coefficients of 31 -bit words, see `ntru_rns::zpoly_t`
+template<const size_t N>
+static inline ntru_rns::zpoly_t
+to_zpoly(const mpz_class* const poly, const size_t bits)
+{
+  ntru_rns::zpoly_t r(N, bits / 31 + 1);
+
+  for (size_t i = 0; i < N; i++) {
+    size_t cnt = 0;
+    mpz_export(r[i], &cnt, -1, sizeof(uint32_t), 0, 1, poly[i].get_mpz_t());
+
+    if (sgn(poly[i]) < 0) {
+      ntru_rns::negate(r[i], r.len);
+    }
+  }
+
+  return r;
+}
+
+// Converts polynomial with coefficients of 31 -bit words ( see
+// `ntru_rns::zpoly_t` ) to one with big integer coefficients
+template<const size_t N>
+static inline void
+from_zpoly(const ntru_rns::zpoly_t& poly, mpz_class* const res)
+{
+  std::vector<uint32_t> w(poly.len);
+
+  for (size_t i = 0; i < N; i++) {
+    std::copy_n(poly[i], poly.len, w.begin());
+
+    const bool neg = (w[poly.len - 1] >> 30) != 0;
+    if (neg) {
+      ntru_rns::negate(w.data(), w.size());
+    }
+
+    mpz_import(
+      res[i].get_mpz_t(), w.size(), -1, sizeof(uint32_t), 0, 1, w.data());
+    if (neg) {
+      mpz_neg(res[i].get_mpz_t(), res[i].get_mpz_t());
+    }
+  }
+}
+
+// Computes a * b mod (x^N + 1), in RNS, using NTT ( see `ntru_rns::mul` ).
+// Returns false, if product can't be represented using available primes.
+template<const size_t N>
+static inline bool
+ntt(const mpz_class* const __restrict a,
+    const size_t abits,
+    const mpz_class* const __restrict b,
+    const size_t bbits,
+    mpz_class* const __restrict res)
+{
+  const auto a_ = to_zpoly<N>(a, abits);
+  const auto b_ = to_zpoly<N>(b, bbits);
+
+  ntru_rns::zpoly_t c;
+  if (!ntru_rns::mul<log2<N>()>(a_, b_, c)) {
+    return false;
+  }
+
+  from_zpoly<N>(c, res);
+  return true;
+}
+
+// # -of big integers, which are required as scratch space by `mul`
+template<const size_t N>
+static inline constexpr size_t
+scratch_len()
+{
+  return karatsuba::karamul_scratch_len<N>();
+}
+
+// Computes a * b mod (x^N + 1), for polynomials of degree N - 1, with big
+// integer coefficients, picking multiplication strategy ( see `select` ) based
+// on degree and bit length of coefficients, using thresholds `t`, while
+// accounting time spent in it, in statistics of calling thread ( see `stats`
+// ). If primes aren't sufficient for multiplying using NTT, it falls back to
+// Karatsuba.
+//
+// Result is written to `res`, while `scratch` must have room for
+// `scratch_len<N>()` -many big integers.
+template<const size_t N>
+static inline void
+mul(const mpz_class* const __restrict a,
+    const mpz_class* const __restrict b,
+    mpz_class* const __restrict res,
+    mpz_class* const __restrict scratch,
+    const thresholds_t& t = thresholds())
+  requires((N >= 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  using sclock = std::chrono::steady_clock;
+
+  const auto t0 = sclock::now();
+
+  const size_t abits = max_bits<N>(a);
+  const size_t bbits = max_bits<N>(b);
+  auto s = select<N>(abits, bbits, t);
+
+  switch (s) {
+    case strategy_t::schoolbook:
+      schoolbook<N>(a, b, res);
+      break;
+    case strategy_t::ntt:
+      if (ntt<N>(a, abits, b, bbits, res)) {
+        break;
+      }
+      s = strategy_t::karatsuba;
+      [[fallthrough]];
+    case strategy_t::karatsuba:
+      karatsuba::karamul<N>(a, b, res, scratch);
+      break;
+  }
+
+  const auto t1 = sclock::now();
+  const auto ns = std::chrono::nanoseconds(t1 - t0).count();
+
+  auto& l = stats()[log2<N>()];
+  l.calls[static_cast<size_t>(s)]++;
+  l.ns[static_cast<size_t>(s)] += static_cast<uint64_t>(ns);
+}
+
+}
@@ -0,0 +1,1141 @@
+#pragma once
+#include "common.hpp"
+#include "ff.hpp"
+#include "fft.hpp"
+#include "polynomial.hpp"
+#include "work_stealing.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GMP-free NTRUSolve, where big integers are fixed-size multi-word integers, of
+// 31 -bit words, while polynomial products and field norms are computed in
+// residue number system ( RNS ) i.e. modulo several 31 -bit NTT-friendly
+// primes, using NTT, and converted back to big integers, using Chinese
+// Remainder Theorem ( CRT ), only when required. It follows the approach taken
+// by reference implementation ( see section 3.2 of
+// https://falcon-sign.info/falcon-impl-20211101.pdf ), though in simpler form.
+namespace ntru_rns {
+
+// 31 -bit prime p s.t. p = 1 mod 2048 and 2^30 < p < 2^31, along with
+// constants required for Montgomery multiplication modulo p ( with R = 2^32 )
+struct prime_t
+{
+  uint32_t p = 0;   // prime modulus
+  uint32_t p0i = 0; // -1/p mod 2^32
+  uint32_t R2 = 0;  // 2^64 mod p
+  uint32_t psi = 0; // primitive 2048 -th root of unity mod p
+};
+
+// # -of primes, which are available for RNS representation, allowing big
+// integers of ~ 30K -bits
+constexpr size_t MAX_PRIMES = 1024;
+
+// 31 -bit word mask
+constexpr uint32_t MASK31 = 0x7fffffffu;
+
+// Modular addition of a, b ∈ [0, p)
+static inline constexpr uint32_t
+mod_add(const uint32_t a, const uint32_t b, const uint32_t p)
+{
+  const uint32_t d = a + b - p;
+  return d + (p & -(d >> 31));
+}
+
+// Modular subtraction of a, b ∈ [0, p)
+static inline constexpr uint32_t
+mod_sub(const uint32_t a, const uint32_t b, const uint32_t p)
+{
+  const uint32_t d = a - b;
+  return d + (p & -(d >> 31));
+}
+
+// Montgomery multiplication of a, b ∈ [0, p), computing a * b / 2^32 mod p
+static inline constexpr uint32_t
+mont_mul(const uint32_t a,
+         const uint32_t b,
+         const uint32_t p,
+         const uint32_t p0i)
+{
+  const uint64_t z = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
+  const uint32_t w = static_cast<uint32_t>(z) * p0i;
+  const uint64_t t = z + static_cast<uint64_t>(w) * static_cast<uint64_t>(p);
+  const uint32_t d = static_cast<uint32_t>(t >> 32) - p;
+
+  return d + (p & -(d >> 31));
+}
+
+// Modular exponentiation b^e mod p
+static inline constexpr uint32_t
+pow_mod(const uint32_t b, uint64_t e, const uint32_t p)
+{
+  uint64_t r = 1;
+  uint64_t x = b % p;
+
+  while (e > 0) {
+    if (e & 1) {
+      r = (r * x) % p;
+    }
+    x = (x * x) % p;
+    e >>= 1;
+  }
+
+  return static_cast<uint32_t>(r);
+}
+
+// Deterministic Miller-Rabin primality test, for 32 -bit odd n > 61
+static inline constexpr bool
+is_prime(const uint32_t n)
+{
+  uint32_t d = n - 1;
+  size_t s = 0;
+  while ((d & 1) == 0) {
+    d >>= 1;
+    s++;
+  }
+
+  for (const uint32_t a : { 2u, 7u, 61u }) {
+    uint64_t x = pow_mod(a, d, n);
+    if ((x == 1) || (x == n - 1)) {
+      continue;
+    }
+
+    bool composite = true;
+    for (size_t i = 1; i < s; i++) {
+      x = (x * x) % n;
+      if (x == n - 1) {
+        composite = false;
+        break;
+      }
+    }
+
+    if (composite) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Returns table of `MAX_PRIMES` -many primes ( see `prime_t` ), in decreasing
+// order, starting from largest one below 2^31. Table is computed on first use.
+//
+// Note, this routine isn't marked `static`, so that all translation units share
+// same table.
+inline const std::vector<prime_t>&
+primes()
+{
+  static const std::vector<prime_t> table = []() {
+    std::vector<prime_t> t;
+    t.reserve(MAX_PRIMES);
+
+    for (uint32_t p = (1u << 31) - 2047u; t.size() < MAX_PRIMES; p -= 2048u) {
+      if (!is_prime(p)) {
+        continue;
+      }
+
+      prime_t P;
+      P.p = p;
+
+      // p^-1 mod 2^32, using Newton iteration
+      uint32_t y = p;
+      for (size_t i = 0; i < 5; i++) {
+        y *= 2u - p * y;
+      }
+      P.p0i = -y;
+
+      const uint64_t r = (1ul << 32) % p;
+      P.R2 = static_cast<uint32_t>((r * r) % p);
+
+      for (uint32_t g = 2;; g++) {
+        const uint32_t c = pow_mod(g, (p - 1) / 2048, p);
+        if (pow_mod(c, 1024, p) == p - 1) {
+          P.psi = c;
+          break;
+        }
+      }
+
+      t.push_back(P);
+    }
+
+    return t;
+  }();
+
+  return table;
+}
+
+// # -of primes, which are required for representing big integers x s.t. |x| <=
+// 2^bits, in RNS, s.t. product of primes is > 2^(bits + 1)
+static inline constexpr size_t
+primes_for(const size_t bits)
+{
+  return bits / 30 + 1;
+}
+
+// Reverses `bits` -many least significant bits of v
+static inline constexpr size_t
+bit_rev(const size_t v, const size_t bits)
+{
+  size_t r = 0;
+  for (size_t i = 0; i < bits; i++) {
+    r |= ((v >> i) & 1ul) << (bits - 1 - i);
+  }
+  return r;
+}
+
+// Twiddle factors of negacyclic NTT of size n = 2^logn, modulo some prime ( see
+// `prime_t` ), both kept in Montgomery form, along with n^-1 mod p
+struct ntt_tables_t
+{
+  std::vector<uint32_t> gm;
+  std::vector<uint32_t> igm;
+  uint32_t ni = 0;
+
+  // Computes gm[k] = ψ^bitrev(k) and igm[k] = ψ^-bitrev(k), for k ∈ [0, n),
+  // s.t. ψ is a primitive 2n -th root of unity mod p.
+  inline ntt_tables_t(const prime_t& P, const size_t logn)
+  {
+    const size_t n = 1ul << logn;
+    const uint64_t p = P.p;
+    const uint64_t psi = pow_mod(P.psi, 1024 / n, P.p);
+
+    std::vector<uint32_t> pw(2 * n);
+    pw[0] = 1;
+    for (size_t i = 1; i < 2 * n; i++) {
+      pw[i] = static_cast<uint32_t>((pw[i - 1] * psi) % p);
+    }
+
+    const auto to_mont = [&](const uint32_t x) {
+      return static_cast<uint32_t>((static_cast<uint64_t>(x) << 32) % p);
+    };
+
+    gm.resize(n);
+    igm.resize(n);
+    for (size_t k = 0; k < n; k++) {
+      const size_t r = bit_rev(k, logn);
+      gm[k] = to_mont(pw[r]);
+      igm[k] = to_mont(pw[(2 * n - r) % (2 * n)]);
+    }
+
+    ni = to_mont(pow_mod(static_cast<uint32_t>(n), P.p - 2, P.p));
+  }
+};
+
+// Returns twiddle factors of negacyclic NTT of size n = 2^logn | logn <= 10,
+// modulo j-th prime ( see `primes` ), which are computed on first use and kept
+// for rest of program's lifetime, as each NTRUSolve uses same ( prime, size )
+// pairs.
+//
+// Note, this routine isn't marked `static`, so that all translation units share
+// same tables.
+inline const ntt_tables_t&
+ntt_tables(const size_t j, const size_t logn)
+{
+  constexpr size_t LOGN_CNT = 11;
+
+  struct cache_t
+  {
+    std::array<std::atomic<const ntt_tables_t*>, MAX_PRIMES * LOGN_CNT> slots{};
+
+    inline ~cache_t()
+    {
+      for (auto& slot : slots) {
+        delete slot.load();
+      }
+    }
+  };
+
+  static cache_t cache;
+
+  auto& slot = cache.slots[j * LOGN_CNT + logn];
+  const ntt_tables_t* tab = slot.load(std::memory_order_acquire);
+
+  if (tab == nullptr) [[unlikely]] {
+    // racing threads may compute same table, only one of them is kept
+    const ntt_tables_t* const fresh = new ntt_tables_t(primes()[j], logn);
+
+    if (slot.compare_exchange_strong(tab, fresh, std::memory_order_acq_rel)) {
+      tab = fresh;
+    } else {
+      delete fresh;
+    }
+  }
+
+  return *tab;
+}
+
+// Forward negacyclic NTT of size n = 2^logn, over coefficients ∈ [0, p),
+// producing evaluations in bit-reversed order, following Cooley-Tukey butterfly
+template<const size_t logn>
+static inline void
+ntt(uint32_t* const a, const ntt_tables_t& tab, const prime_t& P)
+{
+  constexpr size_t n = 1ul << logn;
+
+  size_t t = n;
+  for (size_t m = 1; m < n; m <<= 1) {
+    const size_t ht = t >> 1;
+
+    for (size_t i = 0, j1 = 0; i < m; i++, j1 += t) {
+      const uint32_t s = tab.gm[m + i];
+
+      for (size_t j = j1; j < j1 + ht; j++) {
+        const uint32_t u = a[j];
+        const uint32_t v = mont_mul(a[j + ht], s, P.p, P.p0i);
+
+        a[j] = mod_add(u, v, P.p);
+        a[j + ht] = mod_sub(u, v, P.p);
+      }
+    }
+
+    t = ht;
+  }
+}
+
+// Inverse of `ntt`, following Gentleman-Sande butterfly
+template<const size_t logn>
+static inline void
+intt(uint32_t* const a, const ntt_tables_t& tab, const prime_t& P)
+{
+  constexpr size_t n = 1ul << logn;
+
+  size_t t = 1;
+  for (size_t m = n; m > 1; m >>= 1) {
+    const size_t hm = m >> 1;
+    const size_t dt = t << 1;
+
+    for (size_t i = 0, j1 = 0; i < hm; i++, j1 += dt) {
+      const uint32_t s = tab.igm[hm + i];
+
+      for (size_t j = j1; j < j1 + t; j++) {
+        const uint32_t u = a[j];
+        const uint32_t v = a[j + t];
+
+        a[j] = mod_add(u, v, P.p);
+        a[j + t] = mont_mul(mod_sub(u, v, P.p), s, P.p, P.p0i);
+      }
+    }
+
+    t = dt;
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    a[i] = mont_mul(a[i], tab.ni, P.p, P.p0i);
+  }
+}
+
+// Sign extends top 31 -bit word of a big integer to 32 -bits
+static inline constexpr int32_t
+sign_extend(const uint32_t w)
+{
+  return static_cast<int32_t>(w << 1) >> 1;
+}
+
+// Given a big integer x of `len` -many 31 -bit words ( little-endian, two's
+// complement ), returns smallest `bits` s.t. |x| <= 2^bits
+static inline size_t
+bit_len(const uint32_t* const x, const size_t len)
+{
+  const uint32_t neg = -(x[len - 1] >> 30) & MASK31;
+
+  for (size_t i = len; i > 0; i--) {
+    const uint32_t w = x[i - 1] ^ neg;
+    if (w != 0) {
+      return (i - 1) * 31 + static_cast<size_t>(std::bit_width(w));
+    }
+  }
+
+  return 0;
+}
+
+// Computes x mod p, for big integer x of `len` -many 31 -bit words
+static inline uint32_t
+mod_small(const uint32_t* const x, const size_t len, const uint32_t p)
+{
+  const int32_t top = sign_extend(x[len - 1]);
+  uint64_t r = static_cast<uint64_t>(top < 0 ? top + static_cast<int64_t>(p)
+                                             : static_cast<int64_t>(top));
+
+  for (size_t i = len - 1; i > 0; i--) {
+    r = ((r << 31) | x[i - 1]) % p;
+  }
+
+  return static_cast<uint32_t>(r);
+}
+
+// Approximates x / 2^sh, as a double precision floating point number, for big
+// integer x of `len` -many 31 -bit words, using only its top three significant
+// words i.e. words which are not just sign extension, are skipped.
+static inline double
+to_double(const uint32_t* const x, const size_t xlen, const size_t sh)
+{
+  size_t len = xlen;
+  while (len > 1) {
+    const uint32_t sign = -(x[len - 2] >> 30) & MASK31;
+    if (x[len - 1] != sign) {
+      break;
+    }
+    len--;
+  }
+
+  const size_t lo = len > 3 ? len - 3 : 0;
+
+  double r = static_cast<double>(sign_extend(x[len - 1]));
+  for (size_t i = len - 1; i > lo; i--) {
+    r = r * 2147483648. + static_cast<double>(x[i - 1]);
+  }
+
+  const auto e = static_cast<int>(31 * lo) - static_cast<int>(sh);
+  return std::ldexp(r, e);
+}
+
+// Negates big integer x of `len` -many 31 -bit words, in-place
+static inline void
+negate(uint32_t* const x, const size_t len)
+{
+  uint32_t cc = 1;
+  for (size_t i = 0; i < len; i++) {
+    const uint32_t w = (~x[i] & MASK31) + cc;
+    x[i] = w & MASK31;
+    cc = w >> 31;
+  }
+}
+
+// Computes x -= y * 2^sh, for big integers x, y of `xlen`, `ylen` -many 31 -bit
+// words respectively, s.t. result is truncated to `xlen` -many words.
+static inline void
+sub_shifted(uint32_t* const x,
+            const size_t xlen,
+            const uint32_t* const y,
+            const size_t ylen,
+            const size_t sh)
+{
+  const size_t sw = sh / 31;
+  const size_t sb = sh % 31;
+  const uint32_t ysign = -(y[ylen - 1] >> 30) & MASK31;
+
+  // i-th 31 -bit word of y, while sign extending it
+  const auto yw = [&](const size_t i) {
+    return i < ylen ? y[i] : ysign;
+  };
+
+  uint32_t cc = 0;
+  for (size_t j = sw; j < xlen; j++) {
+    const size_t i = j - sw;
+
+    uint32_t w = (yw(i) << sb) & MASK31;
+    if ((sb > 0) && (i > 0)) {
+      w |= yw(i - 1) >> (31 - sb);
+    }
+
+    const uint32_t d = x[j] - w - cc;
+    x[j] = d & MASK31;
+    cc = d >> 31;
+  }
+}
+
+// Polynomial of degree n - 1, with big integer coefficients, each of `len`
+// -many 31 -bit words, kept one after another
+struct zpoly_t
+{
+  size_t n = 0;
+  size_t len = 0;
+  std::vector<uint32_t> w;
+
+  inline zpoly_t() = default;
+  inline zpoly_t(const size_t n_, const size_t len_)
+    : n(n_)
+    , len(len_)
+    , w(n_ * len_)
+  {
+  }
+
+  inline uint32_t* operator[](const size_t i) { return w.data() + i * len; }
+  inline const uint32_t* operator[](const size_t i) const
+  {
+    return w.data() + i * len;
+  }
+
+  // Smallest `bits` s.t. each coefficient |x| <= 2^bits
+  inline size_t bits() const
+  {
+    size_t b = 0;
+    for (size_t i = 0; i < n; i++) {
+      b = std::max(b, bit_len((*this)[i], len));
+    }
+    return b;
+  }
+
+  // Returns same polynomial, while each coefficient is kept using `nlen`
+  // -many words, which must be enough for holding each of them.
+  inline zpoly_t resize(const size_t nlen) const
+  {
+    zpoly_t r(n, nlen);
+
+    for (size_t i = 0; i < n; i++) {
+      const uint32_t* const src = (*this)[i];
+      const uint32_t sign = -(src[len - 1] >> 30) & MASK31;
+
+      for (size_t j = 0; j < nlen; j++) {
+        r[i][j] = j < len ? src[j] : sign;
+      }
+    }
+
+    return r;
+  }
+
+  // Returns same polynomial, using least # -of words per coefficient
+  inline zpoly_t trim() const { return resize(bits() / 31 + 1); }
+};
+
+// Scratch space of `mul`, `field_norm` and `from_rns`, owned by calling thread.
+// Buffers only ever grow, so that once they are large enough, no memory is
+// allocated for temporaries, by those routines.
+struct scratch_t
+{
+  std::vector<uint32_t> res;
+  std::vector<uint32_t> tmp;
+  std::vector<uint32_t> fe;
+  std::vector<uint32_t> fo;
+  std::vector<uint32_t> prod;
+  std::vector<uint32_t> y;
+};
+
+inline scratch_t&
+scratch()
+{
+  thread_local scratch_t s;
+  return s;
+}
+
+// Converts each coefficient of polynomial to its residue modulo p
+static inline void
+to_rns(const zpoly_t& a, const uint32_t p, uint32_t* const res)
+{
+  for (size_t i = 0; i < a.n; i++) {
+    res[i] = mod_small(a[i], a.len, p);
+  }
+}
+
+// Given residues of each of n coefficients modulo first k primes ( see
+// `primes` ), s.t. residues modulo j-th prime are kept at res[j * n ..], this
+// routine reconstructs big integer coefficients, using Garner's algorithm, s.t.
+// each of them ∈ (-P/2, P/2], where P is product of k primes, writing them to
+// r, whose storage is reused.
+static inline void
+from_rns(const uint32_t* const res, const size_t k, const size_t n, zpoly_t& r)
+{
+  const auto& P = primes();
+
+  r.n = n;
+  r.len = k;
+  r.w.assign(n * k, 0u);
+
+  auto& prod = scratch().prod;
+  prod.assign(k + 1, 0u);
+  size_t plen = 1;
+
+  for (size_t i = 0; i < n; i++) {
+    r[i][0] = res[i];
+  }
+  prod[0] = P[0].p;
+
+  for (size_t j = 1; j < k; j++) {
+    const uint32_t p = P[j].p;
+
+    // s = (p_0 * p_1 * ... * p_{j-1})^-1 mod p_j
+    const uint32_t s = pow_mod(mod_small(prod.data(), plen + 1, p), p - 2, p);
+
+    for (size_t i = 0; i < n; i++) {
+      uint32_t* const x = r[i];
+
+      // x < p_0 * p_1 * ... * p_{j-1}, so it's non-negative, when considered
+      // as a big integer of j + 1 words
+      const uint32_t xm = mod_small(x, j + 1, p);
+      const uint64_t d = mod_sub(res[j * n + i], xm, p);
+      const uint64_t v = (d * s) % p;
+
+      uint64_t cc = 0;
+      for (size_t t = 0; t < plen; t++) {
+        const uint64_t z = x[t] + v * prod[t] + cc;
+        x[t] = static_cast<uint32_t>(z) & MASK31;
+        cc = z >> 31;
+      }
+      for (size_t t = plen; (t < k) && (cc > 0); t++) {
+        const uint64_t z = x[t] + cc;
+        x[t] = static_cast<uint32_t>(z) & MASK31;
+        cc = z >> 31;
+      }
+    }
+
+    // prod *= p_j
+    uint64_t cc = 0;
+    for (size_t t = 0; t < plen; t++) {
+      const uint64_t z = static_cast<uint64_t>(prod[t]) * p + cc;
+      prod[t] = static_cast<uint32_t>(z) & MASK31;
+      cc = z >> 31;
+    }
+    if (cc > 0) {
+      prod[plen++] = static_cast<uint32_t>(cc);
+    }
+  }
+
+  // map x ∈ [0, P) to (-P/2, P/2]
+  auto& y = scratch().y;
+  y.resize(k);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t* const x = r[i];
+
+    uint32_t cc = 0;
+    for (size_t t = 0; t < k; t++) {
+      const uint32_t d = (t < plen ? prod[t] : 0u) - x[t] - cc;
+      y[t] = d & MASK31;
+      cc = d >> 31;
+    }
+
+    bool y_lt_x = false;
+    for (size_t t = k; t > 0; t--) {
+      if (y[t - 1] != x[t - 1]) {
+        y_lt_x = y[t - 1] < x[t - 1];
+        break;
+      }
+    }
+
+    if (y_lt_x) {
+      std::copy_n(y.begin(), k, x);
+      negate(x, k);
+    }
+  }
+}
+
+// Given two polynomials a, b ∈ Z[x]/(x^n + 1), with big integer coefficients,
+// this routine computes a * b, in RNS, using NTT. Returns false, if product
+// can't be represented using available primes.
+template<const size_t logn>
+static inline bool
+mul(const zpoly_t& a, const zpoly_t& b, zpoly_t& c)
+{
+  constexpr size_t n = 1ul << logn;
+
+  const size_t k = primes_for(a.bits() + b.bits() + logn + 1);
+  if (k > MAX_PRIMES) [[unlikely]] {
+    return false;
+  }
+
+  const auto& P = primes();
+  auto& res = scratch().res;
+  auto& tmp = scratch().tmp;
+
+  res.resize(k * n);
+  tmp.resize(n);
+
+  for (size_t j = 0; j < k; j++) {
+    const ntt_tables_t& tab = ntt_tables(j, logn);
+    uint32_t* const ra = res.data() + j * n;
+
+    to_rns(a, P[j].p, ra);
+    to_rns(b, P[j].p, tmp.data());
+
+    ntt<logn>(ra, tab, P[j]);
+    ntt<logn>(tmp.data(), tab, P[j]);
+
+    for (size_t i = 0; i < n; i++) {
+      const uint32_t t = mont_mul(ra[i], tmp[i], P[j].p, P[j].p0i);
+      ra[i] = mont_mul(t, P[j].R2, P[j].p, P[j].p0i);
+    }
+
+    intt<logn>(ra, tab, P[j]);
+  }
+
+  from_rns(res.data(), k, n, c);
+  return true;
+}
+
+// Computes field norm of f ∈ Z[x]/(x^n + 1), projecting it to Z[x]/(x^(n/2) +
+// 1) i.e. N(f) = fe^2 - x * fo^2, s.t. f(x) = fe(x^2) + x * fo(x^2), see
+// section 3.6.1 of Falcon specification https://falcon-sign.info/falcon.pdf
+//
+// Squares are computed in RNS, using NTT, while result is converted back to
+// big integers, only once. Returns false, if norm can't be represented using
+// available primes.
+template<const size_t logn>
+static inline bool
+field_norm(const zpoly_t& f, zpoly_t& r)
+  requires(logn > 0)
+{
+  constexpr size_t n = 1ul << logn;
+  constexpr size_t h = n >> 1;
+
+  const size_t k = primes_for(2 * f.bits() + logn + 1);
+  if (k > MAX_PRIMES) [[unlikely]] {
+    return false;
+  }
+
+  const auto& P = primes();
+  auto& res = scratch().res;
+  auto& fe = scratch().fe;
+  auto& fo = scratch().fo;
+
+  res.resize(k * h);
+  fe.resize(h);
+  fo.resize(h);
+
+  for (size_t j = 0; j < k; j++) {
+    const uint32_t p = P[j].p;
+    const ntt_tables_t& tab = ntt_tables(j, logn - 1);
+
+    for (size_t i = 0; i < h; i++) {
+      fe[i] = mod_small(f[2 * i], f.len, p);
+      fo[i] = mod_small(f[2 * i + 1], f.len, p);
+    }
+
+    ntt<logn - 1>(fe.data(), tab, P[j]);
+    ntt<logn - 1>(fo.data(), tab, P[j]);
+
+    for (size_t i = 0; i < h; i++) {
+      const uint32_t e = mont_mul(fe[i], fe[i], p, P[j].p0i);
+      const uint32_t o = mont_mul(fo[i], fo[i], p, P[j].p0i);
+
+      fe[i] = mont_mul(e, P[j].R2, p, P[j].p0i);
+      fo[i] = mont_mul(o, P[j].R2, p, P[j].p0i);
+    }
+
+    intt<logn - 1>(fe.data(), tab, P[j]);
+    intt<logn - 1>(fo.data(), tab, P[j]);
+
+    // fe^2 - x * fo^2 mod (x^h + 1)
+    uint32_t* const rj = res.data() + j * h;
+    rj[0] = mod_add(fe[0], fo[h - 1], p);
+    for (size_t i = 1; i < h; i++) {
+      rj[i] = mod_sub(fe[i], fo[i - 1], p);
+    }
+  }
+
+  from_rns(res.data(), k, h, r);
+  return true;
+}
+
+// Lifts F ∈ Z[x]/(x^(n/2) + 1) to Z[x]/(x^n + 1) i.e. computes F(x^2)
+static inline zpoly_t
+lift(const zpoly_t& F)
+{
+  zpoly_t r(2 * F.n, F.len);
+
+  for (size_t i = 0; i < F.n; i++) {
+    std::copy_n(F[i], F.len, r[2 * i]);
+  }
+
+  return r;
+}
+
+// Computes Galois conjugate f(-x) of f ∈ Z[x]/(x^n + 1)
+static inline zpoly_t
+galois_conjugate(const zpoly_t& f)
+{
+  zpoly_t r = f;
+
+  for (size_t i = 1; i < f.n; i += 2) {
+    negate(r[i], r.len);
+  }
+
+  return r;
+}
+
+// Extended binary GCD over big integers, computing a, b s.t. a * f + b * g =
+// 1, given f, g ∈ Z, each of `len` -many 31 -bit words. Returns false, if
+// gcd(f, g) != 1. Follows algorithm 14.61 of Handbook of Applied Cryptography.
+static inline bool
+xgcd(const uint32_t* const f,
+     const uint32_t* const g,
+     const size_t len,
+     std::vector<uint32_t>& a,
+     std::vector<uint32_t>& b)
+{
+  const size_t L = len + 2;
+
+  using zint_t = std::vector<uint32_t>;
+
+  const auto load = [&](const uint32_t* const v) {
+    zint_t r(L);
+    std::copy_n(v, len, r.begin());
+
+    const uint32_t sign = -(v[len - 1] >> 30) & MASK31;
+    std::fill(r.begin() + static_cast<std::ptrdiff_t>(len), r.end(), sign);
+
+    if (sign != 0) {
+      negate(r.data(), L);
+    }
+    return r;
+  };
+
+  const auto is_zero = [&](const zint_t& v) {
+    return std::all_of(v.begin(), v.end(), [](auto w) { return w == 0; });
+  };
+  const auto is_even = [](const zint_t& v) { return (v[0] & 1) == 0; };
+
+  const auto add = [&](zint_t& x, const zint_t& y) {
+    uint32_t cc = 0;
+    for (size_t i = 0; i < L; i++) {
+      const uint32_t w = x[i] + y[i] + cc;
+      x[i] = w & MASK31;
+      cc = w >> 31;
+    }
+  };
+  const auto sub = [&](zint_t& x, const zint_t& y) {
+    uint32_t cc = 0;
+    for (size_t i = 0; i < L; i++) {
+      const uint32_t w = x[i] - y[i] - cc;
+      x[i] = w & MASK31;
+      cc = w >> 31;
+    }
+  };
+  const auto half = [&](zint_t& x) {
+    for (size_t i = 0; i + 1 < L; i++) {
+      x[i] = (x[i] >> 1) | ((x[i + 1] & 1) << 30);
+    }
+    x[L - 1] = (x[L - 1] >> 1) | (x[L - 1] & (1u << 30));
+  };
+  // x >= y, for non-negative x, y
+  const auto geq = [&](const zint_t& x, const zint_t& y) {
+    for (size_t i = L; i > 0; i--) {
+      if (x[i - 1] != y[i - 1]) {
+        return x[i - 1] > y[i - 1];
+      }
+    }
+    return true;
+  };
+
+  const zint_t x = load(f);
+  const zint_t y = load(g);
+
+  if (is_zero(x) || is_zero(y) || (is_even(x) && is_even(y))) {
+    return false;
+  }
+
+  zint_t u = x, v = y;
+  zint_t A(L), B(L), C(L), D(L);
+  A[0] = 1;
+  D[0] = 1;
+
+  while (!is_zero(u)) {
+    while (is_even(u)) {
+      half(u);
+      if (is_even(A) && is_even(B)) {
+        half(A);
+        half(B);
+      } else {
+        add(A, y);
+        half(A);
+        sub(B, x);
+        half(B);
+      }
+    }
+
+    while (is_even(v)) {
+      half(v);
+      if (is_even(C) && is_even(D)) {
+        half(C);
+        half(D);
+      } else {
+        add(C, y);
+        half(C);
+        sub(D, x);
+        half(D);
+      }
+    }
+
+    if (geq(u, v)) {
+      sub(u, v);
+      sub(A, C);
+      sub(B, D);
+    } else {
+      sub(v, u);
+      sub(C, A);
+      sub(D, B);
+    }
+  }
+
+  // v = gcd(|f|, |g|) = C * |f| + D * |g|
+  zint_t one(L);
+  one[0] = 1;
+  if (v != one) {
+    return false;
+  }
+
+  if ((f[len - 1] >> 30) != 0) {
+    negate(C.data(), L);
+  }
+  if ((g[len - 1] >> 30) != 0) {
+    negate(D.data(), L);
+  }
+
+  a = std::move(C);
+  b = std::move(D);
+  return true;
+}
+
+// Multiplies big integer x of `len` -many 31 -bit words by small m > 0, s.t.
+// product must fit in `len` -many words.
+static inline void
+mul_small(uint32_t* const x, const size_t len, const uint32_t m)
+{
+  const bool neg = (x[len - 1] >> 30) != 0;
+  if (neg) {
+    negate(x, len);
+  }
+
+  uint64_t cc = 0;
+  for (size_t i = 0; i < len; i++) {
+    const uint64_t z = static_cast<uint64_t>(x[i]) * m + cc;
+    x[i] = static_cast<uint32_t>(z) & MASK31;
+    cc = z >> 31;
+  }
+
+  if (neg) {
+    negate(x, len);
+  }
+}
+
+// Given four polynomials f, g, F, G ∈ Z[x]/(x^n + 1), this routine reduces F, G
+// w.r.t. f, g, using Babai's round-off ( see algorithm 7 of Falcon
+// specification ), while FFT of f, g and f * adj(f) + g * adj(g) are computed
+// only once. Each round computes k = round((F * adj(f) + G * adj(g)) / (f *
+// adj(f) + g * adj(g))), using top 53 -bits of each coefficient, and subtracts
+// (k * f, k * g), computed in RNS, suitably shifted, from (F, G). Returns
+// false, if reduction doesn't converge.
+template<const size_t logn>
+static inline bool
+reduce(const zpoly_t& f, const zpoly_t& g, zpoly_t& F, zpoly_t& G)
+{
+  constexpr size_t n = 1ul << logn;
+  constexpr size_t max_rounds = 1024;
+
+  const size_t blen0 = std::max<size_t>(53, std::max(f.bits(), g.bits()));
+
+  std::vector<fft::cmplx> buf(6 * n);
+  fft::cmplx* const f_adj = buf.data();
+  fft::cmplx* const g_adj = f_adj + n;
+  fft::cmplx* const fg_den = g_adj + n;
+  fft::cmplx* const F_fft = fg_den + n;
+  fft::cmplx* const G_fft = F_fft + n;
+  fft::cmplx* const k = G_fft + n;
+
+  for (size_t i = 0; i < n; i++) {
+    f_adj[i] = fft::cmplx{ to_double(f[i], f.len, blen0) };
+    g_adj[i] = fft::cmplx{ to_double(g[i], g.len, blen0) };
+  }
+
+  fft::fft<logn>(f_adj);
+  fft::fft<logn>(g_adj);
+
+  // f * adj(f) + g * adj(g) is real valued, in FFT form
+  for (size_t i = 0; i < n; i++) {
+    fg_den[i] = fft::cmplx{ std::norm(f_adj[i]) + std::norm(g_adj[i]) };
+  }
+
+  fft::adj_poly<logn>(f_adj);
+  fft::adj_poly<logn>(g_adj);
+
+  zpoly_t kp(n, 3);
+  zpoly_t kf;
+  zpoly_t kg;
+
+  for (size_t round = 0; round < max_rounds; round++) {
+    const size_t blen1 = std::max<size_t>(53, std::max(F.bits(), G.bits()));
+    if (blen1 < blen0) {
+      return true;
+    }
+
+    // ensure that subtraction can't overflow
+    if (blen1 + 2 >= 31 * F.len) {
+      F = F.resize(F.len + 1);
+    }
+    if (blen1 + 2 >= 31 * G.len) {
+      G = G.resize(G.len + 1);
+    }
+
+    // k is computed scaled down by 2^sh, s.t. it has ~ 50 -bits of precision
+    size_t sh = blen1 > blen0 + 50 ? blen1 - blen0 - 50 : 0;
+
+    for (size_t i = 0; i < n; i++) {
+      F_fft[i] = fft::cmplx{ to_double(F[i], F.len, blen0 + sh) };
+      G_fft[i] = fft::cmplx{ to_double(G[i], G.len, blen0 + sh) };
+    }
+
+    fft::fft<logn>(F_fft);
+    fft::fft<logn>(G_fft);
+
+    for (size_t i = 0; i < n; i++) {
+      k[i] = (F_fft[i] * f_adj[i] + G_fft[i] * g_adj[i]) / fg_den[i];
+    }
+
+    fft::ifft<logn>(k);
+
+    // when f, g are ill-conditioned, k may not fit in 62 -bits, in which case
+    // it's scaled down further, trading off progress made in this round
+    double kmax = 0.;
+    for (size_t i = 0; i < n; i++) {
+      kmax = std::max(kmax, std::abs(k[i].real()));
+    }
+    if (!std::isfinite(kmax)) [[unlikely]] {
+      return false;
+    }
+    if (kmax >= 0x1p61) {
+      const auto extra = static_cast<size_t>(std::ilogb(kmax)) - 60;
+      for (size_t i = 0; i < n; i++) {
+        k[i] = fft::cmplx{ std::ldexp(k[i].real(), -static_cast<int>(extra)) };
+      }
+      sh += extra;
+    }
+
+    bool nonzero = false;
+    for (size_t i = 0; i < n; i++) {
+      const auto v = static_cast<int64_t>(std::round(k[i].real()));
+      nonzero |= v != 0;
+
+      kp[i][0] = static_cast<uint32_t>(v) & MASK31;
+      kp[i][1] = static_cast<uint32_t>(v >> 31) & MASK31;
+      kp[i][2] = static_cast<uint32_t>(v >> 62) & MASK31;
+    }
+
+    if (!nonzero) {
+      return true;
+    }
+
+    if (!mul<logn>(f, kp, kf) || !mul<logn>(g, kp, kg)) [[unlikely]] {
+      return false;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      sub_shifted(F[i], F.len, kf[i], kf.len, sh);
+      sub_shifted(G[i], G.len, kg[i], kg.len, sh);
+    }
+  }
+
+  return false;
+}
+
+// Given f, g ∈ Z[x]/(x^n + 1), this routine recursively solves NTRU equation,
+// computing F, G s.t. fG - gF = q mod (x^n + 1), following algorithm 6 of
+// Falcon specification https://falcon-sign.info/falcon.pdf. Returns false, if
+// there's no solution or it's cancelled.
+template<const size_t logn>
+static inline bool
+solve(const zpoly_t& f,
+      const zpoly_t& g,
+      zpoly_t& F,
+      zpoly_t& G,
+      const work_stealing::cancel_t cancelled)
+{
+  if (cancelled()) {
+    return false;
+  }
+
+  if constexpr (logn == 0) {
+    constexpr uint32_t q = ff::Q;
+
+    const size_t len = std::max(f.len, g.len);
+    const zpoly_t f_ = f.resize(len);
+    const zpoly_t g_ = g.resize(len);
+
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+
+    if (!xgcd(f_[0], g_[0], len, a, b)) {
+      return false;
+    }
+
+    // F = -q * b, G = q * a
+    F = zpoly_t(1, a.size() + 1);
+    G = zpoly_t(1, a.size() + 1);
+
+    std::copy_n(b.begin(), b.size(), F[0]);
+    std::copy_n(a.begin(), a.size(), G[0]);
+    F[0][F.len - 1] = -(b.back() >> 30) & MASK31;
+    G[0][G.len - 1] = -(a.back() >> 30) & MASK31;
+
+    mul_small(F[0], F.len, q);
+    negate(F[0], F.len);
+    mul_small(G[0], G.len, q);
+
+    F = F.trim();
+    G = G.trim();
+    return true;
+  } else {
+    zpoly_t fn;
+    zpoly_t gn;
+
+    if (!field_norm<logn>(f, fn) || !field_norm<logn>(g, gn)) {
+      return false;
+    }
+
+    zpoly_t Fn;
+    zpoly_t Gn;
+
+    if (!solve<logn - 1>(fn, gn, Fn, Gn, cancelled) || cancelled()) {
+      return false;
+    }
+
+    if (!mul<logn>(lift(Fn), galois_conjugate(g), F) ||
+        !mul<logn>(lift(Gn), galois_conjugate(f), G)) {
+      return false;
+    }
+
+    if (!reduce<logn>(f, g, F, G)) {
+      return false;
+    }
+
+    F = F.trim();
+    G = G.trim();
+    return true;
+  }
+}
+
+// Given f, g ∈ Z[x]/(x^N + 1), with small coefficients, this routine attempts
+// to solve NTRU equation ( see eq 3.15 of Falcon specification ), computing F,
+// G ∈ Z[x]/(x^N + 1) s.t. fG - gF = q mod (x^N + 1), without using any
+// multi-precision integer library. Returns false, if there's no solution, if
+// coefficients of F, G don't fit in 32 -bit signed integers or if it's
+// cancelled ( see `work_stealing::cancel_t` ), while solving.
+template<const size_t N>
+static inline bool
+ntru_solve(const int32_t* const __restrict f,
+           const int32_t* const __restrict g,
+           int32_t* const __restrict F,
+           int32_t* const __restrict G,
+           const work_stealing::cancel_t cancelled = {})
+  requires((N > 1) && ((N & (N - 1)) == 0) && (N <= 1024))
+{
+  zpoly_t f_(N, 1);
+  zpoly_t g_(N, 1);
+
+  for (size_t i = 0; i < N; i++) {
+    f_[i][0] = static_cast<uint32_t>(f[i]) & MASK31;
+    g_[i][0] = static_cast<uint32_t>(g[i]) & MASK31;
+  }
+
+  zpoly_t F_;
+  zpoly_t G_;
+
+  if (!solve<log2<N>()>(f_, g_, F_, G_, cancelled)) {
+    return false;
+  }
+
+  if ((F_.len != 1) || (G_.len != 1)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    F[i] = sign_extend(F_[i][0]);
+    G[i] = sign_extend(G_[i][0]);
+  }
+
+  return true;
+}
+
+}
@@ -1,19 +1,48 @@
 #pragma once
 #include "shake256.hpp"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <random>
 
 // Pseudo Random Number Generator
 namespace prng {
 
-// Pseudo Random Number Generator s.t. N (>0) -many random bytes are read from
-// SHAKE256 XoF whose state is obtained by hashing 32 random bytes sampled from
-// uniform uint8_t random number generator distribution, using Mersenne Twister
-// engine, which itself is seeded with system random device ( read more @
+// Any source of uniform random bytes, which can be plugged into Falcon's
+// sampler, signer and key generation routines, must satisfy this concept i.e.
+// it must be able to fill N (>=0) -many bytes on request, by exposing
+//
+// void read(uint8_t* const bytes, const size_t len)
+template<typename T>
+concept rng = requires(T& r, uint8_t* const bytes, const size_t len) {
+  {
+    r.read(bytes, len)
+  } -> std::same_as<void>;
+};
+
+// Fills `len` -many seed bytes, sampled from uniform uint8_t random number
+// generator distribution, using Mersenne Twister engine, which itself is seeded
+// with system random device ( read more @
 // https://en.cppreference.com/w/cpp/numeric/random/random_device )
 //
 // Note, std::random_device's behaviour is implementation defined feature, so
-// this PRNG implementation doesn't guarantee that it'll generate cryptographic
-// secure random bytes in all possible cases.
+// this routine doesn't guarantee that it'll generate cryptographic secure
+// random bytes in all possible cases.
+static inline void
+sample_seed(uint8_t* const seed, const size_t len)
+{
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<uint8_t> dis{};
+
+  for (size_t i = 0; i < len; i++) {
+    seed[i] = dis(gen);
+  }
+}
+
+// Pseudo Random Number Generator s.t. N (>0) -many random bytes are read from
+// SHAKE256 XoF whose state is obtained by hashing 32 random bytes, sampled
+// using `sample_seed` routine, defined above.
 struct prng_t
 {
 private:
@@ -22,14 +51,8 @@ private:
 public:
   inline prng_t()
   {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<uint8_t> dis{};
-
     uint8_t seed[32];
-    for (size_t i = 0; i < sizeof(seed); i++) {
-      seed[i] = dis(gen);
-    }
+    sample_seed(seed, sizeof(seed));
 
     state.hash(seed, sizeof(seed));
   }
@@ -40,4 +63,6 @@ public:
   }
 };
 
+static_assert(rng<prng_t>, "SHAKE256 based PRNG must satisfy RNG concept !");
+
 }
@@ -0,0 +1,173 @@
+#pragma once
+#include "prng.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined __AES__ && defined __SSE2__
+#include <immintrin.h>
+
+// Pseudo Random Number Generator
+namespace prng {
+
+// AES-256 in counter mode ( see NIST SP 800-38A ) based Pseudo Random Number
+// Generator, which keeps encrypting consecutive 128 -bit counter blocks, using
+// AES-NI instructions. 8 independent counter blocks are encrypted at a time,
+// so that latency of `aesenc` instruction is hidden, filling 128 -bytes
+// internal buffer.
+//
+// Counter block is interpreted as <64 -bit big-endian nonce> || <64 -bit
+// big-endian counter>, where only the low 64 -bits are incremented.
+//
+// Note, this PRNG is only available on x86_64 targets with AES-NI support,
+// because a portable table-based AES implementation doesn't run in constant
+// -time and randomness fed into Falcon's sampler must stay secret.
+struct aes_ctr_t
+{
+public:
+  static constexpr size_t KEY_LEN = 32;
+  static constexpr size_t IV_LEN = 16;
+  static constexpr size_t BLOCK_LEN = 16;
+  static constexpr size_t BLOCK_CNT = 8;
+  static constexpr size_t BUF_LEN = BLOCK_CNT * BLOCK_LEN;
+
+private:
+  __m128i round_keys[15];
+  uint64_t nonce = 0ul;
+  uint64_t ctr = 0ul;
+  alignas(16) uint8_t buf[BUF_LEN]{};
+  size_t buf_off = BUF_LEN;
+
+  // Computes one of the even indexed round keys of AES-256 key schedule
+  static inline __m128i expand_even(__m128i key, __m128i assist)
+  {
+    assist = _mm_shuffle_epi32(assist, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+  }
+
+  // Computes one of the odd indexed round keys of AES-256 key schedule
+  static inline __m128i expand_odd(__m128i key, __m128i assist)
+  {
+    assist = _mm_shuffle_epi32(assist, 0xaa);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+  }
+
+  // Computes round keys ( 2i, 2i + 1 ) of AES-256 key schedule, given round
+  // constant `rcon`, which must be a compile-time constant
+  template<const int rcon>
+  inline void expand_pair(const size_t i)
+  {
+    const __m128i t0 = _mm_aeskeygenassist_si128(round_keys[i - 1], rcon);
+    round_keys[i] = expand_even(round_keys[i - 2], t0);
+
+    if (i + 1 < 15) {
+      const __m128i t1 = _mm_aeskeygenassist_si128(round_keys[i], 0x00);
+      round_keys[i + 1] = expand_odd(round_keys[i - 1], t1);
+    }
+  }
+
+  // Encrypts next 8 counter blocks, filling internal buffer, and moves
+  // counter forward.
+  inline void refill()
+  {
+    __m128i blocks[BLOCK_CNT];
+
+    for (size_t i = 0; i < BLOCK_CNT; i++) {
+      const auto hi = static_cast<long long>(__builtin_bswap64(ctr + i));
+      const auto lo = static_cast<long long>(__builtin_bswap64(nonce));
+
+      blocks[i] = _mm_xor_si128(_mm_set_epi64x(hi, lo), round_keys[0]);
+    }
+
+    for (size_t r = 1; r < 14; r++) {
+      for (size_t i = 0; i < BLOCK_CNT; i++) {
+        blocks[i] = _mm_aesenc_si128(blocks[i], round_keys[r]);
+      }
+    }
+
+    for (size_t i = 0; i < BLOCK_CNT; i++) {
+      blocks[i] = _mm_aesenclast_si128(blocks[i], round_keys[14]);
+      _mm_store_si128(reinterpret_cast<__m128i*>(buf + i * BLOCK_LEN),
+                      blocks[i]);
+    }
+
+    ctr += BLOCK_CNT;
+    buf_off = 0;
+  }
+
+  // Expands 32 -bytes AES-256 key and sets up initial counter block, from 16
+  // -bytes IV.
+  inline void init(const uint8_t* const key, const uint8_t* const iv)
+  {
+    round_keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+    round_keys[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+
+    expand_pair<0x01>(2);
+    expand_pair<0x02>(4);
+    expand_pair<0x04>(6);
+    expand_pair<0x08>(8);
+    expand_pair<0x10>(10);
+    expand_pair<0x20>(12);
+    expand_pair<0x40>(14);
+
+    nonce = 0ul;
+    ctr = 0ul;
+    for (size_t i = 0; i < 8; i++) {
+      nonce = (nonce << 8) | static_cast<uint64_t>(iv[i]);
+      ctr = (ctr << 8) | static_cast<uint64_t>(iv[8 + i]);
+    }
+
+    buf_off = BUF_LEN;
+  }
+
+public:
+  // Samples 32 -bytes AES-256 key from SHAKE256 based PRNG, which is itself
+  // seeded with system randomness, while starting with all zero counter block.
+  inline aes_ctr_t()
+  {
+    uint8_t key[KEY_LEN];
+    uint8_t iv[IV_LEN]{};
+    prng_t{}.read(key, sizeof(key));
+
+    init(key, iv);
+  }
+
+  // Sets up AES-256-CTR based PRNG, using 32 -bytes key and 16 -bytes initial
+  // counter block. This is useful when caller wants to deterministically
+  // reproduce random byte stream.
+  inline aes_ctr_t(const uint8_t* const key, const uint8_t* const iv)
+  {
+    init(key, iv);
+  }
+
+  // Fills `len` -many bytes with AES-256-CTR keystream, refilling internal
+  // buffer as soon as it gets exhausted.
+  inline void read(uint8_t* const bytes, const size_t len)
+  {
+    size_t off = 0;
+
+    while (off < len) {
+      if (buf_off == BUF_LEN) {
+        refill();
+      }
+
+      const size_t readable = std::min(BUF_LEN - buf_off, len - off);
+      std::memcpy(bytes + off, buf + buf_off, readable);
+
+      buf_off += readable;
+      off += readable;
+    }
+  }
+};
+
+static_assert(rng<aes_ctr_t>,
+              "AES-256-CTR based PRNG must satisfy RNG concept !");
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+#include "prng.hpp"
+#include "prng_chacha20.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <thread>
+
+// Pseudo Random Number Generator
+namespace prng {
+
+// Pseudo Random Number Generator, which moves cost of producing randomness off
+// the critical path of signing, by running wrapped PRNG on a background
+// producer thread. Producer keeps a lock-free single-producer single-consumer
+// ring buffer of `CAP` -bytes filled with PRNG output, while `read` ( i.e. the
+// consumer ) just copies already produced bytes out of the ring. Both the
+// 40 -bytes salt and all bytes consumed by SamplerZ are read from the ring, so
+// a signing call doesn't need to run the underlying PRNG, as long as producer
+// keeps up.
+//
+// Producer writes `CHUNK_LEN` -bytes at a time and parks itself, when ring
+// doesn't have space for another chunk. It's woken up by consumer only after
+// half of the ring becomes free, so that consumer doesn't pay for waking up
+// producer on every read. Consumer blocks, only when ring is empty. Consumer
+// must be a single thread at a time, so one instance of this PRNG is meant to
+// be owned by each signing worker.
+//
+// Note, byte stream read from this PRNG is exactly same as the one produced by
+// wrapped PRNG, so a deterministically seeded PRNG can also be wrapped.
+template<rng RNG = chacha20_t, const size_t CAP = 1ul << 16>
+  requires(std::has_single_bit(CAP) && (CAP >= 4096))
+struct background_t
+{
+public:
+  static constexpr size_t CHUNK_LEN = 512;
+  static constexpr size_t WAKE_LEN = CAP / 2;
+
+private:
+  // Producer and consumer owned indices are kept on separate cache lines, so
+  // that they don't keep invalidating each other's cache line
+  alignas(64) std::atomic<size_t> head{ 0ul }; // next byte to be consumed
+  alignas(64) std::atomic<size_t> tail{ 0ul }; // next byte to be produced
+  alignas(64) std::atomic<bool> parked{ false };
+  alignas(64) std::atomic<bool> stop{ false };
+  alignas(64) uint8_t buf[CAP]{};
+
+  RNG src;
+  std::thread producer;
+
+  // Keeps filling ring buffer with output of wrapped PRNG, one chunk at a time,
+  // until asked to stop. Because CAP is a multiple of CHUNK_LEN, a chunk never
+  // wraps around end of ring buffer.
+  inline void produce()
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+
+    while (!stop.load()) {
+      if (CAP - (t - head.load()) < CHUNK_LEN) {
+        // announce that producer is going to be parked, before checking again,
+        // so that consumer either observes it or producer observes consumed
+        // bytes
+        parked.store(true);
+        if (stop.load() || (CAP - (t - head.load()) >= WAKE_LEN)) {
+          parked.store(false);
+          continue;
+        }
+
+        parked.wait(true);
+        continue;
+      }
+
+      src.read(buf + (t & (CAP - 1)), CHUNK_LEN);
+      t += CHUNK_LEN;
+
+      tail.store(t, std::memory_order_release);
+      tail.notify_one();
+    }
+  }
+
+public:
+  // Starts producer thread, which uses default constructed PRNG
+  inline background_t()
+    : producer(&background_t::produce, this)
+  {
+  }
+
+  // Starts producer thread, which uses given PRNG e.g. a deterministically
+  // seeded one.
+  inline explicit background_t(RNG&& rng)
+    : src(std::move(rng))
+    , producer(&background_t::produce, this)
+  {
+  }
+
+  background_t(const background_t&) = delete;
+  background_t& operator=(const background_t&) = delete;
+
+  // Asks producer thread to stop, waking it up if it's parked, and waits for it
+  // to finish.
+  inline ~background_t()
+  {
+    stop.store(true);
+
+    parked.store(false);
+    parked.notify_one();
+
+    producer.join();
+  }
+
+  // Fills `len` -many bytes with output of wrapped PRNG, taken from ring
+  // buffer, blocking only when ring buffer is empty.
+  inline void read(uint8_t* const bytes, const size_t len)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t off = 0;
+
+    while (off < len) {
+      const size_t t = tail.load(std::memory_order_acquire);
+      if (t == h) {
+        tail.wait(t, std::memory_order_acquire);
+        continue;
+      }
+
+      const size_t idx = h & (CAP - 1);
+      const size_t readable = std::min({ t - h, len - off, CAP - idx });
+      std::memcpy(bytes + off, buf + idx, readable);
+
+      h += readable;
+      off += readable;
+
+      head.store(h);
+      if (parked.load() && (CAP - (t - h) >= WAKE_LEN)) {
+        parked.store(false);
+        parked.notify_one();
+      }
+    }
+  }
+};
+
+static_assert(rng<background_t<>>,
+              "Background PRNG must satisfy RNG concept !");
+
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include "prng.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined __AVX2__
+#include <immintrin.h>
+#endif
+
+// Pseudo Random Number Generator
+namespace prng {
+
+// ChaCha20 based Pseudo Random Number Generator, which keeps producing
+// keystream of ChaCha20 stream cipher ( see RFC 8439 ), under a 256 -bit key.
+// This is what the reference implementation of Falcon uses for feeding its
+// sampler, because ChaCha20 is a lot cheaper per output byte than Keccak.
+//
+// Keystream is produced 8 blocks ( = 512 bytes ) at a time. On x86_64 targets
+// with AVX2 those 8 blocks are computed in parallel, keeping i-th word of all 8
+// block states in a single 256 -bit register. Otherwise a portable scalar
+// implementation is used, which produces exactly same keystream.
+//
+// Note, this implementation uses original ( 64 -bit block counter, 64 -bit
+// nonce ) layout of ChaCha20 state i.e. words 12, 13 hold block counter and
+// words 14, 15 hold nonce.
+struct chacha20_t
+{
+public:
+  static constexpr size_t KEY_LEN = 32;
+  static constexpr size_t BLOCK_LEN = 64;
+  static constexpr size_t BLOCK_CNT = 8;
+  static constexpr size_t BUF_LEN = BLOCK_CNT * BLOCK_LEN;
+
+private:
+  uint32_t state[16]{};
+  alignas(32) uint8_t buf[BUF_LEN]{};
+  size_t buf_off = BUF_LEN;
+
+  // ChaCha20 quarter round, applied on four 32 -bit words of state
+  static inline constexpr void quarter_round(uint32_t& a,
+                                             uint32_t& b,
+                                             uint32_t& c,
+                                             uint32_t& d)
+  {
+    a += b, d ^= a, d = std::rotl(d, 16);
+    c += d, b ^= c, b = std::rotl(b, 12);
+    a += b, d ^= a, d = std::rotl(d, 8);
+    c += d, b ^= c, b = std::rotl(b, 7);
+  }
+
+  // Computes a single 64 -bytes keystream block, for given block counter
+  inline void block(const uint64_t ctr, uint8_t* const out) const
+  {
+    uint32_t x[16];
+    std::memcpy(x, state, sizeof(x));
+
+    x[12] = static_cast<uint32_t>(ctr);
+    x[13] = static_cast<uint32_t>(ctr >> 32);
+
+    uint32_t w[16];
+    std::memcpy(w, x, sizeof(w));
+
+    for (size_t i = 0; i < 10; i++) {
+      quarter_round(w[0], w[4], w[8], w[12]);
+      quarter_round(w[1], w[5], w[9], w[13]);
+      quarter_round(w[2], w[6], w[10], w[14]);
+      quarter_round(w[3], w[7], w[11], w[15]);
+
+      quarter_round(w[0], w[5], w[10], w[15]);
+      quarter_round(w[1], w[6], w[11], w[12]);
+      quarter_round(w[2], w[7], w[8], w[13]);
+      quarter_round(w[3], w[4], w[9], w[14]);
+    }
+
+    for (size_t i = 0; i < 16; i++) {
+      const uint32_t v = w[i] + x[i];
+
+      out[4 * i + 0] = static_cast<uint8_t>(v >> 0);
+      out[4 * i + 1] = static_cast<uint8_t>(v >> 8);
+      out[4 * i + 2] = static_cast<uint8_t>(v >> 16);
+      out[4 * i + 3] = static_cast<uint8_t>(v >> 24);
+    }
+  }
+
+#if defined __AVX2__
+  // Rotates each 32 -bit lane of a 256 -bit register left, by `n` bits
+  template<const int n>
+  static inline __m256i rotl_x8(const __m256i v)
+  {
+    if constexpr (n == 16) {
+      const __m256i idx = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8,
+                                           9, 14, 15, 12, 13, 2, 3, 0, 1, 6,
+                                           7, 4, 5, 10, 11, 8, 9, 14, 15, 12,
+                                           13);
+      return _mm256_shuffle_epi8(v, idx);
+    } else if constexpr (n == 8) {
+      const __m256i idx = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9,
+                                           10, 15, 12, 13, 14, 3, 0, 1, 2, 7,
+                                           4, 5, 6, 11, 8, 9, 10, 15, 12, 13,
+                                           14);
+      return _mm256_shuffle_epi8(v, idx);
+    } else {
+      return _mm256_or_si256(_mm256_slli_epi32(v, n),
+                             _mm256_srli_epi32(v, 32 - n));
+    }
+  }
+
+  // ChaCha20 quarter round, applied on 8 independent block states, in parallel
+  static inline void quarter_round_x8(__m256i& a,
+                                      __m256i& b,
+                                      __m256i& c,
+                                      __m256i& d)
+  {
+    a = _mm256_add_epi32(a, b), d = rotl_x8<16>(_mm256_xor_si256(d, a));
+    c = _mm256_add_epi32(c, d), b = rotl_x8<12>(_mm256_xor_si256(b, c));
+    a = _mm256_add_epi32(a, b), d = rotl_x8<8>(_mm256_xor_si256(d, a));
+    c = _mm256_add_epi32(c, d), b = rotl_x8<7>(_mm256_xor_si256(b, c));
+  }
+#endif
+
+  // Computes next 8 keystream blocks, filling internal buffer, and moves block
+  // counter forward.
+  inline void refill()
+  {
+    const uint64_t ctr = (static_cast<uint64_t>(state[13]) << 32) | state[12];
+
+#if defined __AVX2__
+    __m256i x[16];
+    for (size_t i = 0; i < 16; i++) {
+      x[i] = _mm256_set1_epi32(static_cast<int32_t>(state[i]));
+    }
+
+    // Block counters of 8 parallel blocks, with carry propagated into word 13
+    alignas(32) uint32_t ctr_lo[BLOCK_CNT];
+    alignas(32) uint32_t ctr_hi[BLOCK_CNT];
+    for (size_t i = 0; i < BLOCK_CNT; i++) {
+      ctr_lo[i] = static_cast<uint32_t>(ctr + i);
+      ctr_hi[i] = static_cast<uint32_t>((ctr + i) >> 32);
+    }
+
+    x[12] = _mm256_load_si256(reinterpret_cast<const __m256i*>(ctr_lo));
+    x[13] = _mm256_load_si256(reinterpret_cast<const __m256i*>(ctr_hi));
+
+    __m256i w[16];
+    std::memcpy(w, x, sizeof(w));
+
+    for (size_t i = 0; i < 10; i++) {
+      quarter_round_x8(w[0], w[4], w[8], w[12]);
+      quarter_round_x8(w[1], w[5], w[9], w[13]);
+      quarter_round_x8(w[2], w[6], w[10], w[14]);
+      quarter_round_x8(w[3], w[7], w[11], w[15]);
+
+      quarter_round_x8(w[0], w[5], w[10], w[15]);
+      quarter_round_x8(w[1], w[6], w[11], w[12]);
+      quarter_round_x8(w[2], w[7], w[8], w[13]);
+      quarter_round_x8(w[3], w[4], w[9], w[14]);
+    }
+
+    // i-th register holds i-th word of all 8 blocks, transpose while storing
+    alignas(32) uint32_t words[16][BLOCK_CNT];
+    for (size_t i = 0; i < 16; i++) {
+      const __m256i v = _mm256_add_epi32(w[i], x[i]);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), v);
+    }
+
+    for (size_t b = 0; b < BLOCK_CNT; b++) {
+      for (size_t i = 0; i < 16; i++) {
+        const uint32_t v = words[i][b];
+        uint8_t* const out = buf + b * BLOCK_LEN + 4 * i;
+
+        out[0] = static_cast<uint8_t>(v >> 0);
+        out[1] = static_cast<uint8_t>(v >> 8);
+        out[2] = static_cast<uint8_t>(v >> 16);
+        out[3] = static_cast<uint8_t>(v >> 24);
+      }
+    }
+#else
+    for (size_t b = 0; b < BLOCK_CNT; b++) {
+      block(ctr + b, buf + b * BLOCK_LEN);
+    }
+#endif
+
+    const uint64_t next_ctr = ctr + BLOCK_CNT;
+    state[12] = static_cast<uint32_t>(next_ctr);
+    state[13] = static_cast<uint32_t>(next_ctr >> 32);
+
+    buf_off = 0;
+  }
+
+  // Sets up ChaCha20 state, using 32 -bytes key, 64 -bit nonce and 64 -bit
+  // initial block counter.
+  inline void init(const uint8_t* const key,
+                   const uint64_t nonce,
+                   const uint64_t ctr)
+  {
+    // "expand 32-byte k"
+    state[0] = 0x61707865u;
+    state[1] = 0x3320646eu;
+    state[2] = 0x79622d32u;
+    state[3] = 0x6b206574u;
+
+    for (size_t i = 0; i < 8; i++) {
+      state[4 + i] = (static_cast<uint32_t>(key[4 * i + 0]) << 0) |
+                     (static_cast<uint32_t>(key[4 * i + 1]) << 8) |
+                     (static_cast<uint32_t>(key[4 * i + 2]) << 16) |
+                     (static_cast<uint32_t>(key[4 * i + 3]) << 24);
+    }
+
+    state[12] = static_cast<uint32_t>(ctr);
+    state[13] = static_cast<uint32_t>(ctr >> 32);
+    state[14] = static_cast<uint32_t>(nonce);
+    state[15] = static_cast<uint32_t>(nonce >> 32);
+
+    buf_off = BUF_LEN;
+  }
+
+public:
+  // Samples 32 -bytes ChaCha20 key from SHAKE256 based PRNG, which is itself
+  // seeded with system randomness.
+  inline chacha20_t()
+  {
+    uint8_t key[KEY_LEN];
+    prng_t{}.read(key, sizeof(key));
+
+    init(key, 0ul, 0ul);
+  }
+
+  // Sets up ChaCha20 based PRNG, using 32 -bytes key, 64 -bit nonce and 64
+  // -bit initial block counter. This is useful when caller wants to
+  // deterministically reproduce random byte stream.
+  inline explicit chacha20_t(const uint8_t* const key,
+                             const uint64_t nonce = 0ul,
+                             const uint64_t ctr = 0ul)
+  {
+    init(key, nonce, ctr);
+  }
+
+  // Fills `len` -many bytes with ChaCha20 keystream, refilling internal buffer
+  // as soon as it gets exhausted.
+  inline void read(uint8_t* const bytes, const size_t len)
+  {
+    size_t off = 0;
+
+    while (off < len) {
+      if (buf_off == BUF_LEN) {
+        refill();
+      }
+
+      const size_t readable = std::min(BUF_LEN - buf_off, len - off);
+      std::memcpy(bytes + off, buf + buf_off, readable);
+
+      buf_off += readable;
+      off += readable;
+    }
+  }
+};
+
+static_assert(rng<chacha20_t>,
+              "ChaCha20 based PRNG must satisfy RNG concept !");
+
+}
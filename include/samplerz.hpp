@@ -8,6 +8,10 @@
 #include <cstring>
 #include <utility>
 
+#if defined __AVX2__
+#include <immintrin.h>
+#endif
+
 // Sampler over the Integers
 namespace samplerz {
 
@@ -26,6 +30,23 @@ constexpr double FALCON1024_σ_min = 1.298280334;
 // See table 3.3 of Falcon specification https://falcon-sign.info/falcon.pdf
 constexpr double σ_max = 1.8205;
 
+// Constants, which SamplerZ derives from σ' ( i.e. value stored in a leaf of
+// normalized falcon tree ) and σ_min. Those stay same for all signatures
+// produced using same falcon tree, so they can be computed once per tree.
+struct leaf_t
+{
+  double inv_2σ2 = 0.; // = 1 / (2 * σ'^2)
+  double ccs = 0.;     // = σ_min / σ'
+};
+
+// Given σ' ( value stored in a leaf of normalized falcon tree ) and σ_min,
+// computes constants, required by SamplerZ, for sampling from D_{Z, μ, σ'}
+static inline constexpr leaf_t
+compute_leaf(const double σ_prime, const double σ_min)
+{
+  return leaf_t{ 1. / (2. * σ_prime * σ_prime), σ_min / σ_prime };
+}
+
 // Scaled ( by a factor 2^72 ) Probability Distribution Table, taken from
 // table 3.1 of ( on page 41 ) of Falcon specification
 // https://falcon-sign.info/falcon.pdf
@@ -86,6 +107,30 @@ constexpr u72::u72_t RCDT[]{ -CDT[0],  -CDT[1],  -CDT[2],  -CDT[3],  -CDT[4],
                              -CDT[10], -CDT[11], -CDT[12], -CDT[13], -CDT[14],
                              -CDT[15], -CDT[16], -CDT[17], -CDT[18] };
 
+// Number of RCDT entries, padded to a multiple of 4, so that vectorized base
+// sampler can compare a 72 -bit sample against 4 entries at a time. Padding
+// entries are zero, which no sample can be lesser than.
+constexpr size_t RCDT_PADDED_LEN = 20;
+
+// Low 64 -bits of each RCDT entry, with most significant bit flipped, so that
+// unsigned comparison can be performed using signed comparison instructions
+alignas(32) constexpr auto RCDT_LO = []() {
+  std::array<uint64_t, RCDT_PADDED_LEN> res{};
+  for (size_t i = 0; i < RCDT_PADDED_LEN; i++) {
+    res[i] = (i < std::size(RCDT) - 1) ? RCDT[i].lo ^ (1ul << 63) : 1ul << 63;
+  }
+  return res;
+}();
+
+// High 8 -bits of each RCDT entry
+alignas(32) constexpr auto RCDT_HI = []() {
+  std::array<uint64_t, RCDT_PADDED_LEN> res{};
+  for (size_t i = 0; i < RCDT_PADDED_LEN; i++) {
+    res[i] = (i < std::size(RCDT) - 1) ? RCDT[i].hi : 0ul;
+  }
+  return res;
+}();
+
 // C contains the coefficients of a polynomial that approximates e^-x
 //
 // More precisely, the value:
@@ -105,6 +150,62 @@ constexpr uint64_t C[]{ 0x00000004741183A3ul, 0x00000036548CFC06ul,
                         0x400000000002B400ul, 0x7FFFFFFFFFFF4800ul,
                         0x8000000000000000ul };
 
+// BaseSampler routine as defined in algorithm 12 of Falcon specification
+// https://falcon-sign.info/falcon.pdf s.t. 72 -bit uniform random sample u is
+// given as its low 64 -bits and high 8 -bits. It returns number of RCDT entries
+// which are greater than u, computed without any data dependent branch.
+//
+// On x86_64 targets with AVX2, u is compared against 4 RCDT entries at a time,
+// using split ( 64 -bit low, 8 -bit high ) lanes, and resulting masks are
+// summed up. Otherwise all 18 entries are compared one after another.
+static inline uint32_t
+base_sampler(const uint64_t u_lo, const uint64_t u_hi)
+{
+#if defined __AVX2__
+  const auto lo_ = static_cast<int64_t>(u_lo ^ (1ul << 63));
+  const auto hi_ = static_cast<int64_t>(u_hi);
+
+  const __m256i lo = _mm256_set1_epi64x(lo_);
+  const __m256i hi = _mm256_set1_epi64x(hi_);
+
+  __m256i acc = _mm256_setzero_si256();
+  for (size_t i = 0; i < RCDT_PADDED_LEN; i += 4) {
+    const auto lptr = reinterpret_cast<const __m256i*>(RCDT_LO.data() + i);
+    const auto hptr = reinterpret_cast<const __m256i*>(RCDT_HI.data() + i);
+
+    const __m256i rlo = _mm256_load_si256(lptr);
+    const __m256i rhi = _mm256_load_si256(hptr);
+
+    // u < RCDT[i] <=> (u_hi < r_hi) || ((u_hi == r_hi) && (u_lo < r_lo))
+    const __m256i lt_hi = _mm256_cmpgt_epi64(rhi, hi);
+    const __m256i eq_hi = _mm256_cmpeq_epi64(rhi, hi);
+    const __m256i lt_lo = _mm256_cmpgt_epi64(rlo, lo);
+    const __m256i lt = _mm256_or_si256(lt_hi, _mm256_and_si256(eq_hi, lt_lo));
+
+    acc = _mm256_sub_epi64(acc, lt);
+  }
+
+  const __m128i t0 = _mm_add_epi64(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1));
+  const __m128i t1 = _mm_add_epi64(t0, _mm_unpackhi_epi64(t0, t0));
+
+  return static_cast<uint32_t>(_mm_cvtsi128_si64(t1));
+#else
+  uint32_t z0 = 0u;
+  for (size_t i = 0; i < RCDT_PADDED_LEN; i++) {
+    const uint64_t r_lo = RCDT_LO[i] ^ (1ul << 63);
+
+    const auto lt_hi = static_cast<uint32_t>(u_hi < RCDT_HI[i]);
+    const auto eq_hi = static_cast<uint32_t>(u_hi == RCDT_HI[i]);
+    const auto lt_lo = static_cast<uint32_t>(u_lo < r_lo);
+
+    z0 += lt_hi | (eq_hi & lt_lo);
+  }
+
+  return z0;
+#endif
+}
+
 // BaseSampler routine as defined in algorithm 12 of Falcon specification
 // https://falcon-sign.info/falcon.pdf
 //
@@ -118,32 +219,20 @@ static inline uint32_t
 base_sampler(std::array<uint8_t, 9>&& bytes)
 {
   const u72::u72_t u = u72::u72_t::from_le_bytes(std::move(bytes));
-
-  uint32_t z0 = 0u;
-  for (size_t i = 0; i < 18; i++) {
-    z0 = z0 + 1u * (u < RCDT[i]);
-  }
-
-  return z0;
+  return base_sampler(u.lo, u.hi);
 }
 
 // BaseSampler routine as defined in algorithm 12 of Falcon specification
 // https://falcon-sign.info/falcon.pdf s.t. 72 uniform random bits are sampled
-// from SHAKE256 based PRNG ( which is a parameter of this function ).
+// from a PRNG ( which is a parameter of this function ).
+template<prng::rng RNG>
 static inline uint32_t
-base_sampler(prng::prng_t& rng)
+base_sampler(RNG& rng)
 {
   std::array<uint8_t, 9> bytes;
   rng.read(bytes.data(), bytes.size());
 
-  const u72::u72_t u = u72::u72_t::from_le_bytes(std::move(bytes));
-
-  uint32_t z0 = 0u;
-  for (size_t i = 0; i < 18; i++) {
-    z0 = z0 + 1u * (u < RCDT[i]);
-  }
-
-  return z0;
+  return base_sampler(std::move(bytes));
 }
 
 // Given two 64 -bit unsigned integer operands, this routine multiplies them
@@ -216,56 +305,150 @@ top_63_bits(std::pair<uint64_t, uint64_t> v)
   return ((v.first & mask) << 1) | (v.second >> 63);
 }
 
+// Backends, which can be used for computing integral approximations of
+// 2^63 * ccs * e^−x, inside `approx_exp`
+//
+// - portable : integer Horner loop, using hand-rolled 64x64 -bit multiplication
+// - int128   : integer Horner loop, using compiler provided unsigned __int128,
+//              which lowers to a single `mul` ( or `mulx` with BMI2 ) on x86_64
+// - fpr      : double precision polynomial, evaluated using FMA, same as
+//              `fpr_expm_p63` of Falcon's reference implementation
+//
+// Both integer backends compute exactly same result, while floating point one
+// is never off by more than 2^-50 ( relative to 2^63 ) from those.
+enum class exp_backend_t : uint8_t
+{
+  portable,
+  int128,
+  fpr
+};
+
+// Backend used by `approx_exp`, unless explicitly asked for another one. It's
+// selected at compile-time, defaulting to `int128` when compiler supports
+// 128 -bit integers, which can be overridden by defining one of
+// FALCON_APPROX_EXP_PORTABLE or FALCON_APPROX_EXP_FPR.
+#if defined FALCON_APPROX_EXP_FPR
+constexpr exp_backend_t APPROX_EXP = exp_backend_t::fpr;
+#elif __SIZEOF_INT128__ == 16 && !defined FALCON_APPROX_EXP_PORTABLE
+constexpr exp_backend_t APPROX_EXP = exp_backend_t::int128;
+#else
+constexpr exp_backend_t APPROX_EXP = exp_backend_t::portable;
+#endif
+
+// Coefficients of polynomial approximation of e^-x | x ∈ [0, ln(2)], used by
+// `fpr` backend of `approx_exp`, in order of evaluation. Those are same as
+// ones used in `fpr_expm_p63` of Falcon's reference implementation, which are
+// originally taken from FACCT https://eprint.iacr.org/2018/1234.
+constexpr double C_FPR[]{
+  0.000000002073772366009083061987, 0.000000025299506379442070029551,
+  0.000000275607356160477811864927, 0.000002755586350219122514855659,
+  0.000024801566833585381209939524, 0.000198412739277311890541063977,
+  0.001388888894063186997887560103, 0.008333333327800835146903501993,
+  0.041666666666110491190622155955, 0.166666666666984014666397229121,
+  0.500000000000019206858326015208, 0.999999999999994892974086724280,
+  1.000000000000000000000000000000
+};
+
+// Given two 64 -bit unsigned integers a, b ( s.t. a * b < 2^127 ), this
+// routine computes top 63 -bits of 126 -bit product, using unsigned __int128.
+// Computes exactly same result as `top_63_bits(full_mul_u64(a, b))`.
+#if __SIZEOF_INT128__ == 16
+static inline uint64_t
+mul_top_63_bits(const uint64_t a, const uint64_t b)
+{
+  __extension__ using uint128_t = unsigned __int128;
+
+  const auto c = static_cast<uint128_t>(a) * static_cast<uint128_t>(b);
+  return static_cast<uint64_t>(c >> 63) & ((1ul << 63) - 1ul);
+}
+#endif
+
 // Routine for computing integral approximations of
 //
 // 2^63 * ccs * e^−x | x ∈ [0, ln(2)] , ccs ∈ [0, 1]
 //
 // This is an implementation of algorithm 13, described on page 42 of Falcon
-// specification https://falcon-sign.info/falcon.pdf
+// specification https://falcon-sign.info/falcon.pdf, when using one of the
+// integer backends. Otherwise the polynomial is evaluated in double precision,
+// following `fpr_expm_p63` of Falcon's reference implementation.
+template<const exp_backend_t backend = APPROX_EXP>
 static inline uint64_t
 approx_exp(const double x, const double ccs)
 {
-  uint64_t y = C[0];
-  uint64_t z = static_cast<uint64_t>(std::floor(9223372036854775808. * x));
+  if constexpr (backend == exp_backend_t::fpr) {
+    double y = C_FPR[0];
 
-  for (size_t u = 1; u < 13; u++) {
-    const auto t0 = full_mul_u64(z, y);
-    const auto t1 = top_63_bits(t0);
-    y = C[u] - t1;
-  }
+    for (size_t u = 1; u < std::size(C_FPR); u++) {
+#if defined __FMA__
+      y = std::fma(-y, x, C_FPR[u]);
+#else
+      y = C_FPR[u] - y * x;
+#endif
+    }
 
-  z = static_cast<uint64_t>(std::floor(9223372036854775808. * ccs));
-  const auto t0 = full_mul_u64(z, y);
-  y = top_63_bits(t0);
+    return static_cast<uint64_t>(y * ccs * 9223372036854775808.);
+  } else {
+    uint64_t y = C[0];
+    uint64_t z = static_cast<uint64_t>(std::floor(9223372036854775808. * x));
+
+    for (size_t u = 1; u < 13; u++) {
+      if constexpr (backend == exp_backend_t::int128) {
+#if __SIZEOF_INT128__ == 16
+        y = C[u] - mul_top_63_bits(z, y);
+#else
+        static_assert(backend != exp_backend_t::int128,
+                      "Compiler doesn't support unsigned __int128 !");
+#endif
+      } else {
+        y = C[u] - top_63_bits(full_mul_u64(z, y));
+      }
+    }
+
+    z = static_cast<uint64_t>(std::floor(9223372036854775808. * ccs));
+    if constexpr (backend == exp_backend_t::int128) {
+#if __SIZEOF_INT128__ == 16
+      y = mul_top_63_bits(z, y);
+#endif
+    } else {
+      y = top_63_bits(full_mul_u64(z, y));
+    }
 
-  return y;
+    return y;
+  }
 }
 
 // Computes a single bit ( = 1 ) with probability ≈ ccs * e^−x | ccs, x >= 0
 //
 // This is an implementation of algorithm 14, described on page 43 of Falcon
-// specification https://falcon-sign.info/falcon.pdf s.t. 8 uniform random bits
-// are sampled using SHAKE256 based PRNG.
+// specification https://falcon-sign.info/falcon.pdf s.t. 64 uniform random
+// bits u are compared against 64 -bit approximation of ccs * e^-x, in one go.
+// Algorithm 14 compares them 8 -bits at a time, starting from most significant
+// ones, stopping at first mismatch, which returns exactly same bit, as u < z.
+template<const exp_backend_t backend = APPROX_EXP>
 static inline uint8_t
-ber_exp(const double x, const double ccs, prng::prng_t& rng)
+ber_exp(const double x, const double ccs, const uint64_t u)
 {
   const double s = std::floor(x * INV_LN2);
   const double r = x - s * LN2;
   const uint64_t s_ = std::min<uint64_t>(static_cast<uint64_t>(s), 63ul);
-  const uint64_t z = (2 * approx_exp(r, ccs) - 1) >> s_;
+  const uint64_t z = (2 * approx_exp<backend>(r, ccs) - 1) >> s_;
 
-  int32_t w = 0;
-  int64_t i = 64l;
-  do {
-    i = i - 8l;
-
-    uint8_t t0;
-    rng.read(&t0, sizeof(t0));
+  return u < z;
+}
 
-    w = static_cast<int32_t>(t0) - static_cast<int32_t>((z >> i) & 0xfful);
-  } while ((w == 0) && (i > 0l));
+// Computes a single bit ( = 1 ) with probability ≈ ccs * e^−x | ccs, x >= 0
+//
+// This is an implementation of algorithm 14, described on page 43 of Falcon
+// specification https://falcon-sign.info/falcon.pdf s.t. 64 uniform random bits
+// are sampled at once, using a PRNG.
+template<const exp_backend_t backend = APPROX_EXP, prng::rng RNG>
+static inline uint8_t
+ber_exp(const double x, const double ccs, RNG& rng)
+{
+  uint64_t u;
+  rng.read(reinterpret_cast<uint8_t*>(&u), sizeof(u));
 
-  return w < 0;
+  return ber_exp<backend>(x, ccs, u);
 }
 
 // Computes a single bit ( = 1 ) with probability ≈ ccs * e^−x | ccs, x >= 0
@@ -280,6 +463,7 @@ ber_exp(const double x, const double ccs, prng::prng_t& rng)
 // This routine takes randomness from that array and also return how many random
 // bytes it had to use to finish executing the body of the do-while loop, so
 // that next user of random bytes can just skip forward those many bytes.
+template<const exp_backend_t backend = APPROX_EXP>
 static inline std::pair<uint8_t, size_t>
 ber_exp(const double x,
         const double ccs,
@@ -289,7 +473,7 @@ ber_exp(const double x,
   const double s = std::floor(x * INV_LN2);
   const double r = x - s * LN2;
   const uint64_t s_ = std::min<uint64_t>(static_cast<uint64_t>(s), 63ul);
-  const uint64_t z = (2 * approx_exp(r, ccs) - 1) >> s_;
+  const uint64_t z = (2 * approx_exp<backend>(r, ccs) - 1) >> s_;
 
   size_t ridx = 0;
   int32_t w = 0;
@@ -305,29 +489,37 @@ ber_exp(const double x,
   return std::make_pair(w < 0, ridx);
 }
 
-// Given floating point arguments μ, σ' | σ' ∈ [σ_min, σ_max], integer z ∈ Z,
-// sampled from a distribution very close to D_{Z, μ, σ′}, following algorithm
-// 15 of Falcon specification https://falcon-sign.info/falcon.pdf s.t. all
-// random bits are sampled from a SHAKE256 based PRNG.
+// Given floating point argument μ and constants derived from σ' | σ' ∈ [σ_min,
+// σ_max] ( see `compute_leaf` ), integer z ∈ Z, sampled from a distribution
+// very close to D_{Z, μ, σ′}, following algorithm 15 of Falcon specification
+// https://falcon-sign.info/falcon.pdf s.t. all random bits are sampled from a
+// PRNG, satisfying `prng::rng` concept.
+//
+// Random bytes, required for each attempt, are read from PRNG in one go, so
+// that per-attempt cost of drawing randomness is paid only once.
+template<const exp_backend_t backend = APPROX_EXP, prng::rng RNG>
 static inline int32_t
-samplerz(const double μ,
-         const double σ_prime,
-         const double σ_min,
-         prng::prng_t& rng)
+samplerz(const double μ, const leaf_t& leaf, RNG& rng)
 {
   const double r = μ - std::floor(μ);
-  const double ccs = σ_min / σ_prime;
+  const double ccs = leaf.ccs;
 
-  const double t0 = 1. / (2. * σ_prime * σ_prime);
+  const double t0 = leaf.inv_2σ2;
   constexpr double t1 = 1. / (2. * σ_max * σ_max);
 
   while (true) {
-    const auto z0 = static_cast<int32_t>(base_sampler(rng));
+    // random bytes for base sampler, sign bit and Bernoulli-exp test, read at
+    // once i.e. ( 8 + 1 ) + 1 + 8 bytes
+    uint8_t rb[18];
+    rng.read(rb, sizeof(rb));
 
-    uint8_t v;
-    rng.read(&v, sizeof(v));
+    uint64_t u_lo, u_ber;
+    std::memcpy(&u_lo, rb, sizeof(u_lo));
+    std::memcpy(&u_ber, rb + 10, sizeof(u_ber));
 
-    const auto b = v & 0b1;
+    const auto z0 = static_cast<int32_t>(base_sampler(u_lo, rb[8]));
+
+    const auto b = rb[9] & 0b1;
     const auto z = static_cast<double>(b + (2 * b - 1) * z0);
 
     const auto t2 = z - r;
@@ -338,13 +530,271 @@ samplerz(const double μ,
     const auto t6 = t5 * t1;
 
     const auto x = t4 - t6;
-    const auto t7 = ber_exp(x, ccs, rng);
+    const auto t7 = ber_exp<backend>(x, ccs, u_ber);
     if (t7 == 1) {
       return static_cast<int32_t>(z + std::floor(μ));
     }
   }
 }
 
+// Given floating point arguments μ, σ' | σ' ∈ [σ_min, σ_max], integer z ∈ Z,
+// sampled from a distribution very close to D_{Z, μ, σ′}, following algorithm
+// 15 of Falcon specification https://falcon-sign.info/falcon.pdf s.t. all
+// random bits are sampled from a PRNG, satisfying `prng::rng` concept.
+template<const exp_backend_t backend = APPROX_EXP, prng::rng RNG>
+static inline int32_t
+samplerz(const double μ, const double σ_prime, const double σ_min, RNG& rng)
+{
+  return samplerz<backend>(μ, compute_leaf(σ_prime, σ_min), rng);
+}
+
+#if defined __AVX2__
+
+// Given two vectors of 64 -bit unsigned integers a, b ( each < 2^63 ), this
+// routine computes top 63 -bits of 126 -bit products a[i] * b[i], for all four
+// lanes, emulating 64x64 -bit multiplication using 32x32 -bit multiplications.
+//
+// Vectorized equivalent of `top_63_bits(full_mul_u64(a, b))`.
+static inline __m256i
+mul_top_63_bits_x4(const __m256i a, const __m256i b)
+{
+  const __m256i mask32 = _mm256_set1_epi64x(0xffffffffl);
+
+  const __m256i a_hi = _mm256_srli_epi64(a, 32);
+  const __m256i b_hi = _mm256_srli_epi64(b, 32);
+
+  const __m256i ll = _mm256_mul_epu32(a, b);
+  const __m256i lh = _mm256_mul_epu32(a, b_hi);
+  const __m256i hl = _mm256_mul_epu32(a_hi, b);
+  const __m256i hh = _mm256_mul_epu32(a_hi, b_hi);
+
+  // t = (ll >> 32) + low 32 -bits of lh and hl, doesn't overflow
+  __m256i t = _mm256_srli_epi64(ll, 32);
+  t = _mm256_add_epi64(t, _mm256_and_si256(lh, mask32));
+  t = _mm256_add_epi64(t, _mm256_and_si256(hl, mask32));
+
+  // high 64 -bits of product
+  __m256i hi = _mm256_add_epi64(hh, _mm256_srli_epi64(lh, 32));
+  hi = _mm256_add_epi64(hi, _mm256_srli_epi64(hl, 32));
+  hi = _mm256_add_epi64(hi, _mm256_srli_epi64(t, 32));
+
+  // bit 63 of low 64 -bits of product is bit 31 of t, while only low 62 -bits
+  // of high 64 -bits are kept, same as `top_63_bits` does
+  const __m256i lo63 = _mm256_and_si256(_mm256_srli_epi64(t, 31),
+                                        _mm256_set1_epi64x(1));
+  const __m256i hi62 =
+    _mm256_and_si256(hi, _mm256_set1_epi64x((1l << 62) - 1l));
+  return _mm256_or_si256(_mm256_slli_epi64(hi62, 1), lo63);
+}
+
+// Given four doubles ∈ [0, 1], this routine computes floor(2^63 * v), as 64
+// -bit unsigned integers, by directly using exponent and mantissa bits, because
+// AVX2 doesn't offer double -> 64 -bit integer conversion.
+static inline __m256i
+scale_to_u63_x4(const __m256d v)
+{
+  const __m256i bits = _mm256_castpd_si256(v);
+  const __m256i mant_mask = _mm256_set1_epi64x((1l << 52) - 1l);
+  const __m256i implicit = _mm256_set1_epi64x(1l << 52);
+
+  // v * 2^63 = m * 2^(e - 1075 + 63), so shift by (e - 1012)
+  const __m256i mant = _mm256_and_si256(bits, mant_mask);
+  const __m256i m = _mm256_or_si256(mant, implicit);
+  const __m256i e = _mm256_srli_epi64(bits, 52);
+
+  const __m256i lsh = _mm256_sub_epi64(e, _mm256_set1_epi64x(1012));
+  const __m256i rsh = _mm256_sub_epi64(_mm256_set1_epi64x(1012), e);
+
+  // out of range shift amounts ( including "negative" ones ) produce zero
+  const __m256i t0 = _mm256_sllv_epi64(m, lsh);
+  const __m256i t1 = _mm256_srlv_epi64(m, rsh);
+  return _mm256_or_si256(t0, t1);
+}
+
+// Vectorized equivalent of `approx_exp`, computing integral approximations of
+// 2^63 * ccs * e^−x, for all four lanes, where x ∈ [0, ln(2)] is given as
+// doubles, while ccs is already scaled to 2^63 * ccs.
+static inline __m256i
+approx_exp_x4(const __m256d x, const __m256i ccs)
+{
+  __m256i y = _mm256_set1_epi64x(static_cast<int64_t>(C[0]));
+  const __m256i z = scale_to_u63_x4(x);
+
+  for (size_t u = 1; u < 13; u++) {
+    const __m256i t = mul_top_63_bits_x4(z, y);
+    y = _mm256_sub_epi64(_mm256_set1_epi64x(static_cast<int64_t>(C[u])), t);
+  }
+
+  return mul_top_63_bits_x4(ccs, y);
+}
+
+#endif
+
+// Given `cnt` -many centers μ[i] and constants derived from corresponding σ'[i]
+// ( see `compute_leaf` ), this routine samples integers z[i] from distributions
+// very close to D_{Z, μ[i], σ'[i]}, following algorithm 15 of Falcon
+// specification https://falcon-sign.info/falcon.pdf
+//
+// On x86_64 targets with AVX2, four samples are attempted at a time, where base
+// sampler, Bernoulli-exp test and `approx_exp` are evaluated in SIMD lanes.
+// Each lane works on its own ( μ, σ' ) pair, until it's accepted, and only then
+// it's refilled with next pair, so lanes which got rejected simply retry, in
+// next round. For each attempt, a lane consumes 18 random bytes i.e.
+//
+// - 9 bytes for base sampler, compared against RCDT as 64 -bit low and 8 -bit
+// high limbs
+// - 1 byte for sign bit
+// - 8 bytes for Bernoulli-exp test, compared against 64 -bit approximation of
+// ccs * e^-x, in one go
+//
+// which is same as what `samplerz` consumes, so for `cnt` = 1, both produce
+// same output, for same PRNG state. When more lanes are active, they draw
+// random bytes in turns, so output differs, though it's sampled from same
+// distribution. On other targets, this routine calls `samplerz` `cnt` times.
+template<prng::rng RNG>
+static inline void
+samplerz_batch(const double* const __restrict μ,
+               const leaf_t* const __restrict leaves,
+               int32_t* const __restrict z,
+               const size_t cnt,
+               RNG& rng)
+{
+#if defined __AVX2__
+  constexpr size_t lanes = 4;
+  constexpr size_t rlen = 18;
+  constexpr double t1_ = 1. / (2. * σ_max * σ_max);
+
+  alignas(32) double r[lanes]{};
+  alignas(32) double inv_2σ2[lanes]{};
+  alignas(32) double ccs[lanes]{};
+  alignas(32) uint64_t u_lo[lanes]{};
+  alignas(32) uint64_t u_hi[lanes]{};
+  alignas(32) uint64_t u_sign[lanes]{};
+  alignas(32) uint64_t u_ber[lanes]{};
+  alignas(32) double zs[lanes]{};
+
+  size_t idx[lanes];
+  size_t next = 0;
+  size_t active = 0;
+
+  // assigns next ( μ, σ' ) pair to j-th lane, if any left
+  auto refill = [&](const size_t j) {
+    idx[j] = next;
+    if (next < cnt) {
+      r[j] = μ[next] - std::floor(μ[next]);
+      inv_2σ2[j] = leaves[next].inv_2σ2;
+      ccs[j] = leaves[next].ccs;
+
+      next++;
+      active++;
+    }
+  };
+
+  for (size_t j = 0; j < lanes; j++) {
+    refill(j);
+  }
+
+  const __m256i sign64 = _mm256_set1_epi64x(INT64_MIN);
+  const __m256d t1 = _mm256_set1_pd(t1_);
+  const __m256d ln2 = _mm256_set1_pd(LN2);
+  const __m256d inv_ln2 = _mm256_set1_pd(INV_LN2);
+  const __m256d one = _mm256_set1_pd(1.);
+
+  while (active > 0) {
+    for (size_t j = 0; j < lanes; j++) {
+      if (idx[j] < cnt) {
+        uint8_t rb[rlen];
+        rng.read(rb, sizeof(rb));
+
+        std::memcpy(&u_lo[j], rb, 8);
+        u_hi[j] = rb[8];
+        u_sign[j] = rb[9] & 0b1;
+        std::memcpy(&u_ber[j], rb + 10, 8);
+      }
+    }
+
+    // base sampler i.e. z0 = |{i : u < RCDT[i]}|, with 72 -bit comparison
+    const __m256i ulo = _mm256_xor_si256(
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(u_lo)), sign64);
+    const __m256i uhi =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(u_hi));
+
+    __m256i z0 = _mm256_setzero_si256();
+    for (size_t i = 0; i < 18; i++) {
+      const auto rhi_ = static_cast<int64_t>(RCDT_HI[i]);
+      const auto rlo_ = static_cast<int64_t>(RCDT_LO[i]);
+
+      const __m256i rhi = _mm256_set1_epi64x(rhi_);
+      const __m256i rlo = _mm256_set1_epi64x(rlo_);
+
+      const __m256i lt_hi = _mm256_cmpgt_epi64(rhi, uhi);
+      const __m256i eq_hi = _mm256_cmpeq_epi64(rhi, uhi);
+      const __m256i lt_lo = _mm256_cmpgt_epi64(rlo, ulo);
+      const __m256i lt =
+        _mm256_or_si256(lt_hi, _mm256_and_si256(eq_hi, lt_lo));
+
+      z0 = _mm256_sub_epi64(z0, lt);
+    }
+
+    // z = b + (2b - 1) * z0 i.e. z = z0 + 1 when b = 1, otherwise z = -z0
+    const __m256i z0_32 = _mm256_permutevar8x32_epi32(
+      z0, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6));
+    const __m256d z0d = _mm256_cvtepi32_pd(_mm256_castsi256_si128(z0_32));
+
+    const __m256i b = _mm256_sub_epi64(
+      _mm256_setzero_si256(),
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(u_sign)));
+    const __m256d zd =
+      _mm256_blendv_pd(_mm256_sub_pd(_mm256_setzero_pd(), z0d),
+                       _mm256_add_pd(z0d, one),
+                       _mm256_castsi256_pd(b));
+
+    // x = (z - r)^2 / (2σ'^2) - z0^2 / (2σ_max^2)
+    const __m256d t2 = _mm256_sub_pd(zd, _mm256_load_pd(r));
+    const __m256d t4 = _mm256_mul_pd(_mm256_mul_pd(t2, t2),
+                                     _mm256_load_pd(inv_2σ2));
+    const __m256d t6 = _mm256_mul_pd(_mm256_mul_pd(z0d, z0d), t1);
+    const __m256d x = _mm256_sub_pd(t4, t6);
+
+    // Bernoulli-exp test, see algorithm 14 of Falcon specification
+    const __m256d s = _mm256_floor_pd(_mm256_mul_pd(x, inv_ln2));
+    const __m256d rr = _mm256_sub_pd(x, _mm256_mul_pd(s, ln2));
+
+    const __m128i s32 =
+      _mm_min_epu32(_mm256_cvttpd_epi32(s), _mm_set1_epi32(63));
+    const __m256i s_ = _mm256_cvtepu32_epi64(s32);
+
+    const __m256i ccs_ = scale_to_u63_x4(_mm256_load_pd(ccs));
+    const __m256i y = approx_exp_x4(rr, ccs_);
+
+    const __m256i t8 = _mm256_sub_epi64(_mm256_slli_epi64(y, 1),
+                                        _mm256_set1_epi64x(1));
+    const __m256i zz = _mm256_xor_si256(_mm256_srlv_epi64(t8, s_), sign64);
+
+    const __m256i w = _mm256_xor_si256(
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(u_ber)), sign64);
+    const __m256i acc = _mm256_cmpgt_epi64(zz, w);
+
+    const auto acc_mask = _mm256_movemask_pd(_mm256_castsi256_pd(acc));
+    _mm256_store_pd(zs, zd);
+
+    for (size_t j = 0; j < lanes; j++) {
+      if ((idx[j] < cnt) && ((acc_mask >> j) & 1)) {
+        const size_t k = idx[j];
+        z[k] = static_cast<int32_t>(zs[j] + std::floor(μ[k]));
+
+        active--;
+        refill(j);
+      }
+    }
+  }
+#else
+  for (size_t i = 0; i < cnt; i++) {
+    z[i] = samplerz(μ[i], leaves[i], rng);
+  }
+#endif
+}
+
 // Given floating point arguments μ, σ' | σ' ∈ [σ_min, σ_max], integer z ∈ Z,
 // sampled from a distribution very close to D_{Z, μ, σ′}, following algorithm
 // 15 of Falcon specification https://falcon-sign.info/falcon.pdf
@@ -358,6 +808,7 @@ samplerz(const double μ,
 // routine is written such that I can easily write test cases using KATs (known
 // answer tests) suppiled with Falcon's NIST submission, for easing correct
 // implementation of SamplerZ routine.
+template<const exp_backend_t backend = APPROX_EXP>
 static inline std::pair<int32_t, size_t>
 samplerz(const double μ,
          const double σ_prime,
@@ -392,7 +843,8 @@ samplerz(const double μ,
     const auto t6 = t5 * t1;
 
     const auto x = t4 - t6;
-    const auto [t7, ulen] = ber_exp(x, ccs, rbytes + ridx, rblen - ridx);
+    const auto rb = rbytes + ridx;
+    const auto [t7, ulen] = ber_exp<backend>(x, ccs, rb, rblen - ridx);
     ridx += ulen;
     if (t7 == 1) {
       ret_z = static_cast<int32_t>(z + std::floor(μ));
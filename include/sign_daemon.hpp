@@ -0,0 +1,915 @@
+#pragma once
+#include "async.hpp"
+#include "falcon.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined __linux__
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Local Falcon{512, 1024} signing daemon, which keeps expanded secret keys
+// resident in memory, serving sign/ verify requests from other processes on
+// same host, over Unix domain sockets.
+//
+// Each client shares a memory region with daemon ( a memfd, passed over socket
+// when client connects, sealed against shrinking ), which is split into fixed
+// size slots, used as a ring by client. A slot holds message to be signed/
+// verified, followed by signature, so that payloads are never copied through
+// socket, while only small fixed size request/ response headers are exchanged
+// over a SOCK_SEQPACKET socket.
+//
+// By default, only processes running as daemon's own user can connect to it,
+// see `server_t::listen` and `server_t::allow`.
+//
+// Requests arriving within a short window ( a few microseconds ) are coalesced
+// into batches, which are signed/ verified using batched routines ( see
+// `falcon::expanded_key_t::sign_batch` and `falcon::verify_batch` ), on a
+// worker pool.
+namespace sign_daemon {
+
+#if defined __linux__
+
+// Maximum byte length of message, which can be signed/ verified by daemon
+constexpr size_t MAX_MSG_LEN = 4096;
+
+// Operations, which can be requested from daemon
+enum class op_t : uint8_t
+{
+  sign = 1,
+  verify = 2,
+};
+
+// Sent by client, once connected, along with memfd of shared memory region,
+// which must be sealed using F_SEAL_SHRINK, so that daemon never touches pages
+// truncated away, by client, after being mapped
+struct hello_t
+{
+  uint32_t slot_cnt = 0;
+};
+
+// Request header, sent by client, s.t. payload lives in shared memory slot.
+// Padding is explicit, so that no uninitialized byte is ever sent over socket.
+struct request_t
+{
+  uint64_t id = 0;     // opaque to daemon, echoed back in response
+  uint32_t key_id = 0; // which one of daemon's keys to use
+  uint32_t slot = 0;   // slot of shared memory region, holding payload
+  uint32_t mlen = 0;   // byte length of message, in slot
+  op_t op = op_t::sign;
+  uint8_t reserved[3]{};
+};
+
+// Response header, sent by daemon, once request completes. If request was to
+// sign a message, signature is written to slot, before response is sent.
+struct response_t
+{
+  uint64_t id = 0;
+  uint32_t slot = 0;
+  uint8_t ok = 0; // signed or verified successfully ?
+  uint8_t reserved[3]{};
+};
+
+static_assert(std::has_unique_object_representations_v<request_t>);
+static_assert(std::has_unique_object_representations_v<response_t>);
+
+// Compile-time compute byte length of each slot of shared memory region, which
+// holds message followed by Falcon{512, 1024} signature, padded to a multiple
+// of cache line size.
+template<const size_t N>
+static inline constexpr size_t
+slot_len()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t len = MAX_MSG_LEN + falcon_utils::compute_sig_len<N>();
+  return (len + 63) & ~size_t{ 63 };
+}
+
+// Falcon{512, 1024} signing daemon, which accepts clients on a Unix domain
+// socket and runs an epoll based event loop on the thread calling `run`, while
+// signing/ verification happens on given worker pool.
+template<const size_t N>
+  requires((N == 512) || (N == 1024))
+struct server_t
+{
+private:
+  using sclock = std::chrono::steady_clock;
+
+  static constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  static constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  static constexpr size_t batch_cap = 64;
+
+  // Connected client, along with shared memory region, mapped into daemon's
+  // address space. It's kept alive, by in-flight requests, even after client
+  // disconnects.
+  //
+  // Responses, which can't be sent right away, because client isn't reading
+  // them fast enough, are queued, to be sent by event loop, once socket is
+  // writable. A client, letting more than `slot_cnt` -many responses pile up,
+  // is shut down, because it must have reused a slot, before receiving
+  // response for it.
+  struct client_t
+  {
+    int fd = -1;
+    int epfd = -1;
+    uint8_t* mem = nullptr;
+    size_t slot_cnt = 0;
+
+    std::mutex lock;
+    std::deque<response_t> queued;
+
+    inline ~client_t()
+    {
+      if (mem != nullptr) {
+        munmap(mem, slot_cnt * slot_len<N>());
+      }
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    inline uint8_t* msg(const uint32_t slot) const
+    {
+      return mem + slot * slot_len<N>();
+    }
+
+    inline uint8_t* sig(const uint32_t slot) const
+    {
+      return msg(slot) + MAX_MSG_LEN;
+    }
+
+    // Asks event loop to watch for socket becoming writable or not
+    inline void watch_writable(const bool on) const
+    {
+      epoll_event ev{};
+      ev.events = on ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+      ev.data.fd = fd;
+      epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    // Sends response, without blocking, queueing it, if socket isn't writable.
+    // Can be called from any thread.
+    inline void respond(const response_t& resp)
+    {
+      constexpr int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+      std::lock_guard<std::mutex> guard(lock);
+
+      if (queued.empty()) {
+        const ssize_t n = send(fd, &resp, sizeof(resp), flags);
+        if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+          // sent, or client is gone, which event loop finds out on its own
+          return;
+        }
+      }
+
+      if (queued.size() >= slot_cnt) [[unlikely]] {
+        shutdown(fd, SHUT_RDWR);
+        return;
+      }
+
+      queued.push_back(resp);
+      if (queued.size() == 1) {
+        watch_writable(true);
+      }
+    }
+
+    // Sends queued responses, as long as socket is writable, called by event
+    // loop
+    inline void flush()
+    {
+      constexpr int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+      std::lock_guard<std::mutex> guard(lock);
+
+      while (!queued.empty()) {
+        const auto& resp = queued.front();
+
+        const ssize_t n = send(fd, &resp, sizeof(resp), flags);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+          return;
+        }
+        if (n < 0) {
+          queued.clear();
+          break;
+        }
+
+        queued.pop_front();
+      }
+
+      watch_writable(false);
+    }
+  };
+
+  struct key_t
+  {
+    falcon::expanded_key_t<N> sk;
+    std::vector<uint8_t> pkey = std::vector<uint8_t>(pklen);
+  };
+
+  // A request, along with client who made it
+  struct pending_t
+  {
+    std::shared_ptr<client_t> client;
+    request_t req{};
+  };
+
+  int lfd = -1;
+  int epfd = -1;
+  int evfd = -1;
+  std::string path;
+  std::atomic<bool> stopped{ false };
+
+  // Peers allowed to connect, see `allow`
+  std::vector<uid_t> uids{ geteuid() };
+  std::vector<gid_t> gids;
+
+  std::vector<std::unique_ptr<key_t>> keys;
+  std::unordered_map<int, std::shared_ptr<client_t>> clients;
+  async::pool_t& pool;
+  sclock::duration window;
+
+  std::vector<pending_t> batch;
+  std::atomic<uint64_t> batches{ 0ul };
+  std::atomic<uint64_t> requests{ 0ul };
+  std::atomic<uint64_t> inflight{ 0ul }; // groups being served by pool
+
+  // Whether peer connected on given socket, runs as one of allowed users or
+  // groups, as reported by kernel
+  inline bool allowed(const int fd) const
+  {
+    ucred cred{};
+    socklen_t len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+      return false;
+    }
+
+    return (std::find(uids.begin(), uids.end(), cred.uid) != uids.end()) ||
+           (std::find(gids.begin(), gids.end(), cred.gid) != gids.end());
+  }
+
+  // Accepts all pending connections, closing ones from peers, which aren't
+  // allowed to connect
+  inline void accept_all()
+  {
+    while (1) {
+      constexpr int flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+
+      const int fd = accept4(lfd, nullptr, nullptr, flags);
+      if (fd < 0) {
+        return;
+      }
+      if (!allowed(fd)) {
+        close(fd);
+        continue;
+      }
+
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.fd = fd;
+
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) [[unlikely]] {
+        close(fd);
+        continue;
+      }
+
+      auto client = std::make_shared<client_t>();
+      client->fd = fd;
+      client->epfd = epfd;
+      clients[fd] = std::move(client);
+    }
+  }
+
+  // Receives hello message, along with memfd of shared memory region, mapping
+  // it, only if it's large enough and sealed against shrinking. Returns false,
+  // if client must be dropped. Received memfd is closed, in either case.
+  inline bool handshake(client_t& client)
+  {
+    hello_t hello;
+    iovec iov{ &hello, sizeof(hello) };
+
+    alignas(cmsghdr) uint8_t ctrl[CMSG_SPACE(sizeof(int))];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    const ssize_t n = recvmsg(client.fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0) {
+      return false;
+    }
+
+    int memfd = -1;
+
+    const cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+    if ((cmsg != nullptr) && (cmsg->cmsg_level == SOL_SOCKET) &&
+        (cmsg->cmsg_type == SCM_RIGHTS) &&
+        (cmsg->cmsg_len == CMSG_LEN(sizeof(int)))) {
+      std::memcpy(&memfd, CMSG_DATA(cmsg), sizeof(memfd));
+    }
+    if (memfd < 0) {
+      return false;
+    }
+
+    const bool wellformed = (n == static_cast<ssize_t>(sizeof(hello))) &&
+                            ((msg.msg_flags & MSG_CTRUNC) == 0) &&
+                            (hello.slot_cnt > 0);
+
+    const size_t len = hello.slot_cnt * slot_len<N>();
+    const int seals = wellformed ? fcntl(memfd, F_GET_SEALS) : -1;
+
+    struct stat st;
+    const bool sized = (seals >= 0) && ((seals & F_SEAL_SHRINK) != 0) &&
+                       (fstat(memfd, &st) == 0) &&
+                       (static_cast<size_t>(st.st_size) >= len);
+
+    void* mem = MAP_FAILED;
+    if (sized) {
+      mem = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    }
+    close(memfd);
+
+    if (mem == MAP_FAILED) {
+      return false;
+    }
+
+    client.mem = static_cast<uint8_t*>(mem);
+    client.slot_cnt = hello.slot_cnt;
+    return true;
+  }
+
+  // Drops client, though its shared memory stays mapped, until all its
+  // in-flight requests complete.
+  inline void drop(const int fd)
+  {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    clients.erase(fd);
+  }
+
+  // Reads all requests, which are available on client socket, adding valid
+  // ones to current batch, while rejecting invalid ones right away.
+  inline void read_requests(const int fd)
+  {
+    const auto it = clients.find(fd);
+    if (it == clients.end()) {
+      return;
+    }
+
+    auto client = it->second;
+    if (client->mem == nullptr) {
+      if (!handshake(*client)) {
+        drop(fd);
+      }
+      return;
+    }
+
+    while (batch.size() < batch_cap) {
+      request_t req{};
+      const ssize_t n = recv(fd, &req, sizeof(req), 0);
+
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        drop(fd);
+        return;
+      }
+      if (n < 0) {
+        return;
+      }
+
+      const bool valid = (n == static_cast<ssize_t>(sizeof(req))) &&
+                         (req.slot < client->slot_cnt) &&
+                         (req.mlen <= MAX_MSG_LEN) &&
+                         (req.key_id < keys.size()) &&
+                         ((req.op == op_t::sign) || (req.op == op_t::verify));
+      if (!valid) [[unlikely]] {
+        client->respond(response_t{ req.id, req.slot, 0 });
+        continue;
+      }
+
+      batch.push_back(pending_t{ client, req });
+    }
+  }
+
+  // Polls event loop, without blocking, handling whatever is ready. Returns
+  // false, if daemon is asked to stop.
+  inline bool poll_events(const int timeout_ms)
+  {
+    constexpr int max_events = 64;
+    epoll_event events[max_events];
+
+    const int cnt = epoll_wait(epfd, events, max_events, timeout_ms);
+    if (cnt < 0 && errno != EINTR) [[unlikely]] {
+      return false;
+    }
+    for (int i = 0; i < cnt; i++) {
+      const int fd = events[i].data.fd;
+
+      if (fd == evfd) {
+        return false;
+      } else if (fd == lfd) {
+        accept_all();
+        continue;
+      }
+
+      if ((events[i].events & EPOLLOUT) != 0) {
+        if (const auto it = clients.find(fd); it != clients.end()) {
+          it->second->flush();
+        }
+      }
+      if ((events[i].events & ~uint32_t{ EPOLLOUT }) != 0) {
+        read_requests(fd);
+      }
+    }
+
+    return !stopped.load();
+  }
+
+  // Splits current batch into groups of same key and operation, each of at max
+  // `batch_cap` requests, and submits them to worker pool, which signs/
+  // verifies them using batched routines and responds to clients.
+  inline void dispatch()
+  {
+    std::stable_sort(batch.begin(), batch.end(), [](auto& a, auto& b) {
+      return std::make_pair(a.req.key_id, a.req.op) <
+             std::make_pair(b.req.key_id, b.req.op);
+    });
+
+    batches.fetch_add(1, std::memory_order_relaxed);
+    requests.fetch_add(batch.size(), std::memory_order_relaxed);
+
+    size_t beg = 0;
+    while (beg < batch.size()) {
+      const auto key_id = batch[beg].req.key_id;
+      const auto op = batch[beg].req.op;
+
+      size_t end = beg + 1;
+      while ((end < batch.size()) && (batch[end].req.key_id == key_id) &&
+             (batch[end].req.op == op)) {
+        end++;
+      }
+
+      auto group = std::make_shared<std::vector<pending_t>>(
+        std::make_move_iterator(batch.begin() + beg),
+        std::make_move_iterator(batch.begin() + end));
+
+      const key_t& key = *keys[key_id];
+      inflight.fetch_add(1);
+
+      pool.submit([this, group, &key, op]() {
+        serve(*group, key, op);
+        if (inflight.fetch_sub(1) == 1) {
+          inflight.notify_all();
+        }
+      });
+
+      beg = end;
+    }
+
+    batch.clear();
+  }
+
+  // Signs/ verifies a group of requests, on worker thread, using same key
+  static inline void serve(const std::vector<pending_t>& group,
+                           const key_t& key,
+                           const op_t op)
+  {
+    const size_t cnt = group.size();
+
+    std::vector<const uint8_t*> msgs(cnt);
+    std::vector<size_t> mlens(cnt);
+    std::vector<uint8_t*> sigs(cnt);
+    auto res = std::make_unique<bool[]>(cnt);
+
+    for (size_t i = 0; i < cnt; i++) {
+      msgs[i] = group[i].client->msg(group[i].req.slot);
+      mlens[i] = group[i].req.mlen;
+      sigs[i] = group[i].client->sig(group[i].req.slot);
+    }
+
+    if (op == op_t::sign) {
+      auto& state = async::signer_state<N>();
+      key.sk.sign_batch(
+        msgs.data(), mlens.data(), sigs.data(), cnt, *state.ws, state.rng);
+      std::fill_n(res.get(), cnt, true);
+    } else {
+      const std::vector<const uint8_t*> csigs(sigs.begin(), sigs.end());
+      const auto pkey = key.pkey.data();
+
+      falcon::verify_batch<N>(
+        pkey, msgs.data(), mlens.data(), csigs.data(), res.get(), cnt);
+    }
+
+    for (size_t i = 0; i < cnt; i++) {
+      const auto& req = group[i].req;
+      group[i].client->respond(response_t{ req.id, req.slot, res[i] });
+    }
+  }
+
+public:
+  // Sets up daemon, which signs/ verifies on given worker pool, coalescing
+  // requests arriving within `window` of first one, into a batch.
+  inline explicit server_t(
+    async::pool_t& pool = async::default_pool(),
+    const sclock::duration window = std::chrono::microseconds(20))
+    : pool(pool)
+    , window(window)
+  {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    evfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = evfd;
+
+    const bool ok = (epfd >= 0) && (evfd >= 0) &&
+                    (epoll_ctl(epfd, EPOLL_CTL_ADD, evfd, &ev) == 0);
+    if (!ok) [[unlikely]] {
+      if (evfd >= 0) {
+        close(evfd);
+      }
+      if (epfd >= 0) {
+        close(epfd);
+      }
+
+      evfd = -1;
+      epfd = -1;
+    }
+
+    batch.reserve(batch_cap);
+  }
+
+  server_t(const server_t&) = delete;
+  server_t& operator=(const server_t&) = delete;
+
+  // Waits for in-flight requests to complete, before closing all sockets.
+  inline ~server_t()
+  {
+    for (auto n = inflight.load(); n != 0; n = inflight.load()) {
+      inflight.wait(n);
+    }
+
+    clients.clear();
+
+    if (lfd >= 0) {
+      close(lfd);
+      unlink(path.c_str());
+    }
+    if (valid()) {
+      close(evfd);
+      close(epfd);
+    }
+  }
+
+  // Whether event loop could be set up, otherwise daemon can't listen on a
+  // socket, nor run
+  inline bool valid() const { return (epfd >= 0) && (evfd >= 0); }
+
+  // Expands byte encoded secret key and keeps it resident, along with public
+  // key, which is used for verification requests. Returns false, if secret key
+  // can't be decoded. Keys must be added before daemon is run, while i-th key
+  // added is identified by `i`, in requests.
+  inline bool add_key(const uint8_t* const __restrict pkey,
+                      const uint8_t* const __restrict skey)
+  {
+    auto key = std::make_unique<key_t>();
+    if (!key->sk.expand(skey)) {
+      return false;
+    }
+
+    std::copy_n(pkey, pklen, key->pkey.begin());
+    keys.push_back(std::move(key));
+    return true;
+  }
+
+  // Allows peers running as one of given users or groups to connect, replacing
+  // default, which only allows daemon's own effective user. Must be called
+  // before daemon is run.
+  inline void allow(std::vector<uid_t> uids_, std::vector<gid_t> gids_ = {})
+  {
+    uids = std::move(uids_);
+    gids = std::move(gids_);
+  }
+
+  // Starts listening on Unix domain socket, at given path, which is created
+  // with given permission bits ( masked by umask ). A socket file, already
+  // existing at path, is replaced only if no one is listening on it anymore.
+  // Returns false, if socket can't be bound or event loop couldn't be set up (
+  // see `valid` ).
+  inline bool listen(const std::string& sock_path, const mode_t mode = 0600)
+  {
+    sockaddr_un addr{};
+    if (!valid() || (lfd >= 0) || (sock_path.size() >= sizeof(addr.sun_path))) {
+      return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, sock_path.data(), sock_path.size());
+    const auto saddr = reinterpret_cast<const sockaddr*>(&addr);
+
+    if (struct stat st; lstat(sock_path.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        return false;
+      }
+
+      const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+      const bool stale = (fd >= 0) &&
+                         (::connect(fd, saddr, sizeof(addr)) != 0) &&
+                         (errno == ECONNREFUSED);
+      if (fd >= 0) {
+        close(fd);
+      }
+      if (!stale) {
+        return false;
+      }
+
+      unlink(sock_path.c_str());
+    }
+
+    lfd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (lfd < 0) {
+      return false;
+    }
+
+    // on Linux, socket file is created with permission bits of socket, so
+    // that it's never accessible by others, not even for a moment
+    if ((fchmod(lfd, mode) != 0) || (bind(lfd, saddr, sizeof(addr)) != 0) ||
+        (::listen(lfd, 128) != 0)) {
+      close(lfd);
+      lfd = -1;
+      return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = lfd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) != 0) [[unlikely]] {
+      close(lfd);
+      unlink(sock_path.c_str());
+      lfd = -1;
+      return false;
+    }
+
+    path = sock_path;
+    return true;
+  }
+
+  // Runs event loop on calling thread, until `stop` is called. Once a request
+  // arrives, event loop keeps polling for more of them, without blocking, till
+  // coalescing window elapses or batch is full, before dispatching batch.
+  inline void run()
+  {
+    while (poll_events(-1)) {
+      if (batch.empty()) {
+        continue;
+      }
+
+      const auto deadline = sclock::now() + window;
+      while ((batch.size() < batch_cap) && (sclock::now() < deadline)) {
+        if (!poll_events(0)) {
+          break;
+        }
+      }
+
+      dispatch();
+    }
+
+    if (!batch.empty()) {
+      dispatch();
+    }
+  }
+
+  // Asks event loop to stop. Can be called from any thread.
+  inline void stop()
+  {
+    stopped.store(true);
+
+    const uint64_t one = 1;
+    if (::write(evfd, &one, sizeof(one)) < 0) {
+      // eventfd counter can't overflow, as it's written only once
+    }
+  }
+
+  // Number of batches dispatched and requests served, so far, which tells how
+  // well requests are being coalesced.
+  inline uint64_t batch_count() const { return batches.load(); }
+  inline uint64_t request_count() const { return requests.load(); }
+};
+
+// Client of Falcon{512, 1024} signing daemon, which shares a memory region of
+// `slot_cnt` -many slots with daemon. Caller decides which slot is used by a
+// request and must not reuse a slot, until response for it is received. One
+// client must be used by a single thread at a time.
+template<const size_t N>
+  requires((N == 512) || (N == 1024))
+struct client_t
+{
+private:
+  static constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+
+  int fd = -1;
+  uint8_t* mem = nullptr;
+  size_t slot_cnt = 0;
+  uint64_t next_id = 0;
+
+public:
+  client_t() = default;
+  client_t(const client_t&) = delete;
+  client_t& operator=(const client_t&) = delete;
+
+  inline ~client_t()
+  {
+    if (mem != nullptr) {
+      munmap(mem, slot_cnt * slot_len<N>());
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  // Connects to daemon listening at given path, sharing a memory region of
+  // `slot_cnt` -many slots with it. Returns false, if connection can't be
+  // established.
+  inline bool connect(const std::string& sock_path, const uint32_t slots)
+  {
+    sockaddr_un addr{};
+    if ((sock_path.size() >= sizeof(addr.sun_path)) || (slots == 0)) {
+      return false;
+    }
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, sock_path.data(), sock_path.size());
+
+    const auto saddr = reinterpret_cast<const sockaddr*>(&addr);
+    if (::connect(fd, saddr, sizeof(addr)) != 0) {
+      return false;
+    }
+
+    // memfd is sealed against shrinking, because daemon refuses to map it
+    // otherwise
+    const size_t len = slots * slot_len<N>();
+    const unsigned flags = MFD_CLOEXEC | MFD_ALLOW_SEALING;
+    const int memfd = memfd_create("falcon-sign", flags);
+    if (memfd < 0) {
+      return false;
+    }
+    if ((ftruncate(memfd, static_cast<off_t>(len)) != 0) ||
+        (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) != 0)) {
+      close(memfd);
+      return false;
+    }
+
+    void* const m =
+      mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (m == MAP_FAILED) {
+      close(memfd);
+      return false;
+    }
+
+    mem = static_cast<uint8_t*>(m);
+    slot_cnt = slots;
+
+    hello_t hello{ slots };
+    iovec iov{ &hello, sizeof(hello) };
+
+    alignas(cmsghdr) uint8_t ctrl[CMSG_SPACE(sizeof(int))]{};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(memfd));
+
+    const ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    close(memfd);
+
+    return n == static_cast<ssize_t>(sizeof(hello));
+  }
+
+  // Message buffer of given slot, of `MAX_MSG_LEN` -bytes, where message can
+  // be written in place, before submitting request
+  inline uint8_t* msg(const uint32_t slot)
+  {
+    return mem + slot * slot_len<N>();
+  }
+
+  // Signature buffer of given slot, which is written to by daemon, for sign
+  // requests, while it's read by daemon, for verify requests
+  inline uint8_t* sig(const uint32_t slot) { return msg(slot) + MAX_MSG_LEN; }
+
+  // Number of slots in shared memory region
+  inline size_t slots() const { return slot_cnt; }
+
+  // Submits request, whose payload is already in given slot, returning its
+  // identifier, which is echoed back in response, or returns false, if request
+  // can't be sent.
+  inline bool submit(const op_t op,
+                     const uint32_t key_id,
+                     const uint32_t slot,
+                     const uint32_t mlen,
+                     uint64_t& id)
+  {
+    request_t req{};
+    req.id = next_id++;
+    req.key_id = key_id;
+    req.slot = slot;
+    req.mlen = mlen;
+    req.op = op;
+
+    id = req.id;
+    return send(fd, &req, sizeof(req), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(sizeof(req));
+  }
+
+  // Blocks until next response arrives. Returns false, if daemon is gone.
+  inline bool receive(response_t& resp)
+  {
+    return recv(fd, &resp, sizeof(resp), 0) ==
+           static_cast<ssize_t>(sizeof(resp));
+  }
+
+  // Signs mlen -bytes message using daemon's key with given identifier, using
+  // first slot, writing compressed signature to `sig`. Returns false, if
+  // message can't be signed.
+  inline bool sign(const uint32_t key_id,
+                   const uint8_t* const __restrict msg_,
+                   const size_t mlen,
+                   uint8_t* const __restrict sig_)
+  {
+    if (mlen > MAX_MSG_LEN) {
+      return false;
+    }
+
+    std::memcpy(msg(0), msg_, mlen);
+
+    uint64_t id = 0;
+    response_t resp{};
+
+    const auto len = static_cast<uint32_t>(mlen);
+    if (!submit(op_t::sign, key_id, 0, len, id) || !receive(resp)) {
+      return false;
+    }
+    if ((resp.id != id) || (resp.ok == 0)) {
+      return false;
+    }
+
+    std::memcpy(sig_, sig(0), siglen);
+    return true;
+  }
+
+  // Verifies compressed signature of mlen -bytes message, using public key of
+  // daemon's key with given identifier, using first slot.
+  inline bool verify(const uint32_t key_id,
+                     const uint8_t* const __restrict msg_,
+                     const size_t mlen,
+                     const uint8_t* const __restrict sig_)
+  {
+    if (mlen > MAX_MSG_LEN) {
+      return false;
+    }
+
+    std::memcpy(msg(0), msg_, mlen);
+    std::memcpy(sig(0), sig_, siglen);
+
+    uint64_t id = 0;
+    response_t resp{};
+
+    const auto len = static_cast<uint32_t>(mlen);
+    if (!submit(op_t::verify, key_id, 0, len, id) || !receive(resp)) {
+      return false;
+    }
+
+    return (resp.id == id) && (resp.ok != 0);
+  }
+};
+
+#endif
+
+}
@@ -0,0 +1,479 @@
+#pragma once
+#include "falcon.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#if defined __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Multi-threaded Falcon{512, 1024} Signing Engine
+namespace sign_engine {
+
+// Bounded lock-free multi-producer multi-consumer queue, holding at max `CAP`
+// -many elements, following Dmitry Vyukov's design
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// Each cell carries a sequence number, which tells producers ( and consumers )
+// whether cell is ready to be written to ( or read from ), in current round, so
+// that producers and consumers only contend on their own index.
+template<typename T, const size_t CAP>
+  requires(std::has_single_bit(CAP))
+struct mpmc_queue_t
+{
+private:
+  struct alignas(64) cell_t
+  {
+    std::atomic<size_t> seq{ 0ul };
+    T data{};
+  };
+
+  alignas(64) std::atomic<size_t> enq{ 0ul }; // next cell to be written to
+  alignas(64) std::atomic<size_t> deq{ 0ul }; // next cell to be read from
+  std::unique_ptr<cell_t[]> cells = std::make_unique<cell_t[]>(CAP);
+
+public:
+  inline mpmc_queue_t()
+  {
+    for (size_t i = 0; i < CAP; i++) {
+      cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  mpmc_queue_t(const mpmc_queue_t&) = delete;
+  mpmc_queue_t& operator=(const mpmc_queue_t&) = delete;
+
+  // Attempts to push an element to queue, returning false if queue is full, in
+  // which case given element isn't moved from.
+  inline bool try_push(T&& v)
+  {
+    size_t pos = enq.load(std::memory_order_relaxed);
+
+    while (1) {
+      cell_t& cell = cells[pos & (CAP - 1)];
+      const size_t seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+      if (diff == 0) {
+        const auto mo = std::memory_order_relaxed;
+        if (enq.compare_exchange_weak(pos, pos + 1, mo)) {
+          cell.data = std::move(v);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enq.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Attempts to pop an element from queue, returning false if queue is empty.
+  inline bool try_pop(T& v)
+  {
+    size_t pos = deq.load(std::memory_order_relaxed);
+
+    while (1) {
+      cell_t& cell = cells[pos & (CAP - 1)];
+      const size_t seq = cell.seq.load(std::memory_order_acquire);
+      const auto diff =
+        static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+      if (diff == 0) {
+        const auto mo = std::memory_order_relaxed;
+        if (deq.compare_exchange_weak(pos, pos + 1, mo)) {
+          v = std::move(cell.data);
+          cell.seq.store(pos + CAP, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = deq.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+// Concurrent latency histogram, with log-linear buckets i.e. each power of 2
+// range of values is split into 16 equal width buckets, so that any recorded
+// value can be reported with relative error of at max 1/16 ( = 6.25% ), while
+// keeping a fixed number of buckets, covering whole 64 -bit range.
+struct histogram_t
+{
+private:
+  static constexpr size_t SUB_BITS = 4;
+  static constexpr size_t SUB_CNT = 1ul << SUB_BITS;
+  static constexpr size_t BUCKET_CNT = (64 - SUB_BITS + 1) * SUB_CNT;
+
+  std::array<std::atomic<uint64_t>, BUCKET_CNT> buckets{};
+
+  // Index of bucket, to which given value belongs
+  static inline constexpr size_t index(const uint64_t v)
+  {
+    if (v < SUB_CNT) {
+      return v;
+    }
+
+    const size_t msb = std::bit_width(v) - 1;
+    const size_t sub = (v >> (msb - SUB_BITS)) & (SUB_CNT - 1);
+    return (msb - SUB_BITS + 1) * SUB_CNT + sub;
+  }
+
+  // Largest value, which belongs to bucket at given index
+  static inline constexpr uint64_t upper_bound(const size_t idx)
+  {
+    if (idx < SUB_CNT) {
+      return idx;
+    }
+
+    const size_t msb = idx / SUB_CNT + SUB_BITS - 1;
+    const uint64_t sub = idx % SUB_CNT;
+    const uint64_t lo = (1ul << msb) | (sub << (msb - SUB_BITS));
+    return lo + ((1ul << (msb - SUB_BITS)) - 1);
+  }
+
+public:
+  // Records a value, can be called from many threads at once
+  inline void record(const uint64_t v)
+  {
+    buckets[index(v)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Number of recorded values
+  inline uint64_t count() const
+  {
+    uint64_t total = 0;
+    for (const auto& b : buckets) {
+      total += b.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // Returns ( upper bound of bucket holding ) p-th quantile of recorded values
+  // s.t. p ∈ [0, 1] e.g. 0.99 for p99. Returns 0, if nothing is recorded.
+  inline uint64_t percentile(const double p) const
+  {
+    const uint64_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+
+    const auto rank = static_cast<uint64_t>(std::ceil(p * total));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_CNT; i++) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if ((seen >= rank) && (seen > 0)) {
+        return upper_bound(i);
+      }
+    }
+
+    return upper_bound(BUCKET_CNT - 1);
+  }
+
+  // Forgets all recorded values
+  inline void reset()
+  {
+    for (auto& b : buckets) {
+      b.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+// Snapshot of signing engine counters, see `engine_t::stats`
+struct stats_t
+{
+  uint64_t submitted = 0; // # -of sign requests accepted
+  uint64_t completed = 0; // # -of signatures produced
+  double throughput = 0.; // signatures produced per second
+  uint64_t p50_ns = 0;     // median latency, in nanoseconds
+  uint64_t p99_ns = 0;     // 99th percentile latency, in nanoseconds
+  uint64_t p999_ns = 0;    // 99.9th percentile latency, in nanoseconds
+};
+
+// Falcon{512, 1024} signing engine, which holds expanded secret keys ( see
+// `falcon::expanded_key_t` ) and runs a fixed pool of worker threads, each
+// pinned to a core ( on Linux ) and owning its own ChaCha20 based PRNG and
+// signing scratch space, so that nothing is set up per signing request.
+//
+// Sign requests are accepted from any number of threads, through a bounded
+// lock-free MPMC queue, while completion is reported either using a future or
+// by invoking a callback, on worker thread. Idle workers park themselves, until
+// next request arrives.
+//
+// Latency of each request ( i.e. time from it being submitted to signature
+// being produced ) is recorded, so that p50/p99/p999 latency and throughput can
+// be queried, see `stats`.
+//
+// Note, message and signature buffers are borrowed i.e. caller must keep them
+// alive until request completes.
+template<const size_t N, const size_t QUEUE_CAP = 1ul << 12>
+  requires(((N == 512) || (N == 1024)) && std::has_single_bit(QUEUE_CAP))
+struct engine_t
+{
+public:
+  // Invoked on worker thread, once request completes, with true if signature
+  // was produced.
+  using callback_t = std::function<void(bool)>;
+
+private:
+  using sclock = std::chrono::steady_clock;
+
+  struct request_t
+  {
+    size_t key_id = 0;
+    const uint8_t* msg = nullptr;
+    size_t mlen = 0;
+    uint8_t* sig = nullptr;
+    std::optional<std::promise<bool>> promise; // only for future based request
+    callback_t callback;
+    sclock::time_point submitted_at;
+  };
+
+  struct alignas(64) worker_t
+  {
+    prng::chacha20_t rng;
+    std::unique_ptr<signing::workspace_t<N>> ws =
+      std::make_unique<signing::workspace_t<N>>();
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<falcon::expanded_key_t<N>>> keys;
+  std::mutex keys_lock;
+  alignas(64) std::atomic<size_t> key_cnt{ 0ul };
+
+  mpmc_queue_t<request_t, QUEUE_CAP> queue;
+  alignas(64) std::atomic<uint64_t> pushed{ 0ul }; // workers park on this
+  alignas(64) std::atomic<bool> stop{ false };
+
+  alignas(64) std::atomic<uint64_t> submitted{ 0ul };
+  alignas(64) std::atomic<uint64_t> completed{ 0ul };
+  histogram_t latency;
+  std::atomic<sclock::rep> started{ sclock::now().time_since_epoch().count() };
+
+  std::vector<std::unique_ptr<worker_t>> workers;
+
+  // Pins given thread to given core, best effort i.e. failure is ignored
+  static inline void pin(std::thread& thread, const size_t core)
+  {
+#if defined __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+  }
+
+  // Keeps serving sign requests, until engine is asked to stop and queue is
+  // drained.
+  inline void serve(worker_t& w)
+  {
+    request_t req;
+
+    while (1) {
+      const uint64_t seen = pushed.load(std::memory_order_acquire);
+
+      if (!queue.try_pop(req)) {
+        if (stop.load()) {
+          break;
+        }
+
+        pushed.wait(seen, std::memory_order_acquire);
+        continue;
+      }
+
+      keys[req.key_id]->sign(req.msg, req.mlen, req.sig, *w.ws, w.rng);
+
+      const auto lat = sclock::now() - req.submitted_at;
+      const auto ns = std::chrono::nanoseconds(lat).count();
+      latency.record(static_cast<uint64_t>(ns));
+      completed.fetch_add(1, std::memory_order_relaxed);
+
+      if (req.callback) {
+        req.callback(true);
+        req.callback = nullptr;
+      } else {
+        req.promise->set_value(true);
+        req.promise.reset();
+      }
+    }
+  }
+
+  // Pushes request to queue, yielding while queue is full, and wakes up a
+  // parked worker, if any.
+  inline void enqueue(request_t&& req)
+  {
+    req.submitted_at = sclock::now();
+    while (!queue.try_push(std::move(req))) {
+      std::this_thread::yield();
+    }
+
+    submitted.fetch_add(1, std::memory_order_relaxed);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+  }
+
+public:
+  // Starts `worker_cnt` -many worker threads ( defaults to # -of cores ),
+  // pinning i-th worker to i-th core, if asked to. At max `max_keys` -many
+  // secret keys can be added to engine.
+  inline explicit engine_t(const size_t worker_cnt = 0,
+                           const bool pin_workers = true,
+                           const size_t max_keys = 16)
+    : keys(max_keys)
+  {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t cnt = worker_cnt == 0 ? cores : worker_cnt;
+
+    workers.reserve(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+      auto w = std::make_unique<worker_t>();
+      w->thread = std::thread(&engine_t::serve, this, std::ref(*w));
+      if (pin_workers) {
+        pin(w->thread, i % cores);
+      }
+
+      workers.push_back(std::move(w));
+    }
+  }
+
+  engine_t(const engine_t&) = delete;
+  engine_t& operator=(const engine_t&) = delete;
+
+  // Lets workers finish all pending requests and waits for them to exit.
+  inline ~engine_t()
+  {
+    stop.store(true);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_all();
+
+    for (auto& w : workers) {
+      w->thread.join();
+    }
+  }
+
+  // Expands byte encoded secret key and adds it to engine, returning its
+  // identifier, using which sign requests are made. Returns false, if secret
+  // key can't be decoded or engine can't hold any more keys. Keys can be added
+  // while engine is serving requests.
+  inline bool add_key(const uint8_t* const __restrict skey, size_t& key_id)
+  {
+    std::lock_guard<std::mutex> guard(keys_lock);
+
+    const size_t cnt = key_cnt.load(std::memory_order_relaxed);
+    if (cnt == keys.size()) {
+      return false;
+    }
+
+    auto key = std::make_unique<falcon::expanded_key_t<N>>();
+    if (!key->expand(skey)) {
+      return false;
+    }
+
+    keys[cnt] = std::move(key);
+    key_cnt.store(cnt + 1, std::memory_order_release);
+
+    key_id = cnt;
+    return true;
+  }
+
+  // Submits a request for signing mlen -bytes message, using secret key with
+  // given identifier, writing compressed signature to `sig`. Returned future
+  // resolves to false, only if there's no such key.
+  inline std::future<bool> sign(const size_t key_id,
+                                const uint8_t* const msg,
+                                const size_t mlen,
+                                uint8_t* const sig)
+  {
+    request_t req;
+    req.key_id = key_id;
+    req.msg = msg;
+    req.mlen = mlen;
+    req.sig = sig;
+    auto fut = req.promise.emplace().get_future();
+
+    if (key_id >= key_cnt.load(std::memory_order_acquire)) [[unlikely]] {
+      req.promise->set_value(false);
+      return fut;
+    }
+
+    enqueue(std::move(req));
+    return fut;
+  }
+
+  // Same as above, but once signature is produced, given callback is invoked,
+  // on worker thread. Returns false, without invoking callback, only if
+  // there's no such key.
+  inline bool sign(const size_t key_id,
+                   const uint8_t* const msg,
+                   const size_t mlen,
+                   uint8_t* const sig,
+                   callback_t callback)
+  {
+    if (key_id >= key_cnt.load(std::memory_order_acquire)) [[unlikely]] {
+      return false;
+    }
+
+    request_t req;
+    req.key_id = key_id;
+    req.msg = msg;
+    req.mlen = mlen;
+    req.sig = sig;
+    req.callback = std::move(callback);
+
+    enqueue(std::move(req));
+    return true;
+  }
+
+  // Number of worker threads
+  inline size_t worker_count() const { return workers.size(); }
+
+  // Returns snapshot of counters, collected since engine was created or they
+  // were last reset.
+  inline stats_t stats() const
+  {
+    const auto now = sclock::now().time_since_epoch().count();
+    const auto elapsed = sclock::duration(now - started.load());
+    const double secs = std::chrono::duration<double>(elapsed).count();
+
+    stats_t s;
+    s.submitted = submitted.load(std::memory_order_relaxed);
+    s.completed = completed.load(std::memory_order_relaxed);
+    s.throughput = secs > 0. ? static_cast<double>(s.completed) / secs : 0.;
+    s.p50_ns = latency.percentile(.5);
+    s.p99_ns = latency.percentile(.99);
+    s.p999_ns = latency.percentile(.999);
+
+    return s;
+  }
+
+  // Resets counters, so that next snapshot only covers requests completed
+  // after this call.
+  inline void reset_stats()
+  {
+    submitted.store(0, std::memory_order_relaxed);
+    completed.store(0, std::memory_order_relaxed);
+    latency.reset();
+    started.store(sclock::now().time_since_epoch().count());
+  }
+};
+
+}
@@ -8,55 +8,81 @@
 #include "ntru_gen.hpp"
 #include "polynomial.hpp"
 #include "prng.hpp"
+#include <cassert>
 #include <cstring>
+#include <span>
 
 // Falcon{512, 1024} Signing related Routines
 namespace signing {
 
-// Given mlen -bytes message M, 2x2 matrix B ( in FFT format, holding Falcon
-// secret key ) s.t. B = [[g, -f], [G, -F]] and falcon tree T ( in FFT format ),
-// this routine attempts to sign message M, while sampling 40 -bytes random
-// salt, from system randomness.
-//
-// Signature byte layout looks like:
-//
-// <1 -byte header> +
-// <40 -bytes salt> +
-// <remaining bytes holding compressed signature>
+// Byte length of random salt, which is hashed along with message, see table 3.3
+// of falcon specification
+constexpr size_t SALT_LEN = 40;
+
+// Scratch space required by `sign_hashed`, for signing with Falcon{512, 1024}.
+// It's kept together, so that it can be allocated once and reused across many
+// signing calls, instead of putting it on stack, for each call.
+template<const size_t N>
+struct workspace_t
+{
+  fft::cmplx c_fft[N];
+  fft::cmplx t0[N];
+  fft::cmplx t1[N];
+  fft::cmplx z0[N];
+  fft::cmplx z1[N];
+  fft::cmplx tz0[N];
+  fft::cmplx tz1[N];
+  fft::cmplx s0[N];
+  fft::cmplx s1[N];
+  fft::cmplx tmp[N];
+  int32_t s2[N];
+  alignas(fft::cmplx) uint8_t ffs[ffsampling::ff_sampling_ws_len<N>()];
+};
+
+// Given 40 -bytes salt and degree N polynomial c over Z_q ( obtained by hashing
+// salt and message M, using `hashing::hash_to_point` ), 2x2 matrix B ( in FFT
+// format, holding Falcon secret key ) s.t. B = [[g, -f], [G, -F]], falcon tree
+// T ( in FFT format ) and SamplerZ constants for each leaf of T ( see
+// `ffsampling::precompute_leaves` ), this routine computes a short vector (s1,
+// s2) s.t. s1 + s2 * h = c, and writes compressed signature to `sig`.
 //
-// This routine is an implementation of algorithm 10 of falcon specification
-// https://falcon-sign.info/falcon.pdf s.t. it takes secret key ( as 2x2 matrix
-// B ) and precomputed falcon tree as input.
-template<const size_t N, const int32_t β2, const size_t slen>
+// This routine implements line 3 onwards of algorithm 10 of falcon
+// specification https://falcon-sign.info/falcon.pdf, so that hashing of
+// message can be done by caller e.g. for many messages at once. All scratch
+// space is taken from caller supplied workspace `ws`.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
 static inline void
-sign(const fft::cmplx* const __restrict B,
-     const fft::cmplx* const __restrict T,
-     const uint8_t* const __restrict msg,
-     const size_t mlen,
-     uint8_t* const __restrict sig,
-     const double σ_min, // see table 3.3 of falcon specification
-     prng::prng_t& rng)
+sign_hashed(const fft::cmplx* const __restrict B,
+            const fft::cmplx* const __restrict T,
+            const samplerz::leaf_t* const __restrict L,
+            const uint8_t* const __restrict salt,
+            const ff::ff_t* const __restrict c,
+            uint8_t* const __restrict sig,
+            workspace_t<N>& ws,
+            RNG& rng)
   requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
            ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
 {
   constexpr uint8_t header = 0x30 | static_cast<uint8_t>(log2<N>());
   constexpr double β2_ = static_cast<double>(β2);
 
-  uint8_t salt[40];
-  rng.read(salt, sizeof(salt));
+  auto c_fft = ws.c_fft;
+  auto t0 = ws.t0;
+  auto t1 = ws.t1;
+  auto z0 = ws.z0;
+  auto z1 = ws.z1;
+  auto tz0 = ws.tz0;
+  auto tz1 = ws.tz1;
+  auto s0 = ws.s0;
+  auto s1 = ws.s1;
+  auto s2 = ws.s2;
+  auto tmp = ws.tmp;
 
-  ff::ff_t c[N];
-  hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
-
-  fft::cmplx c_fft[N];
   for (size_t i = 0; i < N; i++) {
     c_fft[i] = fft::cmplx{ static_cast<double>(c[i].v) };
   }
   fft::fft<log2<N>()>(c_fft);
 
-  fft::cmplx t0[N];
-  fft::cmplx t1[N];
-
   polynomial::mul<log2<N>()>(c_fft, B + 3 * N, t0);
   polynomial::mul<log2<N>()>(c_fft, B + N, t1);
 
@@ -66,18 +92,10 @@ sign(const fft::cmplx* const __restrict B,
     t1[i] = -(t1[i] / q);
   }
 
-  fft::cmplx z0[N];
-  fft::cmplx z1[N];
-  fft::cmplx tz0[N];
-  fft::cmplx tz1[N];
-  fft::cmplx s0[N];
-  fft::cmplx s1[N];
-  int32_t s2[N];
-  fft::cmplx tmp[N];
-
   while (1) {
     // ffSampling i.e. compute z = (z0, z1), same as line 6 of algo 10
-    ffsampling::ff_sampling<N, 0, log2<N>()>(t0, t1, T, σ_min, z0, z1, rng);
+    ffsampling::ff_sampling_ws<N, 0, log2<N>()>(
+      t0, t1, T, L, z0, z1, ws.ffs, rng);
 
     // compute tz = (tz0, tz1) = (t0 - z0, t1 - z1)
     polynomial::sub<log2<N>()>(t0, z0, tz0);
@@ -114,7 +132,233 @@ sign(const fft::cmplx* const __restrict B,
   }
 
   sig[0] = header;
-  std::memcpy(sig + 1, salt, sizeof(salt));
+  std::memcpy(sig + 1, salt, SALT_LEN);
+}
+
+// Same as above, but scratch space is allocated on stack.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign_hashed(const fft::cmplx* const __restrict B,
+            const fft::cmplx* const __restrict T,
+            const samplerz::leaf_t* const __restrict L,
+            const uint8_t* const __restrict salt,
+            const ff::ff_t* const __restrict c,
+            uint8_t* const __restrict sig,
+            RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  workspace_t<N> ws;
+  sign_hashed<N, β2, slen>(B, T, L, salt, c, sig, ws, rng);
+}
+
+// Same as above, but SamplerZ constants for leaves of falcon tree T are
+// computed from σ_min, before signing.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign_hashed(const fft::cmplx* const __restrict B,
+            const fft::cmplx* const __restrict T,
+            const uint8_t* const __restrict salt,
+            const ff::ff_t* const __restrict c,
+            uint8_t* const __restrict sig,
+            const double σ_min, // see table 3.3 of falcon specification
+            RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  samplerz::leaf_t L[N];
+  ffsampling::precompute_leaves<N, 0, log2<N>()>(T, σ_min, L);
+
+  sign_hashed<N, β2, slen>(B, T, L, salt, c, sig, rng);
+}
+
+// Given mlen -bytes message M, 2x2 matrix B ( in FFT format, holding Falcon
+// secret key ) s.t. B = [[g, -f], [G, -F]] and falcon tree T ( in FFT format ),
+// this routine attempts to sign message M, while sampling 40 -bytes random
+// salt, from system randomness.
+//
+// Signature byte layout looks like:
+//
+// <1 -byte header> +
+// <40 -bytes salt> +
+// <remaining bytes holding compressed signature>
+//
+// This routine is an implementation of algorithm 10 of falcon specification
+// https://falcon-sign.info/falcon.pdf s.t. it takes secret key ( as 2x2 matrix
+// B ) and precomputed falcon tree as input.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign(const fft::cmplx* const __restrict B,
+     const fft::cmplx* const __restrict T,
+     const uint8_t* const __restrict msg,
+     const size_t mlen,
+     uint8_t* const __restrict sig,
+     const double σ_min, // see table 3.3 of falcon specification
+     RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  uint8_t salt[SALT_LEN];
+  rng.read(salt, sizeof(salt));
+
+  ff::ff_t c[N];
+  hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
+
+  sign_hashed<N, β2, slen>(B, T, salt, c, sig, σ_min, rng);
+}
+
+// Same as `sign` above, but SamplerZ constants for leaves of falcon tree T (
+// see `ffsampling::precompute_leaves` ) are supplied by caller, along with
+// workspace, so that nothing, which can be reused across many signing calls, is
+// computed or allocated per call.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign(const fft::cmplx* const __restrict B,
+     const fft::cmplx* const __restrict T,
+     const samplerz::leaf_t* const __restrict L,
+     const uint8_t* const __restrict msg,
+     const size_t mlen,
+     uint8_t* const __restrict sig,
+     workspace_t<N>& ws,
+     RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  uint8_t salt[SALT_LEN];
+  rng.read(salt, sizeof(salt));
+
+  ff::ff_t c[N];
+  hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
+
+  sign_hashed<N, β2, slen>(B, T, L, salt, c, sig, ws, rng);
+}
+
+// Compile-time compute byte length of scratch space, required by `sign_ws`,
+// for signing with Falcon{512, 1024}. It holds signing workspace ( see
+// `workspace_t` ) and SamplerZ constants for each leaf of falcon tree.
+template<const size_t N>
+static inline constexpr size_t
+sign_ws_len()
+  requires((N == 512) || (N == 1024))
+{
+  return sizeof(workspace_t<N>) + sizeof(samplerz::leaf_t) * N;
+}
+
+// Same as `sign` above, but all scratch space, including SamplerZ constants for
+// leaves of falcon tree T, is taken from caller supplied workspace `ws`, which
+// must be of at least `sign_ws_len<N>()` -bytes and aligned to
+// `alignof(fft::cmplx)` -bytes. Only a few KB of stack is used, so that
+// it can be called from a thread ( or fiber ) with a small stack e.g. 64 KB.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign_ws(const fft::cmplx* const __restrict B,
+        const fft::cmplx* const __restrict T,
+        const uint8_t* const __restrict msg,
+        const size_t mlen,
+        uint8_t* const __restrict sig,
+        const double σ_min, // see table 3.3 of falcon specification
+        std::span<uint8_t> ws,
+        RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  assert(fft::is_valid_ws(ws, sign_ws_len<N>()));
+
+  auto ws_ptr = ws.data();
+  auto& ws_ = *reinterpret_cast<workspace_t<N>*>(ws_ptr);
+  auto L = reinterpret_cast<samplerz::leaf_t*>(ws_ptr + sizeof(workspace_t<N>));
+
+  ffsampling::precompute_leaves<N, 0, log2<N>()>(T, σ_min, L);
+  sign<N, β2, slen>(B, T, L, msg, mlen, sig, ws_, rng);
+}
+
+// Same as `sign` above, but instead of taking message as a contiguous byte
+// array, it takes a reader ( see `hashing::reader` ), which produces message
+// bytes in chunks, so that arbitrarily large messages can be signed using
+// bounded memory. Returns false, leaving signature zeroed, if reader reports
+// an error.
+template<const size_t N,
+         const int32_t β2,
+         const size_t slen,
+         hashing::reader Reader,
+         prng::rng RNG>
+static inline bool
+sign_stream(const fft::cmplx* const __restrict B,
+            const fft::cmplx* const __restrict T,
+            Reader& read,
+            uint8_t* const __restrict sig,
+            const double σ_min, // see table 3.3 of falcon specification
+            RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  uint8_t salt[SALT_LEN];
+  rng.read(salt, sizeof(salt));
+
+  ff::ff_t c[N];
+  if (!hashing::hash_to_point_stream<N>(salt, sizeof(salt), read, c)) {
+    std::memset(sig, 0, slen);
+    return false;
+  }
+
+  sign_hashed<N, β2, slen>(B, T, salt, c, sig, σ_min, rng);
+  return true;
+}
+
+// Given 4 -many messages s.t. i-th message is of `mlens[i]` -bytes, this
+// routine signs all of them using same secret key ( i.e. 2x2 matrix B and
+// falcon tree T ), writing i-th signature to `sigs[i]`. Salts for all four
+// messages are sampled first, so that messages can be hashed together, using
+// `hashing::hash_to_point_x4`, before signing them one after another, using
+// caller supplied SamplerZ constants for leaves of T and workspace.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign_x4(const fft::cmplx* const __restrict B,
+        const fft::cmplx* const __restrict T,
+        const samplerz::leaf_t* const __restrict L,
+        const uint8_t* const* const __restrict msgs,
+        const size_t* const __restrict mlens,
+        uint8_t* const* const __restrict sigs,
+        workspace_t<N>& ws,
+        RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  uint8_t salt[4][SALT_LEN];
+  ff::ff_t c[4][N];
+
+  for (size_t i = 0; i < 4; i++) {
+    rng.read(salt[i], sizeof(salt[i]));
+  }
+
+  const uint8_t* const salts[]{ salt[0], salt[1], salt[2], salt[3] };
+  ff::ff_t* const polys[]{ c[0], c[1], c[2], c[3] };
+  hashing::hash_to_point_x4<N>(salts, SALT_LEN, msgs, mlens, polys);
+
+  for (size_t i = 0; i < 4; i++) {
+    sign_hashed<N, β2, slen>(B, T, L, salt[i], c[i], sigs[i], ws, rng);
+  }
+}
+
+// Same as above, but SamplerZ constants for leaves of T are computed only once,
+// from σ_min, while workspace is allocated on stack.
+template<const size_t N, const int32_t β2, const size_t slen, prng::rng RNG>
+static inline void
+sign_x4(const fft::cmplx* const __restrict B,
+        const fft::cmplx* const __restrict T,
+        const uint8_t* const* const __restrict msgs,
+        const size_t* const __restrict mlens,
+        uint8_t* const* const __restrict sigs,
+        const double σ_min, // see table 3.3 of falcon specification
+        RNG& rng)
+  requires(((N == 512) && (β2 == 34034726) && (slen == 666)) ||
+           ((N == 1024) && (β2 == 70265242) && (slen == 1280)))
+{
+  samplerz::leaf_t L[N];
+  ffsampling::precompute_leaves<N, 0, log2<N>()>(T, σ_min, L);
+
+  workspace_t<N> ws;
+  sign_x4<N, β2, slen>(B, T, L, msgs, mlens, sigs, ws, rng);
 }
 
 }
@@ -48,4 +48,30 @@ compute_sig_len()
   }
 }
 
+// Overwrites `len` -bytes, starting at `ptr`, with zeros, such that compiler
+// can't elide it, even if memory is never read again. Meant for wiping secret
+// key material, before memory is released or reused.
+static inline void
+secure_wipe(void* const ptr, const size_t len)
+{
+  volatile uint8_t* const bytes = static_cast<volatile uint8_t*>(ptr);
+  for (size_t i = 0; i < len; i++) {
+    bytes[i] = 0;
+  }
+}
+
+// Compares two byte arrays, each of length `len`, returning truth value, while
+// taking same time, irrespective of position of first mismatching byte.
+static inline bool
+ct_equal(const uint8_t* const __restrict a,
+         const uint8_t* const __restrict b,
+         const size_t len)
+{
+  uint8_t diff = 0;
+  for (size_t i = 0; i < len; i++) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
+
 }
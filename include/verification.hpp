@@ -8,43 +8,31 @@
 // Falcon{512, 1024} Signature Verification related Routines
 namespace verification {
 
-// Given mlen -bytes message, {666, 1280} -bytes signature ( encapsulating
-// polynomial s2 ) and Falcon{512, 1024} public key as degree N polynomial over
-// Z_q ( i.e. h ), this routine checks whether s1 + s2*h = c ( mod q ) equation
-// holds or not, by computing s1, using arithmetic over Z_q[x]/(x^N + 1) and
-// trying to assert if squared norm of vector of polynomials (s1, s2) is within
-// expected bound β2.
-//
-// This routine returns boolean truth value in case of successful signature
-// verification, otherwise it returns false.
+// Given Falcon{512, 1024} public key as degree N polynomial over Z_q ( i.e.
+// h ), polynomial c over Z_q ( obtained by hashing salt and message, using
+// `hashing::hash_to_point` ) and polynomial s2 ( decoded from signature ), this
+// routine checks whether s1 + s2*h = c ( mod q ) equation holds or not, by
+// computing s1, using arithmetic over Z_q[x]/(x^N + 1) and trying to assert if
+// squared norm of vector of polynomials (s1, s2) is within expected bound β2.
 template<const size_t N, const int32_t β2>
 static inline bool
-verify(const ff::ff_t* const __restrict h,
-       const uint8_t* const __restrict msg,
-       const size_t mlen,
-       const uint8_t* const __restrict sig)
+verify_hashed(const ff::ff_t* const __restrict h,
+              const ff::ff_t* const __restrict c,
+              const int32_t* const __restrict s2)
   requires((N == 512) || (N == 1024))
 {
-  uint8_t salt[40];
-  int32_t s2[N];
-
-  const size_t decoded = decoding::decode_sig<N>(sig, salt, s2);
-  if (!decoded) [[unlikely]] {
-    return decoded;
-  }
-
   ff::ff_t s2_ntt[N];
   for (size_t i = 0; i < N; i++) {
     s2_ntt[i].v = static_cast<uint16_t>((s2[i] < 0) * ff::Q + s2[i]);
   }
 
-  ff::ff_t c[N];
-  hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
+  ff::ff_t c_[N];
+  std::memcpy(c_, c, sizeof(c_));
 
   ff::ff_t h_[N];
   std::memcpy(h_, h, sizeof(h_));
 
-  ntt::ntt<log2<N>()>(c);
+  ntt::ntt<log2<N>()>(c_);
   ntt::ntt<log2<N>()>(s2_ntt);
   ntt::ntt<log2<N>()>(h_);
 
@@ -52,7 +40,7 @@ verify(const ff::ff_t* const __restrict h,
 
   polynomial::mul<log2<N>()>(s2_ntt, h_, s1); // s1 <- s2 * h ( mod q ) [NTT]
   polynomial::neg<log2<N>()>(s1);             // s1 <- -s1 ( mod q ) [NTT]
-  polynomial::add_to<log2<N>()>(s1, c);       // s1 <- s1 + c ( mod q ) [NTT]
+  polynomial::add_to<log2<N>()>(s1, c_);      // s1 <- s1 + c ( mod q ) [NTT]
 
   ntt::intt<log2<N>()>(s1); // s1 <- c - s2*h ( mod q ) [Coeff]
 
@@ -67,16 +55,112 @@ verify(const ff::ff_t* const __restrict h,
     normalized_s1[i] = t0 - t1;
   }
 
-  int32_t sqrd_norm = 0;
+  // accumulated in 64 -bit, because squared norm of (s1, s2), for a forged
+  // signature, can be as large as 2 * N * (q / 2)^2, which overflows int32_t
+  int64_t sqrd_norm = 0;
 
   for (size_t i = 0; i < N; i++) {
-    sqrd_norm += s2[i] * s2[i];
+    sqrd_norm += static_cast<int64_t>(s2[i]) * s2[i];
   }
   for (size_t i = 0; i < N; i++) {
-    sqrd_norm += normalized_s1[i] * normalized_s1[i];
+    sqrd_norm += static_cast<int64_t>(normalized_s1[i]) * normalized_s1[i];
   }
 
   return sqrd_norm <= β2;
 }
 
+// Given mlen -bytes message, {666, 1280} -bytes signature ( encapsulating
+// polynomial s2 ) and Falcon{512, 1024} public key as degree N polynomial over
+// Z_q ( i.e. h ), this routine checks whether s1 + s2*h = c ( mod q ) equation
+// holds or not, by computing s1, using arithmetic over Z_q[x]/(x^N + 1) and
+// trying to assert if squared norm of vector of polynomials (s1, s2) is within
+// expected bound β2.
+//
+// This routine returns boolean truth value in case of successful signature
+// verification, otherwise it returns false.
+template<const size_t N, const int32_t β2>
+static inline bool
+verify(const ff::ff_t* const __restrict h,
+       const uint8_t* const __restrict msg,
+       const size_t mlen,
+       const uint8_t* const __restrict sig)
+  requires((N == 512) || (N == 1024))
+{
+  uint8_t salt[40];
+  int32_t s2[N];
+
+  const size_t decoded = decoding::decode_sig<N>(sig, salt, s2);
+  if (!decoded) [[unlikely]] {
+    return decoded;
+  }
+
+  ff::ff_t c[N];
+  hashing::hash_to_point<N>(salt, sizeof(salt), msg, mlen, c);
+
+  return verify_hashed<N, β2>(h, c, s2);
+}
+
+// Same as `verify` above, but instead of taking message as a contiguous byte
+// array, it takes a reader ( see `hashing::reader` ), which produces message
+// bytes in chunks, so that arbitrarily large messages can be verified using
+// bounded memory. Signature is decoded before reading any message byte, so
+// that reader is not consumed at all, if signature is malformed. Returns false,
+// if reader reports an error.
+template<const size_t N, const int32_t β2, hashing::reader Reader>
+static inline bool
+verify_stream(const ff::ff_t* const __restrict h,
+              Reader& read,
+              const uint8_t* const __restrict sig)
+  requires((N == 512) || (N == 1024))
+{
+  uint8_t salt[40];
+  int32_t s2[N];
+
+  const size_t decoded = decoding::decode_sig<N>(sig, salt, s2);
+  if (!decoded) [[unlikely]] {
+    return decoded;
+  }
+
+  ff::ff_t c[N];
+  if (!hashing::hash_to_point_stream<N>(salt, sizeof(salt), read, c)) {
+    return false;
+  }
+
+  return verify_hashed<N, β2>(h, c, s2);
+}
+
+// Given 4 -many ( public key, message, signature ) triplets s.t. i-th public
+// key is degree N polynomial `hs[i]` over Z_q and i-th message is of `mlens[i]`
+// -bytes, this routine verifies all four signatures, writing i-th verification
+// result to `res[i]`. Signatures are decoded first, so that all four messages
+// can be hashed together, using `hashing::hash_to_point_x4`.
+//
+// Note, same public key can be used for verifying all four signatures.
+template<const size_t N, const int32_t β2>
+static inline void
+verify_x4(const ff::ff_t* const* const __restrict hs,
+          const uint8_t* const* const __restrict msgs,
+          const size_t* const __restrict mlens,
+          const uint8_t* const* const __restrict sigs,
+          bool* const __restrict res)
+  requires((N == 512) || (N == 1024))
+{
+  uint8_t salt[4][40]{};
+  int32_t s2[4][N];
+  ff::ff_t c[4][N];
+  bool decoded[4];
+
+  for (size_t i = 0; i < 4; i++) {
+    decoded[i] = decoding::decode_sig<N>(sigs[i], salt[i], s2[i]);
+  }
+
+  const uint8_t* const salts[]{ salt[0], salt[1], salt[2], salt[3] };
+  ff::ff_t* const polys[]{ c[0], c[1], c[2], c[3] };
+  hashing::hash_to_point_x4<N>(salts, sizeof(salt[0]), msgs, mlens, polys);
+
+  for (size_t i = 0; i < 4; i++) {
+    res[i] = decoded[i] && verify_hashed<N, β2>(hs[i], c[i], s2[i]);
+  }
+}
+
 }
@@ -0,0 +1,330 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool
+namespace work_stealing {
+
+// Cancellation token of one of many speculative attempts, which are numbered
+// in order of being started, s.t. `seq` -th attempt is cancelled as soon as an
+// attempt with lower sequence number succeeds i.e. `best` ( lowest sequence
+// number of a successful attempt, so far ) drops below `seq`. Default
+// constructed token is never cancelled.
+struct cancel_t
+{
+  const std::atomic<uint64_t>* best = nullptr;
+  uint64_t seq = 0;
+
+  inline bool operator()() const
+  {
+    return (best != nullptr) && (best->load(std::memory_order_relaxed) < seq);
+  }
+};
+
+// Fixed size pool of worker threads, where each worker owns a double-ended
+// queue of jobs. A worker takes jobs from back of its own queue ( i.e. most
+// recently submitted one first, which suits nested jobs ), while it steals from
+// front of other workers' queues, once its own queue is empty, so that load is
+// balanced, even when jobs take widely varying time e.g. key generation, where
+// NTRUGen keeps retrying till it finds a solution.
+//
+// Jobs submitted from a worker go to its own queue, while ones submitted from
+// outside are spread across queues, in round-robin manner. Idle workers park
+// themselves, until next job arrives.
+struct pool_t
+{
+public:
+  using job_t = std::function<void()>;
+
+  // Returned by `worker_index`, when calling thread isn't a worker of pool
+  static constexpr size_t NOT_A_WORKER = std::numeric_limits<size_t>::max();
+
+private:
+  struct alignas(64) queue_t
+  {
+    std::mutex lock;
+    std::deque<job_t> jobs;
+  };
+
+  std::vector<std::unique_ptr<queue_t>> queues;
+  std::vector<std::thread> workers;
+
+  alignas(64) std::atomic<uint64_t> pushed{ 0ul }; // workers park on this
+  alignas(64) std::atomic<size_t> next{ 0ul };     // round-robin submission
+  std::atomic<bool> stop{ false };
+
+  // Pool, to which calling thread belongs, along with its index in that pool
+  struct self_t
+  {
+    const pool_t* pool = nullptr;
+    size_t idx = NOT_A_WORKER;
+  };
+
+  static inline self_t& self()
+  {
+    thread_local self_t s;
+    return s;
+  }
+
+  // Takes a job from back of i-th worker's own queue
+  inline bool pop(const size_t i, job_t& job)
+  {
+    std::lock_guard<std::mutex> guard(queues[i]->lock);
+    auto& jobs = queues[i]->jobs;
+
+    if (jobs.empty()) {
+      return false;
+    }
+
+    job = std::move(jobs.back());
+    jobs.pop_back();
+    return true;
+  }
+
+  // Steals a job from front of some other worker's queue, starting with the
+  // one next to i-th worker
+  inline bool steal(const size_t i, job_t& job)
+  {
+    const size_t cnt = queues.size();
+
+    for (size_t k = 1; k < cnt; k++) {
+      const size_t victim = (i + k) % cnt;
+
+      std::lock_guard<std::mutex> guard(queues[victim]->lock);
+      auto& jobs = queues[victim]->jobs;
+
+      if (!jobs.empty()) {
+        job = std::move(jobs.front());
+        jobs.pop_front();
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Takes a job, first from i-th worker's own queue, then from others'
+  inline bool take(const size_t i, job_t& job)
+  {
+    return pop(i, job) || steal(i, job);
+  }
+
+  // Waits till `remaining` -many submitted jobs complete. When called from a
+  // worker, calling worker keeps running jobs, while it waits, so that pool
+  // never runs out of workers.
+  inline void join(const std::atomic<size_t>& remaining)
+  {
+    const size_t idx = worker_index();
+    if (idx != NOT_A_WORKER) {
+      job_t job;
+
+      while (remaining.load(std::memory_order_acquire) != 0) {
+        if (take(idx, job)) {
+          job();
+          job = nullptr;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    for (size_t n = remaining.load(); n != 0; n = remaining.load()) {
+      remaining.wait(n);
+    }
+  }
+
+  // Keeps running jobs, until pool is asked to stop and all queues are drained
+  inline void serve(const size_t i)
+  {
+    self() = self_t{ this, i };
+    job_t job;
+
+    while (1) {
+      const uint64_t seen = pushed.load(std::memory_order_acquire);
+
+      if (!take(i, job)) {
+        if (stop.load()) {
+          break;
+        }
+
+        pushed.wait(seen, std::memory_order_acquire);
+        continue;
+      }
+
+      job();
+      job = nullptr;
+    }
+  }
+
+public:
+  // Starts `worker_cnt` -many worker threads ( defaults to # -of cores )
+  inline explicit pool_t(const size_t worker_cnt = 0)
+  {
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t cnt = worker_cnt == 0 ? cores : worker_cnt;
+
+    for (size_t i = 0; i < cnt; i++) {
+      queues.push_back(std::make_unique<queue_t>());
+    }
+
+    workers.reserve(cnt);
+    for (size_t i = 0; i < cnt; i++) {
+      workers.emplace_back(&pool_t::serve, this, i);
+    }
+  }
+
+  pool_t(const pool_t&) = delete;
+  pool_t& operator=(const pool_t&) = delete;
+
+  // Lets workers finish all pending jobs and waits for them to exit.
+  inline ~pool_t()
+  {
+    stop.store(true);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_all();
+
+    for (auto& w : workers) {
+      w.join();
+    }
+  }
+
+  // Number of worker threads
+  inline size_t size() const { return workers.size(); }
+
+  // Index of calling thread, among workers of this pool, which can be used for
+  // accessing per-worker state. Returns `NOT_A_WORKER`, if calling thread
+  // isn't a worker of this pool.
+  inline size_t worker_index() const
+  {
+    const auto& s = self();
+    return s.pool == this ? s.idx : NOT_A_WORKER;
+  }
+
+  // Submits a job, which is pushed to back of calling worker's own queue or
+  // some worker's queue, when called from outside of pool.
+  inline void submit(job_t&& job)
+  {
+    size_t i = worker_index();
+    if (i == NOT_A_WORKER) {
+      i = next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(queues[i]->lock);
+      queues[i]->jobs.push_back(std::move(job));
+    }
+
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+  }
+
+  // Runs fn(i) for each i ∈ [0, cnt), on workers of pool, returning only after
+  // all of them complete. When called from a worker ( i.e. nested parallelism
+  // ), calling worker keeps running jobs, while it waits, so that pool never
+  // runs out of workers.
+  //
+  // Counter of pending jobs is shared with jobs, as last job notifies waiter
+  // after decrementing it i.e. waiter may have returned by then.
+  template<typename F>
+  inline void parallel_for(const size_t cnt, F&& fn)
+  {
+    const auto remaining = std::make_shared<std::atomic<size_t>>(cnt);
+
+    for (size_t i = 0; i < cnt; i++) {
+      submit([&fn, remaining, i]() {
+        fn(i);
+        if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          remaining->notify_all();
+        }
+      });
+    }
+
+    join(*remaining);
+  }
+
+  // Runs f0() and f1() in parallel, returning only after both of them
+  // complete, s.t. f1 is submitted to pool, while f0 runs on calling thread.
+  // Same as `parallel_for`, calling worker keeps running jobs, while it waits
+  // for f1 to complete.
+  template<typename F0, typename F1>
+  inline void fork_join(F0&& f0, F1&& f1)
+  {
+    const auto remaining = std::make_shared<std::atomic<size_t>>(1ul);
+
+    submit([&f1, remaining]() {
+      f1();
+      remaining->store(0ul, std::memory_order_release);
+      remaining->notify_all();
+    });
+
+    f0();
+    join(*remaining);
+  }
+};
+
+// Pool, on which `fork_join` runs independent branches of computation, being
+// performed by calling thread, in parallel. It's null, unless calling thread
+// is inside a `fork_join_scope_t`.
+inline pool_t*&
+fork_join_pool()
+{
+  static thread_local pool_t* p = nullptr;
+  return p;
+}
+
+// Enables fork-join execution mode for calling thread, on given pool, for
+// lifetime of this object, so that routines, which split their work into two
+// independent branches, using `fork_join` ( e.g. NTRUSolve and ffLDL* at
+// upper levels of recursion ), run those branches in parallel. Nested scopes
+// are allowed.
+struct fork_join_scope_t
+{
+private:
+  pool_t* prev = nullptr;
+
+public:
+  inline explicit fork_join_scope_t(pool_t& pool)
+  {
+    prev = fork_join_pool();
+    fork_join_pool() = &pool;
+  }
+
+  inline ~fork_join_scope_t() { fork_join_pool() = prev; }
+
+  fork_join_scope_t(const fork_join_scope_t&) = delete;
+  fork_join_scope_t& operator=(const fork_join_scope_t&) = delete;
+};
+
+// Runs f0() and f1(), which must be independent of each other, in parallel, on
+// pool of calling thread's fork-join scope ( see `fork_join_scope_t` ), while
+// f1 runs inside same scope, so that it can fork further. Without any scope,
+// those are run one after another, on calling thread.
+template<typename F0, typename F1>
+inline void
+fork_join(F0&& f0, F1&& f1)
+{
+  pool_t* const pool = fork_join_pool();
+  if (pool == nullptr) {
+    f0();
+    f1();
+    return;
+  }
+
+  pool->fork_join(f0, [pool, &f1]() {
+    fork_join_scope_t scope(*pool);
+    f1();
+  });
+}
+
+}
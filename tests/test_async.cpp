@@ -0,0 +1,129 @@
+#include "async.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#if defined __linux__
+
+// Coroutine, which moves itself onto executor's event loop, asynchronously
+// signs a message, verifies it and a tampered copy of it, while checking that
+// it's always resumed on event loop thread.
+template<const size_t N>
+static async::task_t
+sign_verify(async::executor_t& exec,
+            const falcon::expanded_key_t<N>& key,
+            const uint8_t* const pkey,
+            std::vector<uint8_t>& msg,
+            std::vector<uint8_t>& sig,
+            const std::thread::id loop_id,
+            std::vector<uint8_t>& results,
+            const size_t idx,
+            std::atomic<size_t>& pending)
+{
+  co_await exec.schedule();
+  bool on_loop = std::this_thread::get_id() == loop_id;
+
+  const bool _signed =
+    co_await falcon::async_sign<N>(key, msg.data(), msg.size(), sig.data());
+  on_loop &= std::this_thread::get_id() == loop_id;
+
+  const bool _verified = co_await falcon::async_verify<N>(
+    pkey, msg.data(), msg.size(), sig.data());
+  on_loop &= std::this_thread::get_id() == loop_id;
+
+  msg[0] ^= 1;
+  const bool _tampered = co_await falcon::async_verify<N>(
+    pkey, msg.data(), msg.size(), sig.data());
+  on_loop &= std::this_thread::get_id() == loop_id;
+
+  results[idx] = on_loop && _signed && _verified && !_tampered;
+
+  if (pending.fetch_sub(1) == 1) {
+    exec.stop();
+  }
+}
+
+// Generates random Falcon{512, 1024} keypair and runs many coroutines on an
+// epoll based executor, which concurrently sign and verify random messages, by
+// offloading work to a worker pool, s.t. all signatures must verify, while
+// coroutines must always be resumed on event loop thread.
+template<const size_t N>
+void
+test_async_sign_verify()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t task_cnt = 8;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  falcon::keygen<N>(pkey.data(), skey.data());
+
+  falcon::expanded_key_t<N> key;
+  EXPECT_TRUE(key.expand(skey.data()));
+
+  using bytes_t = std::vector<uint8_t>;
+
+  std::vector<bytes_t> msgs(task_cnt, bytes_t(mlen));
+  std::vector<bytes_t> sigs(task_cnt, bytes_t(siglen));
+  std::vector<uint8_t> results(task_cnt, 0);
+  std::atomic<size_t> pending{ task_cnt };
+
+  prng::prng_t rng;
+  for (auto& msg : msgs) {
+    rng.read(msg.data(), msg.size());
+  }
+
+  async::executor_t exec;
+  std::thread loop([&]() { exec.run(); });
+  const auto loop_id = loop.get_id();
+
+  for (size_t i = 0; i < task_cnt; i++) {
+    const auto pk = pkey.data();
+    sign_verify<N>(
+      exec, key, pk, msgs[i], sigs[i], loop_id, results, i, pending);
+  }
+
+  loop.join();
+
+  for (const auto r : results) {
+    EXPECT_TRUE(r);
+  }
+}
+
+TEST(Falcon, AsyncSignVerify)
+{
+  test_async_sign_verify<ntt::FALCON512_N>();
+  test_async_sign_verify<ntt::FALCON1024_N>();
+}
+
+// Coroutine, which moves itself onto executor's event loop and marks that it
+// was resumed
+static async::task_t
+resume_on(async::executor_t& exec, bool& resumed)
+{
+  co_await exec.schedule();
+  resumed = true;
+}
+
+// Checks that a coroutine, posted to executor after it was asked to stop, is
+// still resumed, before event loop returns, as happens, when a worker
+// completes an offloaded job, racing `stop`.
+TEST(Falcon, AsyncExecutorDrainsOnStop)
+{
+  async::executor_t exec;
+
+  bool resumed = false;
+  exec.stop();
+  resume_on(exec, resumed);
+  EXPECT_FALSE(resumed);
+
+  exec.run();
+  EXPECT_TRUE(resumed);
+  EXPECT_EQ(async::executor_t::current(), nullptr);
+}
+
+#endif
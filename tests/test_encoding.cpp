@@ -6,8 +6,11 @@
 #include "keygen.hpp"
 #include "ntt.hpp"
 #include "prng.hpp"
+#include <cmath>
 #include <cstring>
 #include <gtest/gtest.h>
+#include <random>
+#include <vector>
 
 // Test whether random public key ( as polynomial over Fq | q = 12289 ), can be
 // correctly encoded/ decoded or not.
@@ -286,3 +289,97 @@ TEST(Falcon, SignatureDecompression)
   test_sig_decompression<ntt::FALCON512_N>();
   test_sig_decompression<ntt::FALCON1024_N>();
 }
+
+// Signature compression, writing one bit at a time ( which is how
+// `encoding::compress_sig` used to be implemented ), kept here as reference.
+template<const size_t N, const size_t sbytelen>
+static bool
+compress_sig_bitwise(const int32_t* const __restrict poly_s,
+                     uint8_t* const __restrict sig)
+{
+  constexpr size_t slen = 8 * sbytelen - (8 + 320);
+  constexpr size_t max_sbytelen = (std::bit_width(ff::Q) * N) / 8;
+
+  uint8_t sig_buf[max_sbytelen]{};
+  size_t bit_idx = 0;
+
+  // bits beyond signature length are dropped, as compression fails anyway
+  const auto put_bit = [&](const int32_t bit) {
+    if (bit_idx < slen) {
+      sig_buf[bit_idx >> 3] |= bit << (7 - (bit_idx & 7ul));
+    }
+    bit_idx += 1;
+  };
+
+  for (size_t i = 0; i < N; i++) {
+    put_bit(poly_s[i] < 0);
+
+    const int32_t coeff = std::abs(poly_s[i]);
+    for (size_t j = 0; j < 7; j++) {
+      put_bit((coeff >> (6 - j)) & 0b1);
+    }
+
+    bit_idx += static_cast<size_t>(coeff >> 7);
+    put_bit(1);
+  }
+
+  std::memset(sig_buf, 0, max_sbytelen * (bit_idx >= slen));
+  std::memcpy(sig + (1 + 40), sig_buf, sbytelen - (1 + 40));
+
+  return bit_idx < slen;
+}
+
+// Test that signature compression, using a 64 -bit bit-buffer, produces same
+// bytes ( and same outcome ) as writing one bit at a time, for random
+// polynomials, whose coefficients are sampled with varying standard deviation,
+// so that compression succeeds for some and fails for others, along with
+// polynomials having a coefficient, whose code doesn't fit in 64 -bits.
+template<const size_t N>
+static void
+test_sig_compression_bit_buffer()
+{
+  constexpr size_t siglens[]{ 666, 1280 };
+  constexpr size_t siglen = siglens[N == 1024];
+  constexpr double σs[]{ 60., 100., 120., 140., 165. };
+
+  std::vector<int32_t> s2(N);
+  std::vector<uint8_t> sig0(siglen), sig1(siglen);
+
+  std::mt19937_64 gen(std::random_device{}());
+
+  const auto check = [&]() {
+    std::fill(sig0.begin(), sig0.end(), 0xff);
+    std::fill(sig1.begin(), sig1.end(), 0xff);
+
+    const bool ok0 = compress_sig_bitwise<N, siglen>(s2.data(), sig0.data());
+    const bool ok1 = encoding::compress_sig<N, siglen>(s2.data(), sig1.data());
+
+    EXPECT_EQ(ok0, ok1);
+    EXPECT_EQ(sig0, sig1);
+  };
+
+  for (const double σ : σs) {
+    std::normal_distribution<double> dist(0., σ);
+
+    for (size_t i = 0; i < 64; i++) {
+      for (auto& c : s2) {
+        c = static_cast<int32_t>(std::round(dist(gen)));
+      }
+      check();
+    }
+  }
+
+  // long unary codes
+  for (const int32_t k : { 54, 55, 56, 100, 200, 1000 }) {
+    std::fill(s2.begin(), s2.end(), 0);
+    s2[N / 2] = -(k * 128 + 127);
+    s2[N / 2 + 1] = k * 128;
+    check();
+  }
+}
+
+TEST(Falcon, SignatureCompressionBitBuffer)
+{
+  test_sig_compression_bit_buffer<ntt::FALCON512_N>();
+  test_sig_compression_bit_buffer<ntt::FALCON1024_N>();
+}
@@ -0,0 +1,195 @@
+#include "hashing.hpp"
+#include "ntt.hpp"
+#include "prng.hpp"
+#include "signing.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Hashes 4 -many ( salt, message ) pairs, of given message lengths, using both
+// `hash_to_point` and `hash_to_point_x4`, ensuring that both produce same
+// polynomials.
+template<const size_t N>
+static void
+test_hash_to_point_x4(const size_t (&mlens)[4])
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t slen = signing::SALT_LEN;
+
+  std::vector<uint8_t> salt[4];
+  std::vector<uint8_t> msg[4];
+  std::vector<ff::ff_t> expected[4];
+  std::vector<ff::ff_t> computed[4];
+  prng::prng_t rng;
+
+  for (size_t i = 0; i < 4; i++) {
+    salt[i].resize(slen);
+    msg[i].resize(mlens[i]);
+    expected[i].resize(N);
+    computed[i].resize(N);
+
+    rng.read(salt[i].data(), salt[i].size());
+    rng.read(msg[i].data(), msg[i].size());
+
+    const auto sptr = salt[i].data();
+    const auto mptr = msg[i].data();
+    hashing::hash_to_point<N>(sptr, slen, mptr, mlens[i], expected[i].data());
+  }
+
+  const uint8_t* const salts[]{
+    salt[0].data(), salt[1].data(), salt[2].data(), salt[3].data()
+  };
+  const uint8_t* const msgs[]{
+    msg[0].data(), msg[1].data(), msg[2].data(), msg[3].data()
+  };
+  ff::ff_t* const polys[]{
+    computed[0].data(), computed[1].data(), computed[2].data(),
+    computed[3].data()
+  };
+
+  hashing::hash_to_point_x4<N>(salts, slen, msgs, mlens, polys);
+
+  for (size_t i = 0; i < 4; i++) {
+    for (size_t j = 0; j < N; j++) {
+      EXPECT_EQ(computed[i][j].v, expected[i][j].v);
+    }
+  }
+}
+
+TEST(Falcon, HashToPointX4)
+{
+  // Message lengths s.t. 40 -bytes salt || message crosses SHAKE256 rate (
+  // = 136 -bytes ) boundary at different places, for different lanes
+  constexpr size_t mlens[][4]{
+    { 0, 0, 0, 0 },     { 32, 32, 32, 32 },  { 95, 96, 97, 231 },
+    { 0, 1, 232, 1024 }, { 2048, 1, 7, 95 }, { 4096, 232, 0, 97 },
+  };
+
+  for (const auto& ml : mlens) {
+    test_hash_to_point_x4<ntt::FALCON512_N>(ml);
+    test_hash_to_point_x4<ntt::FALCON1024_N>(ml);
+  }
+}
+
+// Parses blocks of SHAKE256 output bytes ( random ones, along with ones
+// crafted to hold 16 -bit values close to k * q and multiples of q ) into
+// polynomial coefficients, using both `rejection_sample_scalar` and
+// `rejection_sample`, starting at different coefficient indices, ensuring
+// that both produce same polynomial and stop at same index.
+template<const size_t N>
+static void
+test_rejection_sample()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t blen = shake256::rate >> 3;
+  constexpr uint16_t q = ff::Q;
+  constexpr uint16_t kq = ((1ul << 16) / q) * q;
+  constexpr uint16_t edges[]{
+    0,         1,      q - 1, q,      q + 1,  2 * q,     3 * q - 1, 4 * q,
+    4 * q + 1, kq - 1, kq,    kq + 1, 0xfffe, 0xffff, 2 * q - 1, 3 * q
+  };
+
+  std::vector<uint8_t> buf(blen);
+  std::vector<ff::ff_t> expected(N);
+  std::vector<ff::ff_t> computed(N);
+  prng::prng_t rng;
+
+  for (size_t itr = 0; itr < 64; itr++) {
+    rng.read(buf.data(), buf.size());
+
+    if (itr & 1ul) {
+      for (size_t off = 0; off < blen; off += 2) {
+        const uint16_t v = edges[(off / 2 + itr) % std::size(edges)];
+
+        buf[off + 0] = static_cast<uint8_t>(v >> 8);
+        buf[off + 1] = static_cast<uint8_t>(v >> 0);
+      }
+    }
+
+    for (const size_t beg : { 0ul, N / 2, N - 70, N - 17, N - 16, N - 1 }) {
+      std::fill(expected.begin(), expected.end(), ff::ff_t{ 0 });
+      std::fill(computed.begin(), computed.end(), ff::ff_t{ 0 });
+
+      const auto bptr = buf.data();
+      const auto eptr = expected.data();
+      const auto cptr = computed.data();
+
+      const size_t idx0 =
+        hashing::rejection_sample_scalar<N>(bptr, blen, eptr, beg);
+      const size_t idx1 = hashing::rejection_sample<N>(bptr, blen, cptr, beg);
+
+      EXPECT_EQ(idx0, idx1);
+      for (size_t i = 0; i < N; i++) {
+        EXPECT_EQ(computed[i].v, expected[i].v);
+      }
+    }
+  }
+}
+
+TEST(Falcon, RejectionSampling)
+{
+  test_rejection_sample<ntt::FALCON512_N>();
+  test_rejection_sample<ntt::FALCON1024_N>();
+}
+
+// Hashes random salt and message, of given length, using both `hash_to_point`
+// and `hash_to_point_stream`, where message is produced by a reader, in chunks
+// of irregular size, ensuring that both produce same polynomial.
+template<const size_t N>
+static void
+test_hash_to_point_stream(const size_t mlen)
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t slen = signing::SALT_LEN;
+  constexpr size_t chunk_lens[]{ 1, 135, 136, 137, 4096, 9000 };
+
+  std::vector<uint8_t> salt(slen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<ff::ff_t> expected(N);
+  std::vector<ff::ff_t> computed(N);
+  prng::prng_t rng;
+
+  rng.read(salt.data(), salt.size());
+  rng.read(msg.data(), msg.size());
+
+  const auto sptr = salt.data();
+  hashing::hash_to_point<N>(sptr, slen, msg.data(), mlen, expected.data());
+
+  size_t off = 0;
+  size_t i = 0;
+  auto read = [&](uint8_t* const bytes, const size_t len) -> ptrdiff_t {
+    const size_t clen_ = chunk_lens[i++ % std::size(chunk_lens)];
+    const size_t clen = std::min({ clen_, len, mlen - off });
+
+    std::copy_n(msg.begin() + off, clen, bytes);
+    off += clen;
+
+    return static_cast<ptrdiff_t>(clen);
+  };
+
+  const auto cptr = computed.data();
+  EXPECT_TRUE(hashing::hash_to_point_stream<N>(sptr, slen, read, cptr));
+
+  for (size_t j = 0; j < N; j++) {
+    EXPECT_EQ(computed[j].v, expected[j].v);
+  }
+
+  // reader failing midway, must be reported
+  off = 0;
+  auto failing = [&](uint8_t* const bytes, const size_t len) -> ptrdiff_t {
+    if (off >= mlen / 2) {
+      return -1;
+    }
+    return read(bytes, len);
+  };
+
+  EXPECT_FALSE(hashing::hash_to_point_stream<N>(sptr, slen, failing, cptr));
+}
+
+TEST(Falcon, HashToPointStream)
+{
+  for (const size_t mlen : { 0ul, 1ul, 96ul, 4352ul, 4353ul, 100000ul }) {
+    test_hash_to_point_stream<ntt::FALCON512_N>(mlen);
+    test_hash_to_point_stream<ntt::FALCON1024_N>(mlen);
+  }
+}
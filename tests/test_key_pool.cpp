@@ -0,0 +1,66 @@
+#include "key_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+// Waits till key pool reaches given depth
+template<typename Pool>
+static void
+wait_for_depth(const Pool& pool, const size_t depth)
+{
+  while (pool.depth() < depth) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+// Test if key pool fills itself up to high watermark, hands out distinct keys,
+// each of which can be used for signing messages, verifiable using its public
+// key, and refills itself once it's drained below low watermark.
+TEST(Falcon, KeyPool)
+{
+  constexpr size_t N = 512;
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t low = 1;
+  constexpr size_t high = 2;
+
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  signing::workspace_t<N> ws;
+  prng::chacha20_t rng;
+
+  rng.read(msg.data(), msg.size());
+
+  key_pool::pool_t<N> pool{ low, high };
+  EXPECT_EQ(pool.low_watermark(), low);
+  EXPECT_EQ(pool.high_watermark(), high);
+
+  wait_for_depth(pool, high);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(pool.depth(), high);
+
+  std::vector<key_pool::pool_t<N>::key_t> keys;
+  for (size_t i = 0; i < high; i++) {
+    auto key = pool.try_acquire();
+    EXPECT_NE(key, nullptr);
+    keys.push_back(std::move(key));
+  }
+
+  for (auto& k : keys) {
+    k->key.sign(msg.data(), mlen, sig.data(), ws, rng);
+
+    const auto pkey = k->pkey.data();
+    EXPECT_TRUE(falcon::verify<N>(pkey, msg.data(), mlen, sig.data()));
+  }
+  EXPECT_NE(keys[0]->pkey, keys[1]->pkey);
+
+  // drained below low watermark, so it must fill itself up again
+  wait_for_depth(pool, high);
+
+  const auto stats = pool.stats();
+  EXPECT_EQ(stats.acquired, high);
+  EXPECT_GE(stats.generated, 2 * high);
+  EXPECT_GT(stats.refill_rate, 0.);
+}
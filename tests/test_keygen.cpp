@@ -2,10 +2,15 @@
 #include "decoding.hpp"
 #include "encoding.hpp"
 #include "falcon.hpp"
+#include "falcon_tree_batch.hpp"
 #include "ntru_gen.hpp"
 #include "ntt.hpp"
 #include "prng.hpp"
+#include "work_stealing.hpp"
+#include <algorithm>
+#include <cmath>
 #include <gtest/gtest.h>
+#include <vector>
 
 // Test if Falcon Key Generation Algorithm works as expected by doing following
 //
@@ -68,3 +73,251 @@ TEST(Falcon, KeyGeneration)
   test_keygen<ntt::FALCON512_N>();
   test_keygen<ntt::FALCON1024_N>();
 }
+
+// Test if Falcon Key Generation Algorithm, taking scratch space from caller
+// supplied workspace, computes same matrix B, falcon tree T and public key h,
+// as the one allocating scratch space on stack does, when both of them are fed
+// with same random byte stream.
+template<const size_t N>
+static void
+test_keygen_ws()
+{
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t wslen = keygen::keygen_ws_len<N>();
+
+  std::vector<fft::cmplx> B0(2 * 2 * N), B1(2 * 2 * N);
+  std::vector<fft::cmplx> T0(ftlen), T1(ftlen);
+  std::vector<ff::ff_t> h0(N), h1(N);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  uint8_t seed[prng::chacha20_t::KEY_LEN];
+  prng::prng_t{}.read(seed, sizeof(seed));
+
+  prng::chacha20_t rng0(seed);
+  prng::chacha20_t rng1(seed);
+
+  keygen::keygen<N>(B0.data(), T0.data(), h0.data(), σ, rng0);
+  keygen::keygen_ws<N>(B1.data(), T1.data(), h1.data(), σ, { ws, wslen }, rng1);
+
+  std::free(ws);
+
+  EXPECT_TRUE(std::equal(B0.begin(), B0.end(), B1.begin()));
+  EXPECT_TRUE(std::equal(T0.begin(), T0.end(), T1.begin()));
+  EXPECT_TRUE(std::equal(h0.begin(), h0.end(), h1.begin(), [](auto a, auto b) {
+    return a.v == b.v;
+  }));
+}
+
+TEST(Falcon, KeyGenerationWithWorkspace)
+{
+  test_keygen_ws<ntt::FALCON512_N>();
+  test_keygen_ws<ntt::FALCON1024_N>();
+}
+
+// Test if fused key generation pipeline ( see `keygen::keygen_fused_ws` ),
+// which emits byte encoded key pair along with matrix B and falcon tree T,
+// computes same key pair as `falcon::keygen` does, when both of them are fed
+// with same random byte stream, while B and T are same as the ones obtained by
+// decoding secret key and expanding it again.
+template<const size_t N>
+static void
+test_keygen_fused()
+{
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t wslen = keygen::keygen_ws_len<N>();
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::vector<fft::cmplx> B0(2 * 2 * N), B1(2 * 2 * N);
+  std::vector<fft::cmplx> T0(ftlen), T1(ftlen);
+  std::vector<uint8_t> pkey0(pklen), pkey1(pklen);
+  std::vector<uint8_t> skey0(sklen), skey1(sklen);
+  std::vector<int32_t> f(N), g(N), F(N), G(N);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  uint8_t seed[prng::chacha20_t::KEY_LEN];
+  prng::prng_t{}.read(seed, sizeof(seed));
+
+  prng::chacha20_t rng0(seed);
+  prng::chacha20_t rng1(seed);
+
+  falcon::keygen<N>(pkey0.data(), skey0.data(), rng0);
+  keygen::keygen_ws<N>(
+    B1.data(), T1.data(), pkey1.data(), skey1.data(), σ, { ws, wslen }, rng1);
+
+  std::free(ws);
+
+  const bool decoded =
+    decoding::decode_skey<N>(skey1.data(), f.data(), g.data(), F.data());
+  falcon::recompute_G<N>(f.data(), g.data(), F.data(), G.data());
+  falcon::compute_matrix_B<N>(
+    f.data(), g.data(), F.data(), G.data(), B0.data());
+  falcon::compute_falcon_tree<N>(B0.data(), T0.data());
+
+  EXPECT_TRUE(decoded);
+  EXPECT_EQ(pkey0, pkey1);
+  EXPECT_EQ(skey0, skey1);
+  EXPECT_TRUE(std::equal(B0.begin(), B0.end(), B1.begin()));
+  EXPECT_TRUE(std::equal(T0.begin(), T0.end(), T1.begin()));
+}
+
+TEST(Falcon, KeyGenerationFused)
+{
+  test_keygen_fused<ntt::FALCON512_N>();
+  test_keygen_fused<ntt::FALCON1024_N>();
+}
+
+// Test that keys ( and matrix B, LDL tree T ) generated in fork-join execution
+// mode, where NTRUSolve and ffLDL* run independent branches in parallel, on
+// workers of a pool, are same as the ones generated sequentially, using same
+// seed.
+template<const size_t N>
+static void
+test_keygen_fork_join(work_stealing::pool_t& pool)
+{
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t wslen = keygen::keygen_ws_len<N>();
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::vector<fft::cmplx> B0(2 * 2 * N), B1(2 * 2 * N);
+  std::vector<fft::cmplx> T0(ftlen), T1(ftlen);
+  std::vector<uint8_t> pkey0(pklen), pkey1(pklen);
+  std::vector<uint8_t> skey0(sklen), skey1(sklen);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  uint8_t seed[prng::chacha20_t::KEY_LEN];
+  prng::prng_t{}.read(seed, sizeof(seed));
+
+  prng::chacha20_t rng0(seed);
+  prng::chacha20_t rng1(seed);
+
+  keygen::keygen_ws<N>(
+    B0.data(), T0.data(), pkey0.data(), skey0.data(), σ, { ws, wslen }, rng0);
+
+  {
+    work_stealing::fork_join_scope_t scope(pool);
+    keygen::keygen_ws<N>(
+      B1.data(), T1.data(), pkey1.data(), skey1.data(), σ, { ws, wslen }, rng1);
+  }
+
+  std::free(ws);
+
+  EXPECT_EQ(pkey0, pkey1);
+  EXPECT_EQ(skey0, skey1);
+  EXPECT_TRUE(std::equal(B0.begin(), B0.end(), B1.begin()));
+  EXPECT_TRUE(std::equal(T0.begin(), T0.end(), T1.begin()));
+}
+
+TEST(Falcon, KeyGenerationForkJoin)
+{
+  work_stealing::pool_t pool{ 4 };
+
+  for (size_t i = 0; i < 4; i++) {
+    test_keygen_fork_join<ntt::FALCON512_N>(pool);
+    test_keygen_fork_join<ntt::FALCON1024_N>(pool);
+  }
+}
+
+// Test that matrix B and falcon tree T, computed for a batch of keys in
+// lockstep, match ( up to rounding errors ) those computed one key at a time,
+// while secret keys expanded in batch can be used for signing messages, which
+// verify using respective public keys.
+template<const size_t N>
+static void
+test_expand_batch()
+{
+  constexpr size_t K = falcon_tree_batch::LANES;
+  constexpr size_t cnt = K + 3; // last batch is partially filled
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t wslen = falcon_tree_batch::expand_ws_len<N, K>();
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  std::vector<uint8_t> pkeys(cnt * pklen);
+  std::vector<uint8_t> skeys(cnt * sklen);
+  std::vector<int32_t> polys(cnt * 2 * 2 * N);
+
+  for (size_t i = 0; i < cnt; i++) {
+    falcon::keygen<N>(pkeys.data() + i * pklen, skeys.data() + i * sklen);
+
+    auto f = polys.data() + i * 2 * 2 * N;
+    decoding::decode_skey<N>(skeys.data() + i * sklen, f, f + N, f + 2 * N);
+    falcon::recompute_G<N>(f, f + N, f + 2 * N, f + 3 * N);
+  }
+
+  // first batch, computed in lockstep
+  std::vector<fft::cmplx> B0(K * 2 * 2 * N), T0(K * ftlen);
+  auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+
+  const int32_t* f[K];
+  const int32_t* g[K];
+  const int32_t* F[K];
+  const int32_t* G[K];
+  fft::cmplx* B[K];
+  fft::cmplx* T[K];
+
+  for (size_t k = 0; k < K; k++) {
+    f[k] = polys.data() + k * 2 * 2 * N;
+    g[k] = f[k] + N;
+    F[k] = f[k] + 2 * N;
+    G[k] = f[k] + 3 * N;
+    B[k] = B0.data() + k * 2 * 2 * N;
+    T[k] = T0.data() + k * ftlen;
+  }
+
+  falcon_tree_batch::expand_ws<N, K>(f, g, F, G, B, T, σ, { ws, wslen });
+  std::free(ws);
+
+  // same keys, computed one at a time
+  std::vector<fft::cmplx> B1(K * 2 * 2 * N), T1(K * ftlen);
+
+  for (size_t k = 0; k < K; k++) {
+    auto B_ = B1.data() + k * 2 * 2 * N;
+    auto T_ = T1.data() + k * ftlen;
+
+    falcon::compute_matrix_B<N>(f[k], g[k], F[k], G[k], B_);
+    falcon::compute_falcon_tree<N>(B_, T_);
+  }
+
+  const auto close = [](const fft::cmplx a, const fft::cmplx b) {
+    return std::abs(a - b) <= 1e-9 * std::max(1., std::abs(b));
+  };
+
+  EXPECT_TRUE(std::equal(B0.begin(), B0.end(), B1.begin(), close));
+  EXPECT_TRUE(std::equal(T0.begin(), T0.end(), T1.begin(), close));
+
+  // all keys, expanded in batches
+  std::vector<falcon::expanded_key_t<N>> keys(cnt);
+  EXPECT_TRUE(
+    falcon::expanded_key_t<N>::expand_batch(skeys.data(), keys.data(), cnt));
+
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  signing::workspace_t<N> sws;
+  prng::prng_t rng;
+
+  for (size_t i = 0; i < cnt; i++) {
+    rng.read(msg.data(), msg.size());
+    keys[i].sign(msg.data(), msg.size(), sig.data(), sws, rng);
+
+    const auto pkey = pkeys.data() + i * pklen;
+    EXPECT_TRUE(falcon::verify<N>(pkey, msg.data(), msg.size(), sig.data()));
+  }
+}
+
+TEST(Falcon, ExpandKeysInBatch)
+{
+  test_expand_batch<ntt::FALCON512_N>();
+  test_expand_batch<ntt::FALCON1024_N>();
+}
@@ -0,0 +1,149 @@
+#include "keygen_batch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Test if work-stealing pool runs each job of ( possibly nested ) parallel
+// loops exactly once, while handing out worker indices, which are valid for
+// accessing per-worker state.
+TEST(Falcon, WorkStealingPool)
+{
+  constexpr size_t outer = 64;
+  constexpr size_t inner = 256;
+
+  work_stealing::pool_t pool{ 4 };
+  std::vector<std::atomic<size_t>> hits(outer * inner);
+  std::atomic<size_t> unindexed{ 0ul };
+
+  EXPECT_EQ(pool.worker_index(), work_stealing::pool_t::NOT_A_WORKER);
+
+  pool.parallel_for(outer, [&](const size_t i) {
+    unindexed += pool.worker_index() >= pool.size();
+
+    pool.parallel_for(inner, [&](const size_t j) {
+      unindexed += pool.worker_index() >= pool.size();
+      hits[i * inner + j].fetch_add(1);
+    });
+  });
+
+  EXPECT_EQ(unindexed.load(), 0ul);
+  for (auto& h : hits) {
+    EXPECT_EQ(h.load(), 1ul);
+  }
+}
+
+// Test if each of Falcon{512, 1024} keypairs, generated in a batch, on a
+// work-stealing pool, can be used for signing and verifying a message, while
+// no two of them are same.
+template<const size_t N>
+static void
+test_keygen_batch(const size_t count, const size_t threads)
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  std::vector<uint8_t> pkeys(count * pklen);
+  std::vector<uint8_t> skeys(count * sklen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  prng::prng_t rng;
+
+  rng.read(msg.data(), msg.size());
+  falcon::keygen_batch<N>(count, pkeys.data(), skeys.data(), threads);
+
+  for (size_t i = 0; i < count; i++) {
+    const auto pkey = pkeys.data() + i * pklen;
+    const auto skey = skeys.data() + i * sklen;
+
+    falcon::sign<N>(skey, msg.data(), mlen, sig.data());
+    EXPECT_TRUE(falcon::verify<N>(pkey, msg.data(), mlen, sig.data()));
+
+    for (size_t j = 0; j < i; j++) {
+      const auto other = pkeys.data() + j * pklen;
+      EXPECT_FALSE(std::equal(pkey, pkey + pklen, other));
+    }
+  }
+}
+
+TEST(Falcon, KeyGenerationBatch)
+{
+  test_keygen_batch<ntt::FALCON512_N>(4, 2);
+  test_keygen_batch<ntt::FALCON1024_N>(2, 2);
+}
+
+// Test if Falcon{512, 1024} keypair, generated by speculatively trying many
+// candidates at once, can be used for signing and verifying a message, while
+// also ensuring that a cancelled candidate is never reported as a solution.
+template<const size_t N>
+static void
+test_keygen_speculative(const size_t threads)
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  prng::prng_t rng;
+
+  rng.read(msg.data(), msg.size());
+  falcon::keygen_speculative<N>(pkey.data(), skey.data(), threads);
+
+  falcon::sign<N>(skey.data(), msg.data(), mlen, sig.data());
+  EXPECT_TRUE(falcon::verify<N>(pkey.data(), msg.data(), mlen, sig.data()));
+
+  int32_t f[N];
+  int32_t g[N];
+  int32_t F[N];
+  int32_t G[N];
+  const std::atomic<uint64_t> best{ 0ul };
+  const work_stealing::cancel_t cancelled{ &best, 1ul };
+
+  EXPECT_FALSE(ntru_gen::ntru_gen_once<N>(f, g, F, G, rng, cancelled));
+}
+
+TEST(Falcon, KeyGenerationSpeculative)
+{
+  test_keygen_speculative<ntt::FALCON512_N>(2);
+  test_keygen_speculative<ntt::FALCON1024_N>(2);
+}
+
+// Test if speculative NTRUGen accepts lowest numbered successful candidate,
+// by ensuring that, for a given seed, it computes same f, g, F, G, no matter
+// how many workers try candidates at once.
+template<const size_t N>
+static void
+test_ntru_gen_speculative_reproducible()
+{
+  uint8_t seed[prng::chacha20_t::KEY_LEN];
+  prng::prng_t{}.read(seed, sizeof(seed));
+
+  std::vector<int32_t> expected(4 * N);
+  std::vector<int32_t> computed(4 * N);
+
+  const auto gen = [&](const size_t threads, int32_t* const fgFG) {
+    work_stealing::pool_t pool{ threads };
+    prng::chacha20_t rng(seed);
+
+    ntru_gen::ntru_gen_speculative<N>(
+      fgFG, fgFG + N, fgFG + 2 * N, fgFG + 3 * N, rng, pool);
+  };
+
+  gen(1, expected.data());
+  for (const size_t threads : { 2ul, 3ul }) {
+    gen(threads, computed.data());
+    EXPECT_EQ(computed, expected);
+  }
+}
+
+TEST(Falcon, NTRUGenSpeculativeReproducible)
+{
+  test_ntru_gen_speculative_reproducible<ntt::FALCON512_N>();
+  test_ntru_gen_speculative_reproducible<ntt::FALCON1024_N>();
+}
@@ -1,10 +1,22 @@
 #include "check_ntru_eq.hpp"
+#include "ntru_solve_rns.hpp"
 #include "prng.hpp"
+#include <atomic>
+#include <cmath>
 #include <gtest/gtest.h>
+#include <vector>
+
+#if !defined FALCON_NTRU_SOLVE_RNS
+#include "gmp_arena.hpp"
+#include "karatsuba.hpp"
+#include "ntru_mul.hpp"
+#include <cstdlib>
+#include <limits>
+#endif
 
 // Test functional correctness of NTRUGen routine, by first generating f, g, F,
 // G ∈ Z[x]/(x^N + 1) and then solving NTRU equation ( see eq 3.15 of Falcon
-// specification ).
+// specification ), while also ensuring that F and G can be encoded.
 //
 // Collects some inspiration from
 // https://github.com/tprest/falcon.py/blob/88d01ed/test.py#L88-L94
@@ -21,12 +33,20 @@ test_ntru_gen()
   ntru_gen::ntru_gen<N>(f, g, F, G, prng);
   const bool flg = test_falcon::check_ntru_eq<N>(f, g, F, G);
 
+  // F and G must be encodable using 8 -bits per coefficient
+  bool in_range = true;
+  for (size_t i = 0; i < N; i++) {
+    in_range &= std::abs(F[i]) <= ntru_gen::FG_COEFF_MAX;
+    in_range &= std::abs(G[i]) <= ntru_gen::FG_COEFF_MAX;
+  }
+
   std::free(f);
   std::free(g);
   std::free(F);
   std::free(G);
 
   EXPECT_TRUE(flg);
+  EXPECT_TRUE(in_range);
 }
 
 TEST(Falcon, NTRUGen)
@@ -34,3 +54,470 @@ TEST(Falcon, NTRUGen)
   test_ntru_gen<ntt::FALCON512_N>();
   test_ntru_gen<ntt::FALCON1024_N>();
 }
+
+// Test functional correctness of GMP-free NTRUSolve ( see ntru_solve_rns.hpp ),
+// by sampling candidate f, g ∈ Z[x]/(x^N + 1), which pass checks of algorithm
+// 5 of Falcon specification, and ensuring that computed F, G solve NTRU
+// equation, while also ensuring that a cancelled attempt never succeeds.
+template<const size_t N>
+static void
+test_ntru_solve_rns()
+{
+  std::vector<int32_t> f(N);
+  std::vector<int32_t> g(N);
+  std::vector<int32_t> F(N);
+  std::vector<int32_t> G(N);
+
+  prng::prng_t prng;
+  size_t solved = 0;
+
+  while (solved < 2) {
+    ntru_gen::gen_poly<log2<N>()>(f.data(), prng);
+    ntru_gen::gen_poly<log2<N>()>(g.data(), prng);
+
+    if (!ntru_gen::is_poly_invertible<log2<N>()>(f.data())) {
+      continue;
+    }
+
+    const double gsnorm =
+      ntru_gen::gram_schmidt_norm<log2<N>()>(f.data(), g.data());
+    if (gsnorm > ntru_gen::GS_NORM_THRESHOLD) {
+      continue;
+    }
+
+    const std::atomic<uint64_t> best{ 0ul };
+    const work_stealing::cancel_t cancelled{ &best, 1ul };
+    EXPECT_FALSE(ntru_rns::ntru_solve<N>(
+      f.data(), g.data(), F.data(), G.data(), cancelled));
+
+    if (!ntru_rns::ntru_solve<N>(f.data(), g.data(), F.data(), G.data())) {
+      continue;
+    }
+
+    EXPECT_TRUE(test_falcon::check_ntru_eq<N>(
+      f.data(), g.data(), F.data(), G.data()));
+    solved++;
+  }
+}
+
+TEST(Falcon, NTRUSolveRNS)
+{
+  test_ntru_solve_rns<ntt::FALCON512_N>();
+  test_ntru_solve_rns<ntt::FALCON1024_N>();
+}
+
+// Test that table based sampler of f, g ( see `ntru_gen::gen_poly` ) follows
+// same distribution as summing up SamplerZ draws ( see
+// `ntru_gen::gen_poly_samplerz` ), by sampling 2^16 coefficients using each of
+// them and performing two-sample χ² test on their histograms, while also
+// checking that mean is ≈ 0 and standard deviation is ≈ 1.17 * √(q/ 2N).
+template<const size_t N>
+static void
+test_gen_poly()
+{
+  constexpr size_t POLY_CNT = (1ul << 16) / N;
+
+  // coefficients with |x| > B are counted in two tail bins
+  const double σ = 1.17 * std::sqrt(static_cast<double>(ff::Q) / (2. * N));
+  const auto B = static_cast<int32_t>(2.5 * σ);
+  const auto BIN_CNT = static_cast<size_t>(2 * B + 3);
+
+  const auto bin = [B](const int32_t x) {
+    return static_cast<size_t>(std::clamp(x, -B - 1, B + 1) + B + 1);
+  };
+
+  std::vector<int32_t> poly(N);
+  std::vector<double> cdt_bins(BIN_CNT);
+  std::vector<double> sz_bins(BIN_CNT);
+
+  prng::prng_t prng;
+
+  double sum = 0.;
+  double sq_sum = 0.;
+
+  for (size_t i = 0; i < POLY_CNT; i++) {
+    ntru_gen::gen_poly<log2<N>()>(poly.data(), prng);
+    for (const int32_t x : poly) {
+      cdt_bins[bin(x)]++;
+
+      sum += static_cast<double>(x);
+      sq_sum += static_cast<double>(x * x);
+    }
+
+    ntru_gen::gen_poly_samplerz<log2<N>()>(poly.data(), prng);
+    for (const int32_t x : poly) {
+      sz_bins[bin(x)]++;
+    }
+  }
+
+  double χ2 = 0.;
+  for (size_t i = 0; i < BIN_CNT; i++) {
+    const double d = cdt_bins[i] - sz_bins[i];
+    χ2 += (d * d) / (cdt_bins[i] + sz_bins[i]);
+  }
+
+  const auto cnt = static_cast<double>(POLY_CNT * N);
+  const double mean = sum / cnt;
+  const double sd = std::sqrt(sq_sum / cnt - mean * mean);
+
+  // when both samplers follow same distribution, χ² ( with BIN_CNT - 1 degrees
+  // of freedom ) exceeds this bound with negligible probability
+  const auto df = static_cast<double>(BIN_CNT - 1);
+  EXPECT_LT(χ2, df + 12. * std::sqrt(2. * df));
+
+  EXPECT_LT(std::abs(mean), 0.1);
+  EXPECT_NEAR(sd / σ, 1., 0.02);
+}
+
+TEST(Falcon, GenPolyDistribution)
+{
+  test_gen_poly<ntt::FALCON512_N>();
+  test_gen_poly<ntt::FALCON1024_N>();
+}
+
+#if !defined FALCON_NTRU_SOLVE_RNS
+
+// Samples a random big integer of at most `bits` -bits, with random sign
+static mpz_class
+random_mpz(prng::prng_t& prng, const size_t bits)
+{
+  std::vector<uint8_t> bytes((bits + 7) / 8 + 1);
+  prng.read(bytes.data(), bytes.size());
+
+  mpz_class x;
+  mpz_import(x.get_mpz_t(), bytes.size() - 1, 1, 1, 0, 0, bytes.data() + 1);
+  mpz_fdiv_r_2exp(x.get_mpz_t(), x.get_mpz_t(), bits);
+
+  return (bytes[0] & 1) ? mpz_class(-x) : x;
+}
+
+// Test that in-place Karatsuba multiplication of two polynomials modulo
+// (x ** N + 1), computes same result as schoolbook multiplication, along with
+// by-value variant of it, for random big integer coefficients.
+template<const size_t N>
+static void
+test_karamul(const size_t bits)
+{
+  prng::prng_t prng;
+
+  std::array<mpz_class, N> a{};
+  std::array<mpz_class, N> b{};
+  for (size_t i = 0; i < N; i++) {
+    a[i] = random_mpz(prng, bits);
+    b[i] = random_mpz(prng, bits);
+  }
+
+  std::array<mpz_class, N> expected{};
+  for (size_t i = 0; i < N; i++) {
+    for (size_t j = 0; j < N; j++) {
+      const mpz_class ab = a[i] * b[j];
+      if (i + j < N) {
+        expected[i + j] += ab;
+      } else {
+        expected[i + j - N] -= ab;
+      }
+    }
+  }
+
+  std::vector<mpz_class> scratch(karatsuba::karamul_scratch_len<N>());
+  std::array<mpz_class, N> res{};
+  karatsuba::karamul<N>(a.data(), b.data(), res.data(), scratch.data());
+
+  // scratch space can be reused, without being cleared
+  std::array<mpz_class, N> res_{};
+  karatsuba::karamul<N>(a.data(), b.data(), res_.data(), scratch.data());
+
+  EXPECT_EQ(res, expected);
+  EXPECT_EQ(res_, expected);
+  EXPECT_EQ(karatsuba::karamul<N>(a, b), expected);
+}
+
+TEST(Falcon, KaramulInPlace)
+{
+  for (const size_t bits : { 1ul, 63ul, 64ul, 1000ul }) {
+    test_karamul<1>(bits);
+    test_karamul<2>(bits);
+    test_karamul<4>(bits);
+    test_karamul<8>(bits);
+    test_karamul<64>(bits);
+  }
+  test_karamul<512>(256);
+}
+
+// Multiplies a, b using `ntru_mul::mul`, with thresholds `t`, returning
+// strategy used for it, as accounted in statistics of calling thread
+template<const size_t N>
+static ntru_mul::strategy_t
+mul_with(const std::array<mpz_class, N>& a,
+         const std::array<mpz_class, N>& b,
+         std::array<mpz_class, N>& res,
+         const ntru_mul::thresholds_t& t)
+{
+  std::vector<mpz_class> scratch(ntru_mul::scratch_len<N>());
+
+  const auto before = ntru_mul::stats()[log2<N>()].calls;
+  ntru_mul::mul<N>(a.data(), b.data(), res.data(), scratch.data(), t);
+  const auto after = ntru_mul::stats()[log2<N>()].calls;
+
+  for (size_t i = 0; i < ntru_mul::STRATEGY_CNT; i++) {
+    if (after[i] != before[i]) {
+      return static_cast<ntru_mul::strategy_t>(i);
+    }
+  }
+  return ntru_mul::strategy_t::karatsuba;
+}
+
+// Test that each multiplication strategy of GMP backed NTRUSolve ( see
+// ntru_mul.hpp ), when forced, computes same product as Karatsuba, for
+// polynomials of degree N - 1, with coefficients of `abits`, `bbits` -bits.
+// Both random coefficients and ones of largest magnitude are tried, so that
+// schoolbook method is exercised right at bit limit of its accumulator.
+template<const size_t N>
+static void
+test_ntru_mul(const size_t abits, const size_t bbits)
+{
+  using ntru_mul::strategy_t;
+  constexpr size_t MAX = std::numeric_limits<size_t>::max();
+
+  prng::prng_t prng;
+
+  for (size_t round = 0; round < 4; round++) {
+    std::array<mpz_class, N> a{};
+    std::array<mpz_class, N> b{};
+
+    for (size_t i = 0; i < N; i++) {
+      if (round == 0) {
+        a[i] = (mpz_class(1) << abits) - 1;
+        b[i] = (mpz_class(1) << bbits) - 1;
+      } else {
+        a[i] = random_mpz(prng, abits);
+        b[i] = random_mpz(prng, bbits);
+      }
+    }
+
+    // ensure coefficients are of exactly `abits`, `bbits` -bits
+    if (sgn(a[0]) == 0 || mpz_sizeinbase(a[0].get_mpz_t(), 2) < abits) {
+      a[0] = -((mpz_class(1) << (abits - 1)) + 1);
+    }
+    if (sgn(b[N - 1]) == 0 || mpz_sizeinbase(b[N - 1].get_mpz_t(), 2) < bbits) {
+      b[N - 1] = (mpz_class(1) << (bbits - 1)) + 1;
+    }
+
+    const auto expected = karatsuba::karamul<N>(a, b);
+
+    const size_t pbits = abits + bbits + log2<N>() + 1;
+    const bool fits = (abits <= ntru_mul::SCHOOLBOOK_MAX_IN_BITS) &&
+                      (bbits <= ntru_mul::SCHOOLBOOK_MAX_IN_BITS) &&
+                      (pbits <= ntru_mul::SCHOOLBOOK_MAX_BITS);
+
+    std::array<mpz_class, N> res{};
+
+    // schoolbook is picked irrespective of thresholds, whenever it's safe
+    if (fits) {
+      ntru_mul::schoolbook<N>(a.data(), b.data(), res.data());
+      EXPECT_EQ(res, expected);
+    }
+
+    const auto s0 = mul_with<N>(a, b, res, { MAX, 0 });
+    EXPECT_EQ(s0, fits ? strategy_t::schoolbook : strategy_t::karatsuba);
+    EXPECT_EQ(res, expected);
+
+    // NTT is used, unless available primes can't represent product, in which
+    // case it falls back to Karatsuba
+    const bool ntt_ok = ntru_mul::ntt<N>(a.data(), abits, b.data(), bbits,
+                                         res.data());
+    if (ntt_ok) {
+      EXPECT_EQ(res, expected);
+    }
+
+    const auto s1 = mul_with<N>(a, b, res, { 1, MAX });
+    EXPECT_EQ(s1,
+              fits     ? strategy_t::schoolbook
+              : ntt_ok ? strategy_t::ntt
+                       : strategy_t::karatsuba);
+    EXPECT_EQ(res, expected);
+  }
+}
+
+TEST(Falcon, NTRUMulStrategies)
+{
+  constexpr size_t SB_BITS = ntru_mul::SCHOOLBOOK_MAX_BITS;
+  constexpr size_t SB_IN_BITS = ntru_mul::SCHOOLBOOK_MAX_IN_BITS;
+
+  // around bit limit of schoolbook method's accumulator and inputs
+  const size_t b8 = std::min((SB_BITS - 4) / 2, SB_IN_BITS);
+  test_ntru_mul<8>(b8, SB_BITS - 4 - b8);
+  test_ntru_mul<8>(b8, SB_BITS - 4 - b8 + 1);
+  test_ntru_mul<8>(SB_IN_BITS, 1);
+  test_ntru_mul<8>(SB_IN_BITS + 1, 1);
+
+  const size_t b1024 = std::min((SB_BITS - 11) / 2, SB_IN_BITS);
+  test_ntru_mul<1024>(b1024, SB_BITS - 11 - b1024);
+  test_ntru_mul<1024>(b1024 + 1, SB_BITS - 11 - b1024);
+
+  // around # -of bits, which available primes can represent
+  const size_t rns_bits = ntru_rns::MAX_PRIMES * 30;
+  test_ntru_mul<2>(rns_bits / 2 - 64, rns_bits / 2 - 64);
+  test_ntru_mul<2>(rns_bits / 2 + 64, rns_bits / 2 + 64);
+
+  test_ntru_mul<64>(300, 400);
+}
+
+// Memory functions counting # -of calls made to them, which are installed
+// before arena allocator, to test that it chains to them
+static size_t chained_calls = 0;
+
+static void*
+counting_alloc(const size_t n)
+{
+  chained_calls++;
+  return std::malloc(n);
+}
+
+static void*
+counting_realloc(void* const p, const size_t, const size_t n)
+{
+  chained_calls++;
+  return std::realloc(p, n);
+}
+
+static void
+counting_free(void* const p, const size_t)
+{
+  chained_calls++;
+  std::free(p);
+}
+
+// Test arena allocator for GMP, i.e. ownership of blocks, reallocation of
+// blocks within and across size classes, moving foreign blocks into arena,
+// chaining to previously installed memory functions and their restoration.
+TEST(Falcon, GMPArena)
+{
+  void* (*prev_alloc)(size_t) = nullptr;
+  void* (*prev_realloc)(void*, size_t, size_t) = nullptr;
+  void (*prev_free)(void*, size_t) = nullptr;
+  mp_get_memory_functions(&prev_alloc, &prev_realloc, &prev_free);
+
+  mp_set_memory_functions(counting_alloc, counting_realloc, counting_free);
+
+  // until installed, activating arena has no effect
+  ASSERT_FALSE(gmp_arena::installed());
+  {
+    gmp_arena::scope_t scope;
+    EXPECT_FALSE(gmp_arena::arena().active);
+  }
+
+  gmp_arena::install();
+  gmp_arena::install();
+  ASSERT_TRUE(gmp_arena::installed());
+
+  auto& a = gmp_arena::arena();
+
+  // arena is inactive, so allocations go to previously installed functions
+  {
+    chained_calls = 0;
+
+    void* const p = gmp_arena::allocate(24);
+    EXPECT_FALSE(a.owns(p));
+
+    void* const q = gmp_arena::reallocate(p, 24, 100);
+    EXPECT_FALSE(a.owns(q));
+
+    gmp_arena::deallocate(q, 100);
+    EXPECT_EQ(chained_calls, 3ul);
+  }
+
+  {
+    gmp_arena::scope_t scope;
+    EXPECT_TRUE(a.active);
+
+    {
+      gmp_arena::scope_t nested;
+      EXPECT_TRUE(a.active);
+    }
+    EXPECT_TRUE(a.active);
+
+    const auto before = gmp_arena::stats();
+    chained_calls = 0;
+
+    // block is rounded up to size class, so growing within it keeps it
+    void* const p = gmp_arena::allocate(20);
+    ASSERT_TRUE(a.owns(p));
+    std::memset(p, 0xab, 20);
+
+    void* const q = gmp_arena::reallocate(p, 20, 32);
+    EXPECT_EQ(q, p);
+
+    // growing beyond size class moves it, preserving content
+    void* const r = gmp_arena::reallocate(q, 32, 200);
+    EXPECT_NE(r, q);
+    ASSERT_TRUE(a.owns(r));
+    for (size_t i = 0; i < 20; i++) {
+      EXPECT_EQ(static_cast<const uint8_t*>(r)[i], 0xab);
+    }
+
+    // freed block is reused by next allocation of same size class
+    void* const s = gmp_arena::allocate(32);
+    EXPECT_EQ(s, q);
+
+    // foreign block is moved into arena, being freed by previous function
+    void* const t = std::malloc(16);
+    std::memset(t, 0xcd, 16);
+
+    void* const u = gmp_arena::reallocate(t, 16, 64);
+    ASSERT_TRUE(a.owns(u));
+    for (size_t i = 0; i < 16; i++) {
+      EXPECT_EQ(static_cast<const uint8_t*>(u)[i], 0xcd);
+    }
+    EXPECT_EQ(chained_calls, 1ul);
+
+    // blocks beyond largest size class go to previous function
+    const size_t big = 2ul << gmp_arena::MAX_CLASS;
+    void* const v = gmp_arena::allocate(big);
+    EXPECT_FALSE(a.owns(v));
+    gmp_arena::deallocate(v, big);
+    EXPECT_EQ(chained_calls, 3ul);
+
+    gmp_arena::deallocate(r, 200);
+    gmp_arena::deallocate(s, 32);
+    gmp_arena::deallocate(u, 64);
+
+    const auto after = gmp_arena::stats();
+    EXPECT_EQ(after.arena_allocs - before.arena_allocs, 4ul);
+
+    // big integers are served from arena
+    mpz_class x = 1;
+    x <<= 1000;
+    EXPECT_TRUE(a.owns(x.get_mpz_t()->_mp_d));
+  }
+  EXPECT_FALSE(a.active);
+
+  // block served from arena, is returned to it, even after deactivation
+  {
+    void* p = nullptr;
+    {
+      gmp_arena::scope_t scope;
+      p = gmp_arena::allocate(48);
+    }
+
+    chained_calls = 0;
+    gmp_arena::deallocate(p, 48);
+    EXPECT_EQ(chained_calls, 0ul);
+  }
+
+  gmp_arena::uninstall();
+  EXPECT_FALSE(gmp_arena::installed());
+
+  void* (*cur_alloc)(size_t) = nullptr;
+  void* (*cur_realloc)(void*, size_t, size_t) = nullptr;
+  void (*cur_free)(void*, size_t) = nullptr;
+  mp_get_memory_functions(&cur_alloc, &cur_realloc, &cur_free);
+
+  EXPECT_EQ(cur_alloc, counting_alloc);
+  EXPECT_EQ(cur_realloc, counting_realloc);
+  EXPECT_EQ(cur_free, counting_free);
+
+  mp_set_memory_functions(prev_alloc, prev_realloc, prev_free);
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "common.hpp"
+#include "falcon.hpp"
+#include "ntt.hpp"
+#include "prng.hpp"
+#include "prng_aes_ctr.hpp"
+#include "prng_background.hpp"
+#include "prng_chacha20.hpp"
+#include <array>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Given a PRNG, this routine ensures that reading N -many bytes in one go or
+// reading them in irregular sized chunks, produces same byte stream.
+template<prng::rng RNG>
+static void
+test_chunked_reads(RNG rng0, RNG rng1)
+{
+  constexpr size_t len = 4099;
+  constexpr size_t chunk_lens[]{ 1, 9, 40, 63, 64, 65, 127, 511, 513 };
+
+  std::vector<uint8_t> bytes0(len, 0);
+  std::vector<uint8_t> bytes1(len, 0);
+
+  rng0.read(bytes0.data(), bytes0.size());
+
+  size_t off = 0;
+  size_t i = 0;
+  while (off < len) {
+    const size_t clen_ = chunk_lens[i % std::size(chunk_lens)];
+    const size_t clen = std::min(clen_, len - off);
+    rng1.read(bytes1.data() + off, clen);
+
+    off += clen;
+    i++;
+  }
+
+  EXPECT_EQ(bytes0, bytes1);
+}
+
+// Test ChaCha20 based PRNG, using keystream block of section 2.3.2 of RFC 8439,
+// along with another keystream block produced by OpenSSL, for same key, such
+// that it's computed in second batch of 8 parallel blocks.
+TEST(Falcon, ChaCha20PRNGKnownAnswerTests)
+{
+  constexpr uint64_t nonce = 0x4a000000ul;
+  constexpr uint64_t ctr = (0x09000000ul << 32) | 1ul;
+
+  std::array<uint8_t, 32> key{};
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = static_cast<uint8_t>(i);
+  }
+
+  std::array<uint8_t, 64> block0{};
+  std::array<uint8_t, 64> block9{};
+  std::array<uint8_t, 64> expected0{};
+  std::array<uint8_t, 64> expected9{};
+
+  to_byte_array("10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c"
+                "4ed2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a250"
+                "3c4e",
+                expected0.data());
+  to_byte_array("426799a5cc38a8a49a8f0a4813494dd76c4bd3330a278a360a40a455da2341"
+                "7e1a600a2faacb382e82ba64ac71a02d4d477c21535024501bbf378276eb6d"
+                "6fdd",
+                expected9.data());
+
+  prng::chacha20_t rng(key.data(), nonce, ctr);
+
+  rng.read(block0.data(), block0.size());
+  for (size_t i = 1; i < 9; i++) {
+    rng.read(block9.data(), block9.size());
+  }
+  rng.read(block9.data(), block9.size());
+
+  EXPECT_EQ(block0, expected0);
+  EXPECT_EQ(block9, expected9);
+
+  test_chunked_reads(prng::chacha20_t(key.data()),
+                     prng::chacha20_t(key.data()));
+}
+
+#if defined __AES__ && defined __SSE2__
+
+// Test AES-256-CTR based PRNG, using key and initial counter block from section
+// F.5.5 of NIST SP 800-38A, while expected keystream blocks are produced by
+// OpenSSL.
+TEST(Falcon, AESCTRPRNGKnownAnswerTests)
+{
+  std::array<uint8_t, 32> key{};
+  std::array<uint8_t, 16> iv{};
+
+  to_byte_array(
+    "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4",
+    key.data());
+  to_byte_array("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv.data());
+
+  std::array<uint8_t, 32> blocks01{};
+  std::array<uint8_t, 16> block9{};
+  std::array<uint8_t, 16> block63{};
+  std::array<uint8_t, 32> expected01{};
+  std::array<uint8_t, 16> expected9{};
+  std::array<uint8_t, 16> expected63{};
+
+  to_byte_array("0bdf7df1591716335e9a8b15c860c5025a6e699d536119065433863c8f65"
+                "7b94",
+                expected01.data());
+  to_byte_array("9acc29a851e3710dcbeffd7512ee1e37", expected9.data());
+  to_byte_array("bde80b7a60c870bb1aa97992772e0328", expected63.data());
+
+  prng::aes_ctr_t rng(key.data(), iv.data());
+
+  rng.read(blocks01.data(), blocks01.size());
+  for (size_t i = 2; i < 9; i++) {
+    rng.read(block9.data(), block9.size());
+  }
+  rng.read(block9.data(), block9.size());
+  for (size_t i = 10; i < 63; i++) {
+    rng.read(block63.data(), block63.size());
+  }
+  rng.read(block63.data(), block63.size());
+
+  EXPECT_EQ(blocks01, expected01);
+  EXPECT_EQ(block9, expected9);
+  EXPECT_EQ(block63, expected63);
+
+  test_chunked_reads(prng::aes_ctr_t(key.data(), iv.data()),
+                     prng::aes_ctr_t(key.data(), iv.data()));
+}
+
+#endif
+
+// Test that background PRNG, wrapping a deterministically seeded ChaCha20 PRNG,
+// produces exactly same byte stream as ChaCha20 PRNG itself does, while bytes
+// are read in irregular sized chunks, wrapping around ring buffer many times.
+TEST(Falcon, BackgroundPRNG)
+{
+  constexpr size_t len = 1ul << 18;
+  constexpr size_t chunk_lens[]{ 1, 9, 40, 63, 64, 65, 127, 511, 513, 8193 };
+
+  std::array<uint8_t, 32> key{};
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = static_cast<uint8_t>(i);
+  }
+
+  std::vector<uint8_t> bytes0(len, 0);
+  std::vector<uint8_t> bytes1(len, 0);
+
+  prng::chacha20_t rng0(key.data());
+  prng::background_t<prng::chacha20_t, 4096> rng1(prng::chacha20_t{
+    key.data() });
+
+  rng0.read(bytes0.data(), bytes0.size());
+
+  size_t off = 0;
+  size_t i = 0;
+  while (off < len) {
+    const size_t clen_ = chunk_lens[i % std::size(chunk_lens)];
+    const size_t clen = std::min(clen_, len - off);
+    rng1.read(bytes1.data() + off, clen);
+
+    off += clen;
+    i++;
+  }
+
+  EXPECT_EQ(bytes0, bytes1);
+}
+
+// Generates Falcon{512, 1024} keypair and signs random messages, using a
+// specific PRNG for feeding key generation and signing, ensuring that signature
+// verification passes.
+template<const size_t N, prng::rng RNG>
+static void
+test_sign_verify_with_rng()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t mlen = 32;
+  constexpr size_t msgcnt = 8;
+
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr int32_t β2 = β2_values[N == 1024];
+
+  std::vector<fft::cmplx> B(2 * 2 * N);
+  std::vector<fft::cmplx> T(ftlen);
+  std::vector<ff::ff_t> h(N);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  RNG rng;
+
+  keygen::keygen<N>(B.data(), T.data(), h.data(), σ, rng);
+
+  bool verified = true;
+  for (size_t i = 0; i < msgcnt; i++) {
+    rng.read(msg.data(), msg.size());
+
+    const auto hptr = h.data();
+    const auto mptr = msg.data();
+    const auto sptr = sig.data();
+
+    falcon::sign<N>(B.data(), T.data(), mptr, mlen, sptr, rng);
+    verified &= verification::verify<N, β2>(hptr, mptr, mlen, sptr);
+  }
+
+  EXPECT_TRUE(verified);
+}
+
+TEST(Falcon, KeygenSignVerifyWithPluggableRNG)
+{
+  test_sign_verify_with_rng<ntt::FALCON512_N, prng::chacha20_t>();
+  test_sign_verify_with_rng<ntt::FALCON1024_N, prng::chacha20_t>();
+  test_sign_verify_with_rng<ntt::FALCON512_N, prng::background_t<>>();
+  test_sign_verify_with_rng<ntt::FALCON1024_N, prng::background_t<>>();
+
+#if defined __AES__ && defined __SSE2__
+  test_sign_verify_with_rng<ntt::FALCON512_N, prng::aes_ctr_t>();
+  test_sign_verify_with_rng<ntt::FALCON1024_N, prng::aes_ctr_t>();
+#endif
+}
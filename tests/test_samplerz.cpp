@@ -1,5 +1,8 @@
+#include "prng.hpp"
+#include "prng_chacha20.hpp"
 #include "samplerz.hpp"
 #include <gtest/gtest.h>
+#include <vector>
 
 // Generic struct for holding input and expected output of samplerZ routine,
 // targeting both Falcon512, Falcon1024 parameter sets.
@@ -15626,12 +15629,14 @@ const samplerz_kat_t falcon1024_samplerz_kats[]{
     220 }
 };
 
-// Test that samplerZ routine is correctly implemented using Falcon512 parameter
-// set and Known Answer Tests, submitted along with Falcon's NIST submission
-// package.
-TEST(Falcon, Falcon512SamplerZKnownAnswerTests)
+// Given Known Answer Tests of SamplerZ, this routine ensures that samplerZ,
+// when computing approximations of ccs * e^-x using given backend, consumes all
+// random bytes and samples expected z ∈ Z.
+template<const samplerz::exp_backend_t backend, const size_t kat_cnt>
+static void
+test_samplerz_kats(const samplerz_kat_t (&kats)[kat_cnt])
 {
-  for (auto kat : falcon512_samplerz_kats) {
+  for (auto kat : kats) {
     std::vector<uint8_t> rbytes(kat.rbytes.length() / 2, 0);
     to_byte_array(kat.rbytes, rbytes.data());
 
@@ -15641,31 +15646,248 @@ TEST(Falcon, Falcon512SamplerZKnownAnswerTests)
     const uint8_t* const data = rbytes.data();
     const size_t dlen = rbytes.size();
 
-    const auto [z, blen] = samplerz::samplerz(μ, σ_prime, σ_min, data, dlen);
+    const auto [z, blen] =
+      samplerz::samplerz<backend>(μ, σ_prime, σ_min, data, dlen);
 
     EXPECT_EQ(dlen, blen); // ensure all random bytes were consumed
     EXPECT_EQ(z, kat.z);   // ensure sampled z matches expected z ∈ Z
   }
 }
 
+// Test that samplerZ routine is correctly implemented using Falcon512 parameter
+// set and Known Answer Tests, submitted along with Falcon's NIST submission
+// package, with each of `approx_exp` backends.
+TEST(Falcon, Falcon512SamplerZKnownAnswerTests)
+{
+  using samplerz::exp_backend_t;
+
+  test_samplerz_kats<exp_backend_t::portable>(falcon512_samplerz_kats);
+#if __SIZEOF_INT128__ == 16
+  test_samplerz_kats<exp_backend_t::int128>(falcon512_samplerz_kats);
+#endif
+  test_samplerz_kats<exp_backend_t::fpr>(falcon512_samplerz_kats);
+}
+
 // Test that samplerZ routine is correctly implemented using Falcon1024
 // parameter set and Known Answer Tests, submitted along with Falcon's NIST
-// submission package.
+// submission package, with each of `approx_exp` backends.
 TEST(Falcon, Falcon1024SamplerZKnownAnswerTests)
 {
-  for (auto kat : falcon1024_samplerz_kats) {
-    std::vector<uint8_t> rbytes(kat.rbytes.length() / 2, 0);
-    to_byte_array(kat.rbytes, rbytes.data());
+  using samplerz::exp_backend_t;
 
-    const auto μ = kat.μ;
-    const auto σ_prime = kat.σ_prime;
-    const auto σ_min = kat.σ_min;
-    const uint8_t* const data = rbytes.data();
-    const size_t dlen = rbytes.size();
+  test_samplerz_kats<exp_backend_t::portable>(falcon1024_samplerz_kats);
+#if __SIZEOF_INT128__ == 16
+  test_samplerz_kats<exp_backend_t::int128>(falcon1024_samplerz_kats);
+#endif
+  test_samplerz_kats<exp_backend_t::fpr>(falcon1024_samplerz_kats);
+}
 
-    const auto [z, blen] = samplerz::samplerz(μ, σ_prime, σ_min, data, dlen);
+// Test that integer backends of `approx_exp` compute exactly same result, while
+// floating point backend stays within 2^-50 ( relative to 2^63 ) of those, for
+// random x ∈ [0, ln(2)] and ccs ∈ [0, 1]. Then ensure that samplerZ produces
+// same sequence of integers, with each backend, when fed with same randomness,
+// so they sample from same distribution.
+TEST(Falcon, ApproxExpBackends)
+{
+  using samplerz::exp_backend_t;
 
-    EXPECT_EQ(dlen, blen); // ensure all random bytes were consumed
-    EXPECT_EQ(z, kat.z);   // ensure sampled z matches expected z ∈ Z
+  constexpr size_t itr_cnt = 1ul << 16;
+  constexpr uint64_t max_diff = 1ul << 14;
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> x_dis(0., samplerz::LN2);
+  std::uniform_real_distribution<double> ccs_dis(0., 1.);
+
+  for (size_t i = 0; i < itr_cnt; i++) {
+    const double x = (i == 0) ? 0. : x_dis(gen);
+    const double ccs = (i == 0) ? 1. : ccs_dis(gen);
+
+    const uint64_t y0 = samplerz::approx_exp<exp_backend_t::portable>(x, ccs);
+    const uint64_t y2 = samplerz::approx_exp<exp_backend_t::fpr>(x, ccs);
+#if __SIZEOF_INT128__ == 16
+    const uint64_t y1 = samplerz::approx_exp<exp_backend_t::int128>(x, ccs);
+    EXPECT_EQ(y0, y1);
+#endif
+
+    // compare 64 -bit values, which Bernoulli-exp test compares against
+    const uint64_t z0 = 2 * y0 - 1;
+    const uint64_t z2 = 2 * y2 - 1;
+    EXPECT_LE(std::max(z0, z2) - std::min(z0, z2), max_diff);
+  }
+
+  std::array<uint8_t, 32> key{};
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = static_cast<uint8_t>(gen());
+  }
+
+  prng::chacha20_t rng0(key.data());
+  prng::chacha20_t rng1(key.data());
+
+  const auto leaf = samplerz::compute_leaf(1.5, samplerz::FALCON512_σ_min);
+  std::uniform_real_distribution<double> μ_dis(-128., 128.);
+
+  size_t mismatch_cnt = 0;
+  for (size_t i = 0; i < itr_cnt; i++) {
+    const double μ = μ_dis(gen);
+
+    const auto z0 = samplerz::samplerz<exp_backend_t::portable>(μ, leaf, rng0);
+    const auto z1 = samplerz::samplerz<exp_backend_t::fpr>(μ, leaf, rng1);
+    mismatch_cnt += z0 != z1;
+  }
+
+  EXPECT_EQ(mismatch_cnt, 0ul);
+}
+
+#if defined __AVX2__
+
+// Test that vectorized `approx_exp_x4` computes exactly same integral
+// approximation of 2^63 * ccs * e^-x, as scalar `approx_exp` does, for random
+// x ∈ [0, ln(2)] and ccs ∈ [0, 1], along with edges of both intervals.
+TEST(Falcon, VectorizedApproxExp)
+{
+  constexpr size_t itr_cnt = 1ul << 14;
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> x_dis(0., samplerz::LN2);
+  std::uniform_real_distribution<double> ccs_dis(0., 1.);
+
+  for (size_t itr = 0; itr < itr_cnt; itr++) {
+    alignas(32) double x[4];
+    alignas(32) double ccs[4];
+    alignas(32) uint64_t res[4];
+
+    for (size_t i = 0; i < 4; i++) {
+      x[i] = x_dis(gen);
+      ccs[i] = ccs_dis(gen);
+    }
+    if (itr == 0) {
+      x[0] = 0., x[1] = samplerz::LN2, x[2] = 1e-300, x[3] = 0.5;
+      ccs[0] = 1., ccs[1] = 0., ccs[2] = 1e-300, ccs[3] = 0.5;
+    }
+
+    const __m256i ccs_ = samplerz::scale_to_u63_x4(_mm256_load_pd(ccs));
+    const __m256i y = samplerz::approx_exp_x4(_mm256_load_pd(x), ccs_);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(res), y);
+
+    for (size_t i = 0; i < 4; i++) {
+      EXPECT_EQ(res[i], samplerz::approx_exp(x[i], ccs[i]));
+    }
+  }
+}
+
+#endif
+
+// Given center μ and standard deviation σ', this routine samples many integers
+// using batched SamplerZ, ensuring that empirical mean and variance of samples
+// are close to μ and σ'^2, respectively. Samples are requested in batches of
+// given size, so that lane refilling logic gets exercised.
+static void
+test_samplerz_batch(const double μ,
+                    const double σ_prime,
+                    const double σ_min,
+                    const size_t batch)
+{
+  constexpr size_t cnt = 1ul << 17;
+
+  const auto leaf = samplerz::compute_leaf(σ_prime, σ_min);
+
+  std::vector<double> μs(batch, μ);
+  std::vector<samplerz::leaf_t> leaves(batch, leaf);
+  std::vector<int32_t> z(batch);
+  prng::prng_t rng;
+
+  double sum = 0.;
+  double sq_sum = 0.;
+  size_t n = 0;
+
+  while (n < cnt) {
+    samplerz::samplerz_batch(μs.data(), leaves.data(), z.data(), batch, rng);
+
+    for (size_t i = 0; i < batch; i++) {
+      const double d = static_cast<double>(z[i]) - μ;
+
+      sum += d;
+      sq_sum += d * d;
+    }
+
+    n += batch;
+  }
+
+  const double mean = sum / static_cast<double>(n);
+  const double var = sq_sum / static_cast<double>(n) - mean * mean;
+
+  EXPECT_NEAR(mean, 0., 0.03);
+  EXPECT_NEAR(var / (σ_prime * σ_prime), 1., 0.03);
+}
+
+TEST(Falcon, BatchedSamplerZ)
+{
+  constexpr double σ_min = samplerz::FALCON512_σ_min;
+
+  test_samplerz_batch(0., σ_min, σ_min, 2);
+  test_samplerz_batch(-91.90471153063714, 1.7037990414754918, σ_min, 2);
+  test_samplerz_batch(15.780311008962793, 1.5, σ_min, 5);
+  test_samplerz_batch(0.5, samplerz::σ_max, σ_min, 64);
+}
+
+// Test that branch-free ( and vectorized, if AVX2 is available ) base sampler
+// computes same result as scalar walk over RCDT, using 72 -bit comparison, for
+// random samples, along with samples which are equal to or adjacent to RCDT
+// entries.
+TEST(Falcon, BranchFreeBaseSampler)
+{
+  auto expected = [](const u72::u72_t u) {
+    uint32_t z0 = 0u;
+    for (size_t i = 0; i < 18; i++) {
+      z0 += u < samplerz::RCDT[i];
+    }
+    return z0;
+  };
+
+  std::vector<u72::u72_t> samples;
+  for (size_t i = 0; i < std::size(samplerz::RCDT); i++) {
+    const auto r = samplerz::RCDT[i];
+
+    samples.push_back(r);
+    samples.push_back(r + u72::u72_t{ 0ul, 1ul });
+    samples.push_back(r - u72::u72_t{ 0ul, 1ul });
+    samples.push_back(u72::u72_t{ r.hi, 0ul });
+    samples.push_back(u72::u72_t{ r.hi, UINT64_MAX });
+  }
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  for (size_t i = 0; i < (1ul << 16); i++) {
+    samples.push_back(u72::u72_t{ gen() & 0xfful, gen() });
+  }
+
+  for (const auto u : samples) {
+    EXPECT_EQ(samplerz::base_sampler(u.lo, u.hi), expected(u));
+  }
+}
+
+// Test that batched SamplerZ, when asked for a single sample, consumes random
+// bytes exactly same way as scalar SamplerZ does, so that both produce same
+// output, for PRNGs in same state.
+TEST(Falcon, BatchedSamplerZMatchesScalar)
+{
+  constexpr double σ_min = samplerz::FALCON1024_σ_min;
+
+  uint8_t key[32]{};
+  prng::chacha20_t rng0(key);
+  prng::chacha20_t rng1(key);
+
+  std::mt19937_64 gen{ std::random_device{}() };
+  std::uniform_real_distribution<double> μ_dis(-256., 256.);
+  std::uniform_real_distribution<double> σ_dis(σ_min, samplerz::σ_max);
+
+  for (size_t i = 0; i < (1ul << 14); i++) {
+    const double μ = μ_dis(gen);
+    const auto leaf = samplerz::compute_leaf(σ_dis(gen), σ_min);
+
+    int32_t z1;
+    const int32_t z0 = samplerz::samplerz(μ, leaf, rng0);
+    samplerz::samplerz_batch(&μ, &leaf, &z1, 1, rng1);
+
+    EXPECT_EQ(z0, z1);
   }
 }
@@ -0,0 +1,346 @@
+#include "sign_daemon.hpp"
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#if defined __linux__
+
+// Generates random Falcon{512, 1024} keypair, runs signing daemon on a Unix
+// domain socket and lets a client sign many messages, with requests pipelined,
+// so that daemon can coalesce them. All signatures must verify, both locally
+// and using daemon, while tampered messages and invalid requests must be
+// rejected.
+template<const size_t N>
+void
+test_sign_daemon()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr uint32_t slot_cnt = 16;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  falcon::keygen<N>(pkey.data(), skey.data());
+
+  const std::string path = "/tmp/falcon-test-" + std::to_string(getpid()) +
+                           "-" + std::to_string(N) + ".sock";
+
+  sign_daemon::server_t<N> server;
+  EXPECT_TRUE(server.valid());
+  EXPECT_TRUE(server.add_key(pkey.data(), skey.data()));
+  ASSERT_TRUE(server.listen(path));
+
+  std::thread loop([&]() { server.run(); });
+
+  sign_daemon::client_t<N> client;
+  ASSERT_TRUE(client.connect(path, slot_cnt));
+
+  // pipelined sign requests, with messages written in place
+  prng::prng_t rng;
+  std::vector<uint64_t> ids(slot_cnt);
+
+  for (uint32_t i = 0; i < slot_cnt; i++) {
+    rng.read(client.msg(i), mlen);
+    EXPECT_TRUE(client.submit(sign_daemon::op_t::sign, 0, i, mlen, ids[i]));
+  }
+
+  for (uint32_t i = 0; i < slot_cnt; i++) {
+    sign_daemon::response_t resp;
+    ASSERT_TRUE(client.receive(resp));
+    ASSERT_LT(resp.slot, slot_cnt);
+
+    EXPECT_EQ(resp.id, ids[resp.slot]);
+    EXPECT_EQ(resp.ok, 1);
+  }
+
+  for (uint32_t i = 0; i < slot_cnt; i++) {
+    const auto msg = client.msg(i);
+    const auto sig = client.sig(i);
+
+    EXPECT_TRUE(falcon::verify<N>(pkey.data(), msg, mlen, sig));
+  }
+
+  // blocking sign and verify requests
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  rng.read(msg.data(), msg.size());
+
+  EXPECT_TRUE(client.sign(0, msg.data(), mlen, sig.data()));
+  EXPECT_TRUE(client.verify(0, msg.data(), mlen, sig.data()));
+  EXPECT_TRUE(falcon::verify<N>(pkey.data(), msg.data(), mlen, sig.data()));
+
+  msg[0] ^= 1;
+  EXPECT_FALSE(client.verify(0, msg.data(), mlen, sig.data()));
+
+  // requests using unknown key must be rejected
+  EXPECT_FALSE(client.sign(1, msg.data(), mlen, sig.data()));
+
+  EXPECT_GE(server.request_count(), slot_cnt + 3);
+  EXPECT_LE(server.batch_count(), server.request_count());
+
+  server.stop();
+  loop.join();
+}
+
+TEST(Falcon, SignDaemon)
+{
+  test_sign_daemon<ntt::FALCON512_N>();
+  test_sign_daemon<ntt::FALCON1024_N>();
+}
+
+// Checks that signing daemon, whose event loop can't be set up, because no
+// more file descriptors can be opened, reports so, instead of running. It's
+// done in a child process, so that file descriptor limit of test process isn't
+// touched.
+TEST(Falcon, SignDaemonWithoutFileDescriptors)
+{
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+
+  if (pid == 0) {
+    const rlimit lim{ 0, 0 };
+    if (setrlimit(RLIMIT_NOFILE, &lim) != 0) {
+      _exit(2);
+    }
+
+    sign_daemon::server_t<ntt::FALCON512_N> server;
+
+    const bool ok = !server.valid() && !server.listen("/tmp/falcon-nofd.sock");
+    server.run(); // must return right away
+
+    _exit(ok ? 0 : 1);
+  }
+
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+// Connects to daemon listening at given path and sends hello message of
+// `hlen` -bytes, declaring `slots` -many slots, along with a memfd, named
+// `name`, of that many slots, which is sealed against shrinking, only if
+// asked to. Returns connected socket.
+template<const size_t N>
+static int
+raw_hello(const std::string& path,
+          const char* const name,
+          const uint32_t slots,
+          const size_t hlen,
+          const bool seal)
+{
+  const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.data(), path.size());
+
+  const auto saddr = reinterpret_cast<const sockaddr*>(&addr);
+  if (connect(fd, saddr, sizeof(addr)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  const int memfd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  const auto len = static_cast<off_t>(slots * sign_daemon::slot_len<N>());
+  EXPECT_EQ(ftruncate(memfd, len), 0);
+  if (seal) {
+    EXPECT_EQ(fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK), 0);
+  }
+
+  sign_daemon::hello_t hello{ slots };
+  iovec iov{ &hello, hlen };
+
+  alignas(cmsghdr) uint8_t ctrl[CMSG_SPACE(sizeof(int))]{};
+  msghdr msg{};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+
+  cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(memfd));
+
+  EXPECT_EQ(sendmsg(fd, &msg, MSG_NOSIGNAL), static_cast<ssize_t>(hlen));
+  close(memfd);
+
+  return fd;
+}
+
+// Whether a memfd, with given name, is still open in this process
+static bool
+memfd_open(const std::string& name)
+{
+  for (const auto& e : std::filesystem::directory_iterator("/proc/self/fd")) {
+    std::error_code ec;
+    const auto target = std::filesystem::read_symlink(e.path(), ec);
+
+    if (!ec && target.string().find("memfd:" + name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether daemon closed connection on given socket, within a few seconds,
+// without having sent any response
+static bool
+dropped(const int fd)
+{
+  const timeval timeout{ 5, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  sign_daemon::response_t resp;
+  return recv(fd, &resp, sizeof(resp), 0) == 0;
+}
+
+// Checks that socket of signing daemon is only accessible by its owner, that
+// live sockets and other files at its path aren't replaced, while stale ones
+// are, and that clients are dropped, when they aren't allowed to connect, send
+// malformed hello, share memory which isn't sealed against shrinking or don't
+// read responses.
+TEST(Falcon, SignDaemonAccessControl)
+{
+  constexpr size_t N = ntt::FALCON512_N;
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  falcon::keygen<N>(pkey.data(), skey.data());
+
+  const std::string path =
+    "/tmp/falcon-test-" + std::to_string(getpid()) + "-acl.sock";
+
+  // regular file at path is never replaced
+  std::ofstream(path) << "not a socket";
+  {
+    sign_daemon::server_t<N> server;
+    EXPECT_FALSE(server.listen(path));
+  }
+  EXPECT_TRUE(std::filesystem::is_regular_file(path));
+  unlink(path.c_str());
+
+  // stale socket at path is replaced
+  {
+    const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.data(), path.size());
+
+    const auto saddr = reinterpret_cast<const sockaddr*>(&addr);
+    EXPECT_EQ(bind(fd, saddr, sizeof(addr)), 0);
+    close(fd);
+  }
+
+  sign_daemon::server_t<N> server;
+  EXPECT_TRUE(server.add_key(pkey.data(), skey.data()));
+  ASSERT_TRUE(server.listen(path));
+
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 0777, 0600u);
+
+  // live socket at path is never replaced
+  {
+    sign_daemon::server_t<N> other;
+    EXPECT_FALSE(other.listen(path));
+  }
+
+  std::thread loop([&]() { server.run(); });
+
+  std::vector<uint8_t> msg(32);
+  std::vector<uint8_t> sig(falcon_utils::compute_sig_len<N>());
+
+  // memfd, which isn't sealed against shrinking, is refused
+  {
+    const int fd = raw_hello<N>(path, "falcon-unsealed", 4, 4, false);
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(dropped(fd));
+    close(fd);
+  }
+
+  // memfd, sent along with malformed hello, is closed by daemon
+  {
+    const int fd = raw_hello<N>(path, "falcon-malformed", 4, 2, true);
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(dropped(fd));
+    close(fd);
+
+    EXPECT_FALSE(memfd_open("falcon-malformed"));
+  }
+
+  // client, which doesn't read responses, is dropped, once more than one
+  // response per slot piles up
+  {
+    sign_daemon::client_t<N> client;
+    ASSERT_TRUE(client.connect(path, 1));
+
+    // enough requests to fill up socket buffers, for which daemon must
+    // queue responses
+    constexpr size_t req_cnt = 1ul << 20;
+
+    size_t sent = 0;
+    for (uint64_t id = 0; sent < req_cnt; sent++) {
+      if (!client.submit(sign_daemon::op_t::sign, 7, 0, 0, id)) {
+        break;
+      }
+    }
+    ASSERT_LT(sent, req_cnt);
+
+    size_t received = 0;
+    sign_daemon::response_t resp;
+    while (client.receive(resp)) {
+      EXPECT_EQ(resp.ok, 0);
+      received++;
+    }
+
+    EXPECT_LT(received, sent);
+  }
+
+  // well behaved client is still served
+  {
+    sign_daemon::client_t<N> client;
+    ASSERT_TRUE(client.connect(path, 1));
+    EXPECT_TRUE(client.sign(0, msg.data(), msg.size(), sig.data()));
+  }
+
+  server.stop();
+  loop.join();
+
+  // peers, which aren't allowed, are dropped right away
+  const std::string strict_path =
+    "/tmp/falcon-test-" + std::to_string(getpid()) + "-strict.sock";
+
+  sign_daemon::server_t<N> strict;
+  EXPECT_TRUE(strict.add_key(pkey.data(), skey.data()));
+  strict.allow({ geteuid() + 1 });
+  ASSERT_TRUE(strict.listen(strict_path));
+
+  std::thread strict_loop([&]() { strict.run(); });
+
+  {
+    sign_daemon::client_t<N> client;
+    if (client.connect(strict_path, 1)) {
+      EXPECT_FALSE(client.sign(0, msg.data(), msg.size(), sig.data()));
+    }
+  }
+
+  strict.stop();
+  strict_loop.join();
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include "sign_engine.hpp"
+#include <gtest/gtest.h>
+#include <latch>
+#include <thread>
+#include <vector>
+
+// Test if bounded MPMC queue neither loses nor duplicates elements, when many
+// producers and consumers use it at once, while also ensuring that it refuses
+// to accept more elements, than it can hold.
+TEST(Falcon, MPMCQueue)
+{
+  constexpr size_t cap = 64;
+  constexpr size_t thread_cnt = 4;
+  constexpr size_t per_thread = 1ul << 14;
+
+  sign_engine::mpmc_queue_t<size_t, cap> queue;
+
+  for (size_t i = 0; i < cap; i++) {
+    EXPECT_TRUE(queue.try_push(size_t{ i }));
+  }
+  EXPECT_FALSE(queue.try_push(size_t{ cap }));
+
+  for (size_t i = 0; i < cap; i++) {
+    size_t v = 0;
+    EXPECT_TRUE(queue.try_pop(v));
+    EXPECT_EQ(v, i);
+  }
+
+  size_t v = 0;
+  EXPECT_FALSE(queue.try_pop(v));
+
+  std::vector<size_t> sums(thread_cnt, 0);
+  std::vector<size_t> cnts(thread_cnt, 0);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < thread_cnt; t++) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < per_thread; i++) {
+        size_t e = t * per_thread + i;
+        while (!queue.try_push(std::move(e))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&, t]() {
+      while (cnts[t] < per_thread) {
+        size_t e = 0;
+        if (queue.try_pop(e)) {
+          sums[t] += e;
+          cnts[t]++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  constexpr size_t total = thread_cnt * per_thread;
+
+  size_t sum = 0;
+  for (const auto s : sums) {
+    sum += s;
+  }
+
+  EXPECT_EQ(sum, (total * (total - 1)) / 2);
+  EXPECT_FALSE(queue.try_pop(v));
+}
+
+// Test if latency histogram reports percentiles within its relative error
+// bound ( = 1/16 ).
+TEST(Falcon, LatencyHistogram)
+{
+  sign_engine::histogram_t hist;
+  EXPECT_EQ(hist.percentile(.5), 0ul);
+
+  for (uint64_t v = 1; v <= 100000; v++) {
+    hist.record(v);
+  }
+
+  EXPECT_EQ(hist.count(), 100000ul);
+
+  const double expected[]{ 50000., 99000., 99900. };
+  const uint64_t computed[]{ hist.percentile(.5),
+                             hist.percentile(.99),
+                             hist.percentile(.999) };
+
+  for (size_t i = 0; i < 3; i++) {
+    EXPECT_GE(static_cast<double>(computed[i]), expected[i]);
+    EXPECT_LE(static_cast<double>(computed[i]), expected[i] * (1. + 1. / 16));
+  }
+
+  hist.reset();
+  EXPECT_EQ(hist.count(), 0ul);
+}
+
+// Generates two random Falcon{512, 1024} keypairs, adds them to signing engine
+// and signs random messages from many threads at once, with both futures and
+// callbacks, s.t. all signatures must verify and engine must account for each
+// of them.
+template<const size_t N>
+void
+test_sign_engine()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t thread_cnt = 4;
+  constexpr size_t msg_cnt = 8;
+  constexpr size_t total = thread_cnt * msg_cnt * 2;
+
+  std::vector<uint8_t> pkeys(2 * pklen);
+  std::vector<uint8_t> skeys(2 * sklen);
+
+  falcon::keygen<N>(pkeys.data(), skeys.data());
+  falcon::keygen<N>(pkeys.data() + pklen, skeys.data() + sklen);
+
+  sign_engine::engine_t<N> engine(3);
+
+  size_t key_ids[2]{};
+  EXPECT_TRUE(engine.add_key(skeys.data(), key_ids[0]));
+  EXPECT_TRUE(engine.add_key(skeys.data() + sklen, key_ids[1]));
+  EXPECT_EQ(engine.worker_count(), 3ul);
+
+  std::vector<uint8_t> msgs(total * mlen);
+  std::vector<uint8_t> sigs(total * siglen);
+  std::vector<uint8_t> verified(total, 0);
+
+  prng::prng_t rng;
+  rng.read(msgs.data(), msgs.size());
+
+  std::latch done(thread_cnt * msg_cnt);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < thread_cnt; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<std::future<bool>> futs;
+
+      for (size_t i = 0; i < msg_cnt; i++) {
+        const size_t idx = (t * msg_cnt + i) * 2;
+        const size_t kidx = i & 1ul;
+
+        const auto m0 = msgs.data() + idx * mlen;
+        const auto s0 = sigs.data() + idx * siglen;
+        futs.push_back(engine.sign(key_ids[kidx], m0, mlen, s0));
+
+        const auto m1 = m0 + mlen;
+        const auto s1 = s0 + siglen;
+        const auto p1 = pkeys.data() + (kidx ^ 1ul) * pklen;
+        const auto cb = [&, idx, m1, s1, p1](bool ok) {
+          const bool v = falcon::verify<N>(p1, m1, mlen, s1);
+          verified[idx + 1] = ok && v;
+          done.count_down();
+        };
+        engine.sign(key_ids[kidx ^ 1ul], m1, mlen, s1, cb);
+      }
+
+      for (size_t i = 0; i < msg_cnt; i++) {
+        const size_t idx = (t * msg_cnt + i) * 2;
+        const size_t kidx = i & 1ul;
+
+        const auto m0 = msgs.data() + idx * mlen;
+        const auto s0 = sigs.data() + idx * siglen;
+        const auto p0 = pkeys.data() + kidx * pklen;
+
+        const bool ok = futs[i].get();
+        verified[idx] = ok && falcon::verify<N>(p0, m0, mlen, s0);
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done.wait();
+
+  for (const auto v : verified) {
+    EXPECT_TRUE(v);
+  }
+
+  // requests using unknown key must be rejected
+  uint8_t sig[siglen];
+  EXPECT_FALSE(engine.sign(2, msgs.data(), mlen, sig).get());
+  EXPECT_FALSE(engine.sign(2, msgs.data(), mlen, sig, [](bool) {}));
+
+  const auto stats = engine.stats();
+  EXPECT_EQ(stats.submitted, total);
+  EXPECT_EQ(stats.completed, total);
+  EXPECT_GT(stats.throughput, 0.);
+  EXPECT_GT(stats.p50_ns, 0ul);
+  EXPECT_LE(stats.p50_ns, stats.p99_ns);
+  EXPECT_LE(stats.p99_ns, stats.p999_ns);
+
+  engine.reset_stats();
+  EXPECT_EQ(engine.stats().completed, 0ul);
+}
+
+TEST(Falcon, SignEngine)
+{
+  test_sign_engine<ntt::FALCON512_N>();
+  test_sign_engine<ntt::FALCON1024_N>();
+}
@@ -2,7 +2,16 @@
 #include "falcon.hpp"
 #include "ntt.hpp"
 #include "prng.hpp"
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+#if defined __unix__
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 // Generates random Falcon{512, 1024} keypair, takes random message bytes of
 // length ∈ [0, 1024), signs message and attempts to verify - all should work.
@@ -46,3 +55,382 @@ TEST(Falcon, KeygenSignVerify)
   test_keygen_sign_verify<ntt::FALCON512_N>();
   test_keygen_sign_verify<ntt::FALCON1024_N>();
 }
+
+// Generates random Falcon{512, 1024} keypair, signs a batch of random messages
+// ( of varying length ) using 4-way batch signing API and verifies them using
+// batch verification API, while also ensuring that a tampered signature doesn't
+// pass batch verification.
+template<const size_t N>
+void
+test_sign_verify_batch()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t count = 11; // = 2 batches of 4 + 3 remaining messages
+
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+
+  std::vector<fft::cmplx> B(2 * 2 * N);
+  std::vector<fft::cmplx> T(ftlen);
+  std::vector<ff::ff_t> h(N);
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<std::vector<uint8_t>> msg(count);
+  std::vector<std::vector<uint8_t>> sig(count);
+  std::vector<const uint8_t*> msgs(count);
+  std::vector<size_t> mlens(count);
+  std::vector<uint8_t*> sigs(count);
+  std::vector<const uint8_t*> csigs(count);
+  bool res[count];
+  prng::prng_t rng;
+
+  keygen::keygen<N>(B.data(), T.data(), h.data(), σ, rng);
+  encoding::encode_pkey<N>(h.data(), pkey.data());
+
+  for (size_t i = 0; i < count; i++) {
+    msg[i].resize(i * 37);
+    sig[i].resize(siglen);
+    rng.read(msg[i].data(), msg[i].size());
+
+    msgs[i] = msg[i].data();
+    mlens[i] = msg[i].size();
+    sigs[i] = sig[i].data();
+    csigs[i] = sig[i].data();
+  }
+
+  const auto m = msgs.data();
+  const auto ml = mlens.data();
+
+  falcon::sign_batch<N>(B.data(), T.data(), m, ml, sigs.data(), count, rng);
+
+  const bool decoded =
+    falcon::verify_batch<N>(pkey.data(), m, ml, csigs.data(), res, count);
+  EXPECT_TRUE(decoded);
+
+  for (size_t i = 0; i < count; i++) {
+    EXPECT_TRUE(res[i]);
+    EXPECT_TRUE(falcon::verify<N>(pkey.data(), m[i], ml[i], sigs[i]));
+  }
+
+  // Tamper with first byte of salt, of a signature in first batch and of one,
+  // which is verified one by one
+  sig[1][1] ^= 1;
+  sig[9][1] ^= 1;
+
+  falcon::verify_batch<N>(pkey.data(), m, ml, csigs.data(), res, count);
+
+  for (size_t i = 0; i < count; i++) {
+    EXPECT_EQ(res[i], (i != 1) && (i != 9));
+  }
+}
+
+TEST(Falcon, SignVerifyBatch)
+{
+  test_sign_verify_batch<ntt::FALCON512_N>();
+  test_sign_verify_batch<ntt::FALCON1024_N>();
+}
+
+// Generates random Falcon{512, 1024} keypair, signs a large random message,
+// which is fed in chunks, using streaming signing API and verifies it using
+// both streaming and regular verification API, while also ensuring that a
+// tampered message doesn't pass streaming verification.
+template<const size_t N>
+void
+test_sign_verify_stream()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t mlen = 1ul << 20;
+  constexpr size_t chunk_len = 1000;
+
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr double σ = σ_values[N == 1024];
+
+  std::vector<fft::cmplx> B(2 * 2 * N);
+  std::vector<fft::cmplx> T(ftlen);
+  std::vector<ff::ff_t> h(N);
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig(siglen);
+  prng::prng_t rng;
+
+  keygen::keygen<N>(B.data(), T.data(), h.data(), σ, rng);
+  encoding::encode_pkey<N>(h.data(), pkey.data());
+  rng.read(msg.data(), msg.size());
+
+  size_t off = 0;
+  auto read = [&](uint8_t* const bytes, const size_t len) -> ptrdiff_t {
+    const size_t clen = std::min({ chunk_len, len, mlen - off });
+
+    std::copy_n(msg.begin() + off, clen, bytes);
+    off += clen;
+
+    return static_cast<ptrdiff_t>(clen);
+  };
+
+  // reader failing midway, must fail both signing and verification
+  size_t calls = 0;
+  auto failing = [&](uint8_t* const bytes, const size_t len) -> ptrdiff_t {
+    if (calls++ == 3) {
+      return -1;
+    }
+    return read(bytes, len);
+  };
+
+  const auto Bp = B.data();
+  const auto Tp = T.data();
+  const auto sp = sig.data();
+
+  EXPECT_FALSE(falcon::sign_stream<N>(Bp, Tp, failing, sp, rng));
+  EXPECT_TRUE(std::all_of(sig.begin(), sig.end(), [](auto v) { return !v; }));
+
+  off = 0;
+  EXPECT_TRUE(falcon::sign_stream<N>(Bp, Tp, read, sp, rng));
+
+  off = 0;
+  EXPECT_TRUE(falcon::verify_stream<N>(pkey.data(), read, sig.data()));
+  EXPECT_TRUE(falcon::verify<N>(pkey.data(), msg.data(), mlen, sig.data()));
+
+  msg[mlen - 1] ^= 1;
+
+  off = 0;
+  EXPECT_FALSE(falcon::verify_stream<N>(pkey.data(), read, sig.data()));
+
+  msg[mlen - 1] ^= 1;
+
+  off = 0;
+  calls = 0;
+  EXPECT_FALSE(falcon::verify_stream<N>(pkey.data(), failing, sig.data()));
+}
+
+TEST(Falcon, SignVerifyStream)
+{
+  test_sign_verify_stream<ntt::FALCON512_N>();
+  test_sign_verify_stream<ntt::FALCON1024_N>();
+}
+
+// Generates two random Falcon{512, 1024} keypairs and signs random messages
+// from many threads at once, using one-shot signing API, s.t. each thread keeps
+// switching between two secret keys, so that its signing context has to reload
+// secret key, while all signatures must still verify.
+template<const size_t N>
+void
+test_sign_verify_thread_context()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t thread_cnt = 4;
+  constexpr size_t msg_cnt = 8;
+
+  std::vector<uint8_t> pkeys(2 * pklen);
+  std::vector<uint8_t> skeys(2 * sklen);
+
+  falcon::keygen<N>(pkeys.data(), skeys.data());
+  falcon::keygen<N>(pkeys.data() + pklen, skeys.data() + sklen);
+
+  std::vector<uint8_t> verified(thread_cnt * msg_cnt, 0);
+  std::vector<std::thread> threads;
+
+  for (size_t t = 0; t < thread_cnt; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<uint8_t> msg(mlen);
+      std::vector<uint8_t> sig(siglen);
+      prng::prng_t rng;
+
+      for (size_t i = 0; i < msg_cnt; i++) {
+        const size_t kidx = (t + i) & 1ul;
+        const auto pkey = pkeys.data() + kidx * pklen;
+        const auto skey = skeys.data() + kidx * sklen;
+
+        rng.read(msg.data(), msg.size());
+
+        const auto mptr = msg.data();
+        const auto sptr = sig.data();
+
+        const bool _signed = falcon::sign<N>(skey, mptr, mlen, sptr);
+        const bool _verified = falcon::verify<N>(pkey, mptr, mlen, sptr);
+
+        verified[t * msg_cnt + i] = _signed && _verified;
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto v : verified) {
+    EXPECT_TRUE(v);
+  }
+}
+
+TEST(Falcon, SignVerifyWithThreadContext)
+{
+  test_sign_verify_thread_context<ntt::FALCON512_N>();
+  test_sign_verify_thread_context<ntt::FALCON1024_N>();
+}
+
+#if defined __unix__
+// Signs same message, using one-shot signing API, both in parent and in forked
+// child process, after parent's signing context is already seeded, ensuring
+// that child's signing context is seeded again i.e. both signatures, though
+// valid, don't share same salt.
+template<const size_t N>
+void
+test_sign_thread_context_after_fork()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr size_t pklen = falcon_utils::compute_pkey_len<N>();
+  constexpr size_t sklen = falcon_utils::compute_skey_len<N>();
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+
+  std::vector<uint8_t> pkey(pklen);
+  std::vector<uint8_t> skey(sklen);
+  std::vector<uint8_t> msg(mlen);
+  std::vector<uint8_t> sig0(siglen);
+  std::vector<uint8_t> sig1(siglen);
+  std::vector<uint8_t> sig2(siglen);
+  prng::prng_t rng;
+
+  falcon::keygen<N>(pkey.data(), skey.data());
+  rng.read(msg.data(), msg.size());
+
+  const auto sptr = skey.data();
+  const auto mptr = msg.data();
+
+  EXPECT_TRUE(falcon::sign<N>(sptr, mptr, mlen, sig0.data()));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+
+  if (pid == 0) {
+    falcon::sign<N>(sptr, mptr, mlen, sig1.data());
+    const ssize_t n = write(fds[1], sig1.data(), sig1.size());
+    _exit(n == static_cast<ssize_t>(sig1.size()) ? 0 : 1);
+  }
+
+  EXPECT_TRUE(falcon::sign<N>(sptr, mptr, mlen, sig2.data()));
+
+  size_t off = 0;
+  while (off < siglen) {
+    const ssize_t n = read(fds[0], sig1.data() + off, siglen - off);
+    if (n <= 0) {
+      break;
+    }
+    off += static_cast<size_t>(n);
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  close(fds[0]);
+  close(fds[1]);
+
+  ASSERT_EQ(off, siglen);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  EXPECT_TRUE(falcon::verify<N>(pkey.data(), mptr, mlen, sig1.data()));
+  EXPECT_TRUE(falcon::verify<N>(pkey.data(), mptr, mlen, sig2.data()));
+  EXPECT_NE(sig1, sig2);
+}
+
+TEST(Falcon, SignWithThreadContextAfterFork)
+{
+  test_sign_thread_context_after_fork<ntt::FALCON512_N>();
+  test_sign_thread_context_after_fork<ntt::FALCON1024_N>();
+}
+#endif
+
+// Generates random Falcon{512, 1024} keypair and signs random messages, using
+// workspace taking signing API, on a thread with only 64 KB of stack, while
+// ensuring that signatures are same as the ones produced by signing API, which
+// allocates scratch space on stack, when both are fed with same random byte
+// stream, and that they verify.
+template<const size_t N>
+void
+test_sign_verify_small_stack()
+  requires((N == 512) || (N == 1024))
+{
+  constexpr double σ_values[]{ 165.736617183, 168.388571447 };
+  constexpr int32_t β2_values[]{ 34034726, 70265242 };
+  constexpr double σ = σ_values[N == 1024];
+  constexpr int32_t β2 = β2_values[N == 1024];
+  constexpr size_t ftlen = (1ul << log2<N>()) * (log2<N>() + 1);
+  constexpr size_t siglen = falcon_utils::compute_sig_len<N>();
+  constexpr size_t mlen = 32;
+  constexpr size_t msg_cnt = 8;
+  constexpr size_t stack_len = 1ul << 16;
+
+  struct ctx_t
+  {
+    std::vector<fft::cmplx> B = std::vector<fft::cmplx>(2 * 2 * N);
+    std::vector<fft::cmplx> T = std::vector<fft::cmplx>(ftlen);
+    std::vector<ff::ff_t> h = std::vector<ff::ff_t>(N);
+    std::vector<uint8_t> msgs = std::vector<uint8_t>(msg_cnt * mlen);
+    std::vector<uint8_t> sigs = std::vector<uint8_t>(msg_cnt * siglen);
+    uint8_t seed[prng::chacha20_t::KEY_LEN];
+  } ctx;
+
+  prng::prng_t rng;
+  keygen::keygen<N>(ctx.B.data(), ctx.T.data(), ctx.h.data(), σ, rng);
+  rng.read(ctx.msgs.data(), ctx.msgs.size());
+  rng.read(ctx.seed, sizeof(ctx.seed));
+
+  // signs all messages, with workspace taking API, on a thread with 64 KB stack
+  const auto sign_all = [](void* arg) -> void* {
+    auto& ctx = *static_cast<ctx_t*>(arg);
+
+    constexpr size_t wslen = signing::sign_ws_len<N>();
+    auto ws = static_cast<uint8_t*>(std::aligned_alloc(64, wslen));
+    prng::chacha20_t rng(ctx.seed);
+
+    for (size_t i = 0; i < msg_cnt; i++) {
+      const auto msg = ctx.msgs.data() + i * mlen;
+      const auto sig = ctx.sigs.data() + i * siglen;
+
+      falcon::sign_ws<N>(
+        ctx.B.data(), ctx.T.data(), msg, mlen, sig, { ws, wslen }, rng);
+    }
+
+    std::free(ws);
+    return nullptr;
+  };
+
+  pthread_attr_t attr;
+  pthread_t thread;
+
+  ASSERT_EQ(pthread_attr_init(&attr), 0);
+  ASSERT_EQ(pthread_attr_setstacksize(&attr, stack_len), 0);
+  ASSERT_EQ(pthread_create(&thread, &attr, sign_all, &ctx), 0);
+  ASSERT_EQ(pthread_join(thread, nullptr), 0);
+  pthread_attr_destroy(&attr);
+
+  std::vector<uint8_t> sig(siglen);
+  prng::chacha20_t rng_(ctx.seed);
+
+  for (size_t i = 0; i < msg_cnt; i++) {
+    const auto msg = ctx.msgs.data() + i * mlen;
+    const auto sig_ = ctx.sigs.data() + i * siglen;
+
+    falcon::sign<N>(ctx.B.data(), ctx.T.data(), msg, mlen, sig.data(), rng_);
+
+    EXPECT_TRUE(std::equal(sig.begin(), sig.end(), sig_));
+    EXPECT_TRUE((verification::verify<N, β2>(ctx.h.data(), msg, mlen, sig_)));
+  }
+}
+
+TEST(Falcon, SignVerifyOnSmallStack)
+{
+  test_sign_verify_small_stack<ntt::FALCON512_N>();
+  test_sign_verify_small_stack<ntt::FALCON1024_N>();
+}